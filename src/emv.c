@@ -2,7 +2,7 @@
  * @file emv.c
  * @brief High level EMV library interface
  *
- * Copyright 2023-2025 Leon Lynch
+ * Copyright 2023-2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -25,10 +25,14 @@
 #include "emv_tal.h"
 #include "emv_app.h"
 #include "emv_dol.h"
+#include "emv_config.h"
 #include "emv_tags.h"
 #include "emv_fields.h"
 #include "emv_oda.h"
 #include "emv_date.h"
+#include "emv_metrics.h"
+#include "emv_rand.h"
+#include "emv_txn_log.h"
 
 #include "iso7816.h"
 
@@ -36,7 +40,6 @@
 #include "emv_debug.h"
 
 #include "crypto_mem.h"
-#include "crypto_rand.h"
 
 #include <stddef.h>
 #include <stdint.h>
@@ -89,18 +92,46 @@ int emv_ctx_reset(struct emv_ctx_t* ctx)
 	ctx->aip = NULL;
 	ctx->afl = NULL;
 
+	if (ctx->metrics) {
+		emv_metrics_reset(ctx->metrics);
+	}
+
+	return 0;
+}
+
+int emv_ctx_set_config(struct emv_ctx_t* ctx, struct emv_config_t* config)
+{
+	struct emv_config_t* prev;
+
+	if (!ctx) {
+		return EMV_ERROR_INVALID_PARAMETER;
+	}
+
+	// The shared configuration is only consulted as an additional read-only
+	// source and therefore the context's own lists are left untouched
+	prev = ctx->shared_config;
+	ctx->shared_config = emv_config_ref(config);
+	emv_config_unref(prev);
+
 	return 0;
 }
 
 int emv_ctx_clear(struct emv_ctx_t* ctx)
 {
+	struct emv_ttl_ext_t* ttl_ext;
+
 	if (!ctx) {
 		return EMV_ERROR_INVALID_PARAMETER;
 	}
 
+	ttl_ext = emv_ttl_ext_get(ctx->ttl);
+	if (ttl_ext) {
+		ttl_ext->metrics = NULL;
+	}
 	ctx->ttl = NULL;
 	emv_tlv_list_clear(&ctx->config);
 	emv_tlv_list_clear(&ctx->supported_aids);
+	emv_ctx_set_config(ctx, NULL);
 	emv_ctx_reset(ctx);
 
 	return 0;
@@ -346,12 +377,36 @@ int emv_atr_parse(const void* atr, size_t atr_len)
 	return 0;
 }
 
-int emv_build_candidate_list(
+static struct emv_metrics_t* emv_ctx_metrics_begin(
+	const struct emv_ctx_t* ctx,
+	struct emv_metrics_mark_t* mark
+)
+{
+	struct emv_ttl_ext_t* ttl_ext;
+
+	if (!ctx) {
+		return NULL;
+	}
+
+	// Ensure that the TTL extension, if attached, accounts for card I/O
+	// according to the current metrics of the EMV processing context
+	ttl_ext = emv_ttl_ext_get(ctx->ttl);
+	if (ttl_ext) {
+		ttl_ext->metrics = ctx->metrics;
+	}
+
+	emv_metrics_step_begin(ctx->metrics, mark);
+	return ctx->metrics;
+}
+
+static int emv_build_candidate_list_internal(
 	const struct emv_ctx_t* ctx,
 	struct emv_app_list_t* app_list
 )
 {
 	int r;
+	const struct emv_tlv_list_t* supported_aids;
+	const struct emv_aid_trie_t* supported_aid_trie;
 
 	if (!ctx || !app_list) {
 		emv_debug_trace_msg("ctx=%p, app_list=%p", ctx, app_list);
@@ -359,10 +414,25 @@ int emv_build_candidate_list(
 		return EMV_ERROR_INVALID_PARAMETER;
 	}
 
+	// Use the supported AIDs of the shared configuration, and its AID prefix
+	// trie, unless the context provides its own
+	if (emv_tlv_list_is_empty(&ctx->supported_aids) && ctx->shared_config) {
+		supported_aids = emv_config_get_supported_aids(ctx->shared_config);
+		supported_aid_trie = emv_config_get_supported_aid_trie(ctx->shared_config);
+	} else {
+		supported_aids = &ctx->supported_aids;
+		supported_aid_trie = NULL;
+	}
+
 	emv_debug_info("Select Payment System Environment (PSE)");
-	r = emv_tal_read_pse(ctx->ttl, &ctx->supported_aids, app_list);
+	r = emv_tal_read_pse_with_trie(
+		ctx->ttl,
+		supported_aids,
+		supported_aid_trie,
+		app_list
+	);
 	if (r < 0) {
-		emv_debug_trace_msg("emv_tal_read_pse() failed; r=%d", r);
+		emv_debug_trace_msg("emv_tal_read_pse_with_trie() failed; r=%d", r);
 		emv_debug_error("Failed to read PSE; terminate session");
 		if (r == EMV_TAL_ERROR_CARD_BLOCKED) {
 			return EMV_OUTCOME_CARD_BLOCKED;
@@ -371,7 +441,7 @@ int emv_build_candidate_list(
 		}
 	}
 	if (r > 0) {
-		emv_debug_trace_msg("emv_tal_read_pse() failed; r=%d", r);
+		emv_debug_trace_msg("emv_tal_read_pse_with_trie() failed; r=%d", r);
 		emv_debug_info("Failed to process PSE; continue session");
 	}
 
@@ -379,7 +449,7 @@ int emv_build_candidate_list(
 	// See EMV 4.4 Book 1, 12.3.2, step 5
 	if (emv_app_list_is_empty(app_list)) {
 		emv_debug_info("Discover list of AIDs");
-		r = emv_tal_find_supported_apps(ctx->ttl, &ctx->supported_aids, app_list);
+		r = emv_tal_find_supported_apps(ctx->ttl, supported_aids, app_list);
 		if (r) {
 			emv_debug_trace_msg("emv_tal_find_supported_apps() failed; r=%d", r);
 			emv_debug_error("Failed to find supported AIDs; terminate session");
@@ -410,7 +480,23 @@ int emv_build_candidate_list(
 	return 0;
 }
 
-int emv_select_application(
+int emv_build_candidate_list(
+	const struct emv_ctx_t* ctx,
+	struct emv_app_list_t* app_list
+)
+{
+	int r;
+	struct emv_metrics_mark_t mark;
+	struct emv_metrics_t* metrics;
+
+	metrics = emv_ctx_metrics_begin(ctx, &mark);
+	r = emv_build_candidate_list_internal(ctx, app_list);
+	emv_metrics_step_end(metrics, EMV_METRICS_STEP_BUILD_CANDIDATE_LIST, &mark);
+
+	return r;
+}
+
+static int emv_select_application_internal(
 	struct emv_ctx_t* ctx,
 	struct emv_app_list_t* app_list,
 	unsigned int index
@@ -503,7 +589,24 @@ exit:
 	return r;
 }
 
-int emv_initiate_application_processing(
+int emv_select_application(
+	struct emv_ctx_t* ctx,
+	struct emv_app_list_t* app_list,
+	unsigned int index
+)
+{
+	int r;
+	struct emv_metrics_mark_t mark;
+	struct emv_metrics_t* metrics;
+
+	metrics = emv_ctx_metrics_begin(ctx, &mark);
+	r = emv_select_application_internal(ctx, app_list, index);
+	emv_metrics_step_end(metrics, EMV_METRICS_STEP_SELECT_APPLICATION, &mark);
+
+	return r;
+}
+
+static int emv_initiate_application_processing_internal(
 	struct emv_ctx_t* ctx,
 	uint8_t pos_entry_mode
 )
@@ -613,7 +716,14 @@ int emv_initiate_application_processing(
 
 	// Create Unpredictable Number (field 9F37)
 	// See EMV 4.4 Book 4, 6.5.6
-	crypto_rand(un, sizeof(un));
+	r = emv_rand(un, sizeof(un));
+	if (r) {
+		emv_debug_trace_msg("emv_rand() failed; r=%d", r);
+
+		// Internal error; terminate session
+		emv_debug_error("Internal error");
+		return EMV_ERROR_INTERNAL;
+	}
 	r = emv_tlv_list_push(
 		&ctx->terminal,
 		EMV_TAG_9F37_UNPREDICTABLE_NUMBER,
@@ -694,7 +804,8 @@ int emv_initiate_application_processing(
 
 		// Populate PDOL data in cache buffer
 		ctx->oda.pdol_data_len = sizeof(ctx->oda.pdol_data);
-		r = emv_dol_build_data(
+		r = emv_dol_plan_cache_build_data(
+			ctx->dol_plan_cache,
 			pdol->value,
 			pdol->length,
 			&sources,
@@ -702,7 +813,7 @@ int emv_initiate_application_processing(
 			&ctx->oda.pdol_data_len
 		);
 		if (r) {
-			emv_debug_trace_msg("emv_dol_build_data() failed; r=%d", r);
+			emv_debug_trace_msg("emv_dol_plan_cache_build_data() failed; r=%d", r);
 			emv_debug_error("Failed to build PDOL data");
 
 			// This is considered an internal error because the PDOL has
@@ -791,7 +902,23 @@ exit:
 	return r;
 }
 
-int emv_read_application_data(struct emv_ctx_t* ctx)
+int emv_initiate_application_processing(
+	struct emv_ctx_t* ctx,
+	uint8_t pos_entry_mode
+)
+{
+	int r;
+	struct emv_metrics_mark_t mark;
+	struct emv_metrics_t* metrics;
+
+	metrics = emv_ctx_metrics_begin(ctx, &mark);
+	r = emv_initiate_application_processing_internal(ctx, pos_entry_mode);
+	emv_metrics_step_end(metrics, EMV_METRICS_STEP_INITIATE_APPLICATION_PROCESSING, &mark);
+
+	return r;
+}
+
+static int emv_read_application_data_internal(struct emv_ctx_t* ctx)
 {
 	int r;
 	struct emv_tlv_list_t record_data = EMV_TLV_LIST_INIT;
@@ -917,7 +1044,20 @@ exit:
 	return r;
 }
 
-int emv_offline_data_authentication(struct emv_ctx_t* ctx)
+int emv_read_application_data(struct emv_ctx_t* ctx)
+{
+	int r;
+	struct emv_metrics_mark_t mark;
+	struct emv_metrics_t* metrics;
+
+	metrics = emv_ctx_metrics_begin(ctx, &mark);
+	r = emv_read_application_data_internal(ctx);
+	emv_metrics_step_end(metrics, EMV_METRICS_STEP_READ_APPLICATION_DATA, &mark);
+
+	return r;
+}
+
+static int emv_offline_data_authentication_internal(struct emv_ctx_t* ctx)
 {
 	int r;
 	const struct emv_tlv_t* term_caps;
@@ -932,7 +1072,7 @@ int emv_offline_data_authentication(struct emv_ctx_t* ctx)
 	emv_debug_info("Offline data authentication");
 
 	// Ensure mandatory configuration fields are present and have valid length
-	term_caps = emv_tlv_list_find_const(&ctx->config, EMV_TAG_9F33_TERMINAL_CAPABILITIES);
+	term_caps = emv_config_find_from_ctx(ctx, EMV_TAG_9F33_TERMINAL_CAPABILITIES);
 	if (!term_caps || term_caps->length != 3) {
 		emv_debug_trace_msg("term_caps=%p, term_caps->length=%u",
 			term_caps, term_caps ? term_caps->length : 0);
@@ -940,7 +1080,7 @@ int emv_offline_data_authentication(struct emv_ctx_t* ctx)
 		r = EMV_ERROR_INVALID_CONFIG;
 		goto exit;
 	}
-	default_ddol = emv_tlv_list_find_const(&ctx->config, EMV_TAG_9F49_DDOL);
+	default_ddol = emv_config_find_from_ctx(ctx, EMV_TAG_9F49_DDOL);
 	if (!default_ddol || default_ddol->length < 2) {
 		emv_debug_trace_msg("default_ddol=%p, default_ddol->length=%u",
 			default_ddol, default_ddol ? default_ddol->length : 0);
@@ -982,6 +1122,19 @@ exit:
 	return r;
 }
 
+int emv_offline_data_authentication(struct emv_ctx_t* ctx)
+{
+	int r;
+	struct emv_metrics_mark_t mark;
+	struct emv_metrics_t* metrics;
+
+	metrics = emv_ctx_metrics_begin(ctx, &mark);
+	r = emv_offline_data_authentication_internal(ctx);
+	emv_metrics_step_end(metrics, EMV_METRICS_STEP_OFFLINE_DATA_AUTHENTICATION, &mark);
+
+	return r;
+}
+
 int emv_processing_restrictions(struct emv_ctx_t* ctx)
 {
 	const struct emv_tlv_t* term_app_version;
@@ -1010,28 +1163,28 @@ int emv_processing_restrictions(struct emv_ctx_t* ctx)
 	emv_debug_info("Processing restrictions");
 
 	// Ensure mandatory configuration fields are present and have valid length
-	term_app_version = emv_tlv_list_find_const(&ctx->config, EMV_TAG_9F09_APPLICATION_VERSION_NUMBER_TERMINAL);
+	term_app_version = emv_config_find_from_ctx(ctx, EMV_TAG_9F09_APPLICATION_VERSION_NUMBER_TERMINAL);
 	if (!term_app_version || term_app_version->length != 2) {
 		emv_debug_trace_msg("term_app_version=%p, term_app_version->length=%u",
 			term_app_version, term_app_version ? term_app_version->length : 0);
 		emv_debug_error("Application Version Number - terminal (9F09) not found or invalid");
 		return EMV_ERROR_INVALID_CONFIG;
 	}
-	term_type = emv_tlv_list_find_const(&ctx->config, EMV_TAG_9F35_TERMINAL_TYPE);
+	term_type = emv_config_find_from_ctx(ctx, EMV_TAG_9F35_TERMINAL_TYPE);
 	if (!term_type || term_type->length != 1) {
 		emv_debug_trace_msg("term_type=%p, term_type->length=%u",
 			term_type, term_type ? term_type->length : 0);
 		emv_debug_error("Terminal Type (9F35) not found or invalid");
 		return EMV_ERROR_INVALID_CONFIG;
 	}
-	addl_term_caps = emv_tlv_list_find_const(&ctx->config, EMV_TAG_9F40_ADDITIONAL_TERMINAL_CAPABILITIES);
+	addl_term_caps = emv_config_find_from_ctx(ctx, EMV_TAG_9F40_ADDITIONAL_TERMINAL_CAPABILITIES);
 	if (!addl_term_caps || addl_term_caps->length != 5) {
 		emv_debug_trace_msg("addl_term_caps=%p, addl_term_caps->length=%u",
 			addl_term_caps, addl_term_caps ? addl_term_caps->length : 0);
 		emv_debug_error("Additional Terminal Capabilities (9F40) not found or invalid");
 		return EMV_ERROR_INVALID_CONFIG;
 	}
-	term_country_code = emv_tlv_list_find_const(&ctx->config, EMV_TAG_9F1A_TERMINAL_COUNTRY_CODE);
+	term_country_code = emv_config_find_from_ctx(ctx, EMV_TAG_9F1A_TERMINAL_COUNTRY_CODE);
 	if (!term_country_code || term_country_code->length != 2) {
 		emv_debug_trace_msg("term_country_code=%p, term_country_code->length=%u",
 			term_country_code, term_country_code ? term_country_code->length : 0);
@@ -1209,9 +1362,10 @@ int emv_processing_restrictions(struct emv_ctx_t* ctx)
 	return 0;
 }
 
-int emv_terminal_risk_management(struct emv_ctx_t* ctx,
+static int emv_terminal_risk_management_internal(struct emv_ctx_t* ctx,
 	const struct emv_txn_log_entry_t* txn_log,
-	size_t txn_log_cnt
+	size_t txn_log_cnt,
+	const struct emv_txn_log_t* txn_log_index
 )
 {
 	int r;
@@ -1242,7 +1396,7 @@ int emv_terminal_risk_management(struct emv_ctx_t* ctx,
 	emv_debug_info("Terminal risk management");
 
 	// Ensure mandatory configuration fields are present and have valid length
-	term_floor_limit = emv_tlv_list_find_const(&ctx->config, EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT);
+	term_floor_limit = emv_config_find_from_ctx(ctx, EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT);
 	if (!term_floor_limit || term_floor_limit->length != 4) {
 		emv_debug_trace_msg("term_floor_limit=%p, term_floor_limit->length=%u",
 			term_floor_limit, term_floor_limit ? term_floor_limit->length : 0);
@@ -1304,7 +1458,7 @@ int emv_terminal_risk_management(struct emv_ctx_t* ctx,
 		return EMV_ERROR_INTERNAL;
 	}
 	emv_debug_trace_msg("Amount, Authorised (Binary) value is %u", (unsigned int)amount_value);
-	if (txn_log && txn_log_cnt) {
+	if ((txn_log && txn_log_cnt) || emv_txn_log_count(txn_log_index)) {
 		const struct emv_tlv_t* pan;
 		const struct emv_txn_log_entry_t* entry = NULL;
 
@@ -1320,6 +1474,9 @@ int emv_terminal_risk_management(struct emv_ctx_t* ctx,
 		// is not mandatory to compare the Application PAN Sequence Number and
 		// that this implementation specifically chooses not to do so because
 		// the risk is considered for the card as a whole.
+		if (txn_log_index) {
+			entry = emv_txn_log_find_latest(txn_log_index, pan->value, pan->length);
+		}
 		for (size_t i = 0; i < txn_log_cnt; ++i) {
 			if (pan->length <= sizeof(txn_log[i].pan) &&
 				memcmp(pan->value, txn_log[i].pan, pan->length) == 0
@@ -1359,9 +1516,9 @@ int emv_terminal_risk_management(struct emv_ctx_t* ctx,
 			return EMV_ERROR_INVALID_CONFIG;
 		}
 
-		x = crypto_rand_byte(1, 99);
+		x = emv_rand_byte(1, 99);
 		if (x < 0) {
-			emv_debug_trace_msg("crypto_rand_byte() failed; r=%d", r);
+			emv_debug_trace_msg("emv_rand_byte() failed; r=%d", x);
 
 			// Internal error; terminate session
 			emv_debug_error("Internal error");
@@ -1561,7 +1718,40 @@ exit:
 	return r;
 }
 
-int emv_card_action_analysis(struct emv_ctx_t* ctx)
+int emv_terminal_risk_management(
+	struct emv_ctx_t* ctx,
+	const struct emv_txn_log_entry_t* txn_log,
+	size_t txn_log_cnt
+)
+{
+	int r;
+	struct emv_metrics_mark_t mark;
+	struct emv_metrics_t* metrics;
+
+	metrics = emv_ctx_metrics_begin(ctx, &mark);
+	r = emv_terminal_risk_management_internal(ctx, txn_log, txn_log_cnt, NULL);
+	emv_metrics_step_end(metrics, EMV_METRICS_STEP_TERMINAL_RISK_MANAGEMENT, &mark);
+
+	return r;
+}
+
+int emv_terminal_risk_management_with_txn_log(
+	struct emv_ctx_t* ctx,
+	const struct emv_txn_log_t* txn_log
+)
+{
+	int r;
+	struct emv_metrics_mark_t mark;
+	struct emv_metrics_t* metrics;
+
+	metrics = emv_ctx_metrics_begin(ctx, &mark);
+	r = emv_terminal_risk_management_internal(ctx, NULL, 0, txn_log);
+	emv_metrics_step_end(metrics, EMV_METRICS_STEP_TERMINAL_RISK_MANAGEMENT, &mark);
+
+	return r;
+}
+
+static int emv_card_action_analysis_internal(struct emv_ctx_t* ctx)
 {
 	int r;
 	uint8_t ref_ctrl;
@@ -1625,7 +1815,8 @@ int emv_card_action_analysis(struct emv_ctx_t* ctx)
 
 	// Populate CDOL1 data in cache buffer
 	ctx->oda.cdol1_data_len = sizeof(ctx->oda.cdol1_data);
-	r = emv_dol_build_data(
+	r = emv_dol_plan_cache_build_data(
+		ctx->dol_plan_cache,
 		cdol1->value,
 		cdol1->length,
 		&sources,
@@ -1633,7 +1824,7 @@ int emv_card_action_analysis(struct emv_ctx_t* ctx)
 		&ctx->oda.cdol1_data_len
 	);
 	if (r) {
-		emv_debug_trace_msg("emv_dol_build_data() failed; r=%d", r);
+		emv_debug_trace_msg("emv_dol_plan_cache_build_data() failed; r=%d", r);
 		emv_debug_error("Failed to build CDOL1 data");
 
 		// This is considered a card error because CDOL1 is provided by the
@@ -1710,3 +1901,16 @@ exit:
 	emv_tlv_list_clear(&genac_list);
 	return r;
 }
+
+int emv_card_action_analysis(struct emv_ctx_t* ctx)
+{
+	int r;
+	struct emv_metrics_mark_t mark;
+	struct emv_metrics_t* metrics;
+
+	metrics = emv_ctx_metrics_begin(ctx, &mark);
+	r = emv_card_action_analysis_internal(ctx);
+	emv_metrics_step_end(metrics, EMV_METRICS_STEP_CARD_ACTION_ANALYSIS, &mark);
+
+	return r;
+}
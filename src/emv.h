@@ -2,7 +2,7 @@
  * @file emv.h
  * @brief High level EMV library interface
  *
- * Copyright 2023-2025 Leon Lynch
+ * Copyright 2023-2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -23,6 +23,7 @@
 #define EMV_H
 
 #include "emv_tlv.h"
+#include "emv_config.h"
 #include "emv_oda_types.h"
 
 #include <sys/cdefs.h>
@@ -35,6 +36,10 @@ __BEGIN_DECLS
 struct emv_ttl_t;
 struct emv_app_list_t;
 struct emv_app_t;
+struct emv_metrics_t;
+struct emv_capk_t;
+struct emv_txn_log_t;
+struct emv_dol_plan_cache_t;
 
 /**
  * @brief EMV processing context
@@ -75,6 +80,17 @@ struct emv_ctx_t {
 	 */
 	struct emv_tlv_list_t supported_aids;
 
+	/**
+	 * @brief Shared immutable terminal configuration.
+	 *
+	 * Set using @ref emv_ctx_set_config(). When set, it is consulted as a
+	 * read-only source after @ref emv_ctx_t.config, which may therefore be
+	 * used to override individual fields, and its supported AIDs are used if
+	 * @ref emv_ctx_t.supported_aids is empty. Do not modify this member
+	 * directly.
+	 */
+	struct emv_config_t* shared_config;
+
 	/**
 	 * @brief Target percentage to be used for random transaction selection
 	 * during terminal risk management. Value must be 0 to 99. Set to zero to
@@ -163,6 +179,46 @@ struct emv_ctx_t {
 	 */
 	struct emv_oda_ctx_t oda;
 
+	/**
+	 * @brief Optional EMV kernel timing metrics. NULL to disable.
+	 *
+	 * Populate after @ref emv_ctx_init() using an object initialised by
+	 * @ref emv_metrics_init(). When set, each EMV kernel step records its
+	 * total time, card I/O time and host processing time. Card I/O time is
+	 * only measured when a TTL extension is attached to @ref emv_ctx_t.ttl
+	 * using @ref emv_ttl_ext_attach() and is otherwise accounted as host
+	 * processing time. The timings of the current transaction are cleared by
+	 * @ref emv_ctx_reset().
+	 */
+	struct emv_metrics_t* metrics;
+
+	/**
+	 * @brief Optional list of additional Certificate Authority Public Keys
+	 * (CAPKs). NULL to only use the static CAPK data.
+	 *
+	 * Populate after @ref emv_ctx_init() and before EMV processing. These
+	 * CAPKs are searched before the static CAPK data during offline data
+	 * authentication and must remain valid while the context is in use.
+	 */
+	const struct emv_capk_t* capk_list;
+
+	/**
+	 * @brief Number of entries in @ref emv_ctx_t.capk_list
+	 */
+	size_t capk_count;
+
+	/**
+	 * @brief Optional cache of compiled Data Object List (DOL) plans. NULL to
+	 * disable.
+	 *
+	 * Populate after @ref emv_ctx_init() using a zeroed object. When set, it
+	 * is used when building PDOL, CDOL1 and DDOL data and is retained by
+	 * @ref emv_ctx_reset() such that subsequent transactions that encounter
+	 * the same DOLs do not decode them again. It must remain valid while the
+	 * context is in use.
+	 */
+	struct emv_dol_plan_cache_t* dol_plan_cache;
+
 	/**
 	 * @brief Various cached fields for internal use
 	 *
@@ -236,12 +292,14 @@ int emv_ctx_init(struct emv_ctx_t* ctx, struct emv_ttl_t* ttl);
  * - @ref emv_ctx_t.params
  * - @ref emv_ctx_t.icc
  * - @ref emv_ctx_t.terminal
+ * - The current transaction timings of @ref emv_ctx_t.metrics, if present
  *
  * And this function will preserve these members that can be reused for the
  * next transaction:
  * - @ref emv_ctx_t.ttl
  * - @ref emv_ctx_t.config
  * - @ref emv_ctx_t.supported_aids
+ * - @ref emv_ctx_t.shared_config
  *
  * @param ctx EMV processing context
  *
@@ -250,6 +308,25 @@ int emv_ctx_init(struct emv_ctx_t* ctx, struct emv_ttl_t* ttl);
  */
 int emv_ctx_reset(struct emv_ctx_t* ctx);
 
+/**
+ * Use shared immutable terminal configuration for EMV processing context.
+ *
+ * The EMV processing context obtains its own reference to @p config and
+ * releases its reference to the previous shared configuration, if any, such
+ * that a new version of the configuration can be used between transactions.
+ * @ref emv_ctx_t.config and @ref emv_ctx_t.supported_aids remain owned by
+ * the context and are not modified. See @ref emv_ctx_t.shared_config.
+ *
+ * @param ctx EMV processing context
+ * @param config Shared terminal configuration created using
+ *               @ref emv_config_create(). NULL to stop using a shared
+ *               configuration.
+ *
+ * @return Zero for success
+ * @return Less than zero for errors. See @ref emv_error_t
+ */
+int emv_ctx_set_config(struct emv_ctx_t* ctx, struct emv_config_t* config);
+
 /**
  * Clear EMV processing context
  *
@@ -475,6 +552,29 @@ int emv_terminal_risk_management(struct emv_ctx_t* ctx,
 	size_t txn_log_cnt
 );
 
+/**
+ * Perform EMV Terminal Risk Management using an indexed transaction log.
+ *
+ * This function is the same as @ref emv_terminal_risk_management() except that
+ * the latest approved transaction with the same Primary Account Number (PAN)
+ * is found using the index of the transaction log instead of comparing every
+ * entry. This is intended for large transaction logs.
+ *
+ * @remark See EMV 4.4 Book 3, 10.6
+ *
+ * @param ctx EMV processing context
+ * @param txn_log Transaction log containing previously approved transactions.
+ *                See @ref emv_txn_log_t. NULL to ignore.
+ *
+ * @return Zero for success
+ * @return Less than zero for errors. See @ref emv_error_t
+ * @return Greater than zero for EMV processing outcome. See @ref emv_outcome_t
+ */
+int emv_terminal_risk_management_with_txn_log(
+	struct emv_ctx_t* ctx,
+	const struct emv_txn_log_t* txn_log
+);
+
 /**
  * Perform EMV Card Action Analysis to determined the risk management decision
  * by the ICC as indicated in the response from GENERATE APPLICATION CRYPTOGRAM.
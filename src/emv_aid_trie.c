@@ -0,0 +1,263 @@
+/**
+ * @file emv_aid_trie.c
+ * @brief Prefix trie for matching Application Identifiers (AIDs)
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_aid_trie.h"
+#include "emv_tlv.h"
+#include "emv_fields.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h> // For malloc(), free() and qsort()
+#include <string.h>
+
+struct emv_aid_trie_node_t {
+	size_t first_child; // Index of first child. Children are consecutive.
+	uint16_t child_count;
+	uint8_t value; // AID byte represented by node
+	const void* exact; // Data of entry requiring exact match, if any
+	const void* partial; // Data of entry allowing partial match, if any
+};
+
+struct emv_aid_trie_t {
+	size_t node_count;
+	struct emv_aid_trie_node_t node[]; // Node zero is the root node
+};
+
+// Range of sorted entries represented by a node while the trie is created
+struct emv_aid_trie_range_t {
+	size_t begin;
+	size_t end;
+	size_t depth;
+};
+
+static int emv_aid_trie_entry_compare(const void* a, const void* b)
+{
+	const struct emv_aid_trie_entry_t* entry_a = *(const struct emv_aid_trie_entry_t* const*)a;
+	const struct emv_aid_trie_entry_t* entry_b = *(const struct emv_aid_trie_entry_t* const*)b;
+	size_t len;
+	int r;
+
+	// Sort by AID bytes and then by length such that entries that are a
+	// prefix of other entries are first
+	len = entry_a->aid_len < entry_b->aid_len ? entry_a->aid_len : entry_b->aid_len;
+	r = memcmp(entry_a->aid, entry_b->aid, len);
+	if (r) {
+		return r;
+	}
+	if (entry_a->aid_len != entry_b->aid_len) {
+		return entry_a->aid_len < entry_b->aid_len ? -1 : 1;
+	}
+
+	// Preserve the order of identical entries such that the first of those
+	// entries is matched
+	if (entry_a != entry_b) {
+		return entry_a < entry_b ? -1 : 1;
+	}
+	return 0;
+}
+
+struct emv_aid_trie_t* emv_aid_trie_create(
+	const struct emv_aid_trie_entry_t* entries,
+	size_t count
+)
+{
+	size_t node_max = 1;
+	const struct emv_aid_trie_entry_t** sorted = NULL;
+	struct emv_aid_trie_range_t* range = NULL;
+	struct emv_aid_trie_t* trie = NULL;
+
+	if (!entries && count) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		if (!entries[i].aid ||
+			!entries[i].aid_len ||
+			!entries[i].data ||
+			(entries[i].asi != EMV_ASI_EXACT_MATCH && entries[i].asi != EMV_ASI_PARTIAL_MATCH)
+		) {
+			return NULL;
+		}
+
+		// Every byte of every entry requires at most one node
+		node_max += entries[i].aid_len;
+	}
+
+	sorted = malloc(count * sizeof(sorted[0]) + 1);
+	range = malloc(node_max * sizeof(range[0]));
+	trie = malloc(sizeof(*trie) + node_max * sizeof(trie->node[0]));
+	if (!sorted || !range || !trie) {
+		goto error;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		sorted[i] = &entries[i];
+	}
+	qsort(sorted, count, sizeof(sorted[0]), &emv_aid_trie_entry_compare);
+
+	// Create the nodes in breadth first order such that all children of a
+	// node are created consecutively. The sorted entries represented by a
+	// node start with those that end at the node, followed by those that
+	// continue at each child in ascending order.
+	memset(&trie->node[0], 0, sizeof(trie->node[0]));
+	range[0].begin = 0;
+	range[0].end = count;
+	range[0].depth = 0;
+	trie->node_count = 1;
+	for (size_t n = 0; n < trie->node_count; ++n) {
+		struct emv_aid_trie_node_t* node = &trie->node[n];
+		size_t depth = range[n].depth;
+		size_t i = range[n].begin;
+
+		for (; i < range[n].end && sorted[i]->aid_len == depth; ++i) {
+			if (sorted[i]->asi == EMV_ASI_EXACT_MATCH) {
+				if (!node->exact) {
+					node->exact = sorted[i]->data;
+				}
+			} else {
+				if (!node->partial) {
+					node->partial = sorted[i]->data;
+				}
+			}
+		}
+
+		node->first_child = trie->node_count;
+		while (i < range[n].end) {
+			uint8_t value = sorted[i]->aid[depth];
+			struct emv_aid_trie_node_t* child = &trie->node[trie->node_count];
+
+			memset(child, 0, sizeof(*child));
+			child->value = value;
+			range[trie->node_count].begin = i;
+			while (i < range[n].end && sorted[i]->aid[depth] == value) {
+				++i;
+			}
+			range[trie->node_count].end = i;
+			range[trie->node_count].depth = depth + 1;
+
+			++trie->node_count;
+			++node->child_count;
+		}
+	}
+
+	free(range);
+	free(sorted);
+	return trie;
+
+error:
+	free(trie);
+	free(range);
+	free(sorted);
+	return NULL;
+}
+
+struct emv_aid_trie_t* emv_aid_trie_create_from_list(
+	const struct emv_tlv_list_t* supported_aids
+)
+{
+	size_t count = 0;
+	const struct emv_tlv_t* tlv;
+	struct emv_aid_trie_entry_t* entries;
+	struct emv_aid_trie_t* trie;
+
+	if (!supported_aids) {
+		return NULL;
+	}
+
+	for (tlv = supported_aids->front; tlv != NULL; tlv = tlv->next) {
+		++count;
+	}
+
+	entries = malloc(count * sizeof(entries[0]) + 1);
+	if (!entries) {
+		return NULL;
+	}
+
+	count = 0;
+	for (tlv = supported_aids->front; tlv != NULL; tlv = tlv->next) {
+		entries[count].aid = tlv->value;
+		entries[count].aid_len = tlv->length;
+		entries[count].asi = tlv->flags;
+		entries[count].data = tlv;
+		++count;
+	}
+
+	// The trie refers to the supported AIDs and not to the entries
+	trie = emv_aid_trie_create(entries, count);
+	free(entries);
+
+	return trie;
+}
+
+void emv_aid_trie_free(struct emv_aid_trie_t* trie)
+{
+	free(trie);
+}
+
+const void* emv_aid_trie_find(
+	const struct emv_aid_trie_t* trie,
+	const uint8_t* aid,
+	size_t aid_len
+)
+{
+	const struct emv_aid_trie_node_t* node;
+	const void* match = NULL;
+
+	if (!trie || !aid) {
+		return NULL;
+	}
+
+	node = &trie->node[0];
+	for (size_t depth = 0; depth < aid_len; ++depth) {
+		size_t lo = node->first_child;
+		size_t hi = node->first_child + node->child_count;
+
+		// Children are sorted by AID byte
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+
+			if (trie->node[mid].value < aid[depth]) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		if (lo == node->first_child + node->child_count ||
+			trie->node[lo].value != aid[depth]
+		) {
+			// No longer entries match
+			break;
+		}
+		node = &trie->node[lo];
+
+		if (depth + 1 == aid_len && node->exact) {
+			// Exact match is preferred
+			// See EMV 4.4 Book 1, 12.3.1
+			return node->exact;
+		}
+		if (node->partial) {
+			// Longest partial match so far
+			match = node->partial;
+		}
+	}
+
+	return match;
+}
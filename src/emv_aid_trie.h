@@ -0,0 +1,111 @@
+/**
+ * @file emv_aid_trie.h
+ * @brief Prefix trie for matching Application Identifiers (AIDs)
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EMV_AID_TRIE_H
+#define EMV_AID_TRIE_H
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+#include <stdint.h>
+
+__BEGIN_DECLS
+
+// Forward declarations
+struct emv_tlv_list_t;
+
+/**
+ * Compiled prefix trie of Application Identifiers (AIDs)
+ *
+ * Each node represents one byte of one or more AIDs and the children of each
+ * node are stored consecutively in ascending order such that the best match
+ * for an AID is found in a single pass over the AID. Each node indicates the
+ * entry, if any, that requires an exact match of the AID that ends at the
+ * node and the entry, if any, that allows a partial match of it. The trie is
+ * never modified after creation and may therefore be used by multiple
+ * threads.
+ */
+struct emv_aid_trie_t;
+
+/// Entry from which @ref emv_aid_trie_t is created
+struct emv_aid_trie_entry_t {
+	const uint8_t* aid; ///< Application Identifier (AID) or AID prefix
+	size_t aid_len; ///< Length of AID in bytes. Must be non-zero.
+	uint8_t asi; ///< Application Selection Indicator. Either @ref EMV_ASI_EXACT_MATCH or @ref EMV_ASI_PARTIAL_MATCH.
+	const void* data; ///< Data to provide when entry is matched. Must not be NULL.
+};
+
+/**
+ * Create AID prefix trie from entries. The entries are only accessed by this
+ * function but the data of each entry is provided by @ref emv_aid_trie_find()
+ * and must therefore remain valid for the lifetime of the trie. If multiple
+ * entries have the same AID and ASI, the first of those entries is matched.
+ *
+ * @param entries Entries
+ * @param count Number of entries
+ * @return AID prefix trie. Use @ref emv_aid_trie_free() to free it. NULL for
+ *         error or invalid entries.
+ */
+struct emv_aid_trie_t* emv_aid_trie_create(
+	const struct emv_aid_trie_entry_t* entries,
+	size_t count
+);
+
+/**
+ * Create AID prefix trie from supported AID (field 9F06) list. The ASI of each
+ * entry is @ref emv_tlv_t.flags and the data provided when an entry is
+ * matched is the @ref emv_tlv_t of the supported AID. The list must not be
+ * modified for the lifetime of the trie.
+ *
+ * @param supported_aids Supported AID (field 9F06) list including ASI flags
+ * @return AID prefix trie. Use @ref emv_aid_trie_free() to free it. NULL for
+ *         error or invalid entries.
+ */
+struct emv_aid_trie_t* emv_aid_trie_create_from_list(
+	const struct emv_tlv_list_t* supported_aids
+);
+
+/**
+ * Free AID prefix trie
+ * @param trie AID prefix trie
+ */
+void emv_aid_trie_free(struct emv_aid_trie_t* trie);
+
+/**
+ * Find best match for Application Identifier (AID). An entry that requires an
+ * exact match is preferred if the AID is identical to it, otherwise the
+ * longest entry that allows a partial match and that is a prefix of the AID,
+ * or identical to it, is matched.
+ * @remark See EMV 4.4 Book 1, 12.3.1
+ *
+ * @param trie AID prefix trie
+ * @param aid Application Identifier (AID)
+ * @param aid_len Length of AID in bytes
+ * @return Data of matched entry. NULL if not found.
+ */
+const void* emv_aid_trie_find(
+	const struct emv_aid_trie_t* trie,
+	const uint8_t* aid,
+	size_t aid_len
+);
+
+__END_DECLS
+
+#endif
@@ -20,6 +20,7 @@
  */
 
 #include "emv_app.h"
+#include "emv_aid_trie.h"
 #include "emv_tags.h"
 #include "emv_fields.h"
 #include "iso8825_ber.h"
@@ -316,6 +317,20 @@ bool emv_app_is_supported(
 	return false;
 }
 
+const struct emv_tlv_t* emv_app_find_supported_aid(
+	const struct emv_app_t* app,
+	const struct emv_aid_trie_t* supported_aid_trie
+)
+{
+	if (!app || !app->aid) {
+		// Invalid app; not supported
+		return NULL;
+	}
+
+	// See EMV 4.4 Book 1, 12.3.1
+	return emv_aid_trie_find(supported_aid_trie, app->aid->value, app->aid->length);
+}
+
 static inline bool emv_app_list_is_valid(const struct emv_app_list_t* list)
 {
 	if (!list) {
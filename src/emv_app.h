@@ -30,6 +30,9 @@
 
 __BEGIN_DECLS
 
+// Forward declarations
+struct emv_aid_trie_t;
+
 /**
  * EMV application
  */
@@ -134,6 +137,25 @@ bool emv_app_is_supported(
 	const struct emv_tlv_list_t* supported_aids
 );
 
+/**
+ * Find best supported AID for EMV application using AID prefix trie. This is
+ * equivalent to @ref emv_app_is_supported() but does not depend on the
+ * number of supported AIDs.
+ * @remark See EMV 4.4 Book 1, 12.3.1
+ *
+ * @param app EMV application
+ * @param supported_aid_trie AID prefix trie created from supported AID
+ *                           (field 9F06) list using
+ *                           @ref emv_aid_trie_create_from_list()
+ * @return Supported AID (field 9F06) that matches EMV application. Exact
+ *         matches are preferred over the longest partial match. NULL if not
+ *         supported.
+ */
+const struct emv_tlv_t* emv_app_find_supported_aid(
+	const struct emv_app_t* app,
+	const struct emv_aid_trie_t* supported_aid_trie
+);
+
 /// Static initialiser for @ref emv_app_list_t
 #define EMV_APP_LIST_INIT { NULL, NULL }
 
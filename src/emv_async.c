@@ -0,0 +1,446 @@
+/**
+ * @file emv_async.c
+ * @brief Resumable EMV kernel sessions for event loop driven terminals
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_async.h"
+#include "emv_utils_config.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#define EMV_ASYNC_USE_FIBERS
+#elif defined(HAVE_MAKECONTEXT) && !defined(__APPLE__)
+// NOTE: swapcontext() also saves and restores the signal mask and therefore
+// glibc performs a sigprocmask() system call for each switch
+#include <ucontext.h>
+#define EMV_ASYNC_USE_UCONTEXT
+#endif
+
+#if defined(EMV_ASYNC_USE_UCONTEXT)
+struct emv_async_platform_t {
+	ucontext_t caller;
+	ucontext_t session;
+};
+#elif defined(EMV_ASYNC_USE_FIBERS)
+struct emv_async_platform_t {
+	LPVOID caller;
+	LPVOID session;
+};
+#endif
+
+bool emv_async_is_supported(void)
+{
+#if defined(EMV_ASYNC_USE_UCONTEXT) || defined(EMV_ASYNC_USE_FIBERS)
+	return true;
+#else
+	return false;
+#endif
+}
+
+#if defined(EMV_ASYNC_USE_UCONTEXT) || defined(EMV_ASYNC_USE_FIBERS)
+
+// Card reader failure reported to the kernel
+#define EMV_ASYNC_TRX_FAILURE (-1)
+
+static int emv_async_trx(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+);
+
+static void emv_async_run(struct emv_async_t* async)
+{
+	async->result = async->func(async->arg);
+	async->state = EMV_ASYNC_STATE_DONE;
+	async->tx_buf = NULL;
+	async->tx_buf_len = 0;
+}
+
+#if defined(EMV_ASYNC_USE_UCONTEXT)
+
+static void emv_async_entry(unsigned int ptr_hi, unsigned int ptr_lo)
+{
+	// makecontext() only passes int arguments, therefore the session
+	// pointer is split into two halves
+	uintptr_t ptr = ((uintptr_t)ptr_hi << 16 << 16) | ptr_lo;
+
+	// Return to caller using uc_link when done
+	emv_async_run((struct emv_async_t*)ptr);
+}
+
+static int emv_async_platform_init(struct emv_async_t* async)
+{
+	async->platform = calloc(1, sizeof(struct emv_async_platform_t));
+	if (!async->platform) {
+		return EMV_ASYNC_ERROR_INTERNAL;
+	}
+	return 0;
+}
+
+static int emv_async_platform_prepare(struct emv_async_t* async)
+{
+	struct emv_async_platform_t* platform = async->platform;
+	uintptr_t ptr = (uintptr_t)async;
+
+	if (getcontext(&platform->session)) {
+		return EMV_ASYNC_ERROR_INTERNAL;
+	}
+	platform->session.uc_stack.ss_sp = async->stack;
+	platform->session.uc_stack.ss_size = async->stack_size;
+	platform->session.uc_link = &platform->caller;
+	makecontext(
+		&platform->session,
+		(void (*)(void))&emv_async_entry,
+		2,
+		(unsigned int)(ptr >> 16 >> 16),
+		(unsigned int)(ptr & 0xFFFFFFFF)
+	);
+
+	return 0;
+}
+
+static int emv_async_switch_to_session(struct emv_async_t* async)
+{
+	struct emv_async_platform_t* platform = async->platform;
+
+	if (swapcontext(&platform->caller, &platform->session)) {
+		return EMV_ASYNC_ERROR_INTERNAL;
+	}
+	return 0;
+}
+
+static void emv_async_switch_to_caller(struct emv_async_t* async)
+{
+	struct emv_async_platform_t* platform = async->platform;
+
+	swapcontext(&platform->session, &platform->caller);
+}
+
+static void emv_async_platform_clear(struct emv_async_t* async)
+{
+	free(async->platform);
+}
+
+#elif defined(EMV_ASYNC_USE_FIBERS)
+
+static void WINAPI emv_async_entry(LPVOID param)
+{
+	struct emv_async_t* async = param;
+	struct emv_async_platform_t* platform = async->platform;
+
+	// Fibers may not return, therefore each kernel step is run in a loop and
+	// control is returned to the caller when done
+	while (true) {
+		emv_async_run(async);
+		SwitchToFiber(platform->caller);
+	}
+}
+
+static int emv_async_platform_init(struct emv_async_t* async)
+{
+	struct emv_async_platform_t* platform;
+
+	platform = calloc(1, sizeof(struct emv_async_platform_t));
+	if (!platform) {
+		return EMV_ASYNC_ERROR_INTERNAL;
+	}
+	async->platform = platform;
+
+	// Fibers manage their own stack and therefore the session stack is only
+	// used to determine the stack size
+	platform->session = CreateFiber(async->stack_size, &emv_async_entry, async);
+	if (!platform->session) {
+		free(platform);
+		async->platform = NULL;
+		return EMV_ASYNC_ERROR_INTERNAL;
+	}
+
+	return 0;
+}
+
+static int emv_async_platform_prepare(struct emv_async_t* async)
+{
+	// Session fiber runs the next kernel step when it is resumed
+	return 0;
+}
+
+static int emv_async_switch_to_session(struct emv_async_t* async)
+{
+	struct emv_async_platform_t* platform = async->platform;
+	bool converted = false;
+
+	// Only fibers can switch to other fibers
+	if (!IsThreadAFiber()) {
+		if (!ConvertThreadToFiber(NULL)) {
+			return EMV_ASYNC_ERROR_INTERNAL;
+		}
+		converted = true;
+	}
+	platform->caller = GetCurrentFiber();
+	SwitchToFiber(platform->session);
+
+	// Undo the conversion such that the calling thread is left as it was
+	// found and may be resumed from another thread next time
+	if (converted) {
+		ConvertFiberToThread();
+	}
+
+	return 0;
+}
+
+static void emv_async_switch_to_caller(struct emv_async_t* async)
+{
+	struct emv_async_platform_t* platform = async->platform;
+
+	SwitchToFiber(platform->caller);
+}
+
+static void emv_async_platform_clear(struct emv_async_t* async)
+{
+	struct emv_async_platform_t* platform = async->platform;
+
+	if (platform) {
+		DeleteFiber(platform->session);
+	}
+	free(platform);
+}
+
+#endif
+
+int emv_async_init(
+	struct emv_async_t* async,
+	struct emv_ttl_t* ttl,
+	void* stack,
+	size_t stack_size
+)
+{
+	int r;
+
+	if (!async || !ttl || !stack || stack_size < EMV_ASYNC_STACK_MIN) {
+		return EMV_ASYNC_ERROR_INVALID_PARAMETER;
+	}
+
+	memset(async, 0, sizeof(*async));
+	async->ttl = ttl;
+	async->stack = stack;
+	async->stack_size = stack_size;
+
+	r = emv_async_platform_init(async);
+	if (r) {
+		return r;
+	}
+
+	// Install transceive function of resumable session. A TTL extension may
+	// be attached afterwards but batched transceive must not be used such
+	// that each exchange can be suspended individually.
+	ttl->cardreader.ctx = async;
+	ttl->cardreader.trx = &emv_async_trx;
+
+	return 0;
+}
+
+int emv_async_start(
+	struct emv_async_t* async,
+	emv_async_func_t func,
+	void* arg
+)
+{
+	int r;
+
+	if (!async || !func) {
+		return EMV_ASYNC_ERROR_INVALID_PARAMETER;
+	}
+	if (!async->platform) {
+		return EMV_ASYNC_ERROR_INVALID_STATE;
+	}
+	if (async->state == EMV_ASYNC_STATE_NEED_RESPONSE) {
+		// Previous kernel step still pending
+		return EMV_ASYNC_ERROR_INVALID_STATE;
+	}
+
+	async->func = func;
+	async->arg = arg;
+	async->result = 0;
+	async->state = EMV_ASYNC_STATE_IDLE;
+
+	r = emv_async_platform_prepare(async);
+	if (r) {
+		return r;
+	}
+	r = emv_async_switch_to_session(async);
+	if (r) {
+		return r;
+	}
+
+	return async->state;
+}
+
+static int emv_async_trx(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+)
+{
+	struct emv_async_t* async = ctx;
+
+	// Suspend kernel step until the response is available
+	async->tx_buf = tx_buf;
+	async->tx_buf_len = tx_buf_len;
+	async->rx_buf = rx_buf;
+	async->rx_buf_len = rx_buf_len;
+	async->state = EMV_ASYNC_STATE_NEED_RESPONSE;
+	emv_async_switch_to_caller(async);
+
+	async->tx_buf = NULL;
+	async->tx_buf_len = 0;
+	async->rx_buf = NULL;
+	async->rx_buf_len = NULL;
+	async->state = EMV_ASYNC_STATE_IDLE;
+
+	return async->trx_result;
+}
+
+int emv_async_resume(
+	struct emv_async_t* async,
+	const void* rx_buf,
+	size_t rx_buf_len
+)
+{
+	int r;
+
+	if (!async) {
+		return EMV_ASYNC_ERROR_INVALID_PARAMETER;
+	}
+	if (async->state != EMV_ASYNC_STATE_NEED_RESPONSE) {
+		return EMV_ASYNC_ERROR_INVALID_STATE;
+	}
+
+	if (rx_buf && rx_buf_len <= *async->rx_buf_len) {
+		memcpy(async->rx_buf, rx_buf, rx_buf_len);
+		*async->rx_buf_len = rx_buf_len;
+		async->trx_result = 0;
+	} else {
+		// Report card reader failure, including responses that exceed the
+		// kernel's receive buffer
+		*async->rx_buf_len = 0;
+		async->trx_result = EMV_ASYNC_TRX_FAILURE;
+	}
+
+	r = emv_async_switch_to_session(async);
+	if (r) {
+		return r;
+	}
+
+	return async->state;
+}
+
+int emv_async_cancel(struct emv_async_t* async)
+{
+	int r;
+
+	if (!async) {
+		return EMV_ASYNC_ERROR_INVALID_PARAMETER;
+	}
+
+	while (async->state == EMV_ASYNC_STATE_NEED_RESPONSE) {
+		r = emv_async_resume(async, NULL, 0);
+		if (r < 0) {
+			return r;
+		}
+	}
+
+	return 0;
+}
+
+int emv_async_clear(struct emv_async_t* async)
+{
+	int r;
+
+	if (!async) {
+		return EMV_ASYNC_ERROR_INVALID_PARAMETER;
+	}
+
+	r = emv_async_cancel(async);
+	if (r) {
+		return r;
+	}
+
+	if (async->platform) {
+		emv_async_platform_clear(async);
+		async->platform = NULL;
+	}
+	if (async->ttl && async->ttl->cardreader.ctx == async) {
+		async->ttl->cardreader.ctx = NULL;
+		async->ttl->cardreader.trx = NULL;
+	}
+	async->ttl = NULL;
+	async->state = EMV_ASYNC_STATE_IDLE;
+
+	return 0;
+}
+
+#else
+
+int emv_async_init(
+	struct emv_async_t* async,
+	struct emv_ttl_t* ttl,
+	void* stack,
+	size_t stack_size
+)
+{
+	return EMV_ASYNC_ERROR_UNSUPPORTED;
+}
+
+int emv_async_start(
+	struct emv_async_t* async,
+	emv_async_func_t func,
+	void* arg
+)
+{
+	return EMV_ASYNC_ERROR_UNSUPPORTED;
+}
+
+int emv_async_resume(
+	struct emv_async_t* async,
+	const void* rx_buf,
+	size_t rx_buf_len
+)
+{
+	return EMV_ASYNC_ERROR_UNSUPPORTED;
+}
+
+int emv_async_cancel(struct emv_async_t* async)
+{
+	return EMV_ASYNC_ERROR_UNSUPPORTED;
+}
+
+int emv_async_clear(struct emv_async_t* async)
+{
+	return EMV_ASYNC_ERROR_UNSUPPORTED;
+}
+
+#endif
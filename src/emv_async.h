@@ -0,0 +1,189 @@
+/**
+ * @file emv_async.h
+ * @brief Resumable EMV kernel sessions for event loop driven terminals
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EMV_ASYNC_H
+#define EMV_ASYNC_H
+
+#include "emv_ttl.h"
+
+#include <sys/cdefs.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+__BEGIN_DECLS
+
+#define EMV_ASYNC_STACK_MIN (16384) ///< Minimum session stack size in bytes
+#define EMV_ASYNC_STACK_DEFAULT (65536) ///< Recommended session stack size in bytes
+
+/// Resumable session errors
+enum emv_async_error_t {
+	EMV_ASYNC_ERROR_INTERNAL = -1, ///< Internal error
+	EMV_ASYNC_ERROR_INVALID_PARAMETER = -2, ///< Invalid function parameter
+	EMV_ASYNC_ERROR_UNSUPPORTED = -3, ///< Resumable sessions not supported by this platform
+	EMV_ASYNC_ERROR_INVALID_STATE = -4, ///< Function not valid in current session state
+};
+
+/// Resumable session state
+enum emv_async_state_t {
+	EMV_ASYNC_STATE_IDLE = 0, ///< No kernel step started
+	EMV_ASYNC_STATE_NEED_RESPONSE, ///< Kernel step awaits card reader response
+	EMV_ASYNC_STATE_DONE, ///< Kernel step completed. See @ref emv_async_t.result.
+};
+
+/**
+ * Kernel step function run by a resumable session
+ *
+ * Typically a wrapper that calls one or more of the kernel functions in
+ * @ref emv.h, for example @ref emv_build_candidate_list() or
+ * @ref emv_read_application_data(), using a kernel context that was
+ * initialised with the resumable session's transport context.
+ *
+ * @param arg Kernel step argument provided to @ref emv_async_start()
+ * @return Result stored in @ref emv_async_t.result
+ */
+typedef int (*emv_async_func_t)(void* arg);
+
+/**
+ * Resumable EMV kernel session
+ *
+ * A resumable session runs a kernel step on its own stack and suspends it
+ * whenever the kernel transmits to the card reader. The caller transmits
+ * the pending C-APDU or C-TPDU using its own, typically non-blocking, I/O and
+ * resumes the kernel step using @ref emv_async_resume() when the response is
+ * available. A single thread can therefore drive many concurrent sessions,
+ * using a fixed amount of memory per session.
+ *
+ * The kernel is unaware of suspension, so the full behaviour of the blocking
+ * API, including GET RESPONSE and Le correction, is preserved.
+ */
+struct emv_async_t {
+	enum emv_async_state_t state; ///< Session state
+
+	/**
+	 * Pending transmit buffer while @ref state is
+	 * @ref EMV_ASYNC_STATE_NEED_RESPONSE. Only valid until the session is
+	 * resumed.
+	 */
+	const void* tx_buf;
+	size_t tx_buf_len; ///< Length of @ref tx_buf in bytes
+
+	int result; ///< Result of kernel step when @ref state is @ref EMV_ASYNC_STATE_DONE
+
+	/// @cond INTERNAL
+	struct emv_ttl_t* ttl;
+	void* stack;
+	size_t stack_size;
+	emv_async_func_t func;
+	void* arg;
+	void* rx_buf;
+	size_t* rx_buf_len;
+	int trx_result;
+	void* platform;
+	/// @endcond
+};
+
+/**
+ * Determine whether resumable sessions are supported by this platform
+ * @return Boolean indicating whether resumable sessions are supported
+ */
+bool emv_async_is_supported(void);
+
+/**
+ * Initialise resumable session and install its card reader transceive
+ * function on the transport context. The card reader mode of the transport
+ * context is preserved and determines whether C-APDUs or C-TPDUs are
+ * provided by @ref emv_async_t.tx_buf.
+ *
+ * @param async Resumable session
+ * @param ttl EMV Terminal Transport Layer context used by the kernel context
+ * @param stack Session stack. Must be suitably aligned and remain valid
+ *              until @ref emv_async_clear() is called.
+ * @param stack_size Size of session stack in bytes. Must be at least
+ *                   @ref EMV_ASYNC_STACK_MIN.
+ * @return Zero for success. Less than zero for error.
+ *         See @ref emv_async_error_t
+ */
+int emv_async_init(
+	struct emv_async_t* async,
+	struct emv_ttl_t* ttl,
+	void* stack,
+	size_t stack_size
+);
+
+/**
+ * Start kernel step. The kernel step runs until it either completes or
+ * transmits to the card reader.
+ *
+ * @param async Resumable session
+ * @param func Kernel step function
+ * @param arg Kernel step argument
+ * @return Session state for success. Less than zero for error.
+ *         See @ref emv_async_state_t and @ref emv_async_error_t
+ */
+int emv_async_start(
+	struct emv_async_t* async,
+	emv_async_func_t func,
+	void* arg
+);
+
+/**
+ * Resume kernel step with the card reader response to the pending transmit
+ * buffer. The kernel step runs until it either completes or transmits to the
+ * card reader again.
+ *
+ * @param async Resumable session
+ * @param rx_buf Received data. NULL to report card reader failure to the
+ *               kernel, which will typically end the kernel step.
+ * @param rx_buf_len Length of received data in bytes
+ * @return Session state for success. Less than zero for error.
+ *         See @ref emv_async_state_t and @ref emv_async_error_t
+ */
+int emv_async_resume(
+	struct emv_async_t* async,
+	const void* rx_buf,
+	size_t rx_buf_len
+);
+
+/**
+ * Cancel pending kernel step by reporting card reader failure to the kernel
+ * until the kernel step completes. This allows the kernel to release its
+ * resources as it would for a card removed during the transaction.
+ *
+ * @param async Resumable session
+ * @return Zero for success. Less than zero for error.
+ *         See @ref emv_async_error_t
+ */
+int emv_async_cancel(struct emv_async_t* async);
+
+/**
+ * Clear resumable session and release platform resources. The pending kernel
+ * step, if any, is cancelled first.
+ *
+ * @param async Resumable session
+ * @return Zero for success. Less than zero for error.
+ *         See @ref emv_async_error_t
+ */
+int emv_async_clear(struct emv_async_t* async);
+
+__END_DECLS
+
+#endif
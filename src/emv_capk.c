@@ -2,7 +2,7 @@
  * @file emv_capk.c
  * @brief EMV Certificate Authority Public Key (CAPK) helper functions
  *
- * Copyright 2025 Leon Lynch
+ * Copyright 2025-2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -21,14 +21,20 @@
 
 #include "emv_capk.h"
 #include "emv_capk_static_data.h"
+#include "emv_rsa.h"
 
 #include "crypto_sha.h"
 #include "crypto_mem.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
+// Precomputed RSA public key parameters of static CAPKs
+static struct emv_rsa_key_t capk_key_list[sizeof(capk_list) / sizeof(capk_list[0])];
+static bool capk_key_list_ready = false;
+
 static int emv_capk_validate(const struct emv_capk_t* capk)
 {
 	int r;
@@ -86,18 +92,53 @@ int emv_capk_init(void)
 		}
 	}
 
+	if (!capk_key_list_ready) {
+		for (size_t i = 0; i < sizeof(capk_list) / sizeof(capk_list[0]); ++i) {
+			r = emv_rsa_key_init(
+				&capk_key_list[i],
+				capk_list[i].modulus,
+				capk_list[i].modulus_len,
+				capk_list[i].exponent,
+				capk_list[i].exponent_len
+			);
+			if (r) {
+				return r;
+			}
+		}
+		capk_key_list_ready = true;
+	}
+
 	return 0;
 }
 
 const struct emv_capk_t* emv_capk_lookup(const uint8_t* rid, uint8_t index)
+{
+	return emv_capk_list_lookup(
+		capk_list,
+		sizeof(capk_list) / sizeof(capk_list[0]),
+		rid,
+		index
+	);
+}
+
+const struct emv_capk_t* emv_capk_list_lookup(
+	const struct emv_capk_t* list,
+	size_t count,
+	const uint8_t* rid,
+	uint8_t index
+)
 {
 	int r;
 
-	for (size_t i = 0; i < sizeof(capk_list) / sizeof(capk_list[0]); ++i) {
-		if (index == capk_list[i].index &&
-			memcmp(rid, capk_list[i].rid, EMV_CAPK_RID_LEN) == 0
+	if (!list || !rid) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		if (index == list[i].index &&
+			memcmp(rid, list[i].rid, EMV_CAPK_RID_LEN) == 0
 		) {
-			const struct emv_capk_t* capk = &capk_list[i];
+			const struct emv_capk_t* capk = &list[i];
 
 			r = emv_capk_validate(capk);
 			if (r) {
@@ -111,6 +152,26 @@ const struct emv_capk_t* emv_capk_lookup(const uint8_t* rid, uint8_t index)
 	return NULL;
 }
 
+const struct emv_rsa_key_t* emv_capk_get_key(const struct emv_capk_t* capk)
+{
+	if (!capk) {
+		return NULL;
+	}
+	if (capk->key) {
+		return capk->key;
+	}
+
+	if (capk_key_list_ready) {
+		for (size_t i = 0; i < sizeof(capk_list) / sizeof(capk_list[0]); ++i) {
+			if (capk == &capk_list[i]) {
+				return &capk_key_list[i];
+			}
+		}
+	}
+
+	return NULL;
+}
+
 int emv_capk_itr_init(struct emv_capk_itr_t* itr)
 {
 	if (!itr) {
@@ -2,7 +2,7 @@
  * @file emv_capk.h
  * @brief EMV Certificate Authority Public Key (CAPK) helper functions
  *
- * Copyright 2025 Leon Lynch
+ * Copyright 2025-2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -28,6 +28,9 @@
 
 __BEGIN_DECLS
 
+// Forward declarations
+struct emv_rsa_key_t;
+
 #define EMV_CAPK_RID_LEN (5) ///< Length of Registered Application Provider Identifier (RID) in bytes
 
 /**
@@ -45,6 +48,13 @@ struct emv_capk_t {
 	size_t exponent_len; ///< Length of CAPK exponent in bytes
 	const void* hash; ///< CAPK hash of RID, index, modulus and exponent
 	size_t hash_len; ///< Length of CAPK hash in bytes
+
+	/**
+	 * Optional precomputed RSA public key parameters. See
+	 * @ref emv_rsa_key_init(). NULL to compute them as needed or to use the
+	 * parameters cached by @ref emv_capk_init() for static CAPKs.
+	 */
+	const struct emv_rsa_key_t* key;
 };
 
 /// Certificate Authority Public Key (CAPK) iterator
@@ -54,7 +64,8 @@ struct emv_capk_itr_t {
 
 /**
  * Initialise and verify integrity of Certificate Authority Public Key (CAPK)
- * data
+ * data. This function also precomputes the RSA public key parameters of each
+ * static CAPK and should be called before EMV processing.
  *
  * @return Zero for success. Non-zero for error.
  */
@@ -70,6 +81,38 @@ int emv_capk_init(void);
  */
 const struct emv_capk_t* emv_capk_lookup(const uint8_t* rid, uint8_t index);
 
+/**
+ * Lookup Certificate Authority Public Key (CAPK) in caller provided list
+ *
+ * This function applies the same integrity validation as
+ * @ref emv_capk_lookup() and is intended for CAPKs that are not part of the
+ * static CAPK data, such as test or simulated card hierarchies.
+ *
+ * @param list List of Certificate Authority Public Keys (CAPKs)
+ * @param count Number of entries in @p list
+ * @param rid Registered Application Provider Identifier (RID). Must be 5 bytes.
+ * @param index Index of Certificate Authority Public Key (CAPK)
+ * @return Pointer to Certificate Authority Public Key (CAPK) in @p list.
+ *         NULL if not found or invalid.
+ */
+const struct emv_capk_t* emv_capk_list_lookup(
+	const struct emv_capk_t* list,
+	size_t count,
+	const uint8_t* rid,
+	uint8_t index
+);
+
+/**
+ * Retrieve precomputed RSA public key parameters of Certificate Authority
+ * Public Key (CAPK)
+ *
+ * @param capk Certificate Authority Public Key (CAPK)
+ * @return Precomputed RSA public key parameters provided by
+ *         @ref emv_capk_t.key or cached by @ref emv_capk_init(). Do NOT free.
+ *         NULL if not available.
+ */
+const struct emv_rsa_key_t* emv_capk_get_key(const struct emv_capk_t* capk);
+
 /**
  * Initialise Certificate Authority Public Key (CAPK) iterator
  *
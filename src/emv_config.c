@@ -0,0 +1,443 @@
+/**
+ * @file emv_config.c
+ * @brief Immutable terminal configuration shared by EMV processing contexts
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_config.h"
+#include "emv.h"
+#include "emv_aid_trie.h"
+#include "emv_tlv.h"
+#include "emv_tags.h"
+#include "emv_fields.h"
+
+#define EMV_DEBUG_SOURCE EMV_DEBUG_SOURCE_EMV
+#include "emv_debug.h"
+
+#include "emv_utils_config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h> // For malloc() and free()
+#include <string.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+struct emv_config_t {
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t mutex;
+#endif
+	unsigned int refcount;
+
+	struct emv_tlv_list_t config;
+	struct emv_tlv_list_t supported_aids;
+
+	// Configuration fields sorted by tag
+	size_t index_count;
+	const struct emv_tlv_t** index;
+
+	// Supported AIDs compiled for application selection
+	struct emv_aid_trie_t* supported_aid_trie;
+};
+
+struct emv_config_slot_t {
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t mutex;
+#endif
+	struct emv_config_t* config;
+};
+
+/// Expected lengths of configuration fields that are used by EMV processing
+static const struct {
+	unsigned int tag;
+	unsigned int min_len;
+	unsigned int max_len;
+} emv_config_field_len[] = {
+	{ EMV_TAG_9F09_APPLICATION_VERSION_NUMBER_TERMINAL, 2, 2 },
+	{ EMV_TAG_9F1A_TERMINAL_COUNTRY_CODE, 2, 2 },
+	{ EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT, 4, 4 },
+	{ EMV_TAG_9F33_TERMINAL_CAPABILITIES, 3, 3 },
+	{ EMV_TAG_9F35_TERMINAL_TYPE, 1, 1 },
+	{ EMV_TAG_9F40_ADDITIONAL_TERMINAL_CAPABILITIES, 5, 5 },
+	{ EMV_TAG_9F49_DDOL, 2, 252 },
+};
+
+static bool emv_config_field_is_valid(const struct emv_tlv_t* tlv)
+{
+	for (size_t i = 0; i < sizeof(emv_config_field_len) / sizeof(emv_config_field_len[0]); ++i) {
+		if (emv_config_field_len[i].tag == tlv->tag) {
+			return tlv->length >= emv_config_field_len[i].min_len &&
+				tlv->length <= emv_config_field_len[i].max_len;
+		}
+	}
+
+	return true;
+}
+
+static bool emv_config_aid_is_valid(const struct emv_tlv_t* tlv)
+{
+	// See EMV 4.4 Book 1, 12.2.1
+	return tlv->tag == EMV_TAG_9F06_AID &&
+		tlv->length >= 5 &&
+		tlv->length <= 16 &&
+		(tlv->flags == EMV_ASI_EXACT_MATCH || tlv->flags == EMV_ASI_PARTIAL_MATCH);
+}
+
+static int emv_config_index_compare(const void* a, const void* b)
+{
+	const struct emv_tlv_t* tlv_a = *(const struct emv_tlv_t* const*)a;
+	const struct emv_tlv_t* tlv_b = *(const struct emv_tlv_t* const*)b;
+
+	if (tlv_a->tag < tlv_b->tag) {
+		return -1;
+	}
+	if (tlv_a->tag > tlv_b->tag) {
+		return 1;
+	}
+	return 0;
+}
+
+static void emv_config_copy_list(
+	const struct emv_tlv_list_t* src,
+	struct emv_tlv_list_t* dst,
+	struct emv_tlv_t** node,
+	uint8_t** value
+)
+{
+	for (const struct emv_tlv_t* tlv = src->front; tlv != NULL; tlv = tlv->next) {
+		struct emv_tlv_t* copy = *node;
+
+		copy->tag = tlv->tag;
+		copy->length = tlv->length;
+		copy->value = *value;
+		copy->flags = tlv->flags;
+		copy->next = NULL;
+		if (tlv->length) {
+			memcpy(copy->value, tlv->value, tlv->length);
+		}
+
+		if (dst->back) {
+			dst->back->next = copy;
+		} else {
+			dst->front = copy;
+		}
+		dst->back = copy;
+
+		*node += 1;
+		*value += tlv->length;
+	}
+}
+
+struct emv_config_t* emv_config_create(
+	const struct emv_tlv_list_t* config,
+	const struct emv_tlv_list_t* supported_aids
+)
+{
+	size_t config_count = 0;
+	size_t aid_count = 0;
+	size_t value_len = 0;
+	const struct emv_tlv_t* tlv;
+	struct emv_config_t* snapshot;
+	struct emv_tlv_t* node;
+	uint8_t* value;
+
+	if (!config) {
+		return NULL;
+	}
+
+	if (emv_tlv_list_has_duplicate(config)) {
+		emv_debug_error("Terminal configuration contains duplicate fields");
+		return NULL;
+	}
+	for (tlv = config->front; tlv != NULL; tlv = tlv->next) {
+		if (!emv_config_field_is_valid(tlv)) {
+			emv_debug_trace_msg("tag=%04X, length=%u", tlv->tag, tlv->length);
+			emv_debug_error("Terminal configuration field is invalid");
+			return NULL;
+		}
+		++config_count;
+		value_len += tlv->length;
+	}
+	if (supported_aids) {
+		for (tlv = supported_aids->front; tlv != NULL; tlv = tlv->next) {
+			if (!emv_config_aid_is_valid(tlv)) {
+				emv_debug_trace_msg("tag=%04X, length=%u, flags=%02X", tlv->tag, tlv->length, tlv->flags);
+				emv_debug_error("Supported AID is invalid");
+				return NULL;
+			}
+			++aid_count;
+			value_len += tlv->length;
+		}
+	}
+
+	// Single allocation consisting of the object itself, followed by the
+	// list nodes, the index and finally the values
+	snapshot = malloc(
+		sizeof(*snapshot) +
+		(config_count + aid_count) * sizeof(struct emv_tlv_t) +
+		config_count * sizeof(snapshot->index[0]) +
+		value_len
+	);
+	if (!snapshot) {
+		emv_debug_error("Failed to allocate terminal configuration");
+		return NULL;
+	}
+	memset(snapshot, 0, sizeof(*snapshot));
+#ifdef HAVE_PTHREAD
+	if (pthread_mutex_init(&snapshot->mutex, NULL)) {
+		emv_debug_error("Failed to initialise terminal configuration mutex");
+		free(snapshot);
+		return NULL;
+	}
+#endif
+	snapshot->refcount = 1;
+
+	node = (struct emv_tlv_t*)(snapshot + 1);
+	snapshot->index = (const struct emv_tlv_t**)(node + config_count + aid_count);
+	value = (uint8_t*)(snapshot->index + config_count);
+
+	emv_config_copy_list(config, &snapshot->config, &node, &value);
+	if (supported_aids) {
+		emv_config_copy_list(supported_aids, &snapshot->supported_aids, &node, &value);
+	}
+
+	for (tlv = snapshot->config.front; tlv != NULL; tlv = tlv->next) {
+		snapshot->index[snapshot->index_count++] = tlv;
+	}
+	qsort(
+		snapshot->index,
+		snapshot->index_count,
+		sizeof(snapshot->index[0]),
+		&emv_config_index_compare
+	);
+
+	snapshot->supported_aid_trie = emv_aid_trie_create_from_list(&snapshot->supported_aids);
+	if (!snapshot->supported_aid_trie) {
+		emv_debug_error("Failed to compile supported AIDs");
+		emv_config_unref(snapshot);
+		return NULL;
+	}
+
+	return snapshot;
+}
+
+struct emv_config_t* emv_config_ref(struct emv_config_t* config)
+{
+	if (!config) {
+		return NULL;
+	}
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&config->mutex);
+#endif
+	++config->refcount;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&config->mutex);
+#endif
+
+	return config;
+}
+
+void emv_config_unref(struct emv_config_t* config)
+{
+	unsigned int refcount;
+
+	if (!config) {
+		return;
+	}
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&config->mutex);
+#endif
+	refcount = --config->refcount;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&config->mutex);
+#endif
+	if (refcount) {
+		return;
+	}
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_destroy(&config->mutex);
+#endif
+	emv_aid_trie_free(config->supported_aid_trie);
+	free(config);
+}
+
+const struct emv_tlv_list_t* emv_config_get_tlv_list(const struct emv_config_t* config)
+{
+	if (!config) {
+		return NULL;
+	}
+
+	return &config->config;
+}
+
+const struct emv_tlv_list_t* emv_config_get_supported_aids(const struct emv_config_t* config)
+{
+	if (!config) {
+		return NULL;
+	}
+
+	return &config->supported_aids;
+}
+
+const struct emv_aid_trie_t* emv_config_get_supported_aid_trie(const struct emv_config_t* config)
+{
+	if (!config) {
+		return NULL;
+	}
+
+	return config->supported_aid_trie;
+}
+
+const struct emv_tlv_t* emv_config_find_const(
+	const struct emv_config_t* config,
+	unsigned int tag
+)
+{
+	size_t lo = 0;
+	size_t hi;
+
+	if (!config) {
+		return NULL;
+	}
+
+	hi = config->index_count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		const struct emv_tlv_t* tlv = config->index[mid];
+
+		if (tlv->tag == tag) {
+			return tlv;
+		}
+		if (tlv->tag < tag) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return NULL;
+}
+
+const struct emv_tlv_t* emv_config_find_from_ctx(
+	const struct emv_ctx_t* ctx,
+	unsigned int tag
+)
+{
+	const struct emv_tlv_t* tlv;
+
+	if (!ctx) {
+		return NULL;
+	}
+
+	// Terminal configuration of the context takes precedence over the shared
+	// terminal configuration
+	tlv = emv_tlv_list_find_const(&ctx->config, tag);
+	if (tlv || !ctx->shared_config) {
+		return tlv;
+	}
+
+	return emv_config_find_const(ctx->shared_config, tag);
+}
+
+struct emv_config_slot_t* emv_config_slot_create(struct emv_config_t* config)
+{
+	struct emv_config_slot_t* slot;
+
+	slot = calloc(1, sizeof(*slot));
+	if (!slot) {
+		emv_debug_error("Failed to allocate terminal configuration holder");
+		return NULL;
+	}
+#ifdef HAVE_PTHREAD
+	if (pthread_mutex_init(&slot->mutex, NULL)) {
+		emv_debug_error("Failed to initialise terminal configuration holder mutex");
+		free(slot);
+		return NULL;
+	}
+#endif
+	slot->config = emv_config_ref(config);
+
+	return slot;
+}
+
+int emv_config_slot_publish(
+	struct emv_config_slot_t* slot,
+	struct emv_config_t* config
+)
+{
+	struct emv_config_t* prev;
+
+	if (!slot) {
+		return -1;
+	}
+
+	// Obtain the new reference before taking the lock and release the
+	// previous reference after releasing the lock such that the last release
+	// of the previous version never happens while holding the lock
+	emv_config_ref(config);
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&slot->mutex);
+#endif
+	prev = slot->config;
+	slot->config = config;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&slot->mutex);
+#endif
+	emv_config_unref(prev);
+
+	return 0;
+}
+
+struct emv_config_t* emv_config_slot_acquire(struct emv_config_slot_t* slot)
+{
+	struct emv_config_t* config;
+
+	if (!slot) {
+		return NULL;
+	}
+
+	// The reference must be obtained while holding the lock to prevent the
+	// current version from being released by a concurrent publish
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&slot->mutex);
+#endif
+	config = emv_config_ref(slot->config);
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&slot->mutex);
+#endif
+
+	return config;
+}
+
+void emv_config_slot_free(struct emv_config_slot_t* slot)
+{
+	if (!slot) {
+		return;
+	}
+
+	emv_config_unref(slot->config);
+#ifdef HAVE_PTHREAD
+	pthread_mutex_destroy(&slot->mutex);
+#endif
+	free(slot);
+}
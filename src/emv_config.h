@@ -0,0 +1,201 @@
+/**
+ * @file emv_config.h
+ * @brief Immutable terminal configuration shared by EMV processing contexts
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EMV_CONFIG_H
+#define EMV_CONFIG_H
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+
+__BEGIN_DECLS
+
+// Forward declarations
+struct emv_aid_trie_t;
+struct emv_ctx_t;
+struct emv_tlv_t;
+struct emv_tlv_list_t;
+
+/**
+ * Immutable terminal configuration
+ *
+ * Consists of terminal configuration fields, similar to
+ * @ref emv_ctx_t.config, and supported AIDs, similar to
+ * @ref emv_ctx_t.supported_aids, that are validated and copied into a single
+ * allocation with an index of the configuration fields by tag. The object is
+ * reference counted and never modified after creation such that multiple
+ * EMV processing contexts, including those used by different threads, can
+ * share it using @ref emv_ctx_set_config().
+ */
+struct emv_config_t;
+
+/**
+ * Holder of the current version of an immutable terminal configuration
+ *
+ * Allows a new version of the terminal configuration to be published while
+ * other threads acquire the current version between transactions.
+ */
+struct emv_config_slot_t;
+
+/**
+ * Create immutable terminal configuration from terminal configuration fields
+ * and supported AIDs.
+ *
+ * The terminal configuration fields must not contain duplicates and the
+ * fields that are used by EMV processing must have valid lengths if
+ * present. The supported AIDs must be Terminal Application Identifier
+ * (field 9F06) fields with a valid length and with @ref emv_tlv_t.flags set
+ * to either @ref EMV_ASI_EXACT_MATCH or @ref EMV_ASI_PARTIAL_MATCH.
+ *
+ * @param config Terminal configuration fields to copy
+ * @param supported_aids Supported AID (field 9F06) list to copy. NULL if no
+ *                       AIDs are supported.
+ * @return Terminal configuration with a reference count of one. Use
+ *         @ref emv_config_unref() to release it. NULL for error or invalid
+ *         configuration.
+ */
+struct emv_config_t* emv_config_create(
+	const struct emv_tlv_list_t* config,
+	const struct emv_tlv_list_t* supported_aids
+);
+
+/**
+ * Obtain additional reference to immutable terminal configuration.
+ * @note This function is thread safe.
+ *
+ * @param config Terminal configuration
+ * @return Terminal configuration provided by @p config
+ */
+struct emv_config_t* emv_config_ref(struct emv_config_t* config);
+
+/**
+ * Release reference to immutable terminal configuration and free it when the
+ * last reference is released.
+ * @note This function is thread safe.
+ *
+ * @param config Terminal configuration. NULL is ignored.
+ */
+void emv_config_unref(struct emv_config_t* config);
+
+/**
+ * Retrieve terminal configuration fields of immutable terminal configuration.
+ * The list must not be modified.
+ *
+ * @param config Terminal configuration
+ * @return Terminal configuration fields. NULL for error.
+ */
+const struct emv_tlv_list_t* emv_config_get_tlv_list(const struct emv_config_t* config);
+
+/**
+ * Retrieve supported AIDs of immutable terminal configuration. The list must
+ * not be modified.
+ *
+ * @param config Terminal configuration
+ * @return Supported AID (field 9F06) list. NULL for error.
+ */
+const struct emv_tlv_list_t* emv_config_get_supported_aids(const struct emv_config_t* config);
+
+/**
+ * Retrieve AID prefix trie of the supported AIDs of immutable terminal
+ * configuration. The trie is created together with the configuration such
+ * that application selection does not depend on the number of supported
+ * AIDs.
+ *
+ * @param config Terminal configuration
+ * @return AID prefix trie. Do NOT free. NULL for error.
+ */
+const struct emv_aid_trie_t* emv_config_get_supported_aid_trie(const struct emv_config_t* config);
+
+/**
+ * Find terminal configuration field in immutable terminal configuration using
+ * its index.
+ *
+ * @param config Terminal configuration
+ * @param tag EMV tag to find
+ * @return EMV TLV field. Do NOT free. NULL if not found.
+ */
+const struct emv_tlv_t* emv_config_find_const(
+	const struct emv_config_t* config,
+	unsigned int tag
+);
+
+/**
+ * Find terminal configuration field of EMV processing context. This searches
+ * @ref emv_ctx_t.config first and then uses the index of
+ * @ref emv_ctx_t.shared_config if available.
+ *
+ * @param ctx EMV processing context
+ * @param tag EMV tag to find
+ * @return EMV TLV field. Do NOT free. NULL if not found.
+ */
+const struct emv_tlv_t* emv_config_find_from_ctx(
+	const struct emv_ctx_t* ctx,
+	unsigned int tag
+);
+
+/**
+ * Create holder of the current version of an immutable terminal
+ * configuration.
+ *
+ * @param config Initial terminal configuration. The holder obtains its own
+ *               reference. NULL for none.
+ * @return Terminal configuration holder. Use @ref emv_config_slot_free() to
+ *         free it. NULL for error.
+ */
+struct emv_config_slot_t* emv_config_slot_create(struct emv_config_t* config);
+
+/**
+ * Publish new version of immutable terminal configuration. Threads that have
+ * already acquired the previous version may continue to use it until they
+ * release it.
+ * @note This function is thread safe.
+ *
+ * @param slot Terminal configuration holder
+ * @param config New terminal configuration. The holder obtains its own
+ *               reference. NULL for none.
+ * @return Zero for success. Less than zero for error.
+ */
+int emv_config_slot_publish(
+	struct emv_config_slot_t* slot,
+	struct emv_config_t* config
+);
+
+/**
+ * Acquire current version of immutable terminal configuration, typically
+ * before a transaction is started.
+ * @note This function is thread safe.
+ *
+ * @param slot Terminal configuration holder
+ * @return Terminal configuration with a new reference. Use
+ *         @ref emv_config_unref() to release it. NULL if none or for error.
+ */
+struct emv_config_t* emv_config_slot_acquire(struct emv_config_slot_t* slot);
+
+/**
+ * Free holder of immutable terminal configuration and release its reference
+ * to the current version.
+ *
+ * @param slot Terminal configuration holder. NULL is ignored.
+ */
+void emv_config_slot_free(struct emv_config_slot_t* slot);
+
+__END_DECLS
+
+#endif
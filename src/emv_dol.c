@@ -2,7 +2,7 @@
  * @file emv_dol.c
  * @brief EMV Data Object List (DOL) processing functions
  *
- * Copyright 2021, 2024-2025 Leon Lynch
+ * Copyright 2021, 2024-2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -129,6 +129,127 @@ int emv_dol_compute_data_length(const void* ptr, size_t len)
 	return total;
 }
 
+static int emv_dol_sources_validate(const struct emv_tlv_sources_t* sources)
+{
+	if (!sources->count ||
+		sources->count > sizeof(sources->list) / sizeof(sources->list[0])
+	) {
+		return -2;
+	}
+	for (size_t i = 0; i < sources->count; ++i) {
+		if (!sources->list[i]) {
+			return -3;
+		}
+	}
+
+	return 0;
+}
+
+static uint8_t emv_dol_get_rule(unsigned int tag)
+{
+	if (emv_tlv_is_format_n(tag)) {
+		return EMV_DOL_PLAN_RULE_N;
+	} else if (emv_tlv_is_format_cn(tag)) {
+		return EMV_DOL_PLAN_RULE_CN;
+	} else {
+		return EMV_DOL_PLAN_RULE_B;
+	}
+}
+
+static void emv_dol_populate_entry(
+	const struct emv_tlv_t* tlv,
+	unsigned int length,
+	uint8_t rule,
+	uint8_t* data_ptr
+)
+{
+	unsigned int pad_len;
+
+	if (!tlv) {
+		// If TLV is not found, zero data output
+		// See EMV 4.4 Book 3, 5.4, step 2b
+		memset(data_ptr, 0, length);
+		return;
+	}
+
+	if (tlv->length >= length) {
+		// TLV is found and length is at least that of the DOL entry,
+		// requiring truncation if it is more
+		// See EMV 4.4 Book 3, 5.4, step 2c
+		unsigned int offset = 0;
+		if (rule == EMV_DOL_PLAN_RULE_N) {
+			offset = tlv->length - length;
+		}
+		memcpy(data_ptr, tlv->value + offset, length);
+		return;
+	}
+
+	// TLV is found and length is less than DOL entry, requiring padding
+	// See EMV 4.4 Book 3, 5.4, step 2d
+	pad_len = length - tlv->length;
+	switch (rule) {
+		case EMV_DOL_PLAN_RULE_N:
+			memset(data_ptr, 0, pad_len);
+			memcpy(data_ptr + pad_len, tlv->value, tlv->length);
+			break;
+
+		case EMV_DOL_PLAN_RULE_CN:
+			memcpy(data_ptr, tlv->value, tlv->length);
+			memset(data_ptr + tlv->length, 0xFF, pad_len);
+			break;
+
+		default:
+			memcpy(data_ptr, tlv->value, tlv->length);
+			memset(data_ptr + tlv->length, 0, pad_len);
+			break;
+	}
+}
+
+static int emv_dol_plan_compile_itr(struct emv_dol_itr_t* itr, struct emv_dol_plan_t* plan)
+{
+	int r = 0;
+	struct emv_dol_entry_t entry;
+
+	plan->data_len = 0;
+	plan->count = 0;
+
+	// Compile entries until the end of the DOL or until the plan is full
+	while (plan->count < EMV_DOL_PLAN_ENTRY_MAX &&
+		(r = emv_dol_itr_next(itr, &entry)) > 0
+	) {
+		struct emv_dol_plan_entry_t* plan_entry = &plan->entry[plan->count];
+
+		plan_entry->tag = entry.tag;
+		plan_entry->offset = plan->data_len;
+		plan_entry->length = entry.length;
+		plan_entry->rule = emv_dol_get_rule(entry.tag);
+
+		plan->data_len += entry.length;
+		++plan->count;
+	}
+
+	// Zero for end of DOL, greater than zero if the plan is full
+	return r;
+}
+
+static void emv_dol_plan_execute(
+	const struct emv_dol_plan_t* plan,
+	const struct emv_tlv_sources_t* sources,
+	uint8_t* data
+)
+{
+	for (unsigned int i = 0; i < plan->count; ++i) {
+		const struct emv_dol_plan_entry_t* plan_entry = &plan->entry[i];
+
+		emv_dol_populate_entry(
+			emv_tlv_sources_find_const(sources, plan_entry->tag),
+			plan_entry->length,
+			plan_entry->rule,
+			data + plan_entry->offset
+		);
+	}
+}
+
 int emv_dol_build_data(
 	const void* ptr,
 	size_t len,
@@ -140,20 +261,14 @@ int emv_dol_build_data(
 	int r;
 	struct emv_dol_itr_t itr;
 	struct emv_dol_entry_t entry;
-	void* data_ptr = data;
+	uint8_t* data_ptr = data;
 
 	if (!ptr || !len || !sources || !data || !data_len || !*data_len) {
 		return -1;
 	}
-	if (!sources->count ||
-		sources->count > sizeof(sources->list) / sizeof(sources->list[0])
-	) {
-		return -2;
-	}
-	for (size_t i = 0; i < sources->count; ++i) {
-		if (!sources->list[i]) {
-			return -3;
-		}
+	r = emv_dol_sources_validate(sources);
+	if (r) {
+		return r;
 	}
 
 	r = emv_dol_itr_init(ptr, len, &itr);
@@ -162,71 +277,152 @@ int emv_dol_build_data(
 	}
 
 	while ((r = emv_dol_itr_next(&itr, &entry)) > 0) {
-		const struct emv_tlv_t* tlv;
-
 		if (*data_len < entry.length) {
 			// Output data length too small
 			return 1;
 		}
 
-		// Populate concatenated data for DOL entry
-		tlv = emv_tlv_sources_find_const(sources, entry.tag);
-		if (!tlv) {
-			// If TLV is not found, zero data output
-			// See EMV 4.4 Book 3, 5.4, step 2b
-			memset(data_ptr, 0, entry.length);
-			data_ptr += entry.length;
-			*data_len -= entry.length;
-			continue;
-		}
+		// Populate concatenated data for DOL entry using the same padding
+		// and truncation rules as a plan
+		emv_dol_populate_entry(
+			emv_tlv_sources_find_const(sources, entry.tag),
+			entry.length,
+			emv_dol_get_rule(entry.tag),
+			data_ptr
+		);
+		data_ptr += entry.length;
+		*data_len -= entry.length;
+	}
+	if (r != 0) {
+		return -6;
+	}
 
-		if (tlv->length == entry.length) {
-			// TLV is found and length matches DOL entry
-			memcpy(data_ptr, tlv->value, entry.length);
-			data_ptr += entry.length;
-			*data_len -= entry.length;
-			continue;
-		}
+	*data_len = data_ptr - (uint8_t*)data;
+	return 0;
+}
 
-		if (tlv->length > entry.length) {
-			// TLV is found and length is more than DOL entry, requiring truncation
-			// See EMV 4.4 Book 3, 5.4, step 2c
-			unsigned int offset = 0;
-			if (emv_tlv_is_format_n(tlv->tag)) {
-				offset = tlv->length - entry.length;
-			}
-			memcpy(data_ptr, tlv->value + offset, entry.length);
-			data_ptr += entry.length;
-			*data_len -= entry.length;
-			continue;
-		}
+int emv_dol_plan_compile(const void* ptr, size_t len, struct emv_dol_plan_t* plan)
+{
+	int r;
+	struct emv_dol_itr_t itr;
 
-		if (tlv->length < entry.length) {
-			// TLV is found and length is less than DOL entry, requiring padding
-			// See EMV 4.4 Book 3, 5.4, step 2d
-			unsigned int pad_len = entry.length - tlv->length;
-			if (emv_tlv_is_format_n(tlv->tag)) {
-				memset(data_ptr, 0, pad_len);
-				memcpy(data_ptr + pad_len, tlv->value, tlv->length);
-			} else if (emv_tlv_is_format_cn(tlv->tag)) {
-				memcpy(data_ptr, tlv->value, tlv->length);
-				memset(data_ptr + tlv->length, 0xFF, pad_len);
-			} else {
-				memcpy(data_ptr, tlv->value, tlv->length);
-				memset(data_ptr + tlv->length, 0, pad_len);
-			}
-			data_ptr += entry.length;
-			*data_len -= entry.length;
-			continue;
-		}
+	if (!ptr || !len || !plan) {
+		return -1;
+	}
+	plan->dol_len = 0;
+	if (len > sizeof(plan->dol)) {
+		// DOL too large for plan
+		return 1;
+	}
 
-		// This should never happen
-		return -5;
+	r = emv_dol_itr_init(ptr, len, &itr);
+	if (r) {
+		return -2;
 	}
+	r = emv_dol_plan_compile_itr(&itr, plan);
 	if (r != 0) {
-		return -6;
+		// A DOL that fits in the plan never has more entries than the plan
+		return -3;
+	}
+
+	memcpy(plan->dol, ptr, len);
+	plan->dol_len = len;
+
+	return 0;
+}
+
+bool emv_dol_plan_matches(const struct emv_dol_plan_t* plan, const void* ptr, size_t len)
+{
+	if (!plan || !ptr || !len) {
+		return false;
+	}
+
+	return plan->dol_len == len && memcmp(plan->dol, ptr, len) == 0;
+}
+
+int emv_dol_plan_build_data(
+	const struct emv_dol_plan_t* plan,
+	const struct emv_tlv_sources_t* sources,
+	void* data,
+	size_t* data_len
+)
+{
+	int r;
+
+	if (!plan || !sources || !data || !data_len || !*data_len) {
+		return -1;
+	}
+	r = emv_dol_sources_validate(sources);
+	if (r) {
+		return r;
+	}
+	if (!plan->dol_len) {
+		return -4;
 	}
+	if (*data_len < plan->data_len) {
+		// Output data length too small
+		return 1;
+	}
+
+	emv_dol_plan_execute(plan, sources, data);
+	*data_len = plan->data_len;
 
-	*data_len = data_ptr - data;
 	return 0;
 }
+
+const struct emv_dol_plan_t* emv_dol_plan_cache_get(
+	struct emv_dol_plan_cache_t* cache,
+	const void* ptr,
+	size_t len
+)
+{
+	int r;
+	struct emv_dol_plan_t* plan;
+
+	if (!cache || !ptr || !len) {
+		return NULL;
+	}
+
+	for (unsigned int i = 0; i < EMV_DOL_PLAN_CACHE_SIZE; ++i) {
+		if (emv_dol_plan_matches(&cache->plan[i], ptr, len)) {
+			return &cache->plan[i];
+		}
+	}
+
+	// Replace least recently compiled plan
+	plan = &cache->plan[cache->next % EMV_DOL_PLAN_CACHE_SIZE];
+	r = emv_dol_plan_compile(ptr, len, plan);
+	if (r) {
+		return NULL;
+	}
+	cache->next = (cache->next + 1) % EMV_DOL_PLAN_CACHE_SIZE;
+
+	return plan;
+}
+
+int emv_dol_plan_cache_build_data(
+	struct emv_dol_plan_cache_t* cache,
+	const void* ptr,
+	size_t len,
+	const struct emv_tlv_sources_t* sources,
+	void* data,
+	size_t* data_len
+)
+{
+	const struct emv_dol_plan_t* plan;
+
+	if (!cache) {
+		// Plan cache not used
+		return emv_dol_build_data(ptr, len, sources, data, data_len);
+	}
+
+	plan = emv_dol_plan_cache_get(cache, ptr, len);
+	if (!plan) {
+		// DOL is either invalid or too large to compile into a plan and
+		// therefore the uncached implementation reports the error or
+		// builds the data
+		return emv_dol_build_data(ptr, len, sources, data, data_len);
+	}
+
+	return emv_dol_plan_build_data(plan, sources, data, data_len);
+}
@@ -3,7 +3,7 @@
  * @brief EMV Data Object List (DOL) processing functions
  * @remark See EMV 4.4 Book 3, 5.4
  *
- * Copyright 2021, 2024-2025 Leon Lynch
+ * Copyright 2021, 2024-2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -25,7 +25,9 @@
 #define EMV_DOL_H
 
 #include <sys/cdefs.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 __BEGIN_DECLS
 
@@ -44,6 +46,62 @@ struct emv_dol_itr_t {
 	size_t len; ///< Length of encoded EMV Data Object List (DOL) in bytes
 };
 
+/// Maximum length of encoded EMV Data Object List (DOL) that can be compiled
+/// into a @ref emv_dol_plan_t
+#define EMV_DOL_PLAN_DOL_MAX (255)
+
+/// Maximum number of entries of @ref emv_dol_plan_t
+#define EMV_DOL_PLAN_ENTRY_MAX (EMV_DOL_PLAN_DOL_MAX / 2)
+
+/// Number of plans cached by @ref emv_dol_plan_cache_t
+#define EMV_DOL_PLAN_CACHE_SIZE (4)
+
+/**
+ * Padding and truncation rule of EMV Data Object List (DOL) plan entry
+ * @remark See EMV 4.4 Book 3, 5.4
+ */
+enum emv_dol_plan_rule_t {
+	EMV_DOL_PLAN_RULE_B = 0, ///< Truncate right; pad right with hex zeros
+	EMV_DOL_PLAN_RULE_N, ///< Format 'n': truncate left; pad left with hex zeros
+	EMV_DOL_PLAN_RULE_CN, ///< Format 'cn': truncate right; pad right with hex 'FF's
+};
+
+/// EMV Data Object List (DOL) plan entry
+struct emv_dol_plan_entry_t {
+	unsigned int tag; ///< EMV tag
+	uint16_t offset; ///< Offset of entry in concatenated data
+	uint8_t length; ///< Expected length
+	uint8_t rule; ///< Padding and truncation rule. See @ref emv_dol_plan_rule_t
+};
+
+/**
+ * Compiled EMV Data Object List (DOL) plan
+ *
+ * A plan is created from an encoded DOL by @ref emv_dol_plan_compile() and
+ * can be executed by @ref emv_dol_plan_build_data() for multiple
+ * transactions without decoding the DOL again.
+ */
+struct emv_dol_plan_t {
+	uint8_t dol[EMV_DOL_PLAN_DOL_MAX]; ///< Encoded EMV Data Object List (DOL) from which the plan was compiled
+	size_t dol_len; ///< Length of encoded EMV Data Object List (DOL) in bytes. Zero if plan is not populated.
+	size_t data_len; ///< Length of concatenated data in bytes
+	unsigned int count; ///< Number of entries
+	struct emv_dol_plan_entry_t entry[EMV_DOL_PLAN_ENTRY_MAX]; ///< Plan entries in DOL order
+};
+
+/**
+ * Cache of compiled EMV Data Object List (DOL) plans, keyed by encoded DOL
+ *
+ * Initialise by zeroing the object. Use @ref emv_ctx_t.dol_plan_cache to
+ * enable it for EMV processing.
+ */
+struct emv_dol_plan_cache_t {
+	struct emv_dol_plan_t plan[EMV_DOL_PLAN_CACHE_SIZE]; ///< Cached plans
+	/// @cond INTERNAL
+	unsigned int next;
+	/// @endcond
+};
+
 /**
  * Decode EMV Data Object List (DOL) entry
  * @remark See EMV 4.4 Book 3, 5.4
@@ -97,6 +155,87 @@ int emv_dol_build_data(
 	size_t* data_len
 );
 
+/**
+ * Compile EMV Data Object List (DOL) into plan
+ *
+ * The plan resolves the offset of each entry in the concatenated data and
+ * whether the entry requires format 'n', format 'cn' or other padding and
+ * truncation, such that building the concatenated data only requires the
+ * data to be found in the EMV TLV sources.
+ *
+ * @param ptr Encoded EMV Data Object List (DOL)
+ * @param len Length of encoded EMV Data Object List (DOL) in bytes
+ * @param plan DOL plan output
+ * @return Zero for success. Less than zero for error. Greater than zero if DOL exceeds @ref EMV_DOL_PLAN_DOL_MAX.
+ */
+int emv_dol_plan_compile(const void* ptr, size_t len, struct emv_dol_plan_t* plan);
+
+/**
+ * Determine whether EMV Data Object List (DOL) plan was compiled from the
+ * specified encoded DOL
+ *
+ * @param plan DOL plan
+ * @param ptr Encoded EMV Data Object List (DOL)
+ * @param len Length of encoded EMV Data Object List (DOL) in bytes
+ * @return Boolean indicating whether plan matches encoded DOL
+ */
+bool emv_dol_plan_matches(const struct emv_dol_plan_t* plan, const void* ptr, size_t len);
+
+/**
+ * Build concatenated data according to compiled Data Object List (DOL) plan.
+ * The output is identical to that of @ref emv_dol_build_data() for the DOL
+ * from which the plan was compiled.
+ *
+ * @param plan DOL plan
+ * @param sources EMV TLV sources to use when building concatenated data
+ * @param data Concatenated data output
+ * @param data_len Length of concatenated data output in bytes
+ * @return Zero for success. Less than zero for internal error. Greater than zero if output data length too small.
+ */
+int emv_dol_plan_build_data(
+	const struct emv_dol_plan_t* plan,
+	const struct emv_tlv_sources_t* sources,
+	void* data,
+	size_t* data_len
+);
+
+/**
+ * Retrieve compiled EMV Data Object List (DOL) plan from cache, or compile it
+ * and replace the least recently compiled plan if it is not cached.
+ *
+ * @param cache DOL plan cache
+ * @param ptr Encoded EMV Data Object List (DOL)
+ * @param len Length of encoded EMV Data Object List (DOL) in bytes
+ * @return DOL plan. NULL for error or if DOL exceeds @ref EMV_DOL_PLAN_DOL_MAX.
+ */
+const struct emv_dol_plan_t* emv_dol_plan_cache_get(
+	struct emv_dol_plan_cache_t* cache,
+	const void* ptr,
+	size_t len
+);
+
+/**
+ * Build concatenated data according to Data Object List (DOL) using a plan
+ * from the cache. This is equivalent to @ref emv_dol_build_data() but only
+ * compiles the DOL if the cache does not yet provide a plan for it.
+ *
+ * @param cache DOL plan cache. NULL to build data without a plan.
+ * @param ptr Encoded EMV Data Object List (DOL)
+ * @param len Length of encoded EMV Data Object List (DOL) in bytes
+ * @param sources EMV TLV sources to use when building concatenated data
+ * @param data Concatenated data output
+ * @param data_len Length of concatenated data output in bytes
+ * @return Zero for success. Less than zero for internal error. Greater than zero if output data length too small.
+ */
+int emv_dol_plan_cache_build_data(
+	struct emv_dol_plan_cache_t* cache,
+	const void* ptr,
+	size_t len,
+	const struct emv_tlv_sources_t* sources,
+	void* data,
+	size_t* data_len
+);
+
 __END_DECLS
 
 #endif
@@ -20,310 +20,195 @@
  */
 
 #include "emv_fields.h"
+#include "emv_aid_trie.h"
+
+#include "emv_utils_config.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
-// Visa
-static const uint8_t visa_aid[] = { 0xA0, 0x00, 0x00, 0x00, 0x03 };
-static const uint8_t visa_credit_debit_pix[] = { 0x10, 0x10 };
-static const uint8_t visa_electron_pix[] = { 0x20, 0x10 };
-static const uint8_t visa_vpay_pix[] = { 0x20, 0x20 };
-static const uint8_t visa_plus_pix[] = { 0x80, 0x10 };
-static const uint8_t visa_usa_debit_aid[] = { 0xA0, 0x00, 0x00, 0x00, 0x98 };
-
-// Mastercard
-static const uint8_t mastercard_aid[] = { 0xA0, 0x00, 0x00, 0x00, 0x04 };
-static const uint8_t mastercard_credit_debit_pix[] = { 0x10, 0x10 };
-static const uint8_t mastercard_maestro_pix[] = { 0x30, 0x60 };
-static const uint8_t mastercard_cirrus_pix[] = { 0x60, 0x00 };
-static const uint8_t mastercard_usa_debit_pix[] = { 0x22, 0x03 };
-static const uint8_t mastercard_maestro_uk_aid[] = { 0xA0, 0x00, 0x00, 0x00, 0x05 };
-static const uint8_t mastercard_test_aid[] = { 0xB0, 0x12, 0x34, 0x56, 0x78 };
-
-// American Express
-static const uint8_t amex_aid[] = { 0xA0, 0x00, 0x00, 0x00, 0x25 };
-static const uint8_t amex_china_credit_debit_aid[] = { 0xA0, 0x00, 0x00, 0x07, 0x90 };
-
-// Discover
-static const uint8_t discover_aid[] = { 0xA0, 0x00, 0x00, 0x01, 0x52 };
-static const uint8_t discover_card_pix[] = { 0x30, 0x10 };
-static const uint8_t discover_usa_debit_pix[] = { 0x40, 0x10 };
-static const uint8_t discover_zip_aid[] = { 0xA0, 0x00, 0x00, 0x03, 0x24 };
-
-// Cartes Bancaires (CB)
-static const uint8_t cb_aid[] = { 0xA0, 0x00, 0x00, 0x00, 0x42 };
-static const uint8_t cb_credit_debit_pix[] = { 0x10, 0x10 };
-static const uint8_t cb_debit_pix[] = { 0x20, 0x10 };
-
-// JCB
-static const uint8_t jcb_aid[] = { 0xA0, 0x00, 0x00, 0x00, 0x65 };
-
-// Dankort
-static const uint8_t dankort_aid[] = { 0xA0, 0x00, 0x00, 0x01, 0x21 };
-static const uint8_t dankort_visadankort_pix[] = { 0x47, 0x11 };
-static const uint8_t dankort_jspeedy_pix[] = { 0x47, 0x12 };
-
-// UnionPay
-static const uint8_t unionpay_aid[] = { 0xA0, 0x00, 0x00, 0x03, 0x33 };
-static const uint8_t unionpay_debit_pix[] = { 0x01, 0x01, 0x01 };
-static const uint8_t unionpay_credit_pix[] = { 0x01, 0x01, 0x02 };
-static const uint8_t unionpay_quasi_credit_pix[] = { 0x01, 0x01, 0x03 };
-static const uint8_t unionpay_electronic_cash_pix[] = { 0x01, 0x01, 0x06 };
-static const uint8_t unionpay_usa_debit_pix[] = { 0x01, 0x01, 0x08 };
-
-// GIM-UEMOA
-static const uint8_t gimuemoa_aid[] = { 0xA0, 0x00, 0x00, 0x03, 0x37 };
-static const uint8_t gimuemoa_standard_pix[] = { 0x10, 0x10, 0x00 };
-static const uint8_t gimuemoa_prepaid_online_pix[] = { 0x10, 0x10, 0x01 };
-static const uint8_t gimuemoa_classic_pix[] = { 0x10, 0x20, 0x00 };
-static const uint8_t gimuemoa_prepaid_offline_pix[] = { 0x10, 0x20, 0x01 };
-static const uint8_t gimuemoa_retrait_pix[] = { 0x30, 0x10, 0x00 };
-static const uint8_t gimuemoa_electronic_wallet_pix[] = { 0x60, 0x10, 0x01 };
-
-// Deutsche Kreditwirtschaft
-static const uint8_t dk_girocard_aid[] = { 0xA0, 0x00, 0x00, 0x03, 0x59, 0x10, 0x10, 0x02, 0x80, 0x01 };
-
-// Verve
-static const uint8_t verve_aid[] = { 0xA0, 0x00, 0x00, 0x03, 0x71 };
-
-// eftpos (Australia)
-static const uint8_t eftpos_aid[] = { 0xA0, 0x00, 0x00, 0x03, 0x84 };
-static const uint8_t eftpos_savings_pix[] = { 0x10 };
-static const uint8_t eftpos_cheque_pix[] = { 0x20 };
-
-// RuPay
-static const uint8_t rupay_aid[] = { 0xA0, 0x00, 0x00, 0x05, 0x24 };
-
-// Mir
-static const uint8_t mir_aid[] = { 0xA0, 0x00, 0x00, 0x06, 0x58 };
-static const uint8_t mir_credit_pix[] = { 0x10, 0x10 };
-static const uint8_t mir_debit_pix[] = { 0x20, 0x10 };
-
-// Meeza
-static const uint8_t meeza_aid[] = { 0xA0, 0x00, 0x00, 0x07, 0x32 };
-
-#define emv_aid_match(aid, aid_len, aid_buf) \
-	(aid_len >= sizeof(aid_buf) && memcmp(aid, aid_buf, sizeof(aid_buf)) == 0)
-
-#define emv_pix_match(aid, aid_len, pix_buf) \
-	(aid_len >= 5 + sizeof(pix_buf) && memcmp(aid + 5, pix_buf, sizeof(pix_buf)) == 0)
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
-int emv_aid_get_info(
-	const uint8_t* aid,
-	size_t aid_len,
-	struct emv_aid_info_t* info
-)
-{
-	if (!aid || !aid_len || !info) {
-		return -1;
-	}
-	memset(info, 0, sizeof(*info));
-
-	if (aid_len < 5 || aid_len > 16) {
-		// Application Identifier (AID) must be 5 to 16 bytes
-		return 1;
-	}
+#define EMV_AID_PREFIX(...) { __VA_ARGS__ }, sizeof((const uint8_t[]){ __VA_ARGS__ })
 
+/// Card scheme and card product of Application Identifier (AID) prefixes.
+/// The longest prefix of an AID determines its card scheme and card product.
+static const struct emv_aid_info_prefix_t {
+	uint8_t aid[16];
+	size_t aid_len;
+	struct emv_aid_info_t info;
+} emv_aid_info_prefix[] = {
 	// Visa
-	if (emv_aid_match(aid, aid_len, visa_aid)) {
-		info->scheme = EMV_CARD_SCHEME_VISA;
-
-		if (emv_pix_match(aid, aid_len, visa_credit_debit_pix)) {
-			info->product = EMV_CARD_PRODUCT_VISA_CREDIT_DEBIT;
-		} else if (emv_pix_match(aid, aid_len, visa_electron_pix)) {
-			info->product = EMV_CARD_PRODUCT_VISA_ELECTRON;
-		} else if (emv_pix_match(aid, aid_len, visa_vpay_pix)) {
-			info->product = EMV_CARD_PRODUCT_VISA_VPAY;
-		} else if (emv_pix_match(aid, aid_len, visa_plus_pix)) {
-			info->product = EMV_CARD_PRODUCT_VISA_PLUS;
-		}
-		return 0;
-
-	} else if (emv_aid_match(aid, aid_len, visa_usa_debit_aid)) {
-		info->scheme = EMV_CARD_SCHEME_VISA;
-		info->product = EMV_CARD_PRODUCT_VISA_USA_DEBIT;
-		return 0;
-	}
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x03), { EMV_CARD_SCHEME_VISA, EMV_CARD_PRODUCT_UNKNOWN } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10), { EMV_CARD_SCHEME_VISA, EMV_CARD_PRODUCT_VISA_CREDIT_DEBIT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x10), { EMV_CARD_SCHEME_VISA, EMV_CARD_PRODUCT_VISA_ELECTRON } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x20), { EMV_CARD_SCHEME_VISA, EMV_CARD_PRODUCT_VISA_VPAY } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x03, 0x80, 0x10), { EMV_CARD_SCHEME_VISA, EMV_CARD_PRODUCT_VISA_PLUS } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x98), { EMV_CARD_SCHEME_VISA, EMV_CARD_PRODUCT_VISA_USA_DEBIT } },
 
 	// Mastercard
-	if (emv_aid_match(aid, aid_len, mastercard_aid)) {
-		info->scheme = EMV_CARD_SCHEME_MASTERCARD;
-
-		if (emv_pix_match(aid, aid_len, mastercard_credit_debit_pix)) {
-			info->product = EMV_CARD_PRODUCT_MASTERCARD_CREDIT_DEBIT;
-		} else if (emv_pix_match(aid, aid_len, mastercard_maestro_pix)) {
-			info->product = EMV_CARD_PRODUCT_MASTERCARD_MAESTRO;
-		} else if (emv_pix_match(aid, aid_len, mastercard_cirrus_pix)) {
-			info->product = EMV_CARD_PRODUCT_MASTERCARD_CIRRUS;
-		} else if (emv_pix_match(aid, aid_len, mastercard_usa_debit_pix)) {
-			info->product = EMV_CARD_PRODUCT_MASTERCARD_USA_DEBIT;
-		}
-		return 0;
-
-	} else if (emv_aid_match(aid, aid_len, mastercard_maestro_uk_aid)) {
-		info->scheme = EMV_CARD_SCHEME_MASTERCARD;
-		info->product = EMV_CARD_PRODUCT_MASTERCARD_MAESTRO_UK;
-		return 0;
-
-	} else if (emv_aid_match(aid, aid_len, mastercard_test_aid)) {
-		info->scheme = EMV_CARD_SCHEME_MASTERCARD;
-		info->product = EMV_CARD_PRODUCT_MASTERCARD_TEST;
-		return 0;
-	}
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x04), { EMV_CARD_SCHEME_MASTERCARD, EMV_CARD_PRODUCT_UNKNOWN } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x04, 0x10, 0x10), { EMV_CARD_SCHEME_MASTERCARD, EMV_CARD_PRODUCT_MASTERCARD_CREDIT_DEBIT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x04, 0x30, 0x60), { EMV_CARD_SCHEME_MASTERCARD, EMV_CARD_PRODUCT_MASTERCARD_MAESTRO } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x04, 0x60, 0x00), { EMV_CARD_SCHEME_MASTERCARD, EMV_CARD_PRODUCT_MASTERCARD_CIRRUS } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x04, 0x22, 0x03), { EMV_CARD_SCHEME_MASTERCARD, EMV_CARD_PRODUCT_MASTERCARD_USA_DEBIT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x05), { EMV_CARD_SCHEME_MASTERCARD, EMV_CARD_PRODUCT_MASTERCARD_MAESTRO_UK } },
+	{ EMV_AID_PREFIX(0xB0, 0x12, 0x34, 0x56, 0x78), { EMV_CARD_SCHEME_MASTERCARD, EMV_CARD_PRODUCT_MASTERCARD_TEST } },
 
 	// American Express
-	if (emv_aid_match(aid, aid_len, amex_aid)) {
-		info->scheme = EMV_CARD_SCHEME_AMEX;
-		info->product = EMV_CARD_PRODUCT_AMEX_CREDIT_DEBIT;
-		return 0;
-
-	} else if (emv_aid_match(aid, aid_len, amex_china_credit_debit_aid)) {
-		info->scheme = EMV_CARD_SCHEME_AMEX;
-		info->product = EMV_CARD_PRODUCT_AMEX_CHINA_CREDIT_DEBIT;
-		return 0;
-	}
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x25), { EMV_CARD_SCHEME_AMEX, EMV_CARD_PRODUCT_AMEX_CREDIT_DEBIT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x07, 0x90), { EMV_CARD_SCHEME_AMEX, EMV_CARD_PRODUCT_AMEX_CHINA_CREDIT_DEBIT } },
 
 	// Discover
-	if (emv_aid_match(aid, aid_len, discover_aid)) {
-		info->scheme = EMV_CARD_SCHEME_DISCOVER;
-
-		if (emv_pix_match(aid, aid_len, discover_card_pix)) {
-			info->product = EMV_CARD_PRODUCT_DISCOVER_CARD;
-		} else if (emv_pix_match(aid, aid_len, discover_usa_debit_pix)) {
-			info->product = EMV_CARD_PRODUCT_DISCOVER_USA_DEBIT;
-		}
-		return 0;
-
-	} else if (emv_aid_match(aid, aid_len, discover_zip_aid)) {
-		info->scheme = EMV_CARD_SCHEME_DISCOVER;
-		info->product = EMV_CARD_PRODUCT_DISCOVER_ZIP;
-		return 0;
-	}
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x01, 0x52), { EMV_CARD_SCHEME_DISCOVER, EMV_CARD_PRODUCT_UNKNOWN } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x01, 0x52, 0x30, 0x10), { EMV_CARD_SCHEME_DISCOVER, EMV_CARD_PRODUCT_DISCOVER_CARD } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x01, 0x52, 0x40, 0x10), { EMV_CARD_SCHEME_DISCOVER, EMV_CARD_PRODUCT_DISCOVER_USA_DEBIT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x24), { EMV_CARD_SCHEME_DISCOVER, EMV_CARD_PRODUCT_DISCOVER_ZIP } },
 
 	// Cartes Bancaires (CB)
-	if (emv_aid_match(aid, aid_len, cb_aid)) {
-		info->scheme = EMV_CARD_SCHEME_CB;
-
-		if (emv_pix_match(aid, aid_len, cb_credit_debit_pix)) {
-			info->product = EMV_CARD_PRODUCT_CB_CREDIT_DEBIT;
-		} else if (emv_pix_match(aid, aid_len, cb_debit_pix)) {
-			info->product = EMV_CARD_PRODUCT_CB_DEBIT;
-		}
-		return 0;
-	}
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x42), { EMV_CARD_SCHEME_CB, EMV_CARD_PRODUCT_UNKNOWN } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x42, 0x10, 0x10), { EMV_CARD_SCHEME_CB, EMV_CARD_PRODUCT_CB_CREDIT_DEBIT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x42, 0x20, 0x10), { EMV_CARD_SCHEME_CB, EMV_CARD_PRODUCT_CB_DEBIT } },
 
 	// JCB
-	if (emv_aid_match(aid, aid_len, jcb_aid)) {
-		info->scheme = EMV_CARD_SCHEME_JCB;
-	}
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x00, 0x65), { EMV_CARD_SCHEME_JCB, EMV_CARD_PRODUCT_UNKNOWN } },
 
 	// Dankort
-	if (emv_aid_match(aid, aid_len, dankort_aid)) {
-		info->scheme = EMV_CARD_SCHEME_DANKORT;
-
-		if (emv_pix_match(aid, aid_len, dankort_visadankort_pix)) {
-			info->product = EMV_CARD_PRODUCT_DANKORT_VISADANKORT;
-		} else if (emv_pix_match(aid, aid_len, dankort_jspeedy_pix)) {
-			info->product = EMV_CARD_PRODUCT_DANKORT_JSPEEDY;
-		}
-		return 0;
-	}
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x01, 0x21), { EMV_CARD_SCHEME_DANKORT, EMV_CARD_PRODUCT_UNKNOWN } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x01, 0x21, 0x47, 0x11), { EMV_CARD_SCHEME_DANKORT, EMV_CARD_PRODUCT_DANKORT_VISADANKORT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x01, 0x21, 0x47, 0x12), { EMV_CARD_SCHEME_DANKORT, EMV_CARD_PRODUCT_DANKORT_JSPEEDY } },
 
 	// UnionPay
-	if (emv_aid_match(aid, aid_len, unionpay_aid)) {
-		info->scheme = EMV_CARD_SCHEME_UNIONPAY;
-
-		if (emv_pix_match(aid, aid_len, unionpay_debit_pix)) {
-			info->product = EMV_CARD_PRODUCT_UNIONPAY_DEBIT;
-		} else if (emv_pix_match(aid, aid_len, unionpay_credit_pix)) {
-			info->product = EMV_CARD_PRODUCT_UNIONPAY_CREDIT;
-		} else if (emv_pix_match(aid, aid_len, unionpay_quasi_credit_pix)) {
-			info->product = EMV_CARD_PRODUCT_UNIONPAY_QUASI_CREDIT;
-		} else if (emv_pix_match(aid, aid_len, unionpay_electronic_cash_pix)) {
-			info->product = EMV_CARD_PRODUCT_UNIONPAY_ELECTRONIC_CASH;
-		} else if (emv_pix_match(aid, aid_len, unionpay_usa_debit_pix)) {
-			info->product = EMV_CARD_PRODUCT_UNIONPAY_USA_DEBIT;
-		}
-		return 0;
-	}
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x33), { EMV_CARD_SCHEME_UNIONPAY, EMV_CARD_PRODUCT_UNKNOWN } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x33, 0x01, 0x01, 0x01), { EMV_CARD_SCHEME_UNIONPAY, EMV_CARD_PRODUCT_UNIONPAY_DEBIT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x33, 0x01, 0x01, 0x02), { EMV_CARD_SCHEME_UNIONPAY, EMV_CARD_PRODUCT_UNIONPAY_CREDIT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x33, 0x01, 0x01, 0x03), { EMV_CARD_SCHEME_UNIONPAY, EMV_CARD_PRODUCT_UNIONPAY_QUASI_CREDIT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x33, 0x01, 0x01, 0x06), { EMV_CARD_SCHEME_UNIONPAY, EMV_CARD_PRODUCT_UNIONPAY_ELECTRONIC_CASH } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x33, 0x01, 0x01, 0x08), { EMV_CARD_SCHEME_UNIONPAY, EMV_CARD_PRODUCT_UNIONPAY_USA_DEBIT } },
 
 	// GIM-UEMOA
-	if (emv_aid_match(aid, aid_len, gimuemoa_aid)) {
-		info->scheme = EMV_CARD_SCHEME_GIMUEMOA;
-
-		if (emv_pix_match(aid, aid_len, gimuemoa_standard_pix)) {
-			info->product = EMV_CARD_PRODUCT_GIMUEMOA_STANDARD;
-		} else if (emv_pix_match(aid, aid_len, gimuemoa_prepaid_online_pix)) {
-			info->product = EMV_CARD_PRODUCT_GIMUEMOA_PREPAID_ONLINE;
-		} else if (emv_pix_match(aid, aid_len, gimuemoa_classic_pix)) {
-			info->product = EMV_CARD_PRODUCT_GIMUEMOA_CLASSIC;
-		} else if (emv_pix_match(aid, aid_len, gimuemoa_prepaid_offline_pix)) {
-			info->product = EMV_CARD_PRODUCT_GIMUEMOA_PREPAID_OFFLINE;
-		} else if (emv_pix_match(aid, aid_len, gimuemoa_retrait_pix)) {
-			info->product = EMV_CARD_PRODUCT_GIMUEMOA_RETRAIT;
-		} else if (emv_pix_match(aid, aid_len, gimuemoa_electronic_wallet_pix)) {
-			info->product = EMV_CARD_PRODUCT_GIMUEMOA_ELECTRONIC_WALLET;
-		}
-		return 0;
-	}
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x37), { EMV_CARD_SCHEME_GIMUEMOA, EMV_CARD_PRODUCT_UNKNOWN } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x37, 0x10, 0x10, 0x00), { EMV_CARD_SCHEME_GIMUEMOA, EMV_CARD_PRODUCT_GIMUEMOA_STANDARD } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x37, 0x10, 0x10, 0x01), { EMV_CARD_SCHEME_GIMUEMOA, EMV_CARD_PRODUCT_GIMUEMOA_PREPAID_ONLINE } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x37, 0x10, 0x20, 0x00), { EMV_CARD_SCHEME_GIMUEMOA, EMV_CARD_PRODUCT_GIMUEMOA_CLASSIC } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x37, 0x10, 0x20, 0x01), { EMV_CARD_SCHEME_GIMUEMOA, EMV_CARD_PRODUCT_GIMUEMOA_PREPAID_OFFLINE } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x37, 0x30, 0x10, 0x00), { EMV_CARD_SCHEME_GIMUEMOA, EMV_CARD_PRODUCT_GIMUEMOA_RETRAIT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x37, 0x60, 0x10, 0x01), { EMV_CARD_SCHEME_GIMUEMOA, EMV_CARD_PRODUCT_GIMUEMOA_ELECTRONIC_WALLET } },
 
 	// Deutsche Kreditwirtschaft
-	if (emv_aid_match(aid, aid_len, dk_girocard_aid)) {
-		info->scheme = EMV_CARD_SCHEME_DK;
-		info->product = EMV_CARD_PRODUCT_DK_GIROCARD;
-		return 0;
-	}
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x59, 0x10, 0x10, 0x02, 0x80, 0x01), { EMV_CARD_SCHEME_DK, EMV_CARD_PRODUCT_DK_GIROCARD } },
 
 	// Verve
-	if (emv_aid_match(aid, aid_len, verve_aid)) {
-		info->scheme = EMV_CARD_SCHEME_VERVE;
-		// Individual Verve card products are not reflected here
-		return 0;
-	}
+	// Individual Verve card products are not reflected here
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x71), { EMV_CARD_SCHEME_VERVE, EMV_CARD_PRODUCT_UNKNOWN } },
 
 	// eftpos (Australia)
-	if (emv_aid_match(aid, aid_len, eftpos_aid)) {
-		info->scheme = EMV_CARD_SCHEME_EFTPOS;
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x84), { EMV_CARD_SCHEME_EFTPOS, EMV_CARD_PRODUCT_UNKNOWN } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x84, 0x10), { EMV_CARD_SCHEME_EFTPOS, EMV_CARD_PRODUCT_EFTPOS_SAVINGS } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x03, 0x84, 0x20), { EMV_CARD_SCHEME_EFTPOS, EMV_CARD_PRODUCT_EFTPOS_CHEQUE } },
 
-		if (emv_pix_match(aid, aid_len, eftpos_savings_pix)) {
-			info->product = EMV_CARD_PRODUCT_EFTPOS_SAVINGS;
-		} else if (emv_pix_match(aid, aid_len, eftpos_cheque_pix)) {
-			info->product = EMV_CARD_PRODUCT_EFTPOS_CHEQUE;
-		}
-		return 0;
+	// RuPay
+	// Individual RuPay card products are not reflected here
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x05, 0x24), { EMV_CARD_SCHEME_RUPAY, EMV_CARD_PRODUCT_UNKNOWN } },
+
+	// Mir
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x06, 0x58), { EMV_CARD_SCHEME_MIR, EMV_CARD_PRODUCT_UNKNOWN } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x06, 0x58, 0x10, 0x10), { EMV_CARD_SCHEME_MIR, EMV_CARD_PRODUCT_MIR_CREDIT } },
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x06, 0x58, 0x20, 0x10), { EMV_CARD_SCHEME_MIR, EMV_CARD_PRODUCT_MIR_DEBIT } },
+
+	// Meeza
+	// Individual Meeza card products are not reflected here
+	{ EMV_AID_PREFIX(0xA0, 0x00, 0x00, 0x07, 0x32), { EMV_CARD_SCHEME_MEEZA, EMV_CARD_PRODUCT_UNKNOWN } },
+};
+#define EMV_AID_INFO_PREFIX_COUNT (sizeof(emv_aid_info_prefix) / sizeof(emv_aid_info_prefix[0]))
+
+// AID prefix trie of emv_aid_info_prefix, created when first needed
+static struct emv_aid_trie_t* emv_aid_info_trie = NULL;
+#ifdef HAVE_PTHREAD
+static pthread_once_t emv_aid_info_trie_once = PTHREAD_ONCE_INIT;
+#else
+static bool emv_aid_info_trie_done = false;
+#endif
+
+static void emv_aid_info_trie_create(void)
+{
+	struct emv_aid_trie_entry_t entries[EMV_AID_INFO_PREFIX_COUNT];
+
+	for (size_t i = 0; i < EMV_AID_INFO_PREFIX_COUNT; ++i) {
+		entries[i].aid = emv_aid_info_prefix[i].aid;
+		entries[i].aid_len = emv_aid_info_prefix[i].aid_len;
+		entries[i].asi = EMV_ASI_PARTIAL_MATCH;
+		entries[i].data = &emv_aid_info_prefix[i];
 	}
 
-	// RuPay
-	if (emv_aid_match(aid, aid_len, rupay_aid)) {
-		info->scheme = EMV_CARD_SCHEME_RUPAY;
-		// Individual RuPay card products are not reflected here
-		return 0;
+	// The trie is retained for the lifetime of the process. If it cannot be
+	// created, the prefixes are compared individually instead.
+	emv_aid_info_trie = emv_aid_trie_create(entries, EMV_AID_INFO_PREFIX_COUNT);
+}
+
+static const struct emv_aid_info_prefix_t* emv_aid_info_find(
+	const uint8_t* aid,
+	size_t aid_len
+)
+{
+	const struct emv_aid_info_prefix_t* match = NULL;
+
+#ifdef HAVE_PTHREAD
+	pthread_once(&emv_aid_info_trie_once, &emv_aid_info_trie_create);
+#else
+	if (!emv_aid_info_trie_done) {
+		emv_aid_info_trie_create();
+		emv_aid_info_trie_done = true;
+	}
+#endif
+	if (emv_aid_info_trie) {
+		return emv_aid_trie_find(emv_aid_info_trie, aid, aid_len);
 	}
 
-	// Mir
-	if (emv_aid_match(aid, aid_len, mir_aid)) {
-		info->scheme = EMV_CARD_SCHEME_MIR;
+	for (size_t i = 0; i < EMV_AID_INFO_PREFIX_COUNT; ++i) {
+		const struct emv_aid_info_prefix_t* prefix = &emv_aid_info_prefix[i];
 
-		if (emv_pix_match(aid, aid_len, mir_credit_pix)) {
-			info->product = EMV_CARD_PRODUCT_MIR_CREDIT;
-		} else if (emv_pix_match(aid, aid_len, mir_debit_pix)) {
-			info->product = EMV_CARD_PRODUCT_MIR_DEBIT;
+		if (aid_len >= prefix->aid_len &&
+			memcmp(aid, prefix->aid, prefix->aid_len) == 0 &&
+			(!match || prefix->aid_len > match->aid_len)
+		) {
+			match = prefix;
 		}
-		return 0;
 	}
 
-	// Meeza
-	if (emv_aid_match(aid, aid_len, meeza_aid)) {
-		info->scheme = EMV_CARD_SCHEME_MEEZA;
-		// Individual Meeza card products are not reflected here
+	return match;
+}
+
+int emv_aid_get_info(
+	const uint8_t* aid,
+	size_t aid_len,
+	struct emv_aid_info_t* info
+)
+{
+	const struct emv_aid_info_prefix_t* prefix;
+
+	if (!aid || !aid_len || !info) {
+		return -1;
+	}
+	memset(info, 0, sizeof(*info));
+
+	if (aid_len < 5 || aid_len > 16) {
+		// Application Identifier (AID) must be 5 to 16 bytes
+		return 1;
+	}
+
+	prefix = emv_aid_info_find(aid, aid_len);
+	if (!prefix) {
+		// Unknown
+		info->scheme = EMV_CARD_SCHEME_UNKNOWN;
+		info->product = EMV_CARD_PRODUCT_UNKNOWN;
 		return 0;
 	}
 
-	// Unknown
-	info->scheme = EMV_CARD_SCHEME_UNKNOWN;
-	info->product = EMV_CARD_PRODUCT_UNKNOWN;
+	*info = prefix->info;
 	return 0;
 }
 
@@ -0,0 +1,206 @@
+/**
+ * @file emv_metrics.c
+ * @brief EMV kernel timing metrics
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_metrics.h"
+#include "emv_utils_config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// TODO: replace with HAL interface in future
+#ifdef HAVE_TIME_H
+#include <time.h>
+#endif
+
+uint64_t emv_metrics_get_time_ns(void)
+{
+	struct timespec t;
+
+	// Prefer monotonic time because step durations should not be affected
+	// by adjustments of the wall clock
+	// TODO: replace with HAL interface in future
+#if defined(HAVE_CLOCK_GETTIME)
+	clock_gettime(CLOCK_MONOTONIC, &t);
+#elif defined(HAVE_TIMESPEC_GET)
+	timespec_get(&t, TIME_UTC);
+#else
+#error "No platform function for current time"
+#endif
+
+	return ((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec;
+}
+
+int emv_metrics_init(struct emv_metrics_t* metrics)
+{
+	if (!metrics) {
+		return -1;
+	}
+
+	memset(metrics, 0, sizeof(*metrics));
+	return 0;
+}
+
+int emv_metrics_reset(struct emv_metrics_t* metrics)
+{
+	if (!metrics) {
+		return -1;
+	}
+
+	memset(metrics->step, 0, sizeof(metrics->step));
+	return 0;
+}
+
+void emv_metrics_step_begin(
+	const struct emv_metrics_t* metrics,
+	struct emv_metrics_mark_t* mark
+)
+{
+	if (!metrics) {
+		return;
+	}
+
+	mark->card_io_ns = metrics->card_io_ns;
+	mark->start_ns = emv_metrics_get_time_ns();
+}
+
+void emv_metrics_step_end(
+	struct emv_metrics_t* metrics,
+	enum emv_metrics_step_t step,
+	const struct emv_metrics_mark_t* mark
+)
+{
+	uint64_t total_ns;
+	uint64_t card_io_ns;
+	uint64_t cpu_ns;
+	struct emv_metrics_timing_t* timing;
+
+	if (!metrics) {
+		return;
+	}
+	if (step >= EMV_METRICS_STEP_COUNT) {
+		return;
+	}
+
+	total_ns = emv_metrics_get_time_ns() - mark->start_ns;
+	card_io_ns = metrics->card_io_ns - mark->card_io_ns;
+	if (card_io_ns > total_ns) {
+		// Different clock granularities should not produce a negative
+		// host processing time
+		card_io_ns = total_ns;
+	}
+	cpu_ns = total_ns - card_io_ns;
+
+	timing = &metrics->step[step];
+	timing->count++;
+	timing->total_ns += total_ns;
+	timing->card_io_ns += card_io_ns;
+	timing->cpu_ns += cpu_ns;
+
+	emv_metrics_histogram_add(&metrics->total[step], total_ns);
+	emv_metrics_histogram_add(&metrics->card_io[step], card_io_ns);
+	emv_metrics_histogram_add(&metrics->cpu[step], cpu_ns);
+}
+
+static unsigned int emv_metrics_histogram_bucket(uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	unsigned int idx = 0;
+
+	// Bucket index is the number of significant bits of the sample in
+	// microseconds
+	while (us && idx < EMV_METRICS_HISTOGRAM_BUCKETS - 1) {
+		us >>= 1;
+		++idx;
+	}
+
+	return idx;
+}
+
+void emv_metrics_histogram_add(
+	struct emv_metrics_histogram_t* hist,
+	uint64_t ns
+)
+{
+	if (!hist) {
+		return;
+	}
+
+	if (!hist->count || ns < hist->min_ns) {
+		hist->min_ns = ns;
+	}
+	if (ns > hist->max_ns) {
+		hist->max_ns = ns;
+	}
+	hist->count++;
+	hist->sum_ns += ns;
+	hist->bucket[emv_metrics_histogram_bucket(ns)]++;
+}
+
+uint64_t emv_metrics_histogram_percentile(
+	const struct emv_metrics_histogram_t* hist,
+	unsigned int percentile
+)
+{
+	uint64_t rank;
+	uint64_t cumulative = 0;
+
+	if (!hist || !hist->count || percentile > 100) {
+		return 0;
+	}
+
+	// Nearest rank of requested percentile
+	rank = (hist->count * percentile + 99) / 100;
+	if (!rank) {
+		return hist->min_ns;
+	}
+
+	for (unsigned int i = 0; i < EMV_METRICS_HISTOGRAM_BUCKETS; ++i) {
+		cumulative += hist->bucket[i];
+		if (cumulative >= rank) {
+			uint64_t upper_ns = ((uint64_t)1 << i) * 1000;
+
+			if (i == EMV_METRICS_HISTOGRAM_BUCKETS - 1 ||
+				upper_ns > hist->max_ns
+			) {
+				return hist->max_ns;
+			}
+			return upper_ns;
+		}
+	}
+
+	return hist->max_ns;
+}
+
+const char* emv_metrics_step_get_string(enum emv_metrics_step_t step)
+{
+	switch (step) {
+		case EMV_METRICS_STEP_BUILD_CANDIDATE_LIST: return "Build candidate list";
+		case EMV_METRICS_STEP_SELECT_APPLICATION: return "Select application";
+		case EMV_METRICS_STEP_INITIATE_APPLICATION_PROCESSING: return "Initiate application processing";
+		case EMV_METRICS_STEP_READ_APPLICATION_DATA: return "Read application data";
+		case EMV_METRICS_STEP_OFFLINE_DATA_AUTHENTICATION: return "Offline data authentication";
+		case EMV_METRICS_STEP_TERMINAL_RISK_MANAGEMENT: return "Terminal risk management";
+		case EMV_METRICS_STEP_CARD_ACTION_ANALYSIS: return "Card action analysis";
+		case EMV_METRICS_STEP_COUNT: break;
+	}
+
+	return "Unknown step";
+}
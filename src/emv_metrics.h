@@ -0,0 +1,199 @@
+/**
+ * @file emv_metrics.h
+ * @brief EMV kernel timing metrics
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EMV_METRICS_H
+#define EMV_METRICS_H
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+#include <stdint.h>
+
+__BEGIN_DECLS
+
+/// Number of buckets in @ref emv_metrics_histogram_t
+#define EMV_METRICS_HISTOGRAM_BUCKETS (32)
+
+/// EMV kernel steps for which timing metrics are recorded
+enum emv_metrics_step_t {
+	EMV_METRICS_STEP_BUILD_CANDIDATE_LIST = 0, ///< @ref emv_build_candidate_list()
+	EMV_METRICS_STEP_SELECT_APPLICATION, ///< @ref emv_select_application()
+	EMV_METRICS_STEP_INITIATE_APPLICATION_PROCESSING, ///< @ref emv_initiate_application_processing()
+	EMV_METRICS_STEP_READ_APPLICATION_DATA, ///< @ref emv_read_application_data()
+	EMV_METRICS_STEP_OFFLINE_DATA_AUTHENTICATION, ///< @ref emv_offline_data_authentication()
+	EMV_METRICS_STEP_TERMINAL_RISK_MANAGEMENT, ///< @ref emv_terminal_risk_management()
+	EMV_METRICS_STEP_CARD_ACTION_ANALYSIS, ///< @ref emv_card_action_analysis()
+
+	EMV_METRICS_STEP_COUNT, ///< Number of EMV kernel steps
+};
+
+/**
+ * Timing of an EMV kernel step during the current transaction
+ * @note All times are in nanoseconds
+ */
+struct emv_metrics_timing_t {
+	unsigned int count; ///< Number of times the step was performed
+	uint64_t total_ns; ///< Total time spent in the step
+	uint64_t card_io_ns; ///< Time spent inside the card reader transceive function
+	uint64_t cpu_ns; ///< Time spent on host processing (eg RSA, hashing, parsing)
+};
+
+/**
+ * Logarithmic latency histogram
+ *
+ * Bucket @c i counts samples of at least 2^(i-1) microseconds and less than
+ * 2^i microseconds, with bucket zero counting samples of less than one
+ * microsecond. The last bucket also counts all larger samples.
+ */
+struct emv_metrics_histogram_t {
+	uint64_t count; ///< Number of samples
+	uint64_t sum_ns; ///< Sum of all samples in nanoseconds
+	uint64_t min_ns; ///< Smallest sample in nanoseconds
+	uint64_t max_ns; ///< Largest sample in nanoseconds
+	uint64_t bucket[EMV_METRICS_HISTOGRAM_BUCKETS]; ///< Sample counts per bucket
+};
+
+/**
+ * EMV kernel timing metrics
+ *
+ * Initialise using @ref emv_metrics_init() and assign to
+ * @ref emv_ctx_t.metrics to enable timing of EMV kernel steps. The timings of
+ * the current transaction are cleared by @ref emv_ctx_reset() while the
+ * histograms accumulate across transactions until
+ * @ref emv_metrics_init() is called again.
+ *
+ * @note This object is not thread safe and should only be used by a single
+ *       EMV processing context at a time.
+ */
+struct emv_metrics_t {
+	/// Timings of current transaction, indexed by @ref emv_metrics_step_t
+	struct emv_metrics_timing_t step[EMV_METRICS_STEP_COUNT];
+
+	/// Histograms of total step time, indexed by @ref emv_metrics_step_t
+	struct emv_metrics_histogram_t total[EMV_METRICS_STEP_COUNT];
+
+	/// Histograms of card I/O time per step, indexed by @ref emv_metrics_step_t
+	struct emv_metrics_histogram_t card_io[EMV_METRICS_STEP_COUNT];
+
+	/// Histograms of host processing time per step, indexed by @ref emv_metrics_step_t
+	struct emv_metrics_histogram_t cpu[EMV_METRICS_STEP_COUNT];
+
+	/**
+	 * @brief Running total of card I/O time in nanoseconds.
+	 *
+	 * Updated by @ref emv_ttl_trx() when @ref emv_ttl_ext_t.metrics is set.
+	 */
+	uint64_t card_io_ns;
+};
+
+/**
+ * Start marker for an EMV kernel step
+ * @cond INTERNAL
+ */
+struct emv_metrics_mark_t {
+	uint64_t start_ns;
+	uint64_t card_io_ns;
+};
+/// @endcond
+
+/**
+ * Retrieve monotonic time for metrics
+ * @return Time in nanoseconds
+ */
+uint64_t emv_metrics_get_time_ns(void);
+
+/**
+ * Initialise EMV kernel timing metrics. This clears both the timings of the
+ * current transaction and the accumulated histograms.
+ *
+ * @param metrics EMV kernel timing metrics
+ * @return Zero for success. Less than zero for error.
+ */
+int emv_metrics_init(struct emv_metrics_t* metrics);
+
+/**
+ * Clear the timings of the current transaction while preserving the
+ * accumulated histograms.
+ *
+ * @param metrics EMV kernel timing metrics
+ * @return Zero for success. Less than zero for error.
+ */
+int emv_metrics_reset(struct emv_metrics_t* metrics);
+
+/**
+ * Mark the start of an EMV kernel step.
+ * @note This function does nothing if @p metrics is NULL
+ *
+ * @param metrics EMV kernel timing metrics. NULL to ignore.
+ * @param mark Step start marker output
+ */
+void emv_metrics_step_begin(
+	const struct emv_metrics_t* metrics,
+	struct emv_metrics_mark_t* mark
+);
+
+/**
+ * Mark the end of an EMV kernel step and record its timing.
+ * @note This function does nothing if @p metrics is NULL
+ *
+ * @param metrics EMV kernel timing metrics. NULL to ignore.
+ * @param step EMV kernel step
+ * @param mark Step start marker provided by @ref emv_metrics_step_begin()
+ */
+void emv_metrics_step_end(
+	struct emv_metrics_t* metrics,
+	enum emv_metrics_step_t step,
+	const struct emv_metrics_mark_t* mark
+);
+
+/**
+ * Add sample to latency histogram
+ *
+ * @param hist Latency histogram
+ * @param ns Sample in nanoseconds
+ */
+void emv_metrics_histogram_add(
+	struct emv_metrics_histogram_t* hist,
+	uint64_t ns
+);
+
+/**
+ * Estimate percentile from latency histogram. The estimate is the upper bound
+ * of the bucket in which the percentile falls, limited to the largest sample.
+ *
+ * @param hist Latency histogram
+ * @param percentile Percentile. Must be 0 to 100.
+ * @return Estimated percentile in nanoseconds. Zero if histogram is empty.
+ */
+uint64_t emv_metrics_histogram_percentile(
+	const struct emv_metrics_histogram_t* hist,
+	unsigned int percentile
+);
+
+/**
+ * Retrieve string associated with EMV kernel step
+ * @param step EMV kernel step
+ * @return Pointer to null-terminated string. Do not free.
+ */
+const char* emv_metrics_step_get_string(enum emv_metrics_step_t step);
+
+__END_DECLS
+
+#endif
@@ -2,7 +2,7 @@
  * @file emv_oda.c
  * @brief EMV Offline Data Authentication (ODA) helper functions
  *
- * Copyright 2025 Leon Lynch
+ * Copyright 2025-2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -28,18 +28,49 @@
 #include "emv_capk.h"
 #include "emv_rsa.h"
 #include "emv_dol.h"
+#include "emv_config.h"
 #include "emv_tal.h"
 
 #define EMV_DEBUG_SOURCE EMV_DEBUG_SOURCE_ODA
 #include "emv_debug.h"
 
+#include "emv_utils_config.h"
+
 #include "crypto_mem.h"
 #include "crypto_sha.h"
 
+#include <limits.h>
 #include <stdbool.h>
 #include <stdlib.h> // For malloc() and free()
 #include <string.h>
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+static const struct emv_capk_t* emv_oda_capk_lookup(
+	const struct emv_ctx_t* ctx,
+	uint8_t index
+)
+{
+	const struct emv_capk_t* capk;
+
+	// Prefer CAPKs provided by the EMV processing context
+	if (ctx->capk_list && ctx->capk_count) {
+		capk = emv_capk_list_lookup(
+			ctx->capk_list,
+			ctx->capk_count,
+			ctx->aid->value,
+			index
+		);
+		if (capk) {
+			return capk;
+		}
+	}
+
+	return emv_capk_lookup(ctx->aid->value, index);
+}
+
 int emv_oda_init(struct emv_oda_ctx_t* ctx)
 {
 	if (!ctx) {
@@ -104,17 +135,79 @@ int emv_oda_prepare_records(
 		return EMV_ODA_ERROR_AFL_INVALID;
 	}
 
-	// Allocate enough space for the total number of full length records
-	// that are intended for offline data authentication, as well as the
-	// encoded AIP, AID (terminal) and PDOL. Assume that the encoded fields
-	// cannot exceed two R-APDU responses in total.
+	// Limit the buffer to the total number of full length records that are
+	// intended for offline data authentication, as well as the encoded AIP,
+	// AID (terminal) and PDOL. Assume that the encoded fields cannot exceed
+	// two R-APDU responses in total. The buffer itself is only allocated as
+	// records are appended such that it is sized according to the actual
+	// records instead.
 	// See EMV 4.4 Book 3, 10.3 (page 98)
-	ctx->record_buf = malloc(EMV_RAPDU_DATA_MAX * (oda_record_count + 2));
-	if (!ctx->record_buf) {
-		emv_debug_error("Failed to allocate ODA buffer");
+	ctx->record_buf_max = EMV_RAPDU_DATA_MAX * (oda_record_count + 2);
+
+	return 0;
+}
+
+int emv_oda_prepare_records_len(
+	struct emv_oda_ctx_t* ctx,
+	size_t records_len
+)
+{
+	int r;
+
+	if (!ctx) {
+		emv_debug_trace_msg("ctx=%p, records_len=%zu", ctx, records_len);
+		emv_debug_error("Invalid parameter");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+	if (records_len > UINT_MAX - (EMV_RAPDU_DATA_MAX * 2)) {
+		emv_debug_trace_msg("records_len=%zu", records_len);
+		emv_debug_error("Invalid ODA records length");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+
+	r = emv_oda_clear_records(ctx);
+	if (r) {
+		emv_debug_trace_msg("emv_oda_clear_records() failed; r=%d", r);
+		emv_debug_error("Invalid parameter");
 		return EMV_ODA_ERROR_INTERNAL;
 	}
 
+	// Limit the buffer to the provided records, as well as the encoded AIP,
+	// AID (terminal) and PDOL, using the same assumption as
+	// emv_oda_prepare_records()
+	ctx->record_buf_max = records_len + (EMV_RAPDU_DATA_MAX * 2);
+
+	return 0;
+}
+
+static int emv_oda_grow_records(struct emv_oda_ctx_t* ctx, unsigned int len)
+{
+	uint8_t* buf;
+	unsigned int size;
+
+	// Grow geometrically to limit the number of reallocations
+	size = ctx->record_buf_size ? ctx->record_buf_size * 2 : EMV_RAPDU_DATA_MAX * 2;
+	if (size < len) {
+		size = len;
+	}
+	if (size > ctx->record_buf_max) {
+		size = ctx->record_buf_max;
+	}
+
+	// Records are cleansed before they are freed and therefore realloc()
+	// cannot be used
+	buf = malloc(size);
+	if (!buf) {
+		return -1;
+	}
+	if (ctx->record_buf) {
+		memcpy(buf, ctx->record_buf, ctx->record_buf_len);
+		crypto_cleanse(ctx->record_buf, ctx->record_buf_len);
+		free(ctx->record_buf);
+	}
+	ctx->record_buf = buf;
+	ctx->record_buf_size = size;
+
 	return 0;
 }
 
@@ -132,6 +225,8 @@ int emv_oda_clear_records(struct emv_oda_ctx_t* ctx)
 	}
 	ctx->record_buf = NULL;
 	ctx->record_buf_len = 0;
+	ctx->record_buf_size = 0;
+	ctx->record_buf_max = 0;
 
 	return 0;
 }
@@ -150,6 +245,308 @@ int emv_oda_clear(struct emv_oda_ctx_t* ctx)
 	return 0;
 }
 
+// Fields upon which issuer public key retrieval depends
+// See emv_rsa_retrieve_issuer_pkey()
+static const unsigned int emv_oda_ipk_icc_tags[] = {
+	EMV_TAG_90_ISSUER_PUBLIC_KEY_CERTIFICATE,
+	EMV_TAG_92_ISSUER_PUBLIC_KEY_REMAINDER,
+	EMV_TAG_9F32_ISSUER_PUBLIC_KEY_EXPONENT,
+	EMV_TAG_5A_APPLICATION_PAN,
+};
+
+#define EMV_ODA_IPK_CACHE_BUCKETS (1024) ///< Number of issuer public key cache buckets
+#define EMV_ODA_IPK_CACHE_MAX (65536) ///< Maximum number of cached issuer public keys
+#define EMV_ODA_IPK_CACHE_ABSENT (0xFFFF) ///< Key length indicating absent field
+
+/// Cached issuer public key retrieval
+struct emv_oda_ipk_cache_entry_t {
+	struct emv_oda_ipk_cache_entry_t* next;
+	const struct emv_capk_t* capk;
+	int r;
+	struct emv_rsa_issuer_pkey_t ipk;
+	size_t key_len;
+	uint8_t key[];
+};
+
+/// Issuer public key cache
+struct emv_oda_ipk_cache_t {
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t mutex;
+#endif
+	size_t count;
+	size_t retrieval_count;
+	struct emv_oda_ipk_cache_entry_t* bucket[EMV_ODA_IPK_CACHE_BUCKETS];
+};
+
+struct emv_oda_ipk_cache_t* emv_oda_ipk_cache_create(void)
+{
+	struct emv_oda_ipk_cache_t* cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache) {
+		emv_debug_error("Failed to allocate issuer public key cache");
+		return NULL;
+	}
+#ifdef HAVE_PTHREAD
+	if (pthread_mutex_init(&cache->mutex, NULL)) {
+		emv_debug_error("Failed to initialise issuer public key cache mutex");
+		free(cache);
+		return NULL;
+	}
+#endif
+
+	return cache;
+}
+
+size_t emv_oda_ipk_cache_get_retrieval_count(struct emv_oda_ipk_cache_t* cache)
+{
+	size_t count;
+
+	if (!cache) {
+		return 0;
+	}
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&cache->mutex);
+#endif
+	count = cache->retrieval_count;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&cache->mutex);
+#endif
+
+	return count;
+}
+
+void emv_oda_ipk_cache_free(struct emv_oda_ipk_cache_t* cache)
+{
+	if (!cache) {
+		return;
+	}
+
+	for (size_t i = 0; i < EMV_ODA_IPK_CACHE_BUCKETS; ++i) {
+		struct emv_oda_ipk_cache_entry_t* entry = cache->bucket[i];
+
+		while (entry) {
+			struct emv_oda_ipk_cache_entry_t* next = entry->next;
+
+			// Cleanse cached issuer public keys and PAN digits
+			crypto_cleanse(entry, sizeof(*entry) + entry->key_len);
+			free(entry);
+			entry = next;
+		}
+	}
+#ifdef HAVE_PTHREAD
+	pthread_mutex_destroy(&cache->mutex);
+#endif
+	free(cache);
+}
+
+static bool emv_oda_ipk_cache_key_append(
+	uint8_t* key,
+	size_t key_size,
+	size_t* key_len,
+	const struct emv_tlv_t* tlv,
+	unsigned int max_len
+)
+{
+	unsigned int len;
+
+	if (!tlv) {
+		len = EMV_ODA_IPK_CACHE_ABSENT;
+	} else {
+		len = tlv->length < max_len ? tlv->length : max_len;
+		if (len >= EMV_ODA_IPK_CACHE_ABSENT) {
+			return false;
+		}
+	}
+	if (*key_len + 2 + (tlv ? len : 0) > key_size) {
+		return false;
+	}
+
+	key[(*key_len)++] = len >> 8;
+	key[(*key_len)++] = len;
+	if (tlv) {
+		memcpy(key + *key_len, tlv->value, len);
+		*key_len += len;
+	}
+
+	return true;
+}
+
+static int emv_oda_ipk_cache_retrieve(
+	struct emv_oda_ipk_cache_t* cache,
+	const struct emv_tlv_t* ipk_cert,
+	const struct emv_capk_t* capk,
+	const struct emv_tlv_list_t* icc,
+	const struct emv_tlv_list_t* params,
+	struct emv_rsa_issuer_pkey_t* ipk
+)
+{
+	int r;
+	uint8_t key[EMV_RAPDU_DATA_MAX * 4];
+	size_t key_len = 0;
+	bool key_valid;
+	uint32_t hash;
+	uintptr_t capk_ptr = (uintptr_t)capk;
+	bool cached;
+	struct emv_oda_ipk_cache_entry_t** bucket;
+	struct emv_oda_ipk_cache_entry_t* entry;
+
+	// The cache key consists of the CAPK and all fields upon which issuer
+	// public key retrieval depends, such that the cached result is identical
+	// to the result of emv_rsa_retrieve_issuer_pkey(). Only the issuer
+	// identifier portion of the PAN is used for validation and therefore
+	// records of cards with the same issuer identifier share the result.
+	// See emv_rsa_retrieve_issuer_pkey()
+	key_valid = true;
+	for (size_t i = 0; key_valid && i < sizeof(emv_oda_ipk_icc_tags) / sizeof(emv_oda_ipk_icc_tags[0]); ++i) {
+		unsigned int tag = emv_oda_ipk_icc_tags[i];
+
+		key_valid = emv_oda_ipk_cache_key_append(
+			key,
+			sizeof(key),
+			&key_len,
+			emv_tlv_list_find_const(icc, tag),
+			tag == EMV_TAG_5A_APPLICATION_PAN ? sizeof(ipk->issuer_id) : EMV_ODA_IPK_CACHE_ABSENT
+		);
+	}
+	if (key_valid) {
+		key_valid = emv_oda_ipk_cache_key_append(
+			key,
+			sizeof(key),
+			&key_len,
+			emv_tlv_list_find_const(params, EMV_TAG_9A_TRANSACTION_DATE),
+			EMV_ODA_IPK_CACHE_ABSENT
+		);
+	}
+	if (!key_valid) {
+		// Fields too large to be cached
+		return emv_rsa_retrieve_issuer_pkey(
+			ipk_cert->value,
+			ipk_cert->length,
+			capk,
+			icc,
+			params,
+			ipk
+		);
+	}
+
+	// FNV-1a hash of CAPK and key
+	hash = 2166136261u;
+	for (size_t i = 0; i < sizeof(capk_ptr); ++i) {
+		hash = (hash ^ ((capk_ptr >> (i * 8)) & 0xFF)) * 16777619u;
+	}
+	for (size_t i = 0; i < key_len; ++i) {
+		hash = (hash ^ key[i]) * 16777619u;
+	}
+	bucket = &cache->bucket[hash % EMV_ODA_IPK_CACHE_BUCKETS];
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&cache->mutex);
+#endif
+	for (entry = *bucket; entry; entry = entry->next) {
+		if (entry->capk == capk &&
+			entry->key_len == key_len &&
+			memcmp(entry->key, key, key_len) == 0
+		) {
+			*ipk = entry->ipk;
+			r = entry->r;
+			break;
+		}
+	}
+	if (!entry) {
+		++cache->retrieval_count;
+	}
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&cache->mutex);
+#endif
+	if (entry) {
+		emv_debug_info("Use cached issuer public key retrieval");
+		crypto_cleanse(key, key_len);
+		return r;
+	}
+
+	// Retrieve issuer public key without holding the lock such that other
+	// retrievals may proceed concurrently. Concurrent retrievals of the same
+	// issuer public key produce the same result and only one is cached.
+	r = emv_rsa_retrieve_issuer_pkey(
+		ipk_cert->value,
+		ipk_cert->length,
+		capk,
+		icc,
+		params,
+		ipk
+	);
+
+	entry = malloc(sizeof(*entry) + key_len);
+	if (!entry) {
+		// Result remains valid even if it cannot be cached
+		crypto_cleanse(key, key_len);
+		return r;
+	}
+	entry->capk = capk;
+	entry->r = r;
+	entry->ipk = *ipk;
+	entry->key_len = key_len;
+	memcpy(entry->key, key, key_len);
+	crypto_cleanse(key, key_len);
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&cache->mutex);
+#endif
+	cached = cache->count >= EMV_ODA_IPK_CACHE_MAX;
+	for (struct emv_oda_ipk_cache_entry_t* other = *bucket; !cached && other; other = other->next) {
+		// Concurrent retrieval may already have cached the same result
+		cached = other->capk == capk &&
+			other->key_len == key_len &&
+			memcmp(other->key, entry->key, key_len) == 0;
+	}
+	if (!cached) {
+		entry->next = *bucket;
+		*bucket = entry;
+		++cache->count;
+		entry = NULL;
+	}
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&cache->mutex);
+#endif
+	if (entry) {
+		// Cache is full or result is already cached
+		crypto_cleanse(entry, sizeof(*entry) + key_len);
+		free(entry);
+	}
+
+	return r;
+}
+
+static int emv_oda_retrieve_issuer_pkey(
+	struct emv_ctx_t* ctx,
+	const struct emv_tlv_t* ipk_cert,
+	const struct emv_capk_t* capk,
+	struct emv_rsa_issuer_pkey_t* ipk
+)
+{
+	if (ctx->oda.ipk_cache) {
+		return emv_oda_ipk_cache_retrieve(
+			ctx->oda.ipk_cache,
+			ipk_cert,
+			capk,
+			&ctx->icc,
+			&ctx->params,
+			ipk
+		);
+	}
+
+	return emv_rsa_retrieve_issuer_pkey(
+		ipk_cert->value,
+		ipk_cert->length,
+		capk,
+		&ctx->icc,
+		&ctx->params,
+		ipk
+	);
+}
+
 int emv_oda_append_record(
 	struct emv_oda_ctx_t* ctx,
 	const void* record,
@@ -163,8 +560,8 @@ int emv_oda_append_record(
 		emv_debug_error("Invalid parameter");
 		return EMV_ODA_ERROR_INVALID_PARAMETER;
 	}
-	if (!ctx->record_buf) {
-		emv_debug_trace_msg("ctx->record_buf=%p", ctx->record_buf);
+	if (!ctx->record_buf_max) {
+		emv_debug_trace_msg("ctx->record_buf_max=%u", ctx->record_buf_max);
 		emv_debug_error("Invalid ODA buffer");
 		return EMV_ODA_ERROR_INVALID_PARAMETER;
 	}
@@ -173,6 +570,23 @@ int emv_oda_append_record(
 		emv_debug_error("Invalid ODA record length");
 		return EMV_ODA_ERROR_INVALID_PARAMETER;
 	}
+	if (ctx->record_buf_len + record_len > ctx->record_buf_max) {
+		emv_debug_trace_msg("record_buf_len=%u, record_len=%u, record_buf_max=%u",
+			ctx->record_buf_len, record_len, ctx->record_buf_max
+		);
+		emv_debug_error("ODA buffer overflow");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+
+	if (ctx->record_buf_len + record_len > ctx->record_buf_size) {
+		int r;
+
+		r = emv_oda_grow_records(ctx, ctx->record_buf_len + record_len);
+		if (r) {
+			emv_debug_error("Failed to allocate ODA buffer");
+			return EMV_ODA_ERROR_INTERNAL;
+		}
+	}
 
 	memcpy(ctx->record_buf + ctx->record_buf_len, record, record_len);
 	ctx->record_buf_len += record_len;
@@ -336,7 +750,7 @@ int emv_oda_apply_sda(struct emv_ctx_t* ctx)
 
 	// Retrieve Certificate Authority Public Key (CAPK)
 	// See EMV 4.4 Book 2, 5.2
-	capk = emv_capk_lookup(ctx->aid->value, capk_index->value[0]);
+	capk = emv_oda_capk_lookup(ctx, capk_index->value[0]);
 	if (!capk) {
 		emv_debug_error(
 			"CAPK %02X%02X%02X%02X%02X #%02X not found",
@@ -353,16 +767,9 @@ int emv_oda_apply_sda(struct emv_ctx_t* ctx)
 
 	// Retrieve issuer public key
 	// See EMV 4.4 Book 2, 5.3
-	r = emv_rsa_retrieve_issuer_pkey(
-		ipk_cert->value,
-		ipk_cert->length,
-		capk,
-		&ctx->icc,
-		&ctx->params,
-		&ipk
-	);
+	r = emv_oda_retrieve_issuer_pkey(ctx, ipk_cert, capk, &ipk);
 	if (r) {
-		emv_debug_trace_msg("emv_rsa_retrieve_issuer_pkey() failed; r=%d", r);
+		emv_debug_trace_msg("emv_oda_retrieve_issuer_pkey() failed; r=%d", r);
 		emv_debug_error("Failed to retrieve issuer public key");
 		// EMV_TVR_SDA_FAILED already set in TVR
 		r = EMV_ODA_SDA_FAILED;
@@ -497,7 +904,7 @@ static int emv_oda_apply_sad_auth(struct emv_ctx_t* ctx, struct emv_rsa_icc_pkey
 
 	// Retrieve Certificate Authority Public Key (CAPK)
 	// See EMV 4.4 Book 2, 6.2
-	capk = emv_capk_lookup(ctx->aid->value, capk_index->value[0]);
+	capk = emv_oda_capk_lookup(ctx, capk_index->value[0]);
 	if (!capk) {
 		emv_debug_error(
 			"CAPK %02X%02X%02X%02X%02X #%02X not found",
@@ -513,16 +920,9 @@ static int emv_oda_apply_sad_auth(struct emv_ctx_t* ctx, struct emv_rsa_icc_pkey
 
 	// Retrieve issuer public key
 	// See EMV 4.4 Book 2, 6.3
-	r = emv_rsa_retrieve_issuer_pkey(
-		ipk_cert->value,
-		ipk_cert->length,
-		capk,
-		&ctx->icc,
-		&ctx->params,
-		&ipk
-	);
+	r = emv_oda_retrieve_issuer_pkey(ctx, ipk_cert, capk, &ipk);
 	if (r) {
-		emv_debug_trace_msg("emv_rsa_retrieve_issuer_pkey() failed; r=%d", r);
+		emv_debug_trace_msg("emv_oda_retrieve_issuer_pkey() failed; r=%d", r);
 		if (r < 0) {
 			emv_debug_error("Failed to retrieve issuer public key");
 		} else {
@@ -648,7 +1048,7 @@ int emv_oda_apply_dda(struct emv_ctx_t* ctx)
 	ddol = emv_tlv_list_find_const(&ctx->icc, EMV_TAG_9F49_DDOL);
 	if (!ddol) {
 		emv_debug_info("Use default Dynamic Data Authentication Data Object List (DDOL)");
-		ddol = emv_tlv_list_find_const(&ctx->config, EMV_TAG_9F49_DDOL);
+		ddol = emv_config_find_from_ctx(ctx, EMV_TAG_9F49_DDOL);
 		if (!ddol) {
 			// Presence of Default DDOL should have been confirmed by
 			// emv_offline_data_authentication(), but if it is missing then
@@ -702,7 +1102,8 @@ int emv_oda_apply_dda(struct emv_ctx_t* ctx)
 
 	// Build DDOL data
 	// See EMV 4.4 Book 3, 5.4
-	r = emv_dol_build_data(
+	r = emv_dol_plan_cache_build_data(
+		ctx->dol_plan_cache,
 		ddol->value,
 		ddol->length,
 		&sources,
@@ -710,7 +1111,7 @@ int emv_oda_apply_dda(struct emv_ctx_t* ctx)
 		&ddol_data_len
 	);
 	if (r) {
-		emv_debug_trace_msg("emv_dol_build_data() failed; r=%d", r);
+		emv_debug_trace_msg("emv_dol_plan_cache_build_data() failed; r=%d", r);
 		emv_debug_error("Failed to build DDOL data");
 		// EMV_TVR_DDA_FAILED already set in TVR
 		r = EMV_ODA_DDA_FAILED;
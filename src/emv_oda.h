@@ -2,7 +2,7 @@
  * @file emv_oda.h
  * @brief EMV Offline Data Authentication (ODA) helper functions
  *
- * Copyright 2025 Leon Lynch
+ * Copyright 2025-2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -75,6 +75,10 @@ int emv_oda_init(struct emv_oda_ctx_t* ctx);
  * Prepare Offline Data Authentication (ODA) application record buffer
  * according to provided Application File Locator (AFL)
  *
+ * The buffer is allocated as records are appended and grows to the actual
+ * length of the records, limited by the maximum length of the records that
+ * are intended for offline data authentication according to the AFL.
+ *
  * @param ctx Offline Data Authentication (ODA) context
  * @param afl Application File Locator (AFL) field. Must be multiples of 4 bytes.
  * @param afl_len Length of Application File Locator (AFL) field. Must be multiples of 4 bytes.
@@ -88,6 +92,59 @@ int emv_oda_prepare_records(
 	size_t afl_len
 );
 
+/**
+ * Prepare Offline Data Authentication (ODA) application record buffer
+ * according to the known length of the records that are intended for
+ * offline data authentication, for example when verifying a logged
+ * transaction instead of reading the records from the card.
+ *
+ * The buffer is allocated as records are appended and grows to the actual
+ * length of the records, limited by the provided length and the encoded
+ * fields that are appended during offline data authentication.
+ *
+ * @param ctx Offline Data Authentication (ODA) context
+ * @param records_len Total length of application records in bytes
+ *
+ * @return Zero for success.
+ * @return Less than zero for error. See @ref emv_oda_error_t
+ */
+int emv_oda_prepare_records_len(
+	struct emv_oda_ctx_t* ctx,
+	size_t records_len
+);
+
+/**
+ * Create issuer public key cache. When provided by
+ * @ref emv_oda_ctx_t.ipk_cache, issuer public key retrieval uses the cached
+ * result of a previous retrieval with the same Certificate Authority Public
+ * Key (CAPK), issuer public key fields, issuer identifier digits of the
+ * application PAN and transaction date. The outcome of offline data
+ * authentication is identical to when the cache is not used.
+ *
+ * The cache may be shared by multiple contexts that are used concurrently by
+ * different threads. The CAPKs must remain valid while the cache is in use.
+ *
+ * @return Issuer public key cache. Use @ref emv_oda_ipk_cache_free() to free
+ *         memory. NULL for error.
+ */
+struct emv_oda_ipk_cache_t* emv_oda_ipk_cache_create(void);
+
+/**
+ * Retrieve number of issuer public key retrievals that could not use a cached
+ * result
+ *
+ * @param cache Issuer public key cache
+ * @return Number of issuer public key retrievals
+ */
+size_t emv_oda_ipk_cache_get_retrieval_count(struct emv_oda_ipk_cache_t* cache);
+
+/**
+ * Free issuer public key cache
+ *
+ * @param cache Issuer public key cache
+ */
+void emv_oda_ipk_cache_free(struct emv_oda_ipk_cache_t* cache);
+
 /**
  * Clear and free Offline Data Authentication (ODA) records. This function
  * is only intended to free memory sooner when these records are no longer
@@ -3,7 +3,7 @@
  * @brief EMV Offline Data Authentication (ODA) types used by high level EMV
  *        library interface
  *
- * Copyright 2025 Leon Lynch
+ * Copyright 2025-2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -29,6 +29,9 @@
 
 __BEGIN_DECLS
 
+// Forward declarations
+struct emv_oda_ipk_cache_t;
+
 /**
  * EMV Offline Data Authentication (ODA) method
  */
@@ -70,6 +73,15 @@ struct emv_rsa_icc_pkey_t {
 struct emv_oda_ctx_t {
 	uint8_t* record_buf; ///< Application record buffer
 	unsigned int record_buf_len; ///< Length of application record buffer
+	unsigned int record_buf_size; ///< Allocated size of application record buffer
+	unsigned int record_buf_max; ///< Maximum length of application record buffer according to AFL
+
+	/**
+	 * Issuer public key cache shared by multiple contexts, for example when
+	 * verifying logged transactions in bulk. NULL when not in use. See
+	 * @ref emv_oda_ipk_cache_create().
+	 */
+	struct emv_oda_ipk_cache_t* ipk_cache;
 
 	/**
 	 * Cached Processing Options Data Object List (PDOL) data for validating
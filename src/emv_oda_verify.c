@@ -0,0 +1,612 @@
+/**
+ * @file emv_oda_verify.c
+ * @brief Offline verification of EMV Offline Data Authentication (ODA) for
+ *        logged transactions
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_oda_verify.h"
+#include "emv_oda.h"
+#include "emv.h"
+#include "emv_tlv.h"
+#include "emv_tags.h"
+#include "emv_ttl.h"
+
+#define EMV_DEBUG_SOURCE EMV_DEBUG_SOURCE_ODA
+#include "emv_debug.h"
+
+#include "emv_utils_config.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h> // For sysconf()
+#endif
+
+#ifdef HAVE_PTHREAD
+/// Worker thread and its share of the transactions
+struct emv_oda_verify_worker_t {
+	struct emv_oda_verify_pool_t* pool;
+	pthread_t thread;
+	bool running;
+	pthread_mutex_t mutex;
+	size_t begin;
+	size_t end;
+};
+
+/// Work-stealing worker pool for a single batch
+struct emv_oda_verify_pool_t {
+	struct emv_oda_verify_ctx_t* ctx;
+	const struct emv_oda_verify_input_t* input;
+	struct emv_oda_verify_result_t* result;
+	struct emv_oda_verify_worker_t* workers;
+	unsigned int worker_count;
+};
+#endif
+
+int emv_oda_verify_init(struct emv_oda_verify_ctx_t* ctx)
+{
+	if (!ctx) {
+		emv_debug_trace_msg("ctx=%p", ctx);
+		emv_debug_error("Invalid parameter");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+	memset(ctx, 0, sizeof(*ctx));
+
+	ctx->ipk_cache = emv_oda_ipk_cache_create();
+	if (!ctx->ipk_cache) {
+		return EMV_ODA_ERROR_INTERNAL;
+	}
+
+	return 0;
+}
+
+static int emv_oda_verify_trx(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+)
+{
+	const struct emv_tlv_list_t* icc = ctx;
+	const uint8_t* c_apdu = tx_buf;
+	uint8_t* r_apdu = rx_buf;
+	const struct emv_tlv_t* sdad;
+	size_t r_apdu_len = 0;
+
+	if (!tx_buf || tx_buf_len < 4 || !rx_buf || !rx_buf_len || *rx_buf_len < 2) {
+		return -1;
+	}
+
+	// Only INTERNAL AUTHENTICATE is answered, using the logged Signed
+	// Dynamic Application Data (field 9F4B)
+	// See EMV 4.4 Book 3, 6.5.9.2, table 19
+	sdad = emv_tlv_list_find_const(icc, EMV_TAG_9F4B_SIGNED_DYNAMIC_APPLICATION_DATA);
+	if (c_apdu[1] != 0x88 ||
+		!sdad ||
+		sdad->length > 0xFF ||
+		*rx_buf_len < sdad->length + 5
+	) {
+		// Referenced data not found
+		r_apdu[0] = 0x6A;
+		r_apdu[1] = 0x88;
+		*rx_buf_len = 2;
+		return 0;
+	}
+
+	// Response format 1
+	// See EMV 4.4 Book 3, 6.5.9.4
+	r_apdu[r_apdu_len++] = EMV_TAG_80_RESPONSE_MESSAGE_TEMPLATE_FORMAT_1;
+	if (sdad->length > 0x7F) {
+		r_apdu[r_apdu_len++] = 0x81;
+	}
+	r_apdu[r_apdu_len++] = sdad->length;
+	memcpy(r_apdu + r_apdu_len, sdad->value, sdad->length);
+	r_apdu_len += sdad->length;
+	r_apdu[r_apdu_len++] = 0x90;
+	r_apdu[r_apdu_len++] = 0x00;
+	*rx_buf_len = r_apdu_len;
+
+	return 0;
+}
+
+static int emv_oda_verify_parse(
+	const void* ptr,
+	size_t len,
+	struct emv_tlv_list_t* list
+)
+{
+	if (!len) {
+		return 0;
+	}
+	if (!ptr) {
+		return -1;
+	}
+
+	return emv_tlv_parse(ptr, len, list);
+}
+
+static int emv_oda_verify_clear_field(
+	struct emv_tlv_list_t* list,
+	unsigned int tag,
+	unsigned int length
+)
+{
+	struct emv_tlv_t* tlv;
+
+	tlv = emv_tlv_list_find(list, tag);
+	if (tlv) {
+		if (tlv->length != length) {
+			return -1;
+		}
+		memset(tlv->value, 0, tlv->length);
+		return 0;
+	}
+
+	return emv_tlv_list_push(list, tag, length, (uint8_t[5]){ 0 }, 0);
+}
+
+static int emv_oda_verify_copy(
+	uint8_t* buf,
+	size_t buf_size,
+	size_t* buf_len,
+	const void* data,
+	size_t data_len
+)
+{
+	if (!data_len) {
+		*buf_len = 0;
+		return 0;
+	}
+	if (!data || data_len > buf_size) {
+		return -1;
+	}
+	memcpy(buf, data, data_len);
+	*buf_len = data_len;
+
+	return 0;
+}
+
+static int emv_oda_verify_prepare(
+	struct emv_ctx_t* emv,
+	const struct emv_oda_verify_input_t* input
+)
+{
+	int r;
+	const uint8_t* records = input->records;
+
+	// Logged fields
+	if (emv_oda_verify_parse(input->icc, input->icc_len, &emv->icc) ||
+		emv_oda_verify_parse(input->terminal, input->terminal_len, &emv->terminal) ||
+		emv_oda_verify_parse(input->params, input->params_len, &emv->params)
+	) {
+		emv_debug_error("Failed to parse logged transaction data");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+
+	// Offline data authentication starts with its own TVR and TSI bits only
+	if (emv_oda_verify_clear_field(&emv->terminal, EMV_TAG_95_TERMINAL_VERIFICATION_RESULTS, 5) ||
+		emv_oda_verify_clear_field(&emv->terminal, EMV_TAG_9B_TRANSACTION_STATUS_INFORMATION, 2)
+	) {
+		emv_debug_error("Invalid TVR or TSI");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+
+	// Populate cached fields as emv_initiate_application_processing() would
+	emv->aid = emv_tlv_list_find_const(&emv->terminal, EMV_TAG_9F06_AID);
+	emv->tvr = emv_tlv_list_find_const(&emv->terminal, EMV_TAG_95_TERMINAL_VERIFICATION_RESULTS);
+	emv->tsi = emv_tlv_list_find_const(&emv->terminal, EMV_TAG_9B_TRANSACTION_STATUS_INFORMATION);
+	emv->aip = emv_tlv_list_find_const(&emv->icc, EMV_TAG_82_APPLICATION_INTERCHANGE_PROFILE);
+	if (!emv->aid || emv->aid->length < 5) {
+		emv_debug_error("AID (terminal) not found");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+
+	// Static data to be authenticated, with room for the AIP
+	if (input->records_len && !records) {
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+	r = emv_oda_prepare_records_len(&emv->oda, input->records_len);
+	if (r) {
+		emv_debug_trace_msg("emv_oda_prepare_records_len() failed; r=%d", r);
+		emv_debug_error("Invalid static data length");
+		return r;
+	}
+	for (size_t offset = 0; offset < input->records_len; offset += EMV_RAPDU_DATA_MAX) {
+		size_t len = input->records_len - offset;
+
+		if (len > EMV_RAPDU_DATA_MAX) {
+			len = EMV_RAPDU_DATA_MAX;
+		}
+		r = emv_oda_append_record(&emv->oda, records + offset, len);
+		if (r) {
+			emv_debug_trace_msg("emv_oda_append_record() failed; r=%d", r);
+			return EMV_ODA_ERROR_INTERNAL;
+		}
+	}
+
+	// Cached DOL data and GENAC response for Transaction Data Hash Code
+	if (emv_oda_verify_copy(
+			emv->oda.pdol_data,
+			sizeof(emv->oda.pdol_data),
+			&emv->oda.pdol_data_len,
+			input->pdol_data,
+			input->pdol_data_len
+		) ||
+		emv_oda_verify_copy(
+			emv->oda.cdol1_data,
+			sizeof(emv->oda.cdol1_data),
+			&emv->oda.cdol1_data_len,
+			input->cdol1_data,
+			input->cdol1_data_len
+		) ||
+		emv_oda_verify_copy(
+			emv->oda.genac_data,
+			sizeof(emv->oda.genac_data),
+			&emv->oda.genac_data_len,
+			input->genac_data,
+			input->genac_data_len
+		)
+	) {
+		emv_debug_error("Invalid PDOL data, CDOL1 data or GENAC response data");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+
+	return 0;
+}
+
+static int emv_oda_verify_genac(struct emv_ctx_t* emv)
+{
+	int r;
+	struct emv_tlv_list_t genac_list = EMV_TLV_LIST_INIT;
+	static const unsigned int genac_tags[] = {
+		EMV_TAG_9F27_CRYPTOGRAM_INFORMATION_DATA,
+		EMV_TAG_9F4B_SIGNED_DYNAMIC_APPLICATION_DATA,
+	};
+
+	// Logged GENAC response fields used by CDA
+	for (size_t i = 0; i < sizeof(genac_tags) / sizeof(genac_tags[0]); ++i) {
+		const struct emv_tlv_t* tlv;
+
+		tlv = emv_tlv_list_find_const(&emv->icc, genac_tags[i]);
+		if (!tlv) {
+			continue;
+		}
+		r = emv_tlv_list_push(&genac_list, tlv->tag, tlv->length, tlv->value, 0);
+		if (r) {
+			emv_debug_trace_msg("emv_tlv_list_push() failed; r=%d", r);
+			emv_tlv_list_clear(&genac_list);
+			return EMV_ODA_ERROR_INTERNAL;
+		}
+	}
+
+	r = emv_oda_process_genac(emv, &genac_list);
+	emv_tlv_list_clear(&genac_list);
+
+	return r;
+}
+
+int emv_oda_verify(
+	struct emv_oda_verify_ctx_t* ctx,
+	const struct emv_oda_verify_input_t* input,
+	struct emv_oda_verify_result_t* result
+)
+{
+	int r;
+	struct emv_ttl_t ttl;
+	struct emv_ctx_t emv;
+	const struct emv_tlv_t* term_caps;
+
+	if (!ctx || !input || !result) {
+		emv_debug_trace_msg("ctx=%p, input=%p, result=%p", ctx, input, result);
+		emv_debug_error("Invalid parameter");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+	memset(result, 0, sizeof(*result));
+
+	// Card responses are provided by the logged ICC data
+	memset(&ttl, 0, sizeof(ttl));
+	ttl.cardreader.mode = EMV_CARDREADER_MODE_APDU;
+	ttl.cardreader.trx = &emv_oda_verify_trx;
+	r = emv_ctx_init(&emv, &ttl);
+	if (r) {
+		emv_debug_trace_msg("emv_ctx_init() failed; r=%d", r);
+		return EMV_ODA_ERROR_INTERNAL;
+	}
+	ttl.cardreader.ctx = &emv.icc;
+	emv.capk_list = ctx->capk_list;
+	emv.capk_count = ctx->capk_count;
+	emv.oda.ipk_cache = ctx->ipk_cache;
+	if (ctx->config) {
+		// Shared by all transactions and therefore restored before the
+		// EMV processing context is cleared
+		emv.config = *ctx->config;
+	}
+
+	r = emv_oda_verify_prepare(&emv, input);
+	if (r) {
+		goto exit;
+	}
+
+	switch (input->method) {
+		case EMV_ODA_METHOD_NONE:
+			term_caps = emv_tlv_list_find_const(&emv.terminal, EMV_TAG_9F33_TERMINAL_CAPABILITIES);
+			if (!term_caps) {
+				term_caps = emv_tlv_list_find_const(&emv.config, EMV_TAG_9F33_TERMINAL_CAPABILITIES);
+			}
+			if (!term_caps || term_caps->length != 3) {
+				emv_debug_error("Terminal Capabilities not found");
+				r = EMV_ODA_ERROR_INVALID_PARAMETER;
+				goto exit;
+			}
+			r = emv_oda_apply(&emv, term_caps->value);
+			break;
+
+		case EMV_ODA_METHOD_SDA:
+			emv.oda.method = EMV_ODA_METHOD_SDA;
+			r = emv_oda_apply_sda(&emv);
+			break;
+
+		case EMV_ODA_METHOD_DDA:
+			emv.oda.method = EMV_ODA_METHOD_DDA;
+			r = emv_oda_apply_dda(&emv);
+			break;
+
+		case EMV_ODA_METHOD_CDA:
+			emv.oda.method = EMV_ODA_METHOD_CDA;
+			r = emv_oda_apply_cda(&emv);
+			break;
+
+		default:
+			emv_debug_trace_msg("method=%u", input->method);
+			emv_debug_error("Unsupported ODA method");
+			r = EMV_ODA_ERROR_INVALID_PARAMETER;
+			goto exit;
+	}
+
+	// Complete CDA using the logged GENAC response
+	if (r == 0 && emv.oda.method == EMV_ODA_METHOD_CDA) {
+		r = emv_oda_verify_genac(&emv);
+	}
+
+exit:
+	result->r = r;
+	result->method = emv.oda.method;
+	if (emv.tvr && emv.tvr->length == sizeof(result->tvr)) {
+		memcpy(result->tvr, emv.tvr->value, sizeof(result->tvr));
+	}
+	if (emv.tsi && emv.tsi->length == sizeof(result->tsi)) {
+		memcpy(result->tsi, emv.tsi->value, sizeof(result->tsi));
+	}
+	emv.config = EMV_TLV_LIST_INIT;
+	emv_ctx_clear(&emv);
+
+	return 0;
+}
+
+static unsigned int emv_oda_verify_get_threads(const struct emv_oda_verify_ctx_t* ctx)
+{
+#ifdef HAVE_PTHREAD
+	if (ctx->threads) {
+		return ctx->threads;
+	}
+#ifdef _SC_NPROCESSORS_ONLN
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	if (count > 0) {
+		return count;
+	}
+#endif
+#endif
+
+	return 1;
+}
+
+#ifdef HAVE_PTHREAD
+static bool emv_oda_verify_worker_pop(
+	struct emv_oda_verify_worker_t* worker,
+	size_t* idx
+)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&worker->mutex);
+	if (worker->begin < worker->end) {
+		*idx = worker->begin++;
+		found = true;
+	}
+	pthread_mutex_unlock(&worker->mutex);
+
+	return found;
+}
+
+static bool emv_oda_verify_worker_steal(struct emv_oda_verify_worker_t* worker)
+{
+	struct emv_oda_verify_pool_t* pool = worker->pool;
+	unsigned int self = worker - pool->workers;
+
+	for (unsigned int i = 1; i < pool->worker_count; ++i) {
+		struct emv_oda_verify_worker_t* victim;
+		size_t remaining;
+		size_t begin = 0;
+		size_t end = 0;
+
+		// Steal the upper half of the remaining transactions, rounded up
+		// such that the last remaining transaction can be stolen as well
+		victim = &pool->workers[(self + i) % pool->worker_count];
+		pthread_mutex_lock(&victim->mutex);
+		remaining = victim->end - victim->begin;
+		if (remaining) {
+			begin = victim->end - (remaining + 1) / 2;
+			end = victim->end;
+			victim->end = begin;
+		}
+		pthread_mutex_unlock(&victim->mutex);
+
+		if (remaining) {
+			pthread_mutex_lock(&worker->mutex);
+			worker->begin = begin;
+			worker->end = end;
+			pthread_mutex_unlock(&worker->mutex);
+			return true;
+		}
+	}
+
+	// Transactions are never added and therefore all work has been taken
+	return false;
+}
+
+static void* emv_oda_verify_worker_run(void* arg)
+{
+	struct emv_oda_verify_worker_t* worker = arg;
+	struct emv_oda_verify_pool_t* pool = worker->pool;
+	size_t idx;
+
+	do {
+		while (emv_oda_verify_worker_pop(worker, &idx)) {
+			emv_oda_verify(pool->ctx, &pool->input[idx], &pool->result[idx]);
+		}
+	} while (emv_oda_verify_worker_steal(worker));
+
+	return NULL;
+}
+#endif
+
+int emv_oda_verify_batch(
+	struct emv_oda_verify_ctx_t* ctx,
+	const struct emv_oda_verify_input_t* input,
+	size_t count,
+	struct emv_oda_verify_result_t* result
+)
+{
+	int r;
+	unsigned int threads;
+
+	if (!ctx || (count && (!input || !result))) {
+		emv_debug_trace_msg("ctx=%p, input=%p, count=%zu, result=%p",
+			ctx, input, count, result
+		);
+		emv_debug_error("Invalid parameter");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+	if (!ctx->ipk_cache) {
+		emv_debug_error("Invalid context");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+
+	threads = emv_oda_verify_get_threads(ctx);
+	if (threads > count) {
+		threads = count;
+	}
+	if (threads <= 1) {
+		for (size_t i = 0; i < count; ++i) {
+			r = emv_oda_verify(ctx, &input[i], &result[i]);
+			if (r) {
+				return r;
+			}
+		}
+		return 0;
+	}
+
+#ifdef HAVE_PTHREAD
+	struct emv_oda_verify_pool_t pool;
+	unsigned int mutex_count;
+
+	pool.ctx = ctx;
+	pool.input = input;
+	pool.result = result;
+	pool.worker_count = threads;
+	pool.workers = calloc(threads, sizeof(*pool.workers));
+	if (!pool.workers) {
+		emv_debug_error("Failed to allocate worker threads");
+		return EMV_ODA_ERROR_INTERNAL;
+	}
+
+	// Each worker starts with an equal share of the transactions
+	for (mutex_count = 0; mutex_count < threads; ++mutex_count) {
+		struct emv_oda_verify_worker_t* worker = &pool.workers[mutex_count];
+
+		if (pthread_mutex_init(&worker->mutex, NULL)) {
+			emv_debug_error("Failed to initialise worker mutex");
+			r = EMV_ODA_ERROR_INTERNAL;
+			goto exit;
+		}
+		worker->pool = &pool;
+		worker->begin = count * mutex_count / threads;
+		worker->end = count * (mutex_count + 1) / threads;
+	}
+
+	// The calling thread is the first worker. If a worker thread cannot be
+	// created, its share of the transactions is stolen by the others.
+	for (unsigned int i = 1; i < threads; ++i) {
+		struct emv_oda_verify_worker_t* worker = &pool.workers[i];
+
+		r = pthread_create(&worker->thread, NULL, &emv_oda_verify_worker_run, worker);
+		if (r) {
+			emv_debug_trace_msg("pthread_create() failed; r=%d", r);
+			continue;
+		}
+		worker->running = true;
+	}
+	emv_oda_verify_worker_run(&pool.workers[0]);
+	for (unsigned int i = 1; i < threads; ++i) {
+		if (pool.workers[i].running) {
+			pthread_join(pool.workers[i].thread, NULL);
+		}
+	}
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	for (unsigned int i = 0; i < mutex_count; ++i) {
+		pthread_mutex_destroy(&pool.workers[i].mutex);
+	}
+	free(pool.workers);
+	return r;
+#else
+	return EMV_ODA_ERROR_INTERNAL;
+#endif
+}
+
+size_t emv_oda_verify_get_issuer_pkey_count(struct emv_oda_verify_ctx_t* ctx)
+{
+	if (!ctx) {
+		return 0;
+	}
+
+	return emv_oda_ipk_cache_get_retrieval_count(ctx->ipk_cache);
+}
+
+int emv_oda_verify_clear(struct emv_oda_verify_ctx_t* ctx)
+{
+	if (!ctx) {
+		emv_debug_trace_msg("ctx=%p", ctx);
+		emv_debug_error("Invalid parameter");
+		return EMV_ODA_ERROR_INVALID_PARAMETER;
+	}
+
+	emv_oda_ipk_cache_free(ctx->ipk_cache);
+	memset(ctx, 0, sizeof(*ctx));
+
+	return 0;
+}
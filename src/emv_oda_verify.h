@@ -0,0 +1,248 @@
+/**
+ * @file emv_oda_verify.h
+ * @brief Offline verification of EMV Offline Data Authentication (ODA) for
+ *        logged transactions
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EMV_ODA_VERIFY_H
+#define EMV_ODA_VERIFY_H
+
+#include "emv_oda_types.h"
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+#include <stdint.h>
+
+__BEGIN_DECLS
+
+// Forward declarations
+struct emv_capk_t;
+struct emv_tlv_list_t;
+struct emv_oda_ipk_cache_t;
+
+/**
+ * Logged transaction data required to verify offline data authentication
+ * without the card. All fields are optional but offline data authentication
+ * will fail if a field that the ODA method requires is missing.
+ */
+struct emv_oda_verify_input_t {
+	/**
+	 * ODA method selected during the transaction.
+	 * @ref EMV_ODA_METHOD_NONE to select the method as @ref emv_oda_apply()
+	 * would, according to Terminal Capabilities (field 9F33) in
+	 * @ref terminal or @ref emv_oda_verify_ctx_t.config and Application Interchange Profile (field 82) in
+	 * @ref icc.
+	 */
+	enum emv_oda_method_t method;
+
+	/**
+	 * BER encoded ICC data, as found in @ref emv_ctx_t.icc after the
+	 * transaction. For DDA this must include the Signed Dynamic Application
+	 * Data (field 9F4B) provided by INTERNAL AUTHENTICATE, and for CDA this
+	 * must include the Signed Dynamic Application Data (field 9F4B) and
+	 * Cryptogram Information Data (field 9F27) provided by GENERATE
+	 * APPLICATION CRYPTOGRAM.
+	 */
+	const void* icc;
+	size_t icc_len; ///< Length of @ref icc in bytes
+
+	/**
+	 * BER encoded terminal data, as found in @ref emv_ctx_t.terminal after
+	 * the transaction. Must include the AID (field 9F06) and, for DDA or CDA,
+	 * the Unpredictable Number (field 9F37). Terminal Verification Results
+	 * (field 95) and Transaction Status Information (field 9B) are ignored.
+	 */
+	const void* terminal;
+	size_t terminal_len; ///< Length of @ref terminal in bytes
+
+	/**
+	 * BER encoded transaction parameters, as found in @ref emv_ctx_t.params.
+	 * Should include the Transaction Date (field 9A).
+	 */
+	const void* params;
+	size_t params_len; ///< Length of @ref params in bytes
+
+	/**
+	 * Static data to be authenticated, as read from the application records
+	 * identified by the Application File Locator (AFL). The AIP is appended
+	 * according to the Static Data Authentication Tag List (field 9F4A) and
+	 * must not be included.
+	 */
+	const void* records;
+	size_t records_len; ///< Length of @ref records in bytes
+
+	/**
+	 * Processing Options Data Object List (PDOL) data, as provided by
+	 * @ref emv_oda_ctx_t.pdol_data. Only used by CDA.
+	 */
+	const void* pdol_data;
+	size_t pdol_data_len; ///< Length of @ref pdol_data in bytes
+
+	/**
+	 * Card Risk Management Data Object List 1 (CDOL1) data, as provided by
+	 * @ref emv_oda_ctx_t.cdol1_data. Only used by CDA.
+	 */
+	const void* cdol1_data;
+	size_t cdol1_data_len; ///< Length of @ref cdol1_data in bytes
+
+	/**
+	 * GENERATE APPLICATION CRYPTOGRAM response data, as provided by
+	 * @ref emv_oda_ctx_t.genac_data. Only used by CDA.
+	 */
+	const void* genac_data;
+	size_t genac_data_len; ///< Length of @ref genac_data in bytes
+};
+
+/**
+ * Verdict of offline data authentication for a logged transaction
+ */
+struct emv_oda_verify_result_t {
+	/**
+	 * Zero if offline data authentication succeeded. Greater than zero if
+	 * offline data authentication failed, see @ref emv_oda_result_t. Less
+	 * than zero if the transaction would have been terminated or could not
+	 * be verified, see @ref emv_oda_error_t.
+	 */
+	int r;
+
+	enum emv_oda_method_t method; ///< ODA method that was verified
+	uint8_t tvr[5]; ///< Terminal Verification Results (field 95) bits set by offline data authentication
+	uint8_t tsi[2]; ///< Transaction Status Information (field 9B) bits set by offline data authentication
+};
+
+/**
+ * Offline data authentication verification context
+ *
+ * Use @ref emv_oda_verify_init() to initialise the context, populate the
+ * optional members, and use @ref emv_oda_verify_clear() to release its
+ * resources.
+ */
+struct emv_oda_verify_ctx_t {
+	/**
+	 * Optional list of Certificate Authority Public Keys (CAPKs) that are
+	 * searched before the static CAPK data, similar to
+	 * @ref emv_ctx_t.capk_list. NULL to only use the static CAPK data. Must
+	 * remain valid while the context is in use.
+	 */
+	const struct emv_capk_t* capk_list;
+	size_t capk_count; ///< Number of entries in @ref capk_list
+
+	/**
+	 * Optional terminal configuration, similar to @ref emv_ctx_t.config,
+	 * providing the Default Dynamic Data Authentication Data Object List
+	 * (DDOL) (field 9F49) for DDA when the card does not provide a DDOL.
+	 * NULL if not available. Must remain valid while the context is in use.
+	 */
+	const struct emv_tlv_list_t* config;
+
+	/**
+	 * Number of worker threads used by @ref emv_oda_verify_batch(),
+	 * including the calling thread. Zero to use the number of online
+	 * processors.
+	 */
+	unsigned int threads;
+
+	/// @cond INTERNAL
+	struct emv_oda_ipk_cache_t* ipk_cache;
+	/// @endcond
+};
+
+/**
+ * Initialise offline data authentication verification context
+ *
+ * @param ctx Offline data authentication verification context
+ *
+ * @return Zero for success.
+ * @return Less than zero for error. See @ref emv_oda_error_t
+ */
+int emv_oda_verify_init(struct emv_oda_verify_ctx_t* ctx);
+
+/**
+ * Verify offline data authentication of a single logged transaction using
+ * the same processing as @ref emv_oda_apply_sda(), @ref emv_oda_apply_dda(),
+ * @ref emv_oda_apply_cda() and @ref emv_oda_process_genac(). The card
+ * responses are taken from the logged ICC data instead of the card.
+ *
+ * This function may be called concurrently by multiple threads using the
+ * same context.
+ *
+ * @param ctx Offline data authentication verification context
+ * @param input Logged transaction data
+ * @param result Verdict output
+ *
+ * @return Zero for success, in which case @p result provides the verdict.
+ * @return Less than zero for error. See @ref emv_oda_error_t
+ */
+int emv_oda_verify(
+	struct emv_oda_verify_ctx_t* ctx,
+	const struct emv_oda_verify_input_t* input,
+	struct emv_oda_verify_result_t* result
+);
+
+/**
+ * Verify offline data authentication of many logged transactions using the
+ * worker threads specified by @ref emv_oda_verify_ctx_t.threads. Each worker
+ * thread starts with an equal share of the transactions and steals half of
+ * the remaining transactions of another worker thread when it runs out, such
+ * that transactions with slower ODA methods or larger keys do not leave other
+ * worker threads idle. Issuer public key retrieval is shared by all
+ * transactions that depend upon the same issuer public key fields.
+ *
+ * @note The debug callback provided to @ref emv_debug_init() may be called
+ *       by multiple worker threads concurrently.
+ *
+ * @param ctx Offline data authentication verification context
+ * @param input Array of logged transaction data
+ * @param count Number of logged transactions
+ * @param result Array of verdict outputs, in the same order as @p input
+ *
+ * @return Zero for success, in which case @p result provides the verdicts.
+ * @return Less than zero for error. See @ref emv_oda_error_t
+ */
+int emv_oda_verify_batch(
+	struct emv_oda_verify_ctx_t* ctx,
+	const struct emv_oda_verify_input_t* input,
+	size_t count,
+	struct emv_oda_verify_result_t* result
+);
+
+/**
+ * Retrieve number of issuer public key retrievals performed by the context.
+ * Transactions that depend upon the same issuer public key fields share a
+ * single retrieval.
+ *
+ * @param ctx Offline data authentication verification context
+ * @return Number of issuer public key retrievals
+ */
+size_t emv_oda_verify_get_issuer_pkey_count(struct emv_oda_verify_ctx_t* ctx);
+
+/**
+ * Clear offline data authentication verification context and release its
+ * resources, including cached issuer public keys.
+ *
+ * @param ctx Offline data authentication verification context
+ *
+ * @return Zero for success.
+ * @return Less than zero for error. See @ref emv_oda_error_t
+ */
+int emv_oda_verify_clear(struct emv_oda_verify_ctx_t* ctx);
+
+__END_DECLS
+
+#endif
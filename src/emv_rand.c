@@ -0,0 +1,377 @@
+/**
+ * @file emv_rand.c
+ * @brief Buffered random number generation for EMV processing
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_rand.h"
+#include "emv_utils_config.h"
+
+#include "crypto_mem.h"
+#include "crypto_rand.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD_ATFORK
+#include <pthread.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define EMV_RAND_THREAD_LOCAL __declspec(thread)
+#else
+#define EMV_RAND_THREAD_LOCAL _Thread_local
+#endif
+
+#define EMV_RAND_KEY_LEN (32)
+#define EMV_RAND_NONCE_LEN (12)
+#define EMV_RAND_BLOCK_LEN (64)
+#define EMV_RAND_BLOCK_COUNT (16)
+#define EMV_RAND_BUF_LEN (EMV_RAND_BLOCK_LEN * EMV_RAND_BLOCK_COUNT)
+
+/// Generator state of a single thread
+struct emv_rand_state_t {
+	uint32_t key[EMV_RAND_KEY_LEN / 4];
+	uint32_t nonce[EMV_RAND_NONCE_LEN / 4];
+	uint8_t buf[EMV_RAND_BUF_LEN];
+	size_t buf_pos; // Offset of next unused output in buf
+	size_t output_len; // Output since last reseed
+	unsigned int generation; // Zero if not instantiated
+	bool reseed;
+
+	// Continuous health test state
+	bool seed_fp_valid;
+	uint64_t seed_fp;
+	bool block_fp_valid;
+	uint64_t block_fp;
+};
+
+static void emv_rand_default_seed(void* ctx, void* buf, size_t len);
+
+static EMV_RAND_THREAD_LOCAL struct emv_rand_state_t emv_rand_state;
+static emv_rand_seed_func_t emv_rand_seed_func = &emv_rand_default_seed;
+static void* emv_rand_seed_ctx = NULL;
+
+// Incremented whenever all threads must instantiate their generators again
+static unsigned int emv_rand_generation = 1;
+
+#ifdef HAVE_PTHREAD_ATFORK
+static pthread_once_t emv_rand_atfork_once = PTHREAD_ONCE_INIT;
+#endif
+
+static void emv_rand_default_seed(void* ctx, void* buf, size_t len)
+{
+	crypto_rand(buf, len);
+}
+
+static void emv_rand_next_generation(void)
+{
+	++emv_rand_generation;
+	if (!emv_rand_generation) {
+		// Zero indicates that a generator is not instantiated
+		++emv_rand_generation;
+	}
+}
+
+#ifdef HAVE_PTHREAD_ATFORK
+static void emv_rand_atfork_child(void)
+{
+	// Child process must not repeat the output of the parent process
+	emv_rand_next_generation();
+}
+
+static void emv_rand_atfork_register(void)
+{
+	pthread_atfork(NULL, NULL, &emv_rand_atfork_child);
+}
+#endif
+
+void emv_rand_set_seed_func(emv_rand_seed_func_t func, void* ctx)
+{
+	if (func) {
+		emv_rand_seed_func = func;
+		emv_rand_seed_ctx = ctx;
+	} else {
+		emv_rand_seed_func = &emv_rand_default_seed;
+		emv_rand_seed_ctx = NULL;
+	}
+	emv_rand_next_generation();
+}
+
+static inline uint32_t emv_rand_load32_le(const uint8_t* buf)
+{
+	return buf[0] |
+		((uint32_t)buf[1] << 8) |
+		((uint32_t)buf[2] << 16) |
+		((uint32_t)buf[3] << 24);
+}
+
+static inline void emv_rand_store32_le(uint8_t* buf, uint32_t x)
+{
+	buf[0] = x;
+	buf[1] = x >> 8;
+	buf[2] = x >> 16;
+	buf[3] = x >> 24;
+}
+
+static inline uint32_t emv_rand_rotl32(uint32_t x, unsigned int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+#define EMV_RAND_QUARTER_ROUND(a, b, c, d) \
+	do { \
+		a += b; d ^= a; d = emv_rand_rotl32(d, 16); \
+		c += d; b ^= c; b = emv_rand_rotl32(b, 12); \
+		a += b; d ^= a; d = emv_rand_rotl32(d, 8); \
+		c += d; b ^= c; b = emv_rand_rotl32(b, 7); \
+	} while (0)
+
+// ChaCha20 block function
+// See RFC 8439, 2.3
+static void emv_rand_chacha20_block(
+	const uint32_t* key,
+	uint32_t counter,
+	const uint32_t* nonce,
+	uint8_t* out
+)
+{
+	uint32_t input[16];
+	uint32_t x[16];
+
+	input[0] = 0x61707865;
+	input[1] = 0x3320646e;
+	input[2] = 0x79622d32;
+	input[3] = 0x6b206574;
+	memcpy(&input[4], key, EMV_RAND_KEY_LEN);
+	input[12] = counter;
+	memcpy(&input[13], nonce, EMV_RAND_NONCE_LEN);
+	memcpy(x, input, sizeof(x));
+
+	for (unsigned int i = 0; i < 10; ++i) {
+		// Column rounds
+		EMV_RAND_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+		EMV_RAND_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+		EMV_RAND_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+		EMV_RAND_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+
+		// Diagonal rounds
+		EMV_RAND_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+		EMV_RAND_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+		EMV_RAND_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+		EMV_RAND_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+	}
+
+	for (unsigned int i = 0; i < 16; ++i) {
+		emv_rand_store32_le(out + (i * 4), x[i] + input[i]);
+	}
+
+	crypto_cleanse(input, sizeof(input));
+	crypto_cleanse(x, sizeof(x));
+}
+
+static uint64_t emv_rand_fingerprint(const uint8_t* buf, size_t len)
+{
+	// FNV-1a
+	uint64_t fp = 0xcbf29ce484222325;
+
+	for (size_t i = 0; i < len; ++i) {
+		fp ^= buf[i];
+		fp *= 0x100000001b3;
+	}
+
+	return fp;
+}
+
+static void emv_rand_state_clear(struct emv_rand_state_t* state)
+{
+	crypto_cleanse(state, sizeof(*state));
+}
+
+static int emv_rand_state_reseed(struct emv_rand_state_t* state)
+{
+	uint8_t seed[EMV_RAND_SEED_LEN];
+	bool stuck = true;
+	uint64_t fp;
+
+#ifdef HAVE_PTHREAD_ATFORK
+	pthread_once(&emv_rand_atfork_once, &emv_rand_atfork_register);
+#endif
+
+	emv_rand_seed_func(emv_rand_seed_ctx, seed, sizeof(seed));
+
+	// Continuous health tests of seed material: reject seed material that
+	// consists of a single repeated byte value or that repeats the previous
+	// seed material
+	for (size_t i = 1; i < sizeof(seed); ++i) {
+		if (seed[i] != seed[0]) {
+			stuck = false;
+			break;
+		}
+	}
+	fp = emv_rand_fingerprint(seed, sizeof(seed));
+	if (stuck || (state->seed_fp_valid && fp == state->seed_fp)) {
+		crypto_cleanse(seed, sizeof(seed));
+		return EMV_RAND_ERROR_HEALTH_TEST_FAILED;
+	}
+	state->seed_fp = fp;
+	state->seed_fp_valid = true;
+
+	for (unsigned int i = 0; i < EMV_RAND_KEY_LEN / 4; ++i) {
+		state->key[i] = emv_rand_load32_le(seed + (i * 4));
+	}
+	for (unsigned int i = 0; i < EMV_RAND_NONCE_LEN / 4; ++i) {
+		state->nonce[i] = emv_rand_load32_le(seed + EMV_RAND_KEY_LEN + (i * 4));
+	}
+	crypto_cleanse(seed, sizeof(seed));
+
+	// Discard output produced using the previous key
+	crypto_cleanse(state->buf, sizeof(state->buf));
+	state->buf_pos = sizeof(state->buf);
+	state->output_len = 0;
+	state->reseed = false;
+
+	return 0;
+}
+
+static int emv_rand_state_refill(struct emv_rand_state_t* state)
+{
+	// Block counter starts at one, as for ChaCha20 encryption
+	// See RFC 8439, 2.4
+	for (unsigned int i = 0; i < EMV_RAND_BLOCK_COUNT; ++i) {
+		uint8_t* block = state->buf + (i * EMV_RAND_BLOCK_LEN);
+		uint64_t fp;
+
+		emv_rand_chacha20_block(state->key, i + 1, state->nonce, block);
+
+		// Continuous health test of generator output: reject consecutive
+		// blocks that end with the same 64 bits
+		fp = emv_rand_fingerprint(block + EMV_RAND_BLOCK_LEN - 8, 8);
+		if (state->block_fp_valid && fp == state->block_fp) {
+			return EMV_RAND_ERROR_HEALTH_TEST_FAILED;
+		}
+		state->block_fp = fp;
+		state->block_fp_valid = true;
+	}
+
+	// Replace key with the start of the output such that earlier output
+	// cannot be recovered from the generator state
+	for (unsigned int i = 0; i < EMV_RAND_KEY_LEN / 4; ++i) {
+		state->key[i] = emv_rand_load32_le(state->buf + (i * 4));
+	}
+	crypto_cleanse(state->buf, EMV_RAND_KEY_LEN);
+	state->buf_pos = EMV_RAND_KEY_LEN;
+
+	return 0;
+}
+
+int emv_rand(void* buf, size_t len)
+{
+	int r;
+	struct emv_rand_state_t* state = &emv_rand_state;
+	uint8_t* ptr = buf;
+
+	if (!buf && len) {
+		return EMV_RAND_ERROR_INVALID_PARAMETER;
+	}
+
+	if (state->generation != emv_rand_generation) {
+		// Instantiate generator, for example in a new thread, after the
+		// seed function changed or in the child process after fork()
+		emv_rand_state_clear(state);
+		r = emv_rand_state_reseed(state);
+		if (r) {
+			goto error;
+		}
+		state->generation = emv_rand_generation;
+	}
+
+	while (len) {
+		size_t n;
+
+		if (state->reseed || state->output_len >= EMV_RAND_RESEED_INTERVAL) {
+			r = emv_rand_state_reseed(state);
+			if (r) {
+				goto error;
+			}
+		}
+		if (state->buf_pos >= sizeof(state->buf)) {
+			r = emv_rand_state_refill(state);
+			if (r) {
+				goto error;
+			}
+		}
+
+		n = sizeof(state->buf) - state->buf_pos;
+		if (n > len) {
+			n = len;
+		}
+		memcpy(ptr, state->buf + state->buf_pos, n);
+		crypto_cleanse(state->buf + state->buf_pos, n);
+		state->buf_pos += n;
+		state->output_len += n;
+		ptr += n;
+		len -= n;
+	}
+
+	return 0;
+
+error:
+	// Generator must be instantiated again before the next output
+	emv_rand_state_clear(state);
+	if (buf) {
+		crypto_cleanse(buf, ptr - (uint8_t*)buf);
+	}
+	return r;
+}
+
+int emv_rand_byte(unsigned int min, unsigned int max)
+{
+	int r;
+	unsigned int range;
+	unsigned int limit;
+	uint8_t x;
+
+	if (min > max || max > 0xFF) {
+		return EMV_RAND_ERROR_INVALID_PARAMETER;
+	}
+
+	// Reject values beyond the largest multiple of the range to avoid
+	// modulo bias
+	range = max - min + 1;
+	limit = 0x100 - (0x100 % range);
+	do {
+		r = emv_rand(&x, sizeof(x));
+		if (r) {
+			return r;
+		}
+	} while (x >= limit);
+
+	return min + (x % range);
+}
+
+void emv_rand_reseed(void)
+{
+	emv_rand_state.reseed = true;
+}
+
+void emv_rand_clear(void)
+{
+	emv_rand_state_clear(&emv_rand_state);
+}
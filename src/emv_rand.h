@@ -0,0 +1,114 @@
+/**
+ * @file emv_rand.h
+ * @brief Buffered random number generation for EMV processing
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EMV_RAND_H
+#define EMV_RAND_H
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+
+__BEGIN_DECLS
+
+/// Length of seed material in bytes, consisting of a 256-bit ChaCha20 key
+/// followed by a 96-bit ChaCha20 nonce
+#define EMV_RAND_SEED_LEN (44)
+
+/// Number of output bytes after which the generator is reseeded
+#define EMV_RAND_RESEED_INTERVAL (65536)
+
+/**
+ * Random number generation errors
+ */
+enum emv_rand_error_t {
+	EMV_RAND_ERROR_INVALID_PARAMETER = -1, ///< Invalid function parameter
+	EMV_RAND_ERROR_HEALTH_TEST_FAILED = -2, ///< Continuous health test failed
+};
+
+/**
+ * Seed function used to obtain seed material
+ *
+ * @param ctx Seed function context provided to @ref emv_rand_set_seed_func()
+ * @param buf Seed material output of length @p len
+ * @param len Length of seed material in bytes
+ */
+typedef void (*emv_rand_seed_func_t)(void* ctx, void* buf, size_t len);
+
+/**
+ * Set the seed function used by all threads to seed and reseed the
+ * generator. This also causes all threads to reseed before their next
+ * output. Deterministic seed functions allow benchmarks and tests to be
+ * reproducible but must never be used for actual transactions.
+ *
+ * @note This function is not thread safe and must not be called while other
+ *       threads use @ref emv_rand() or @ref emv_rand_byte().
+ *
+ * @param func Seed function. NULL to restore the default seed function that
+ *             uses the crypto library's random number generator.
+ * @param ctx Seed function context
+ */
+void emv_rand_set_seed_func(emv_rand_seed_func_t func, void* ctx);
+
+/**
+ * Fill buffer with random bytes provided by the generator of the current
+ * thread.
+ *
+ * Each thread has its own ChaCha20 based generator that produces a buffer of
+ * output at a time such that the crypto library's random number generator is
+ * only used for seeding and periodic reseeding. The key is replaced with
+ * generator output after every refill to prevent the recovery of earlier
+ * output. The seed material and generator output are subject to continuous
+ * health tests and a failure causes the generator of the current thread to
+ * be cleared and reseeded before the next output.
+ *
+ * @param buf Output buffer
+ * @param len Length of output in bytes
+ *
+ * @return Zero for success.
+ * @return Less than zero for error. See @ref emv_rand_error_t
+ */
+int emv_rand(void* buf, size_t len);
+
+/**
+ * Obtain unbiased random byte value within the specified range using
+ * @ref emv_rand().
+ *
+ * @param min Minimum value
+ * @param max Maximum value. Must not exceed 255.
+ *
+ * @return Random value in the range @p min to @p max, inclusive.
+ * @return Less than zero for error. See @ref emv_rand_error_t
+ */
+int emv_rand_byte(unsigned int min, unsigned int max);
+
+/**
+ * Reseed the generator of the current thread before its next output.
+ */
+void emv_rand_reseed(void);
+
+/**
+ * Clear the generator state of the current thread. Should be used before a
+ * thread exits to ensure that its generator state does not remain in memory.
+ */
+void emv_rand_clear(void);
+
+__END_DECLS
+
+#endif
@@ -2,7 +2,7 @@
  * @file emv_rsa.c
  * @brief EMV RSA helper functions
  *
- * Copyright 2025 Leon Lynch
+ * Copyright 2025-2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -27,6 +27,8 @@
 #include "emv_tags.h"
 #include "emv_date.h"
 
+#include "emv_utils_config.h"
+
 #define EMV_DEBUG_SOURCE EMV_DEBUG_SOURCE_ODA
 #include "emv_debug.h"
 
@@ -88,6 +90,360 @@ struct emv_rsa_decrypted_sdad_t {
 	uint8_t body[(1984 / 8) - 25 + 20 + 1];
 } __attribute__((packed));
 
+#ifdef EMV_RSA_BACKEND_BUILTIN_DEFAULT
+static enum emv_rsa_backend_t emv_rsa_backend = EMV_RSA_BACKEND_BUILTIN;
+#else
+static enum emv_rsa_backend_t emv_rsa_backend = EMV_RSA_BACKEND_CRYPTO;
+#endif
+
+int emv_rsa_set_backend(enum emv_rsa_backend_t backend)
+{
+	if (backend != EMV_RSA_BACKEND_CRYPTO &&
+		backend != EMV_RSA_BACKEND_BUILTIN
+	) {
+		return -1;
+	}
+
+	emv_rsa_backend = backend;
+	return 0;
+}
+
+enum emv_rsa_backend_t emv_rsa_get_backend(void)
+{
+	return emv_rsa_backend;
+}
+
+// Double width limb for limb multiplication
+#if defined(__SIZEOF_INT128__)
+typedef unsigned __int128 emv_rsa_dlimb_t;
+#else
+typedef uint64_t emv_rsa_dlimb_t;
+#endif
+#define EMV_RSA_LIMB_BITS (sizeof(emv_rsa_limb_t) * 8)
+#define EMV_RSA_LIMB_BYTES (sizeof(emv_rsa_limb_t))
+
+static int emv_rsa_mont_cmp(const emv_rsa_limb_t* a, const emv_rsa_limb_t* b, unsigned int limbs)
+{
+	for (unsigned int i = limbs; i > 0; --i) {
+		if (a[i - 1] != b[i - 1]) {
+			return a[i - 1] > b[i - 1] ? 1 : -1;
+		}
+	}
+	return 0;
+}
+
+static void emv_rsa_mont_sub(emv_rsa_limb_t* a, const emv_rsa_limb_t* b, unsigned int limbs)
+{
+	emv_rsa_limb_t borrow = 0;
+
+	for (unsigned int i = 0; i < limbs; ++i) {
+		emv_rsa_limb_t d = a[i] - b[i];
+		emv_rsa_limb_t next_borrow = (a[i] < b[i]) | (d < borrow);
+		a[i] = d - borrow;
+		borrow = next_borrow;
+	}
+}
+
+static void emv_rsa_mont_load(
+	emv_rsa_limb_t* r,
+	const uint8_t* buf,
+	size_t buf_len
+)
+{
+	// Big endian bytes to little endian limbs
+	for (size_t i = 0; i < buf_len; ++i) {
+		r[i / EMV_RSA_LIMB_BYTES] |= (emv_rsa_limb_t)buf[buf_len - 1 - i] << (8 * (i % EMV_RSA_LIMB_BYTES));
+	}
+}
+
+// Montgomery multiplication r = a * b * R^-1 mod n where R = 2^(limb bits *
+// limbs) using the Coarsely Integrated Operand Scanning (CIOS) method. At
+// least one of the operands must be less than n for the result to be less
+// than n.
+static void emv_rsa_mont_mul(
+	const struct emv_rsa_key_t* key,
+	const emv_rsa_limb_t* a,
+	const emv_rsa_limb_t* b,
+	emv_rsa_limb_t* r
+)
+{
+	const unsigned int limbs = key->limbs;
+	const emv_rsa_limb_t* n = key->n;
+	emv_rsa_limb_t t[EMV_RSA_KEY_LIMBS_MAX + 2] = { 0 };
+
+	for (unsigned int i = 0; i < limbs; ++i) {
+		emv_rsa_dlimb_t c = 0;
+		emv_rsa_limb_t m;
+
+		// t += a * b[i]
+		for (unsigned int j = 0; j < limbs; ++j) {
+			c = (emv_rsa_dlimb_t)a[j] * b[i] + t[j] + (c >> EMV_RSA_LIMB_BITS);
+			t[j] = (emv_rsa_limb_t)c;
+		}
+		c = (emv_rsa_dlimb_t)t[limbs] + (c >> EMV_RSA_LIMB_BITS);
+		t[limbs] = (emv_rsa_limb_t)c;
+		t[limbs + 1] = (emv_rsa_limb_t)(c >> EMV_RSA_LIMB_BITS);
+
+		// t = (t + m * n) / 2^(limb bits)
+		m = t[0] * key->n0inv;
+		c = (emv_rsa_dlimb_t)m * n[0] + t[0];
+		for (unsigned int j = 1; j < limbs; ++j) {
+			c = (emv_rsa_dlimb_t)m * n[j] + t[j] + (c >> EMV_RSA_LIMB_BITS);
+			t[j - 1] = (emv_rsa_limb_t)c;
+		}
+		c = (emv_rsa_dlimb_t)t[limbs] + (c >> EMV_RSA_LIMB_BITS);
+		t[limbs - 1] = (emv_rsa_limb_t)c;
+		t[limbs] = t[limbs + 1] + (emv_rsa_limb_t)(c >> EMV_RSA_LIMB_BITS);
+	}
+
+	if (t[limbs] || emv_rsa_mont_cmp(t, n, limbs) >= 0) {
+		emv_rsa_mont_sub(t, n, limbs);
+	}
+	memcpy(r, t, limbs * sizeof(emv_rsa_limb_t));
+}
+
+// Montgomery squaring r = a * a * R^-1 mod n which computes each of the
+// off-diagonal products only once, followed by separate Montgomery reduction.
+// The operand must be less than n.
+static void emv_rsa_mont_sqr(
+	const struct emv_rsa_key_t* key,
+	const emv_rsa_limb_t* a,
+	emv_rsa_limb_t* r
+)
+{
+	const unsigned int limbs = key->limbs;
+	const emv_rsa_limb_t* n = key->n;
+	emv_rsa_limb_t t[(EMV_RSA_KEY_LIMBS_MAX * 2) + 1] = { 0 };
+	emv_rsa_limb_t carry;
+	emv_rsa_dlimb_t c;
+
+	// Off-diagonal products a[i] * a[j] where i < j
+	for (unsigned int i = 0; i < limbs; ++i) {
+		c = 0;
+		for (unsigned int j = i + 1; j < limbs; ++j) {
+			c = (emv_rsa_dlimb_t)a[i] * a[j] + t[i + j] + (c >> EMV_RSA_LIMB_BITS);
+			t[i + j] = (emv_rsa_limb_t)c;
+		}
+		t[i + limbs] = (emv_rsa_limb_t)(c >> EMV_RSA_LIMB_BITS);
+	}
+
+	// Double the off-diagonal products
+	carry = 0;
+	for (unsigned int i = 0; i < limbs * 2; ++i) {
+		emv_rsa_limb_t next_carry = t[i] >> (EMV_RSA_LIMB_BITS - 1);
+		t[i] = (t[i] << 1) | carry;
+		carry = next_carry;
+	}
+
+	// Add diagonal products a[i] * a[i]
+	c = 0;
+	for (unsigned int i = 0; i < limbs; ++i) {
+		c = (emv_rsa_dlimb_t)a[i] * a[i] + t[i * 2] + (c >> EMV_RSA_LIMB_BITS);
+		t[i * 2] = (emv_rsa_limb_t)c;
+		c = (emv_rsa_dlimb_t)t[(i * 2) + 1] + (c >> EMV_RSA_LIMB_BITS);
+		t[(i * 2) + 1] = (emv_rsa_limb_t)c;
+	}
+
+	// Montgomery reduction
+	for (unsigned int i = 0; i < limbs; ++i) {
+		emv_rsa_limb_t m = t[i] * key->n0inv;
+
+		c = 0;
+		for (unsigned int j = 0; j < limbs; ++j) {
+			c = (emv_rsa_dlimb_t)m * n[j] + t[i + j] + (c >> EMV_RSA_LIMB_BITS);
+			t[i + j] = (emv_rsa_limb_t)c;
+		}
+		c >>= EMV_RSA_LIMB_BITS;
+		for (unsigned int k = i + limbs; c && k <= limbs * 2; ++k) {
+			c += t[k];
+			t[k] = (emv_rsa_limb_t)c;
+			c >>= EMV_RSA_LIMB_BITS;
+		}
+	}
+
+	if (t[limbs * 2] || emv_rsa_mont_cmp(t + limbs, n, limbs) >= 0) {
+		emv_rsa_mont_sub(t + limbs, n, limbs);
+	}
+	memcpy(r, t + limbs, limbs * sizeof(emv_rsa_limb_t));
+}
+
+int emv_rsa_key_init(
+	struct emv_rsa_key_t* key,
+	const void* modulus,
+	size_t modulus_len,
+	const void* exponent,
+	size_t exponent_len
+)
+{
+	const uint8_t* m = modulus;
+	const uint8_t* e = exponent;
+	unsigned int limbs;
+	unsigned int bits;
+	emv_rsa_limb_t inv;
+	emv_rsa_limb_t t[EMV_RSA_KEY_LIMBS_MAX];
+
+	if (!key || !modulus || !exponent) {
+		return -1;
+	}
+	if (!modulus_len || modulus_len > EMV_RSA_KEY_LIMBS_MAX * EMV_RSA_LIMB_BYTES ||
+		!exponent_len || exponent_len > sizeof(key->exponent)
+	) {
+		return -2;
+	}
+	if (!m[0] || !(m[modulus_len - 1] & 0x01)) {
+		// Modulus must be odd and have no leading zero bytes
+		return -3;
+	}
+
+	memset(key, 0, sizeof(*key));
+	key->modulus_len = modulus_len;
+	limbs = (modulus_len + EMV_RSA_LIMB_BYTES - 1) / EMV_RSA_LIMB_BYTES;
+	key->limbs = limbs;
+	emv_rsa_mont_load(key->n, m, modulus_len);
+	for (size_t i = 0; i < exponent_len; ++i) {
+		key->exponent = (key->exponent << 8) | e[i];
+	}
+	if (!key->exponent) {
+		return -4;
+	}
+
+	// Compute n0inv = -n^-1 mod 2^(limb bits) using Newton's method which
+	// doubles the number of correct bits in each iteration
+	inv = 1;
+	for (unsigned int i = 0; i < 6; ++i) {
+		inv *= 2 - key->n[0] * inv;
+	}
+	key->n0inv = -inv;
+
+	// Compute R^2 mod n by first doubling 2^(bits - 1) < n until it is
+	// 2^limbs * R mod n, which is the Montgomery representation of 2^limbs,
+	// followed by Montgomery squarings to obtain the Montgomery
+	// representation of 2^(limb bits * limbs) = R
+	bits = (limbs - 1) * EMV_RSA_LIMB_BITS;
+	for (emv_rsa_limb_t top = key->n[limbs - 1]; top; top >>= 1) {
+		++bits;
+	}
+	memset(t, 0, sizeof(t));
+	t[(bits - 1) / EMV_RSA_LIMB_BITS] = (emv_rsa_limb_t)1 << ((bits - 1) % EMV_RSA_LIMB_BITS);
+	for (unsigned int i = 0; i < (limbs * EMV_RSA_LIMB_BITS) - bits + 1 + limbs; ++i) {
+		emv_rsa_limb_t carry = 0;
+
+		for (unsigned int j = 0; j < limbs; ++j) {
+			emv_rsa_limb_t next_carry = t[j] >> (EMV_RSA_LIMB_BITS - 1);
+			t[j] = (t[j] << 1) | carry;
+			carry = next_carry;
+		}
+		if (carry || emv_rsa_mont_cmp(t, key->n, limbs) >= 0) {
+			emv_rsa_mont_sub(t, key->n, limbs);
+		}
+	}
+	for (unsigned int i = 1; i < EMV_RSA_LIMB_BITS; i <<= 1) {
+		emv_rsa_mont_sqr(key, t, t);
+	}
+	memcpy(key->rr, t, limbs * sizeof(emv_rsa_limb_t));
+
+	return 0;
+}
+
+static void emv_rsa_mont_exp(
+	const struct emv_rsa_key_t* key,
+	const void* input,
+	void* output
+)
+{
+	uint8_t* out = output;
+	emv_rsa_limb_t x[EMV_RSA_KEY_LIMBS_MAX] = { 0 };
+	emv_rsa_limb_t xm[EMV_RSA_KEY_LIMBS_MAX];
+	emv_rsa_limb_t a[EMV_RSA_KEY_LIMBS_MAX];
+
+	// Input is less than the modulus as validated by emv_rsa_mod_exp()
+	emv_rsa_mont_load(x, input, key->modulus_len);
+
+	// Convert to Montgomery representation
+	emv_rsa_mont_mul(key, x, key->rr, xm);
+
+	if (key->exponent == 3) {
+		// x^3 = (x^2 * R) * x * R^-1
+		emv_rsa_mont_sqr(key, xm, a);
+		emv_rsa_mont_mul(key, a, x, a);
+	} else if (key->exponent == 65537) {
+		// x^65537 = (x^65536 * R) * x * R^-1
+		emv_rsa_mont_sqr(key, xm, a);
+		for (unsigned int i = 1; i < 16; ++i) {
+			emv_rsa_mont_sqr(key, a, a);
+		}
+		emv_rsa_mont_mul(key, a, x, a);
+	} else {
+		// Generic left-to-right square-and-multiply exponentiation. Public
+		// key operations do not require constant time exponentiation.
+		emv_rsa_limb_t one[EMV_RSA_KEY_LIMBS_MAX] = { 1 };
+		int bit = 31;
+
+		while (!(key->exponent & ((uint32_t)1 << bit))) {
+			--bit;
+		}
+		memcpy(a, xm, sizeof(a));
+		while (--bit >= 0) {
+			emv_rsa_mont_sqr(key, a, a);
+			if (key->exponent & ((uint32_t)1 << bit)) {
+				emv_rsa_mont_mul(key, a, xm, a);
+			}
+		}
+		emv_rsa_mont_mul(key, a, one, a);
+	}
+
+	// Little endian limbs to big endian output bytes
+	for (size_t i = 0; i < key->modulus_len; ++i) {
+		out[key->modulus_len - 1 - i] = a[i / EMV_RSA_LIMB_BYTES] >> (8 * (i % EMV_RSA_LIMB_BYTES));
+	}
+}
+
+int emv_rsa_mod_exp(
+	const struct emv_rsa_key_t* key,
+	const void* modulus,
+	size_t modulus_len,
+	const void* exponent,
+	size_t exponent_len,
+	const void* input,
+	void* output
+)
+{
+	int r;
+	struct emv_rsa_key_t tmp;
+
+	if (!modulus || !exponent || !input || !output) {
+		return -1;
+	}
+
+	if (emv_rsa_backend == EMV_RSA_BACKEND_CRYPTO) {
+		return crypto_rsa_mod_exp(
+			modulus,
+			modulus_len,
+			exponent,
+			exponent_len,
+			input,
+			output
+		);
+	}
+
+	// Reject input that is not less than the modulus, like the crypto
+	// backend. Both are big endian and of the same length.
+	if (memcmp(input, modulus, modulus_len) >= 0) {
+		return -2;
+	}
+
+	if (!key || key->modulus_len != modulus_len) {
+		r = emv_rsa_key_init(&tmp, modulus, modulus_len, exponent, exponent_len);
+		if (r) {
+			return r;
+		}
+		key = &tmp;
+	}
+	emv_rsa_mont_exp(key, input, output);
+
+	return 0;
+}
+
 int emv_rsa_retrieve_issuer_pkey(
 	const uint8_t* issuer_cert,
 	size_t issuer_cert_len,
@@ -131,7 +487,8 @@ int emv_rsa_retrieve_issuer_pkey(
 
 	// Decrypt Issuer Public Key Certificate (field 90)
 	// See EMV 4.4 Book 2, 5.3, step 2
-	r = crypto_rsa_mod_exp(
+	r = emv_rsa_mod_exp(
+		emv_capk_get_key(capk),
 		capk->modulus,
 		capk->modulus_len,
 		capk->exponent,
@@ -374,7 +731,8 @@ int emv_rsa_retrieve_ssad(
 
 	// Decrypt Signed Static Application Data (field 93)
 	// See EMV 4.4 Book 2, 5.4, step 2
-	r = crypto_rsa_mod_exp(
+	r = emv_rsa_mod_exp(
+		NULL,
 		issuer_pkey->modulus,
 		issuer_pkey->modulus_len,
 		issuer_pkey->exponent,
@@ -524,7 +882,8 @@ int emv_rsa_retrieve_icc_pkey(
 
 	// Decrypt ICC Public Key Certificate (field 9F46)
 	// See EMV 4.4 Book 2, 6.4, step 2
-	r = crypto_rsa_mod_exp(
+	r = emv_rsa_mod_exp(
+		NULL,
 		issuer_pkey->modulus,
 		issuer_pkey->modulus_len,
 		issuer_pkey->exponent,
@@ -792,7 +1151,8 @@ int emv_rsa_retrieve_sdad(
 	// Decrypt Signed Dynamic Application Data (field 9F4B)
 	// See EMV 4.4 Book 2, 6.5.2, step 2
 	// See EMV 4.4 Book 2, 6.6.2, step 2
-	r = crypto_rsa_mod_exp(
+	r = emv_rsa_mod_exp(
+		NULL,
 		icc_pkey->modulus,
 		icc_pkey->modulus_len,
 		icc_pkey->exponent,
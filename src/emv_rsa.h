@@ -2,7 +2,7 @@
  * @file emv_rsa.h
  * @brief EMV RSA helper functions
  *
- * Copyright 2025 Leon Lynch
+ * Copyright 2025-2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -97,6 +97,118 @@ struct emv_rsa_sdad_t {
 	uint8_t hash[20]; ///< Hash used for Signed Dynamic Application Data validation
 };
 
+/**
+ * RSA public key operation backends
+ *
+ * The default backend is selected at build time using the EMV_RSA_BACKEND
+ * CMake option and can be changed using @ref emv_rsa_set_backend().
+ */
+enum emv_rsa_backend_t {
+	/**
+	 * Generic modular exponentiation provided by the crypto library, which
+	 * in turn uses the implementation (for example mbed TLS or OpenSSL) that
+	 * was selected when the crypto library was built.
+	 */
+	EMV_RSA_BACKEND_CRYPTO = 0,
+
+	/**
+	 * Built-in Montgomery multiplication specialised for the public
+	 * exponents 3 and 65537 that are used by virtually all EMV keys. Other
+	 * public exponents use generic square-and-multiply exponentiation.
+	 * Precomputed parameters provided by @ref emv_rsa_key_t are used when
+	 * available.
+	 */
+	EMV_RSA_BACKEND_BUILTIN,
+};
+
+/// @cond INTERNAL
+#if defined(__SIZEOF_INT128__)
+typedef uint64_t emv_rsa_limb_t;
+#else
+typedef uint32_t emv_rsa_limb_t;
+#endif
+/// @endcond
+
+/// Maximum number of limbs of an RSA modulus used by EMV
+#define EMV_RSA_KEY_LIMBS_MAX ((1984 / 8) / sizeof(emv_rsa_limb_t))
+
+/**
+ * Precomputed RSA public key parameters for @ref EMV_RSA_BACKEND_BUILTIN
+ *
+ * These parameters are independent of the data to be decrypted and can
+ * therefore be computed once per public key. See @ref emv_capk_t.key.
+ */
+struct emv_rsa_key_t {
+	/// @cond INTERNAL
+	unsigned int modulus_len;
+	unsigned int limbs;
+	uint32_t exponent;
+	emv_rsa_limb_t n0inv;
+	emv_rsa_limb_t n[EMV_RSA_KEY_LIMBS_MAX];
+	emv_rsa_limb_t rr[EMV_RSA_KEY_LIMBS_MAX];
+	/// @endcond
+};
+
+/**
+ * Select RSA public key operation backend for all subsequent RSA public key
+ * operations. This function is not thread safe and should be called before
+ * EMV processing.
+ *
+ * @param backend RSA public key operation backend
+ * @return Zero for success. Less than zero for error.
+ */
+int emv_rsa_set_backend(enum emv_rsa_backend_t backend);
+
+/**
+ * Retrieve current RSA public key operation backend
+ * @return RSA public key operation backend
+ */
+enum emv_rsa_backend_t emv_rsa_get_backend(void);
+
+/**
+ * Precompute RSA public key parameters for @ref EMV_RSA_BACKEND_BUILTIN
+ *
+ * @param key Precomputed RSA public key parameters output
+ * @param modulus Public key modulus. Must be odd and without leading zero
+ *                bytes.
+ * @param modulus_len Length of public key modulus in bytes
+ * @param exponent Public key exponent
+ * @param exponent_len Length of public key exponent in bytes
+ *
+ * @return Zero for success. Less than zero for error.
+ */
+int emv_rsa_key_init(
+	struct emv_rsa_key_t* key,
+	const void* modulus,
+	size_t modulus_len,
+	const void* exponent,
+	size_t exponent_len
+);
+
+/**
+ * Perform RSA public key operation using the current backend
+ *
+ * @param key Optional precomputed RSA public key parameters. Only used by
+ *            @ref EMV_RSA_BACKEND_BUILTIN. NULL to compute them as needed.
+ * @param modulus Public key modulus
+ * @param modulus_len Length of public key modulus in bytes
+ * @param exponent Public key exponent
+ * @param exponent_len Length of public key exponent in bytes
+ * @param input Input of length @p modulus_len. Must be less than @p modulus.
+ * @param output Output of length @p modulus_len
+ *
+ * @return Zero for success. Non-zero for error.
+ */
+int emv_rsa_mod_exp(
+	const struct emv_rsa_key_t* key,
+	const void* modulus,
+	size_t modulus_len,
+	const void* exponent,
+	size_t exponent_len,
+	const void* input,
+	void* output
+);
+
 /**
  * Retrieve issuer public key and optionally validate certificate hash.
  * @remark See EMV 4.4 Book 2, 5.3
@@ -0,0 +1,473 @@
+/**
+ * @file emv_session.c
+ * @brief Card reader session recording and replay
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_session.h"
+#include "emv_metrics.h"
+#include "emv_utils_config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// TODO: replace with HAL interface in future
+#ifdef HAVE_TIME_H
+#include <time.h>
+#endif
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const uint8_t session_magic[] = { 'E', 'M', 'V', 'S' };
+
+static void put_le16(uint8_t* buf, uint16_t value)
+{
+	buf[0] = value & 0xFF;
+	buf[1] = value >> 8;
+}
+
+static void put_le32(uint8_t* buf, uint32_t value)
+{
+	buf[0] = value & 0xFF;
+	buf[1] = (value >> 8) & 0xFF;
+	buf[2] = (value >> 16) & 0xFF;
+	buf[3] = value >> 24;
+}
+
+static uint16_t get_le16(const uint8_t* buf)
+{
+	return (uint16_t)buf[0] | ((uint16_t)buf[1] << 8);
+}
+
+static uint32_t get_le32(const uint8_t* buf)
+{
+	return (uint32_t)buf[0] |
+		((uint32_t)buf[1] << 8) |
+		((uint32_t)buf[2] << 16) |
+		((uint32_t)buf[3] << 24);
+}
+
+static uint32_t ns_to_us32(uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+
+	if (us > UINT32_MAX) {
+		return UINT32_MAX;
+	}
+	return us;
+}
+
+static void wait_until(uint64_t deadline_ns)
+{
+	uint64_t now_ns = emv_metrics_get_time_ns();
+
+	if (now_ns >= deadline_ns) {
+		return;
+	}
+
+	// TODO: replace with HAL interface in future
+#ifdef HAVE_NANOSLEEP
+	{
+		struct timespec t;
+		uint64_t ns = deadline_ns - now_ns;
+
+		t.tv_sec = ns / 1000000000;
+		t.tv_nsec = ns % 1000000000;
+		nanosleep(&t, NULL);
+	}
+#else
+	while (emv_metrics_get_time_ns() < deadline_ns);
+#endif
+}
+
+static FILE* emv_session_create_file(const char* filename)
+{
+#if !defined(_WIN32)
+	int fd;
+	FILE* file;
+
+	// Session files contain sensitive cardholder data and are therefore
+	// only accessible by the owner, also when replacing an existing file
+	fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fchmod(fd, S_IRUSR | S_IWUSR)) {
+		close(fd);
+		return NULL;
+	}
+
+	file = fdopen(fd, "wb");
+	if (!file) {
+		close(fd);
+		return NULL;
+	}
+
+	return file;
+#else
+	return fopen(filename, "wb");
+#endif
+}
+
+int emv_session_recorder_init(
+	struct emv_session_recorder_t* rec,
+	const struct emv_cardreader_t* cardreader,
+	const char* filename
+)
+{
+	uint8_t header[EMV_SESSION_HEADER_LEN];
+
+	if (!rec || !cardreader || !cardreader->trx || !filename) {
+		return EMV_SESSION_ERROR_INVALID_PARAMETER;
+	}
+
+	memset(rec, 0, sizeof(*rec));
+	rec->cardreader = *cardreader;
+
+	rec->file = emv_session_create_file(filename);
+	if (!rec->file) {
+		return EMV_SESSION_ERROR_FILE_IO;
+	}
+
+	memcpy(header, session_magic, sizeof(session_magic));
+	header[4] = EMV_SESSION_FORMAT_VERSION;
+	header[5] = cardreader->mode;
+	header[6] = 0;
+	header[7] = 0;
+	if (fwrite(header, sizeof(header), 1, rec->file) != 1) {
+		fclose(rec->file);
+		rec->file = NULL;
+		return EMV_SESSION_ERROR_FILE_IO;
+	}
+
+	rec->last_ns = emv_metrics_get_time_ns();
+
+	return 0;
+}
+
+int emv_session_recorder_trx(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+)
+{
+	int r;
+	struct emv_session_recorder_t* rec = ctx;
+	uint8_t header[EMV_SESSION_RECORD_HEADER_LEN];
+	uint64_t start_ns;
+	uint64_t end_ns;
+	size_t rx_len;
+
+	if (!rec || !rec->file || !tx_buf || !rx_buf || !rx_buf_len) {
+		return EMV_SESSION_ERROR_INVALID_PARAMETER;
+	}
+	if (tx_buf_len > UINT16_MAX) {
+		return EMV_SESSION_ERROR_INVALID_PARAMETER;
+	}
+
+	start_ns = emv_metrics_get_time_ns();
+	r = rec->cardreader.trx(rec->cardreader.ctx, tx_buf, tx_buf_len, rx_buf, rx_buf_len);
+	end_ns = emv_metrics_get_time_ns();
+
+	// Record received data only for successful exchanges
+	rx_len = r ? 0 : *rx_buf_len;
+	if (rx_len > UINT16_MAX) {
+		return EMV_SESSION_ERROR_INTERNAL;
+	}
+
+	put_le32(header + 0, ns_to_us32(start_ns - rec->last_ns));
+	put_le32(header + 4, ns_to_us32(end_ns - start_ns));
+	put_le16(header + 8, (uint16_t)(int16_t)r);
+	put_le16(header + 10, tx_buf_len);
+	put_le16(header + 12, rx_len);
+	if (fwrite(header, sizeof(header), 1, rec->file) != 1 ||
+		fwrite(tx_buf, tx_buf_len, 1, rec->file) != 1 ||
+		(rx_len && fwrite(rx_buf, rx_len, 1, rec->file) != 1)
+	) {
+		return EMV_SESSION_ERROR_FILE_IO;
+	}
+
+	rec->exchange_count++;
+	rec->last_ns = end_ns;
+
+	return r;
+}
+
+int emv_session_recorder_close(struct emv_session_recorder_t* rec)
+{
+	int r;
+
+	if (!rec) {
+		return EMV_SESSION_ERROR_INVALID_PARAMETER;
+	}
+	if (!rec->file) {
+		return 0;
+	}
+
+	r = fclose(rec->file);
+	rec->file = NULL;
+	if (r) {
+		return EMV_SESSION_ERROR_FILE_IO;
+	}
+
+	return 0;
+}
+
+static int emv_session_validate(const uint8_t* buf, size_t buf_len)
+{
+	size_t offset;
+
+	if (buf_len < EMV_SESSION_HEADER_LEN) {
+		return EMV_SESSION_ERROR_INVALID_FORMAT;
+	}
+	if (memcmp(buf, session_magic, sizeof(session_magic)) != 0) {
+		return EMV_SESSION_ERROR_INVALID_FORMAT;
+	}
+	if (buf[4] != EMV_SESSION_FORMAT_VERSION) {
+		return EMV_SESSION_ERROR_INVALID_FORMAT;
+	}
+	if (buf[5] != EMV_CARDREADER_MODE_APDU &&
+		buf[5] != EMV_CARDREADER_MODE_TPDU &&
+		buf[5] != EMV_CARDREADER_MODE_TPDU_T1
+	) {
+		return EMV_SESSION_ERROR_INVALID_FORMAT;
+	}
+
+	// Validate exchange record lengths up front to simplify replay
+	offset = EMV_SESSION_HEADER_LEN;
+	while (offset < buf_len) {
+		size_t record_len;
+
+		if (buf_len - offset < EMV_SESSION_RECORD_HEADER_LEN) {
+			return EMV_SESSION_ERROR_INVALID_FORMAT;
+		}
+		record_len = EMV_SESSION_RECORD_HEADER_LEN +
+			get_le16(buf + offset + 10) +
+			get_le16(buf + offset + 12);
+		if (buf_len - offset < record_len) {
+			return EMV_SESSION_ERROR_INVALID_FORMAT;
+		}
+		offset += record_len;
+	}
+
+	return 0;
+}
+
+int emv_session_player_init(
+	struct emv_session_player_t* player,
+	const void* buf,
+	size_t buf_len,
+	unsigned int flags
+)
+{
+	int r;
+
+	if (!player || !buf) {
+		return EMV_SESSION_ERROR_INVALID_PARAMETER;
+	}
+	memset(player, 0, sizeof(*player));
+
+	r = emv_session_validate(buf, buf_len);
+	if (r) {
+		return r;
+	}
+
+	player->buf = malloc(buf_len);
+	if (!player->buf) {
+		return EMV_SESSION_ERROR_INTERNAL;
+	}
+	memcpy(player->buf, buf, buf_len);
+	player->buf_len = buf_len;
+	player->mode = player->buf[5];
+	player->flags = flags;
+
+	return emv_session_player_rewind(player);
+}
+
+int emv_session_player_load(
+	struct emv_session_player_t* player,
+	const char* filename,
+	unsigned int flags
+)
+{
+	int r;
+	FILE* file;
+	long file_len;
+	uint8_t* buf = NULL;
+
+	if (!player || !filename) {
+		return EMV_SESSION_ERROR_INVALID_PARAMETER;
+	}
+	memset(player, 0, sizeof(*player));
+
+	file = fopen(filename, "rb");
+	if (!file) {
+		return EMV_SESSION_ERROR_FILE_IO;
+	}
+	if (fseek(file, 0, SEEK_END) != 0) {
+		r = EMV_SESSION_ERROR_FILE_IO;
+		goto exit;
+	}
+	file_len = ftell(file);
+	if (file_len < 0 || fseek(file, 0, SEEK_SET) != 0) {
+		r = EMV_SESSION_ERROR_FILE_IO;
+		goto exit;
+	}
+	if (file_len < EMV_SESSION_HEADER_LEN) {
+		r = EMV_SESSION_ERROR_INVALID_FORMAT;
+		goto exit;
+	}
+
+	buf = malloc(file_len);
+	if (!buf) {
+		r = EMV_SESSION_ERROR_INTERNAL;
+		goto exit;
+	}
+	if (fread(buf, file_len, 1, file) != 1) {
+		r = EMV_SESSION_ERROR_FILE_IO;
+		goto exit;
+	}
+
+	r = emv_session_validate(buf, file_len);
+	if (r) {
+		goto exit;
+	}
+
+	// Transfer ownership of buffer to player
+	player->buf = buf;
+	buf = NULL;
+	player->buf_len = file_len;
+	player->mode = player->buf[5];
+	player->flags = flags;
+	r = emv_session_player_rewind(player);
+
+exit:
+	if (buf) {
+		free(buf);
+	}
+	fclose(file);
+	return r;
+}
+
+int emv_session_player_rewind(struct emv_session_player_t* player)
+{
+	if (!player || !player->buf) {
+		return EMV_SESSION_ERROR_INVALID_PARAMETER;
+	}
+
+	player->offset = EMV_SESSION_HEADER_LEN;
+	player->exchange_count = 0;
+	player->last_ns = emv_metrics_get_time_ns();
+
+	return 0;
+}
+
+bool emv_session_player_is_complete(const struct emv_session_player_t* player)
+{
+	if (!player || !player->buf) {
+		return false;
+	}
+
+	return player->offset >= player->buf_len;
+}
+
+int emv_session_player_trx(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+)
+{
+	struct emv_session_player_t* player = ctx;
+	const uint8_t* record;
+	uint32_t gap_us;
+	uint32_t trx_us;
+	int16_t result;
+	uint16_t record_tx_len;
+	uint16_t record_rx_len;
+	uint64_t start_ns;
+
+	if (!player || !player->buf || !tx_buf || !rx_buf || !rx_buf_len) {
+		return EMV_SESSION_ERROR_INVALID_PARAMETER;
+	}
+	if (player->offset >= player->buf_len) {
+		return EMV_SESSION_ERROR_END_OF_SESSION;
+	}
+
+	// Exchange record lengths were validated when the session was loaded
+	record = player->buf + player->offset;
+	gap_us = get_le32(record + 0);
+	trx_us = get_le32(record + 4);
+	result = (int16_t)get_le16(record + 8);
+	record_tx_len = get_le16(record + 10);
+	record_rx_len = get_le16(record + 12);
+	record += EMV_SESSION_RECORD_HEADER_LEN;
+
+	if (tx_buf_len != record_tx_len ||
+		memcmp(tx_buf, record, record_tx_len) != 0
+	) {
+		return EMV_SESSION_ERROR_MISMATCH;
+	}
+	record += record_tx_len;
+
+	if (*rx_buf_len < record_rx_len) {
+		return EMV_SESSION_ERROR_BUFFER_TOO_SMALL;
+	}
+
+	if (player->flags & EMV_SESSION_REPLAY_GAP_TIME) {
+		// Ensure that at least the recorded delay has elapsed since the
+		// previous exchange
+		wait_until(player->last_ns + (uint64_t)gap_us * 1000);
+	}
+	start_ns = emv_metrics_get_time_ns();
+
+	memcpy(rx_buf, record, record_rx_len);
+	*rx_buf_len = record_rx_len;
+
+	if (player->flags & EMV_SESSION_REPLAY_TRX_TIME) {
+		wait_until(start_ns + (uint64_t)trx_us * 1000);
+	}
+
+	player->offset += EMV_SESSION_RECORD_HEADER_LEN + record_tx_len + record_rx_len;
+	player->exchange_count++;
+	player->last_ns = emv_metrics_get_time_ns();
+
+	return result;
+}
+
+void emv_session_player_free(struct emv_session_player_t* player)
+{
+	if (!player) {
+		return;
+	}
+
+	if (player->buf) {
+		free(player->buf);
+	}
+	memset(player, 0, sizeof(*player));
+}
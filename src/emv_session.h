@@ -0,0 +1,238 @@
+/**
+ * @file emv_session.h
+ * @brief Card reader session recording and replay
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EMV_SESSION_H
+#define EMV_SESSION_H
+
+#include "emv_ttl.h"
+
+#include <sys/cdefs.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+__BEGIN_DECLS
+
+/**
+ * @name Session file format
+ *
+ * A session file consists of an 8-byte header followed by a sequence of
+ * exchange records. All integers are little endian.
+ *
+ * Header:
+ * - Magic "EMVS" (4 bytes)
+ * - Format version (1 byte). See @ref EMV_SESSION_FORMAT_VERSION.
+ * - Card reader mode (1 byte). See @ref emv_cardreader_mode_t.
+ * - Reserved (2 bytes)
+ *
+ * Exchange record:
+ * - Time since end of previous exchange in microseconds (4 bytes)
+ * - Time spent inside card reader transceive function in microseconds (4 bytes)
+ * - Result of card reader transceive function (2 bytes, signed)
+ * - Length of transmitted data (2 bytes)
+ * - Length of received data (2 bytes)
+ * - Transmitted data
+ * - Received data
+ */
+/// @{
+#define EMV_SESSION_FORMAT_VERSION              (0x01) ///< Session file format version
+#define EMV_SESSION_HEADER_LEN                  (8) ///< Length of session file header in bytes
+#define EMV_SESSION_RECORD_HEADER_LEN           (14) ///< Length of exchange record header in bytes
+/// @}
+
+/**
+ * @name Session replay flags
+ * @anchor emv-session-replay-flags
+ */
+/// @{
+#define EMV_SESSION_REPLAY_WIRE_SPEED           (0x00) ///< Replay exchanges as fast as possible
+#define EMV_SESSION_REPLAY_TRX_TIME             (0x01) ///< Preserve recorded time spent inside card reader transceive function
+#define EMV_SESSION_REPLAY_GAP_TIME             (0x02) ///< Preserve recorded minimum delay between exchanges
+/// @}
+
+/// Session errors
+enum emv_session_error_t {
+	EMV_SESSION_ERROR_INTERNAL = -1, ///< Internal error
+	EMV_SESSION_ERROR_INVALID_PARAMETER = -2, ///< Invalid function parameter
+	EMV_SESSION_ERROR_FILE_IO = -3, ///< Failed to read or write session file
+	EMV_SESSION_ERROR_INVALID_FORMAT = -4, ///< Invalid session file format
+	EMV_SESSION_ERROR_END_OF_SESSION = -5, ///< No more exchanges in session
+	EMV_SESSION_ERROR_MISMATCH = -6, ///< Transmitted data does not match session
+	EMV_SESSION_ERROR_BUFFER_TOO_SMALL = -7, ///< Receive buffer too small for recorded data
+};
+
+/**
+ * Session recorder
+ *
+ * Wraps an existing card reader and records every exchange to a session
+ * file. Use @ref emv_session_recorder_trx() and the recorder object as the
+ * transceive function and context of @ref emv_cardreader_t.
+ *
+ * @warning Session files contain all card data in the clear, including
+ * sensitive cardholder data such as the Application PAN, Track 2 Equivalent
+ * Data and Cardholder Name. Only record sessions with test cards or in a
+ * secure environment and protect or delete session files accordingly.
+ */
+struct emv_session_recorder_t {
+	struct emv_cardreader_t cardreader; ///< Wrapped card reader
+	FILE* file; ///< Session file
+	uint64_t last_ns; ///< Time at end of previous exchange
+	unsigned int exchange_count; ///< Number of recorded exchanges
+};
+
+/**
+ * Session player
+ *
+ * Replays a session file previously recorded by @ref emv_session_recorder_t.
+ * Use @ref emv_session_player_trx() and the player object as the transceive
+ * function and context of @ref emv_cardreader_t.
+ */
+struct emv_session_player_t {
+	enum emv_cardreader_mode_t mode; ///< Card reader mode of recorded session
+	unsigned int flags; ///< Replay flags. See @ref emv-session-replay-flags "Session replay flags"
+	uint8_t* buf; ///< Session file content
+	size_t buf_len; ///< Length of session file content in bytes
+	size_t offset; ///< Offset of next exchange record
+	uint64_t last_ns; ///< Time at end of previous exchange
+	unsigned int exchange_count; ///< Number of replayed exchanges
+};
+
+/**
+ * Initialise session recorder and create session file
+ *
+ * @note On POSIX platforms the session file is created, or an existing file
+ * is truncated, with read and write permissions for the owner only
+ *
+ * @param rec Session recorder
+ * @param cardreader Card reader to wrap
+ * @param filename Session file to create
+ * @return Zero for success. Less than zero for error. See @ref emv_session_error_t
+ */
+int emv_session_recorder_init(
+	struct emv_session_recorder_t* rec,
+	const struct emv_cardreader_t* cardreader,
+	const char* filename
+);
+
+/**
+ * Session recorder transceive function
+ * @note This function has the same signature as @ref emv_cardreader_trx_t
+ *
+ * @param ctx Session recorder
+ * @param tx_buf Transmit buffer
+ * @param tx_buf_len Length of transmit buffer in bytes
+ * @param rx_buf Receive buffer
+ * @param rx_buf_len Length of receive buffer in bytes
+ * @return Result of wrapped card reader. Less than zero for recording error.
+ */
+int emv_session_recorder_trx(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+);
+
+/**
+ * Close session file of session recorder
+ *
+ * @param rec Session recorder
+ * @return Zero for success. Less than zero for error. See @ref emv_session_error_t
+ */
+int emv_session_recorder_close(struct emv_session_recorder_t* rec);
+
+/**
+ * Initialise session player from memory buffer
+ * @note The session player will use its own copy of the buffer
+ *
+ * @param player Session player
+ * @param buf Session data
+ * @param buf_len Length of session data in bytes
+ * @param flags Replay flags. See @ref emv-session-replay-flags "Session replay flags"
+ * @return Zero for success. Less than zero for error. See @ref emv_session_error_t
+ */
+int emv_session_player_init(
+	struct emv_session_player_t* player,
+	const void* buf,
+	size_t buf_len,
+	unsigned int flags
+);
+
+/**
+ * Initialise session player from session file
+ *
+ * @param player Session player
+ * @param filename Session file to load
+ * @param flags Replay flags. See @ref emv-session-replay-flags "Session replay flags"
+ * @return Zero for success. Less than zero for error. See @ref emv_session_error_t
+ */
+int emv_session_player_load(
+	struct emv_session_player_t* player,
+	const char* filename,
+	unsigned int flags
+);
+
+/**
+ * Restart session replay from the first exchange
+ *
+ * @param player Session player
+ * @return Zero for success. Less than zero for error. See @ref emv_session_error_t
+ */
+int emv_session_player_rewind(struct emv_session_player_t* player);
+
+/**
+ * Determine whether all exchanges of the session have been replayed
+ *
+ * @param player Session player
+ * @return Boolean indicating whether all exchanges have been replayed
+ */
+bool emv_session_player_is_complete(const struct emv_session_player_t* player);
+
+/**
+ * Session player transceive function
+ * @note This function has the same signature as @ref emv_cardreader_trx_t
+ *
+ * @param ctx Session player
+ * @param tx_buf Transmit buffer
+ * @param tx_buf_len Length of transmit buffer in bytes
+ * @param rx_buf Receive buffer
+ * @param rx_buf_len Length of receive buffer in bytes
+ * @return Recorded result of card reader. Less than zero for replay error.
+ */
+int emv_session_player_trx(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+);
+
+/**
+ * Free session player resources
+ *
+ * @param player Session player
+ */
+void emv_session_player_free(struct emv_session_player_t* player);
+
+__END_DECLS
+
+#endif
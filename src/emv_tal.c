@@ -32,6 +32,7 @@
 
 #include "iso8825_ber.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -41,13 +42,13 @@ static int emv_tal_parse_aef_record(
 	const void* aef_record,
 	size_t aef_record_len,
 	const struct emv_tlv_list_t* supported_aids,
+	const struct emv_aid_trie_t* supported_aid_trie,
 	struct emv_app_list_t* app_list
 );
-static int emv_tal_read_sfi_records(
+struct emv_tal_read_records_ctx_t;
+static int emv_tal_read_records_flush(
 	struct emv_ttl_t* ttl,
-	const struct emv_afl_entry_t* afl_entry,
-	struct emv_tlv_list_t* list,
-	struct emv_oda_ctx_t* oda
+	struct emv_tal_read_records_ctx_t* ctx
 );
 
 int emv_tal_read_pse(
@@ -55,6 +56,16 @@ int emv_tal_read_pse(
 	const struct emv_tlv_list_t* supported_aids,
 	struct emv_app_list_t* app_list
 )
+{
+	return emv_tal_read_pse_with_trie(ttl, supported_aids, NULL, app_list);
+}
+
+int emv_tal_read_pse_with_trie(
+	struct emv_ttl_t* ttl,
+	const struct emv_tlv_list_t* supported_aids,
+	const struct emv_aid_trie_t* supported_aid_trie,
+	struct emv_app_list_t* app_list
+)
 {
 	int r;
 	uint8_t fci[EMV_RAPDU_DATA_MAX];
@@ -189,6 +200,7 @@ int emv_tal_read_pse(
 			aef_record,
 			aef_record_len,
 			supported_aids,
+			supported_aid_trie,
 			app_list
 		);
 		if (r) {
@@ -222,6 +234,7 @@ static int emv_tal_parse_aef_record(
 	const void* aef_record,
 	size_t aef_record_len,
 	const struct emv_tlv_list_t* supported_aids,
+	const struct emv_aid_trie_t* supported_aid_trie,
 	struct emv_app_list_t* app_list
 )
 {
@@ -262,6 +275,7 @@ static int emv_tal_parse_aef_record(
 	// Iterate Application Templates (field 61)
 	while ((r = iso8825_ber_itr_next(&itr, &tlv)) > 0) {
 		struct emv_app_t* app;
+		bool supported;
 
 		if (tlv.tag != EMV_TAG_61_APPLICATION_TEMPLATE) {
 			// Ignore unexpected data elements in AEF template
@@ -280,7 +294,12 @@ static int emv_tal_parse_aef_record(
 			continue;
 		}
 
-		if (emv_app_is_supported(app, supported_aids)) {
+		if (supported_aid_trie) {
+			supported = emv_app_find_supported_aid(app, supported_aid_trie) != NULL;
+		} else {
+			supported = emv_app_is_supported(app, supported_aids);
+		}
+		if (supported) {
 			// App supported; add to candidate list
 			// See EMV 4.4 Book 1, 12.3.2, step 3
 			emv_debug_info("Application is supported");
@@ -746,202 +765,236 @@ exit:
 	return r;
 }
 
-static int emv_tal_read_sfi_records(
-	struct emv_ttl_t* ttl,
-	const struct emv_afl_entry_t* afl_entry,
-	struct emv_tlv_list_t* list,
-	struct emv_oda_ctx_t* oda
+// Application records submitted as a single READ RECORD batch
+struct emv_tal_read_records_ctx_t {
+	struct emv_ttl_record_ref_t records[EMV_TTL_BATCH_MAX];
+	struct emv_afl_entry_t afl_entry[EMV_TTL_BATCH_MAX];
+	size_t count;
+
+	struct emv_tlv_list_t* list;
+	struct emv_oda_ctx_t* oda;
+	bool afl_entry_oda_record_invalid;
+	bool oda_record_invalid;
+	int r;
+};
+
+static int emv_tal_read_record_cb(
+	void* cb_ctx,
+	size_t idx,
+	const void* data,
+	size_t data_len,
+	uint16_t sw1sw2
 )
 {
+	struct emv_tal_read_records_ctx_t* ctx = cb_ctx;
 	int r;
-	bool oda_record_invalid = false;
+	const uint8_t* record = data;
+	size_t record_len = data_len;
+	const struct emv_afl_entry_t* afl_entry = &ctx->afl_entry[idx];
+	uint8_t record_number = ctx->records[idx].record_number;
+	bool record_oda = false;
+	struct emv_tlv_list_t record_list = EMV_TLV_LIST_INIT;
 
-	if (!ttl || !afl_entry || !list) {
-		// Invalid parameters; terminate session
-		return EMV_TAL_ERROR_INVALID_PARAMETER;
+	if (record_number == afl_entry->first_record) {
+		// Offline data authentication validity is tracked per AFL entry
+		ctx->afl_entry_oda_record_invalid = false;
 	}
 
-	for (uint8_t record_number = afl_entry->first_record; record_number <= afl_entry->last_record; ++record_number) {
-		uint8_t record[EMV_RAPDU_DATA_MAX];
-		size_t record_len = sizeof(record);
-		uint16_t sw1sw2;
-		bool record_oda = false;
-		struct emv_tlv_list_t record_list = EMV_TLV_LIST_INIT;
-
-		// READ RECORD
+	if (sw1sw2 != 0x9000) {
+		// Failed to READ RECORD; terminate session
 		// See EMV 4.4 Book 3, 10.2
-		emv_debug_info("READ RECORD from SFI %u, record %u", afl_entry->sfi, record_number);
-		r = emv_ttl_read_record(ttl, afl_entry->sfi, record_number, record, &record_len, &sw1sw2);
-		if (r) {
-			emv_debug_trace_msg("emv_ttl_read_record() failed; r=%d", r);
-			// TTL failure; terminate session
-			// (bad card or reader)
-			emv_debug_error("TTL failure");
-			return EMV_TAL_ERROR_TTL_FAILURE;
-		}
+		emv_debug_error("Failed to READ RECORD");
+		ctx->r = EMV_TAL_ERROR_READ_RECORD_FAILED;
+		return 1;
+	}
 
-		if (sw1sw2 != 0x9000) {
-			// Failed to READ RECORD; terminate session
-			// See EMV 4.4 Book 3, 10.2
-			emv_debug_error("Failed to READ RECORD");
-			return EMV_TAL_ERROR_READ_RECORD_FAILED;
+	// Determine whether record is intended for offline data authentication
+	if (!ctx->afl_entry_oda_record_invalid &&
+		afl_entry->oda_record_count &&
+		record_number - afl_entry->first_record < afl_entry->oda_record_count
+	) {
+		record_oda = true;
+	}
+
+	// The records for SFIs 1 - 10 must be encoded as field 70 and the
+	// records for SFIs beyond that range are outside of EMV except for the
+	// card Transaction Log
+	// See EMV 4.4 Book 3, 5.3.2.2
+	// See EMV 4.4 Book 3, 6.5.11.4
+	// See EMV 4.4 Book 3, 7.1
+
+	// The records intended for offline data authentication must be encoded
+	// as field 70. If not, then offline data authentication will be
+	// considered to have been performed but failed.
+	// See EMV 4.4 Book 3, 10.3 (page 98)
+
+	// Therefore, any record that is not encoded as field 70 should not be
+	// parsed for EMV fields, and if that record is also intended for
+	// offline data authentication then further offline data authentication
+	// will be invalidated. However, this implementation chooses to parse
+	// proprietary records with an SFI outside 1 - 10 that are encoded as
+	// field 70.
+	if (!record_len || record[0] != EMV_TAG_70_DATA_TEMPLATE) {
+		if (afl_entry->sfi >= 1 && afl_entry->sfi <= 10) {
+			// Invalid record for SFIs 1 - 10
+			// EMV 4.4 Book 3, 6.5.11.4
+			emv_debug_error("Invalid record for SFI %u", afl_entry->sfi);
+			ctx->r = EMV_TAL_ERROR_READ_RECORD_INVALID;
+			return 1;
 		}
 
-		// Determine whether record is intended for offline data authentication
-		if (!oda_record_invalid &&
-			afl_entry->oda_record_count &&
-			record_number - afl_entry->first_record < afl_entry->oda_record_count
-		) {
-			record_oda = true;
+		if (record_oda) {
+			// See EMV 4.4 Book 3, 10.3 (page 98)
+			emv_debug_error("Offline data authentication not possible due to proprietary record");
+			ctx->afl_entry_oda_record_invalid = true;
+			ctx->oda_record_invalid = true;
 		}
 
-		// The records for SFIs 1 - 10 must be encoded as field 70 and the
-		// records for SFIs beyond that range are outside of EMV except for the
-		// card Transaction Log
-		// See EMV 4.4 Book 3, 5.3.2.2
-		// See EMV 4.4 Book 3, 6.5.11.4
-		// See EMV 4.4 Book 3, 7.1
-
-		// The records intended for offline data authentication must be encoded
-		// as field 70. If not, then offline data authentication will be
-		// considered to have been performed but failed.
-		// See EMV 4.4 Book 3, 10.3 (page 98)
-
-		// Therefore, any record that is not encoded as field 70 should not be
-		// parsed for EMV fields, and if that record is also intended for
-		// offline data authentication then further offline data authentication
-		// will be invalidated. However, this implementation chooses to parse
-		// proprietary records with an SFI outside 1 - 10 that are encoded as
-		// field 70.
-		if (record[0] != EMV_TAG_70_DATA_TEMPLATE) {
-			if (afl_entry->sfi >= 1 && afl_entry->sfi <= 10) {
-				// Invalid record for SFIs 1 - 10
-				// EMV 4.4 Book 3, 6.5.11.4
-				emv_debug_error("Invalid record for SFI %u", afl_entry->sfi);
-				return EMV_TAL_ERROR_READ_RECORD_INVALID;
-			}
-
-			if (record_oda) {
-				// See EMV 4.4 Book 3, 10.3 (page 98)
-				emv_debug_error("Offline data authentication not possible due to proprietary record");
-				oda_record_invalid = true;
-			}
+		// This implementation chooses to continue reading records if a
+		// proprietary record has an SFI outside 1 - 10 and is not encoded
+		// as field 70, although it will not be parsed for EMV fields.
+		emv_debug_info("Skip proprietary record");
+		return 0;
+	}
 
-			// This implementation chooses to continue reading records if a
-			// proprietary record has an SFI outside 1 - 10 and is not encoded
-			// as field 70, although it will not be parsed for EMV fields.
-			emv_debug_info("Skip proprietary record");
-			continue;
-		}
+	if (afl_entry->sfi >= 1 && afl_entry->sfi <= 10) {
+		struct iso8825_tlv_t record_template;
+		size_t record_template_len;
 
-		if (afl_entry->sfi >= 1 && afl_entry->sfi <= 10) {
-			struct iso8825_tlv_t record_template;
-			size_t record_template_len;
+		// Record should contain a single record template for SFIs 1 - 10
+		// See EMV 4.4 Book 3, 6.5.11.4
+		r = iso8825_ber_decode(record, record_len, &record_template);
+		if (r <= 0) {
+			emv_debug_trace_msg("iso8825_ber_decode() failed; r=%d", r);
 
-			// Record should contain a single record template for SFIs 1 - 10
+			// Failed to parse application data record template
 			// See EMV 4.4 Book 3, 6.5.11.4
-			r = iso8825_ber_decode(record, record_len, &record_template);
-			if (r <= 0) {
-				emv_debug_trace_msg("iso8825_ber_decode() failed; r=%d", r);
-
-				// Failed to parse application data record template
-				// See EMV 4.4 Book 3, 6.5.11.4
-				emv_debug_error("Failed to parse record template");
-				return EMV_TAL_ERROR_READ_RECORD_INVALID;
-			}
-			record_template_len = r;
-			if (record_template.tag != EMV_TAG_70_DATA_TEMPLATE) {
-				// Invalid record template for SFIs 1 - 10
-				// See EMV 4.4 Book 3, 6.5.11.4
-				emv_debug_error("Invalid record template tag 0x%02X", record_template.tag);
-				return EMV_TAL_ERROR_READ_RECORD_INVALID;
-			}
-			if (record_template_len != record_len) {
-				// Record should contain a single record template without
-				// additional data after it
-				// See EMV 4.4 Book 3, 6.5.11.4
-				emv_debug_error("Invalid record template total length %zu; expected %zu", record_template_len, record_len);
-				return EMV_TAL_ERROR_READ_RECORD_INVALID;
-			}
+			emv_debug_error("Failed to parse record template");
+			ctx->r = EMV_TAL_ERROR_READ_RECORD_INVALID;
+			return 1;
+		}
+		record_template_len = r;
+		if (record_template.tag != EMV_TAG_70_DATA_TEMPLATE) {
+			// Invalid record template for SFIs 1 - 10
+			// See EMV 4.4 Book 3, 6.5.11.4
+			emv_debug_error("Invalid record template tag 0x%02X", record_template.tag);
+			ctx->r = EMV_TAL_ERROR_READ_RECORD_INVALID;
+			return 1;
+		}
+		if (record_template_len != record_len) {
+			// Record should contain a single record template without
+			// additional data after it
+			// See EMV 4.4 Book 3, 6.5.11.4
+			emv_debug_error("Invalid record template total length %zu; expected %zu", record_template_len, record_len);
+			ctx->r = EMV_TAL_ERROR_READ_RECORD_INVALID;
+			return 1;
+		}
+
+		if (record_oda) {
+			emv_debug_info("Record template content used for offline data authentication");
 
-			if (record_oda) {
-				emv_debug_info("Record template content used for offline data authentication");
-
-				if (oda) {
-					// For SFIs 1 - 10, use record template content for ODA
-					// See EMV 4.4 Book 3, 10.3 (page 98)
-					r = emv_oda_append_record(oda, record_template.value, record_template.length);
-					if (r) {
-						emv_debug_trace_msg("emv_oda_append_record() failed; r=%d", r);
-						// emv_oda_append_record() also prints error
-						oda_record_invalid = true;
-					}
+			if (ctx->oda) {
+				// For SFIs 1 - 10, use record template content for ODA
+				// See EMV 4.4 Book 3, 10.3 (page 98)
+				r = emv_oda_append_record(ctx->oda, record_template.value, record_template.length);
+				if (r) {
+					emv_debug_trace_msg("emv_oda_append_record() failed; r=%d", r);
+					// emv_oda_append_record() also prints error
+					ctx->afl_entry_oda_record_invalid = true;
+					ctx->oda_record_invalid = true;
 				}
 			}
-		} else {
-			if (record_oda) {
-				emv_debug_info("Record used verbatim for offline data authentication");
-				if (oda) {
-					// For SFIs 11 - 30, use record verbatim for ODA
-					// See EMV 4.4 Book 3, 10.3 (page 98)
-					r = emv_oda_append_record(oda, record, record_len);
-					if (r) {
-						emv_debug_trace_msg("emv_oda_append_record() failed; r=%d", r);
-						// emv_oda_append_record() also prints error
-						oda_record_invalid = true;
-					}
+		}
+	} else {
+		if (record_oda) {
+			emv_debug_info("Record used verbatim for offline data authentication");
+			if (ctx->oda) {
+				// For SFIs 11 - 30, use record verbatim for ODA
+				// See EMV 4.4 Book 3, 10.3 (page 98)
+				r = emv_oda_append_record(ctx->oda, record, record_len);
+				if (r) {
+					emv_debug_trace_msg("emv_oda_append_record() failed; r=%d", r);
+					// emv_oda_append_record() also prints error
+					ctx->afl_entry_oda_record_invalid = true;
+					ctx->oda_record_invalid = true;
 				}
 			}
 		}
+	}
 
-		// Parse application data knowing that the record starts with 70 and
-		// that it contains a single record template for SFIs 1 - 10. The EMV
-		// specification does not indicate whether SFIs beyond 1 - 10 may
-		// contain multiple record templates or additional data after the
-		// record template(s), and only states that the record template tag and
-		// length should not be excluded during offline data authentication
-		// processing. This implementation therefore assumes that any record
-		// that has passed the preceding validations is suitable for parsing.
-		r = emv_tlv_parse(record, record_len, &record_list);
-		if (r) {
-			emv_debug_trace_msg("emv_tlv_parse() failed; r=%d", r);
+	// Parse application data knowing that the record starts with 70 and
+	// that it contains a single record template for SFIs 1 - 10. The EMV
+	// specification does not indicate whether SFIs beyond 1 - 10 may
+	// contain multiple record templates or additional data after the
+	// record template(s), and only states that the record template tag and
+	// length should not be excluded during offline data authentication
+	// processing. This implementation therefore assumes that any record
+	// that has passed the preceding validations is suitable for parsing.
+	r = emv_tlv_parse(record, record_len, &record_list);
+	if (r) {
+		emv_debug_trace_msg("emv_tlv_parse() failed; r=%d", r);
 
-			// Always cleanup record list
-			emv_tlv_list_clear(&record_list);
+		// Always cleanup record list
+		emv_tlv_list_clear(&record_list);
 
-			if (r < 0) {
-				// Internal error; terminate session
-				emv_debug_error("Internal error");
-				return EMV_TAL_ERROR_INTERNAL;
-			}
-			if (r > 0) {
-				// Parse error; terminate session
-				emv_debug_error("Failed to parse application data record");
-				return EMV_TAL_ERROR_READ_RECORD_PARSE_FAILED;
-			}
+		if (r < 0) {
+			// Internal error; terminate session
+			emv_debug_error("Internal error");
+			ctx->r = EMV_TAL_ERROR_INTERNAL;
+			return 1;
 		}
-		emv_debug_info_ber("READ RECORD [%u,%u] response", record, record_len, afl_entry->sfi, record_number);
+		if (r > 0) {
+			// Parse error; terminate session
+			emv_debug_error("Failed to parse application data record");
+			ctx->r = EMV_TAL_ERROR_READ_RECORD_PARSE_FAILED;
+			return 1;
+		}
+	}
+	emv_debug_info_ber("READ RECORD [%u,%u] response", record, record_len, afl_entry->sfi, record_number);
 
-		r = emv_tlv_list_append(list, &record_list);
-		if (r) {
-			emv_debug_trace_msg("emv_tlv_list_append() failed; r=%d", r);
+	r = emv_tlv_list_append(ctx->list, &record_list);
+	if (r) {
+		emv_debug_trace_msg("emv_tlv_list_append() failed; r=%d", r);
 
-			// Always cleanup record list
-			emv_tlv_list_clear(&record_list);
+		// Always cleanup record list
+		emv_tlv_list_clear(&record_list);
 
-			// Internal error; terminate session
-			emv_debug_error("Internal error");
-			return EMV_TAL_ERROR_INTERNAL;
-		}
+		// Internal error; terminate session
+		emv_debug_error("Internal error");
+		ctx->r = EMV_TAL_ERROR_INTERNAL;
+		return 1;
 	}
 
-	// Successfully read records although offline data authentication may have
-	// failed
-	if (oda_record_invalid) {
-		return EMV_TAL_RESULT_ODA_RECORD_INVALID;
-	} else {
-		return 0;
+	return 0;
+}
+
+static int emv_tal_read_records_flush(
+	struct emv_ttl_t* ttl,
+	struct emv_tal_read_records_ctx_t* ctx
+)
+{
+	int r;
+
+	// READ RECORD
+	// See EMV 4.4 Book 3, 10.2
+	for (size_t i = 0; i < ctx->count; ++i) {
+		emv_debug_info("READ RECORD from SFI %u, record %u", ctx->records[i].sfi, ctx->records[i].record_number);
+	}
+	r = emv_ttl_read_record_batch(ttl, ctx->records, ctx->count, &emv_tal_read_record_cb, ctx);
+	ctx->count = 0;
+	if (ctx->r) {
+		// Return error value as-is
+		return ctx->r;
 	}
+	if (r) {
+		emv_debug_trace_msg("emv_ttl_read_record_batch() failed; r=%d", r);
+		// TTL failure; terminate session
+		// (bad card or reader)
+		emv_debug_error("TTL failure");
+		return EMV_TAL_ERROR_TTL_FAILURE;
+	}
+
+	return 0;
 }
 
 int emv_tal_read_afl_records(
@@ -955,7 +1008,7 @@ int emv_tal_read_afl_records(
 	int r;
 	struct emv_afl_itr_t afl_itr;
 	struct emv_afl_entry_t afl_entry;
-	bool oda_record_invalid = false;
+	struct emv_tal_read_records_ctx_t ctx;
 
 	if (!ttl || !afl || !afl_len || !list) {
 		// Invalid parameters; terminate session
@@ -978,18 +1031,40 @@ int emv_tal_read_afl_records(
 		}
 	}
 
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.list = list;
+	ctx.oda = oda;
+
+	// Submit the records of all AFL entries as READ RECORD batches such that
+	// card readers providing batch transceive avoid a host round trip for
+	// each record. Offline data authentication failure does not terminate
+	// the reading of records.
+	// See EMV 4.4 Book 3, 10.3 (page 98)
 	while ((r = emv_afl_itr_next(&afl_itr, &afl_entry)) > 0) {
-		r = emv_tal_read_sfi_records(ttl, &afl_entry, list, oda);
-		if (r) {
-			emv_debug_trace_msg("emv_tal_read_sfi_records() failed; r=%d", r);
-			if (r == EMV_TAL_RESULT_ODA_RECORD_INVALID) {
-				// Continue regardless of offline data authentication failure
-				// See EMV 4.4 Book 3, 10.3 (page 98)
-				oda_record_invalid = true;
-			} else {
-				// Return error value as-is
-				return r;
+		for (unsigned int record_number = afl_entry.first_record; record_number <= afl_entry.last_record; ++record_number) {
+			if (ctx.count == EMV_TTL_BATCH_MAX) {
+				r = emv_tal_read_records_flush(ttl, &ctx);
+				if (r) {
+					// Return error value as-is
+					return r;
+				}
 			}
+
+			ctx.records[ctx.count].sfi = afl_entry.sfi;
+			ctx.records[ctx.count].record_number = record_number;
+			ctx.afl_entry[ctx.count] = afl_entry;
+			++ctx.count;
+		}
+	}
+	if (ctx.count) {
+		int flush_r;
+
+		// Read remaining records, including those preceding an AFL parse
+		// error
+		flush_r = emv_tal_read_records_flush(ttl, &ctx);
+		if (flush_r) {
+			// Return error value as-is
+			return flush_r;
 		}
 	}
 	if (r < 0) {
@@ -1003,7 +1078,7 @@ int emv_tal_read_afl_records(
 
 	// Successfully read records although offline data authentication may have
 	// failed
-	if (oda_record_invalid) {
+	if (ctx.oda_record_invalid) {
 		return EMV_TAL_RESULT_ODA_RECORD_INVALID;
 	} else {
 		return 0;
@@ -30,6 +30,7 @@ __BEGIN_DECLS
 
 // Forward declarations
 struct emv_ttl_t;
+struct emv_aid_trie_t;
 struct emv_app_list_t;
 struct emv_app_t;
 struct emv_tlv_list_t;
@@ -110,6 +111,35 @@ int emv_tal_read_pse(
 	struct emv_app_list_t* app_list
 );
 
+/**
+ * Read Payment System Environment (PSE) records and build candidate
+ * application list using an AID prefix trie of the supported AIDs. This is
+ * equivalent to @ref emv_tal_read_pse() but does not compare each
+ * application with every supported AID.
+ * @remark See EMV 4.4 Book 1, 12.3.2
+ *
+ * @param ttl EMV Terminal Transport Layer context
+ * @param supported_aids Supported AID (field 9F06) list including ASI flags
+ * @param supported_aid_trie AID prefix trie created from @p supported_aids
+ *                           using @ref emv_aid_trie_create_from_list(). NULL
+ *                           to compare each application with every
+ *                           supported AID instead.
+ * @param app_list Candidate application list output
+ *
+ * @return Zero for success
+ * @return Less than zero indicates that the terminal should terminate the
+ *         card session. See @ref emv_tal_error_t
+ * @return Greater than zero indicates that reading of PSE records failed and
+ *         that the terminal may continue the card session. See
+ *         @ref emv_tal_result_t
+ */
+int emv_tal_read_pse_with_trie(
+	struct emv_ttl_t* ttl,
+	const struct emv_tlv_list_t* supported_aids,
+	const struct emv_aid_trie_t* supported_aid_trie,
+	struct emv_app_list_t* app_list
+);
+
 /**
  * Find supported applications and build candidate application list
  * @remark See EMV 4.4 Book 1, 12.3.3
@@ -22,6 +22,7 @@
 #include "emv_tlv.h"
 #include "iso8825_ber.h"
 #include "emv.h"
+#include "emv_config.h"
 #include "emv_tags.h"
 
 #include <stdbool.h>
@@ -372,11 +373,16 @@ int emv_tlv_sources_init_from_ctx(
 	// - ICC data obtained from the current card should not be overridden by
 	//   config or current transaction parameters
 	// - Transaction parameters can override config
+	// - Config of the context can override the shared config, which is
+	//   only consulted as a read-only source
 	sources->count = 4;
 	sources->list[0] = &ctx->terminal;
 	sources->list[1] = &ctx->icc;
 	sources->list[2] = &ctx->params;
 	sources->list[3] = &ctx->config;
+	if (ctx->shared_config) {
+		sources->list[sources->count++] = emv_config_get_tlv_list(ctx->shared_config);
+	}
 
 	return 0;
 }
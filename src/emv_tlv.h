@@ -68,7 +68,7 @@ struct emv_tlv_list_t {
  */
 struct emv_tlv_sources_t {
 	unsigned int count;                         ///< Number of source lists
-	const struct emv_tlv_list_t* list[4];       ///< Array of source lists
+	const struct emv_tlv_list_t* list[5];       ///< Array of source lists
 };
 
 /**
@@ -208,6 +208,7 @@ int emv_tlv_list_append(struct emv_tlv_list_t* list, struct emv_tlv_list_t* othe
  * - ICC data obtained from the current card should not be overridden by config
  *   or current transaction parameters
  * - Transaction parameters can override config
+ * - Config of the context can override the shared config, if any
  * @param sources EMV TLV sources
  * @param ctx EMV processing context
  * @return Zero for success. Less than zero for error.
@@ -21,6 +21,8 @@
 
 #include "emv_ttl.h"
 #include "emv_tags.h"
+#include "emv_metrics.h"
+#include "iso7816.h"
 #include "iso7816_apdu.h"
 
 #define EMV_DEBUG_SOURCE EMV_DEBUG_SOURCE_TTL
@@ -29,13 +31,442 @@
 #include <stdbool.h>
 #include <string.h>
 
-int emv_ttl_trx(
+// Maximum number of attempts to recover from protocol T=1 transmission errors
+// See EMV Contact Interface Specification v1.0, 9.2.5.2
+#define EMV_TTL_T1_RETRY_MAX (3)
+
+static struct emv_ttl_ins_stats_t* emv_ttl_stats_get(
+	struct emv_ttl_stats_t* stats,
+	uint8_t ins
+)
+{
+	struct emv_ttl_ins_stats_t* ins_stats;
+
+	for (unsigned int i = 0; i < stats->ins_count; ++i) {
+		if (stats->ins[i].ins == ins) {
+			return &stats->ins[i];
+		}
+	}
+
+	if (stats->ins_count >= EMV_TTL_STATS_INS_MAX) {
+		return &stats->other;
+	}
+
+	ins_stats = &stats->ins[stats->ins_count++];
+	ins_stats->ins = ins;
+	return ins_stats;
+}
+
+static int emv_ttl_ext_trx(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+)
+{
+	struct emv_ttl_ext_t* ext = ctx;
+
+	// Forward exchanges that do not originate from this TTL implementation
+	// to the card reader populated by the caller
+	return ext->cardreader.trx(ext->cardreader.ctx, tx_buf, tx_buf_len, rx_buf, rx_buf_len);
+}
+
+struct emv_ttl_ext_t* emv_ttl_ext_get(const struct emv_ttl_t* ctx)
+{
+	if (!ctx || ctx->cardreader.trx != &emv_ttl_ext_trx) {
+		return NULL;
+	}
+
+	return ctx->cardreader.ctx;
+}
+
+static int emv_ttl_cardreader_trx(
+	struct emv_ttl_t* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len,
+	struct emv_ttl_ins_stats_t* ins_stats
+)
+{
+	int r;
+	struct emv_ttl_ext_t* ext;
+	uint64_t trx_ns;
+
+	ext = emv_ttl_ext_get(ctx);
+	if (!ext) {
+		return ctx->cardreader.trx(ctx->cardreader.ctx, tx_buf, tx_buf_len, rx_buf, rx_buf_len);
+	}
+	if (!ext->metrics && !ins_stats) {
+		return ext->cardreader.trx(ext->cardreader.ctx, tx_buf, tx_buf_len, rx_buf, rx_buf_len);
+	}
+
+	trx_ns = emv_metrics_get_time_ns();
+	r = ext->cardreader.trx(ext->cardreader.ctx, tx_buf, tx_buf_len, rx_buf, rx_buf_len);
+	trx_ns = emv_metrics_get_time_ns() - trx_ns;
+
+	if (ext->metrics) {
+		ext->metrics->card_io_ns += trx_ns;
+	}
+	if (ins_stats) {
+		ins_stats->exchanges++;
+		ins_stats->tx_bytes += tx_buf_len;
+		ins_stats->trx_ns += trx_ns;
+		if (r) {
+			ins_stats->errors++;
+		} else {
+			ins_stats->rx_bytes += *rx_buf_len;
+		}
+	}
+
+	return r;
+}
+
+static size_t emv_ttl_t1_edc(
+	const struct emv_ttl_t1_t* t1,
+	const uint8_t* buf,
+	size_t len,
+	uint8_t* edc
+)
+{
+	if (t1->edc_crc) {
+		// CRC with polynomial x^16 + x^12 + x^5 + 1 and initial value FFFF
+		// See ISO 7816-3:2006, 11.4.4
+		uint16_t crc = 0xFFFF;
+
+		for (size_t i = 0; i < len; ++i) {
+			crc ^= (uint16_t)buf[i] << 8;
+			for (unsigned int j = 0; j < 8; ++j) {
+				if (crc & 0x8000) {
+					crc = (crc << 1) ^ 0x1021;
+				} else {
+					crc <<= 1;
+				}
+			}
+		}
+
+		edc[0] = crc >> 8;
+		edc[1] = crc & 0xFF;
+		return 2;
+
+	} else {
+		// LRC is exclusive-OR of all bytes
+		// See ISO 7816-3:2006, 11.4.4
+		uint8_t lrc = 0;
+
+		for (size_t i = 0; i < len; ++i) {
+			lrc ^= buf[i];
+		}
+
+		edc[0] = lrc;
+		return 1;
+	}
+}
+
+static size_t emv_ttl_t1_build_block(
+	const struct emv_ttl_t1_t* t1,
+	uint8_t pcb,
+	const void* inf,
+	size_t inf_len,
+	uint8_t* block
+)
+{
+	// Prologue field: NAD PCB LEN
+	// NAD is always zero because EMV does not use node addressing
+	// See ISO 7816-3:2006, 11.3.1
+	// See EMV Contact Interface Specification v1.0, 9.2.4.1.1
+	block[0] = 0x00;
+	block[1] = pcb;
+	block[2] = inf_len;
+
+	// Information field
+	if (inf_len) {
+		memcpy(block + 3, inf, inf_len);
+	}
+
+	// Epilogue field
+	return 3 + inf_len + emv_ttl_t1_edc(t1, block, 3 + inf_len, block + 3 + inf_len);
+}
+
+static bool emv_ttl_t1_block_is_valid(
+	const struct emv_ttl_t1_t* t1,
+	const uint8_t* block,
+	size_t block_len
+)
+{
+	size_t edc_len = t1->edc_crc ? 2 : 1;
+	uint8_t edc[2];
+
+	if (block_len < 3 + edc_len) {
+		return false;
+	}
+
+	// Validate prologue field
+	// See EMV Contact Interface Specification v1.0, 9.2.4.1
+	if (block[0] != 0x00 || block[2] == 0xFF) {
+		return false;
+	}
+	if (block_len != 3 + block[2] + edc_len) {
+		return false;
+	}
+	if ((block[1] & EMV_TTL_T1_PCB_S_BLOCK) == EMV_TTL_T1_PCB_R_BLOCK &&
+		block[2] != 0
+	) {
+		// R-block must not have an information field
+		return false;
+	}
+	if ((block[1] & EMV_TTL_T1_PCB_R_BLOCK) == 0 &&
+		block[2] > t1->ifsd
+	) {
+		// I-block information field must not exceed IFSD
+		return false;
+	}
+
+	// Validate epilogue field
+	emv_ttl_t1_edc(t1, block, block_len - edc_len, edc);
+	return memcmp(edc, block + block_len - edc_len, edc_len) == 0;
+}
+
+static size_t emv_ttl_t1_build_i_block(
+	struct emv_ttl_t1_t* t1,
+	const uint8_t** data,
+	size_t* data_len,
+	uint8_t* block
+)
+{
+	uint8_t pcb = EMV_TTL_T1_PCB_I_BLOCK;
+	size_t inf_len = *data_len;
+	size_t block_len;
+
+	// Chain the remaining data if it exceeds IFSC
+	// See ISO 7816-3:2006, 11.6.2.3
+	if (inf_len > t1->ifsc) {
+		inf_len = t1->ifsc;
+		pcb |= EMV_TTL_T1_PCB_I_M;
+	}
+	if (t1->ns) {
+		pcb |= EMV_TTL_T1_PCB_I_NS;
+	}
+	t1->ns ^= 1;
+
+	block_len = emv_ttl_t1_build_block(t1, pcb, *data, inf_len, block);
+	*data += inf_len;
+	*data_len -= inf_len;
+
+	return block_len;
+}
+
+static size_t emv_ttl_t1_build_r_block(
+	const struct emv_ttl_t1_t* t1,
+	uint8_t error,
+	uint8_t* block
+)
+{
+	uint8_t pcb = EMV_TTL_T1_PCB_R_BLOCK | error;
+
+	if (t1->nr) {
+		pcb |= EMV_TTL_T1_PCB_R_NR;
+	}
+
+	return emv_ttl_t1_build_block(t1, pcb, NULL, 0, block);
+}
+
+static int emv_ttl_t1_trx(
 	struct emv_ttl_t* ctx,
 	const void* c_apdu,
 	size_t c_apdu_len,
 	void* r_apdu,
 	size_t* r_apdu_len,
-	uint16_t* sw1sw2
+	struct emv_ttl_ins_stats_t* ins_stats
+)
+{
+	int r;
+	struct emv_ttl_ext_t* ext;
+	struct emv_ttl_t1_t* t1;
+
+	// Remaining C-APDU data to transmit
+	const uint8_t* c_apdu_ptr = c_apdu;
+	size_t c_apdu_remaining = c_apdu_len;
+
+	// Current position in R-APDU output
+	uint8_t* r_apdu_ptr = r_apdu;
+
+	// Most recent I-block; retained for chaining and retransmission
+	uint8_t i_block[EMV_TTL_T1_BLOCK_MAX];
+	size_t i_block_len;
+	bool chaining;
+
+	// Most recent R-block or S-block
+	uint8_t tx_block[EMV_TTL_T1_BLOCK_MAX];
+
+	// Next block to transmit
+	const uint8_t* tx_buf;
+	size_t tx_buf_len;
+	unsigned int retries = 0;
+
+	ext = emv_ttl_ext_get(ctx);
+	if (!ext || !ext->t1.ifsc || !ext->t1.ifsd) {
+		// Protocol T=1 state not attached or not initialised by
+		// emv_ttl_t1_init()
+		return -10;
+	}
+	t1 = &ext->t1;
+
+	// Build first I-block
+	i_block_len = emv_ttl_t1_build_i_block(t1, &c_apdu_ptr, &c_apdu_remaining, i_block);
+	chaining = c_apdu_remaining != 0;
+	tx_buf = i_block;
+	tx_buf_len = i_block_len;
+
+	do {
+		uint8_t rx_block[EMV_TTL_T1_BLOCK_MAX];
+		size_t rx_block_len = sizeof(rx_block);
+		uint8_t pcb;
+		uint8_t inf_len;
+		const uint8_t* inf;
+		uint8_t error;
+
+		emv_debug_ctpdu(tx_buf, tx_buf_len);
+		r = emv_ttl_cardreader_trx(ctx, tx_buf, tx_buf_len, rx_block, &rx_block_len, ins_stats);
+		if (r) {
+			return r;
+		}
+		emv_debug_rtpdu(rx_block, rx_block_len);
+
+		if (!emv_ttl_t1_block_is_valid(t1, rx_block, rx_block_len)) {
+			// Request retransmission of invalid block
+			// See ISO 7816-3:2006, 11.6.3.2, rule 7.1
+			error = EMV_TTL_T1_PCB_R_ERROR_EDC;
+			goto retry;
+		}
+		pcb = rx_block[1];
+		inf_len = rx_block[2];
+		inf = rx_block + 3;
+
+		if ((pcb & EMV_TTL_T1_PCB_R_BLOCK) == EMV_TTL_T1_PCB_I_BLOCK) {
+			// I-block
+			if (chaining || !!(pcb & EMV_TTL_T1_PCB_I_NS) != t1->nr) {
+				// Card must acknowledge chained I-blocks using R-blocks and
+				// must use the expected send-sequence number
+				error = EMV_TTL_T1_PCB_R_ERROR_OTHER;
+				goto retry;
+			}
+			t1->nr ^= 1;
+			retries = 0;
+
+			// Ensure that R-APDU buffer has enough capacity for incoming data
+			if (r_apdu_ptr - (uint8_t*)r_apdu + inf_len > *r_apdu_len) {
+				return -11;
+			}
+			memcpy(r_apdu_ptr, inf, inf_len);
+			r_apdu_ptr += inf_len;
+
+			if (pcb & EMV_TTL_T1_PCB_I_M) {
+				// Acknowledge chained I-block and request next I-block
+				// See ISO 7816-3:2006, 11.6.2.3
+				tx_buf_len = emv_ttl_t1_build_r_block(t1, 0, tx_block);
+				tx_buf = tx_block;
+				continue;
+			}
+
+			*r_apdu_len = r_apdu_ptr - (uint8_t*)r_apdu;
+			return 0;
+		}
+
+		if ((pcb & EMV_TTL_T1_PCB_S_BLOCK) == EMV_TTL_T1_PCB_R_BLOCK) {
+			// R-block
+			if (chaining && !!(pcb & EMV_TTL_T1_PCB_R_NR) == t1->ns) {
+				// Card acknowledged chained I-block; transmit next I-block
+				i_block_len = emv_ttl_t1_build_i_block(t1, &c_apdu_ptr, &c_apdu_remaining, i_block);
+				chaining = c_apdu_remaining != 0;
+				tx_buf = i_block;
+				tx_buf_len = i_block_len;
+				retries = 0;
+				continue;
+			}
+
+			// Card requests retransmission of the most recent block
+			// See ISO 7816-3:2006, 11.6.3.2, rule 6
+			if (++retries > EMV_TTL_T1_RETRY_MAX) {
+				return 12;
+			}
+			t1->retransmissions++;
+			continue;
+		}
+
+		// S-block
+		if (pcb & EMV_TTL_T1_PCB_S_RESPONSE) {
+			// Terminal did not send any S-block request
+			error = EMV_TTL_T1_PCB_R_ERROR_OTHER;
+			goto retry;
+		}
+		switch (pcb & EMV_TTL_T1_PCB_S_TYPE_MASK) {
+			case EMV_TTL_T1_PCB_S_WTX:
+				// Waiting time extension request; the card reader is
+				// responsible for extending the block waiting time
+				// See ISO 7816-3:2006, 11.6.2.4
+				if (inf_len != 1) {
+					error = EMV_TTL_T1_PCB_R_ERROR_OTHER;
+					goto retry;
+				}
+				t1->wtx = inf[0];
+				t1->wtx_count++;
+				break;
+
+			case EMV_TTL_T1_PCB_S_IFS:
+				// Card requests a new IFSC
+				// See EMV Contact Interface Specification v1.0, 9.2.4.3
+				if (inf_len != 1 || inf[0] < 0x10 || inf[0] == 0xFF) {
+					error = EMV_TTL_T1_PCB_R_ERROR_OTHER;
+					goto retry;
+				}
+				t1->ifsc = inf[0];
+				break;
+
+			case EMV_TTL_T1_PCB_S_ABORT:
+				// Chain abortion is not supported by EMV
+				// See EMV Contact Interface Specification v1.0, 9.2.4.3
+				return 13;
+
+			default:
+				error = EMV_TTL_T1_PCB_R_ERROR_OTHER;
+				goto retry;
+		}
+
+		// Respond to S-block request with the same information field
+		tx_buf_len = emv_ttl_t1_build_block(
+			t1,
+			pcb | EMV_TTL_T1_PCB_S_RESPONSE,
+			inf,
+			inf_len,
+			tx_block
+		);
+		tx_buf = tx_block;
+		continue;
+
+	retry:
+		// Terminal does not attempt resynchronisation and the card should
+		// be deactivated after repeated transmission errors
+		// See EMV Contact Interface Specification v1.0, 9.2.5.2
+		if (++retries > EMV_TTL_T1_RETRY_MAX) {
+			return 12;
+		}
+		t1->retransmissions++;
+		tx_buf_len = emv_ttl_t1_build_r_block(t1, error, tx_block);
+		tx_buf = tx_block;
+
+	} while (true);
+}
+
+static int emv_ttl_trx_internal(
+	struct emv_ttl_t* ctx,
+	const void* c_apdu,
+	size_t c_apdu_len,
+	void* r_apdu,
+	size_t* r_apdu_len,
+	uint16_t* sw1sw2,
+	struct emv_ttl_ins_stats_t* ins_stats
 )
 {
 	enum iso7816_apdu_case_t apdu_case;
@@ -81,8 +512,11 @@ int emv_ttl_trx(
 			return -2;
 	}
 
-	if (ctx->cardreader.mode == EMV_CARDREADER_MODE_APDU) {
-		// For APDU mode, transmit C-APDU as-is
+	if (ctx->cardreader.mode == EMV_CARDREADER_MODE_APDU ||
+		ctx->cardreader.mode == EMV_CARDREADER_MODE_TPDU_T1
+	) {
+		// For APDU mode and protocol T=1, transmit C-APDU as-is
+		// See EMV Contact Interface Specification v1.0, 9.3.2
 		tx_buf = c_apdu;
 		tx_buf_len = c_apdu_len;
 
@@ -126,9 +560,13 @@ int emv_ttl_trx(
 		bool tx_get_response = false;
 		bool tx_update_le  = false;
 
-		emv_debug_ctpdu(tx_buf, tx_buf_len);
-
-		r = ctx->cardreader.trx(ctx->cardreader.ctx, tx_buf, tx_buf_len, rx_buf, &rx_len);
+		if (ctx->cardreader.mode == EMV_CARDREADER_MODE_TPDU_T1) {
+			// For protocol T=1, the C-APDU is transmitted using I-blocks
+			r = emv_ttl_t1_trx(ctx, tx_buf, tx_buf_len, rx_buf, &rx_len, ins_stats);
+		} else {
+			emv_debug_ctpdu(tx_buf, tx_buf_len);
+			r = emv_ttl_cardreader_trx(ctx, tx_buf, tx_buf_len, rx_buf, &rx_len, ins_stats);
+		}
 		if (r) {
 			return r;
 		}
@@ -138,7 +576,9 @@ int emv_ttl_trx(
 			return 1;
 		}
 
-		emv_debug_rtpdu(rx_buf, rx_len);
+		if (ctx->cardreader.mode != EMV_CARDREADER_MODE_TPDU_T1) {
+			emv_debug_rtpdu(rx_buf, rx_len);
+		}
 
 		// Store INS of most recent tx for later use
 		INS = *((uint8_t*)(tx_buf + 1));
@@ -344,8 +784,10 @@ int emv_ttl_trx(
 			*r_apdu_len -= rx_len;
 		}
 
-		// For APDU mode and a response that appears to contain response data
-		if (ctx->cardreader.mode == EMV_CARDREADER_MODE_APDU &&
+		// For APDU mode or protocol T=1 and a response that appears to
+		// contain response data
+		if ((ctx->cardreader.mode == EMV_CARDREADER_MODE_APDU ||
+			ctx->cardreader.mode == EMV_CARDREADER_MODE_TPDU_T1) &&
 			rx_len > 2
 		) {
 			// Response data is only allowed for APDU cases 2 and 4
@@ -394,6 +836,10 @@ int emv_ttl_trx(
 			tx_buf = c_tpdu_header;
 			tx_buf_len = sizeof(c_tpdu_header);
 
+			if (ins_stats) {
+				ins_stats->get_response++;
+			}
+
 			// Next transmission
 			continue;
 		}
@@ -406,6 +852,10 @@ int emv_ttl_trx(
 			tx_buf = c_tpdu_header;
 			tx_buf_len = sizeof(c_tpdu_header);
 
+			if (ins_stats) {
+				ins_stats->le_retries++;
+			}
+
 			// Next transmission
 			continue;
 		}
@@ -423,6 +873,188 @@ int emv_ttl_trx(
 	} while (true);
 }
 
+int emv_ttl_ext_attach(struct emv_ttl_t* ctx, struct emv_ttl_ext_t* ext)
+{
+	if (!ctx || !ext || !ctx->cardreader.trx) {
+		return -1;
+	}
+	if (emv_ttl_ext_get(ctx)) {
+		// Extension already attached
+		return -2;
+	}
+
+	// Retain card reader populated by the caller and interpose on it such
+	// that the extension can be found by emv_ttl_ext_get()
+	memset(ext, 0, sizeof(*ext));
+	ext->cardreader = ctx->cardreader;
+	ctx->cardreader.ctx = ext;
+	ctx->cardreader.trx = &emv_ttl_ext_trx;
+
+	return 0;
+}
+
+int emv_ttl_ext_detach(struct emv_ttl_t* ctx)
+{
+	struct emv_ttl_ext_t* ext;
+
+	if (!ctx) {
+		return -1;
+	}
+
+	ext = emv_ttl_ext_get(ctx);
+	if (!ext) {
+		// No extension attached
+		return 1;
+	}
+
+	// Restore card reader populated by the caller
+	ctx->cardreader.ctx = ext->cardreader.ctx;
+	ctx->cardreader.trx = ext->cardreader.trx;
+
+	return 0;
+}
+
+int emv_ttl_t1_init(
+	struct emv_ttl_t* ctx,
+	const struct iso7816_atr_info_t* atr_info
+)
+{
+	int r;
+	struct emv_ttl_ext_t* ext;
+	struct emv_ttl_t1_t* t1;
+	uint8_t ifsd = EMV_TTL_T1_IFS_MAX;
+	uint8_t tx_block[EMV_TTL_T1_BLOCK_MAX];
+	size_t tx_block_len;
+
+	if (!ctx || !atr_info) {
+		return -1;
+	}
+	if (ctx->cardreader.mode != EMV_CARDREADER_MODE_TPDU_T1) {
+		return -2;
+	}
+	ext = emv_ttl_ext_get(ctx);
+	if (!ext) {
+		// Protocol T=1 state requires an attached extension
+		return -3;
+	}
+	t1 = &ext->t1;
+
+	// Initial protocol T=1 parameters
+	// See ISO 7816-3:2006, 11.4
+	memset(t1, 0, sizeof(*t1));
+	t1->ifsc = atr_info->protocol_T1.IFSI;
+	t1->ifsd = EMV_TTL_T1_IFS_DEFAULT;
+	t1->edc_crc = atr_info->protocol_T1.error_detection_code == ISO7816_ERROR_DETECTION_CODE_CRC;
+	if (t1->ifsc > EMV_TTL_T1_IFS_MAX) {
+		t1->ifsc = EMV_TTL_T1_IFS_MAX;
+	}
+
+	// Negotiate maximum IFSD using S(IFS request) as the first block
+	// See EMV Contact Interface Specification v1.0, 9.2.4.3
+	tx_block_len = emv_ttl_t1_build_block(
+		t1,
+		EMV_TTL_T1_PCB_S_BLOCK | EMV_TTL_T1_PCB_S_IFS,
+		&ifsd,
+		sizeof(ifsd),
+		tx_block
+	);
+	for (unsigned int i = 0; i <= EMV_TTL_T1_RETRY_MAX; ++i) {
+		uint8_t rx_block[EMV_TTL_T1_BLOCK_MAX];
+		size_t rx_block_len = sizeof(rx_block);
+
+		emv_debug_ctpdu(tx_block, tx_block_len);
+		r = emv_ttl_cardreader_trx(ctx, tx_block, tx_block_len, rx_block, &rx_block_len, NULL);
+		if (r) {
+			return r;
+		}
+		emv_debug_rtpdu(rx_block, rx_block_len);
+
+		if (!emv_ttl_t1_block_is_valid(t1, rx_block, rx_block_len) ||
+			rx_block[1] != (EMV_TTL_T1_PCB_S_BLOCK | EMV_TTL_T1_PCB_S_RESPONSE | EMV_TTL_T1_PCB_S_IFS) ||
+			rx_block[2] != 1 ||
+			rx_block[3] != ifsd
+		) {
+			// Retransmit S(IFS request)
+			// See ISO 7816-3:2006, 11.6.3.2, rule 7.3
+			t1->retransmissions++;
+			continue;
+		}
+
+		t1->ifsd = ifsd;
+		return 0;
+	}
+
+	// IFSD negotiation failed
+	return 1;
+}
+
+int emv_ttl_trx(
+	struct emv_ttl_t* ctx,
+	const void* c_apdu,
+	size_t c_apdu_len,
+	void* r_apdu,
+	size_t* r_apdu_len,
+	uint16_t* sw1sw2
+)
+{
+	int r;
+	struct emv_ttl_ext_t* ext;
+	struct emv_ttl_ins_stats_t* ins_stats = NULL;
+	uint64_t trx_ns = 0;
+
+	ext = emv_ttl_ext_get(ctx);
+	if (ext && ext->stats && c_apdu && c_apdu_len >= 4) {
+		// Account all exchanges to the instruction of the original command
+		ins_stats = emv_ttl_stats_get(ext->stats, ((const uint8_t*)c_apdu)[1]);
+		ins_stats->commands++;
+		trx_ns = ins_stats->trx_ns;
+	}
+
+	r = emv_ttl_trx_internal(
+		ctx,
+		c_apdu,
+		c_apdu_len,
+		r_apdu,
+		r_apdu_len,
+		sw1sw2,
+		ins_stats
+	);
+
+	if (ins_stats) {
+		emv_metrics_histogram_add(&ins_stats->latency, ins_stats->trx_ns - trx_ns);
+	}
+
+	return r;
+}
+
+int emv_ttl_stats_reset(struct emv_ttl_stats_t* stats)
+{
+	if (!stats) {
+		return -1;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	return 0;
+}
+
+const struct emv_ttl_ins_stats_t* emv_ttl_stats_find(
+	const struct emv_ttl_stats_t* stats,
+	uint8_t ins
+)
+{
+	if (!stats) {
+		return NULL;
+	}
+
+	for (unsigned int i = 0; i < stats->ins_count; ++i) {
+		if (stats->ins[i].ins == ins) {
+			return &stats->ins[i];
+		}
+	}
+
+	return NULL;
+}
+
 int emv_ttl_select_by_df_name(
 	struct emv_ttl_t* ctx,
 	const void* df_name,
@@ -605,6 +1237,214 @@ int emv_ttl_read_record(
 	return 0;
 }
 
+static int emv_ttl_read_record_single(
+	struct emv_ttl_t* ctx,
+	const struct emv_ttl_record_ref_t* record,
+	size_t idx,
+	emv_ttl_read_record_cb_t cb,
+	void* cb_ctx
+)
+{
+	int r;
+	uint8_t data[EMV_RAPDU_DATA_MAX];
+	size_t data_len = sizeof(data);
+	uint16_t sw1sw2;
+
+	r = emv_ttl_read_record(ctx, record->sfi, record->record_number, data, &data_len, &sw1sw2);
+	if (r) {
+		return r;
+	}
+
+	return cb(cb_ctx, idx, data, data_len, sw1sw2);
+}
+
+struct emv_ttl_batch_state_t {
+	size_t base_idx;
+	size_t rx_count;
+	bool repeat;
+	emv_ttl_read_record_cb_t cb;
+	void* cb_ctx;
+	struct emv_ttl_ins_stats_t* ins_stats;
+};
+
+static int emv_ttl_read_record_batch_rx(
+	void* cb_ctx,
+	size_t idx,
+	const void* rx_buf,
+	size_t rx_buf_len
+)
+{
+	struct emv_ttl_batch_state_t* state = cb_ctx;
+	const uint8_t* rx = rx_buf;
+	uint8_t SW1;
+	uint8_t SW2;
+
+	if (idx != state->rx_count) {
+		// Card reader must provide responses in order
+		return 14;
+	}
+
+	if (state->ins_stats) {
+		state->ins_stats->exchanges++;
+		state->ins_stats->rx_bytes += rx_buf_len;
+	}
+
+	if (rx_buf_len < 2) {
+		// No response or incomplete status bytes
+		emv_debug_error("No response");
+		return 1;
+	}
+	emv_debug_rapdu(rx_buf, rx_buf_len);
+
+	SW1 = rx[rx_buf_len - 2];
+	SW2 = rx[rx_buf_len - 1];
+	if (SW1 == 0x61 || SW1 == 0x6C) {
+		// Response requires GET RESPONSE or Le correction. Abort the batch
+		// and repeat the command individually because the card reader may
+		// already have transmitted the next command.
+		state->repeat = true;
+		return 1;
+	}
+
+	state->rx_count++;
+	return state->cb(
+		state->cb_ctx,
+		state->base_idx + idx,
+		rx_buf,
+		rx_buf_len - 2,
+		((uint16_t)SW1 << 8) | SW2
+	);
+}
+
+int emv_ttl_read_record_batch(
+	struct emv_ttl_t* ctx,
+	const struct emv_ttl_record_ref_t* records,
+	size_t count,
+	emv_ttl_read_record_cb_t cb,
+	void* cb_ctx
+)
+{
+	int r;
+	struct emv_ttl_ext_t* ext;
+	size_t idx = 0;
+
+	if (!ctx || !records || !count || !cb) {
+		return -1;
+	}
+
+	// For READ RECORD, ensure that SFI is from 0x01 to 0x1E
+	// See ISO 7816-4:2005, 7.3.2, table 47
+	for (size_t i = 0; i < count; ++i) {
+		if (records[i].sfi < 0x01 || records[i].sfi > 0x1E) {
+			return -3;
+		}
+	}
+
+	ext = emv_ttl_ext_get(ctx);
+	if (!ext ||
+		!ext->trx_batch ||
+		ctx->cardreader.mode != EMV_CARDREADER_MODE_APDU
+	) {
+		// Fall back to individual READ RECORD commands
+		for (idx = 0; idx < count; ++idx) {
+			r = emv_ttl_read_record_single(ctx, &records[idx], idx, cb, cb_ctx);
+			if (r) {
+				return r;
+			}
+		}
+		return 0;
+	}
+
+	while (idx < count) {
+		struct iso7816_apdu_case_2s_t c_apdu[EMV_TTL_BATCH_MAX];
+		const void* tx_bufs[EMV_TTL_BATCH_MAX];
+		size_t tx_buf_lens[EMV_TTL_BATCH_MAX];
+		size_t batch_count = count - idx;
+		struct emv_ttl_batch_state_t state;
+		uint64_t trx_ns = 0;
+
+		if (batch_count > EMV_TTL_BATCH_MAX) {
+			batch_count = EMV_TTL_BATCH_MAX;
+		}
+
+		// Build READ RECORD commands
+		// See EMV 4.4 Book 1, 11.2.2, table 3 and table 4
+		for (size_t i = 0; i < batch_count; ++i) {
+			c_apdu[i].CLA = 0x00;
+			c_apdu[i].INS = 0xB2;
+			c_apdu[i].P1  = records[idx + i].record_number;
+			c_apdu[i].P2  = (records[idx + i].sfi << 3) | 0x04;
+			c_apdu[i].Le  = 0x00;
+			tx_bufs[i] = &c_apdu[i];
+			tx_buf_lens[i] = sizeof(c_apdu[i]);
+			emv_debug_capdu(&c_apdu[i], sizeof(c_apdu[i]));
+		}
+
+		memset(&state, 0, sizeof(state));
+		state.base_idx = idx;
+		state.cb = cb;
+		state.cb_ctx = cb_ctx;
+		if (ext->stats) {
+			state.ins_stats = emv_ttl_stats_get(ext->stats, 0xB2);
+			state.ins_stats->commands += batch_count;
+			state.ins_stats->tx_bytes += batch_count * sizeof(c_apdu[0]);
+		}
+
+		if (ext->metrics || state.ins_stats) {
+			trx_ns = emv_metrics_get_time_ns();
+		}
+		r = ext->trx_batch(
+			ext->cardreader.ctx,
+			tx_bufs,
+			tx_buf_lens,
+			batch_count,
+			&emv_ttl_read_record_batch_rx,
+			&state
+		);
+		if (ext->metrics || state.ins_stats) {
+			trx_ns = emv_metrics_get_time_ns() - trx_ns;
+			if (ext->metrics) {
+				ext->metrics->card_io_ns += trx_ns;
+			}
+		}
+		if (state.ins_stats) {
+			state.ins_stats->trx_ns += trx_ns;
+			if (state.rx_count) {
+				// Distribute batch duration evenly across the responses
+				for (size_t i = 0; i < state.rx_count; ++i) {
+					emv_metrics_histogram_add(&state.ins_stats->latency, trx_ns / state.rx_count);
+				}
+			}
+			if (state.repeat) {
+				// Commands without responses will be submitted again
+				state.ins_stats->commands -= batch_count - state.rx_count;
+			} else if (r) {
+				state.ins_stats->errors++;
+			}
+		}
+		idx += state.rx_count;
+
+		if (state.repeat) {
+			// Repeat command individually using the full APDU case 2 flow
+			r = emv_ttl_read_record_single(ctx, &records[idx], idx, cb, cb_ctx);
+			if (r) {
+				return r;
+			}
+			++idx;
+			continue;
+		}
+		if (r) {
+			return r;
+		}
+		if (state.rx_count != batch_count) {
+			// Card reader did not provide all responses
+			return 15;
+		}
+	}
+
+	return 0;
+}
+
 int emv_ttl_get_processing_options(
 	struct emv_ttl_t* ctx,
 	const void* data,
@@ -22,12 +22,18 @@
 #ifndef EMV_TTL_H
 #define EMV_TTL_H
 
+#include "emv_metrics.h"
+
 #include <sys/cdefs.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 __BEGIN_DECLS
 
+// Forward declarations
+struct iso7816_atr_info_t;
+
 /// Maximum length of C-APDU data field in bytes
 #define EMV_CAPDU_DATA_MAX (255)
 
@@ -43,7 +49,8 @@ __BEGIN_DECLS
 /// Card reader mode
 enum emv_cardreader_mode_t {
 	EMV_CARDREADER_MODE_APDU = 1,               ///< Card reader is in APDU mode
-	EMV_CARDREADER_MODE_TPDU,                   ///< Card reader is in TPDU mode
+	EMV_CARDREADER_MODE_TPDU,                   ///< Card reader is in TPDU mode using protocol T=0
+	EMV_CARDREADER_MODE_TPDU_T1,                ///< Card reader is in TPDU mode using protocol T=1 and transceives complete blocks
 };
 
 /// Card reader transceive function type
@@ -55,11 +62,56 @@ typedef int (*emv_cardreader_trx_t)(
 	size_t* rx_buf_len
 );
 
+/**
+ * Card reader batch receive callback function type
+ *
+ * @param cb_ctx Callback context
+ * @param idx Index of the transmit buffer to which the response belongs
+ * @param rx_buf Receive buffer
+ * @param rx_buf_len Length of receive buffer in bytes
+ * @return Zero to continue receiving responses. Non-zero to abort the batch.
+ */
+typedef int (*emv_cardreader_batch_cb_t)(
+	void* cb_ctx,
+	size_t idx,
+	const void* rx_buf,
+	size_t rx_buf_len
+);
+
+/**
+ * Card reader batch transceive function type
+ *
+ * The card reader may transmit the next frame before the response to the
+ * previous frame has been delivered to the host, but must transmit the frames
+ * to the card in order and must invoke the callback for each response in
+ * order, as the responses arrive. If the callback returns non-zero, the card
+ * reader must stop invoking the callback and return that value.
+ *
+ * @param ctx Card reader transceive function context
+ * @param tx_bufs Transmit buffers
+ * @param tx_buf_lens Lengths of transmit buffers in bytes
+ * @param count Number of transmit buffers
+ * @param cb Callback function for each response
+ * @param cb_ctx Callback context
+ * @return Zero for success. Less than zero for error. Otherwise the non-zero
+ *         value returned by the callback.
+ */
+typedef int (*emv_cardreader_trx_batch_t)(
+	void* ctx,
+	const void* const* tx_bufs,
+	const size_t* tx_buf_lens,
+	size_t count,
+	emv_cardreader_batch_cb_t cb,
+	void* cb_ctx
+);
+
 /**
  * EMV Terminal Transport Layer (TTL) abstraction for card reader
  * @note the card reader mode determines whether the @ref trx function
  * operates on TPDU frames or APDU frames. Typically PC/SC card readers use
- * APDU mode.
+ * APDU mode. For protocol T=1, each invocation of the @ref trx function
+ * transmits a single block and receives a single block, including the
+ * prologue and epilogue fields.
  */
 struct emv_cardreader_t {
 	enum emv_cardreader_mode_t mode;            ///< Card reader mode (TPDU vs APDU)
@@ -67,11 +119,156 @@ struct emv_cardreader_t {
 	emv_cardreader_trx_t trx;                   ///< Card reader transceive function
 };
 
+/// Maximum number of distinct instructions (INS) tracked by @ref emv_ttl_stats_t
+#define EMV_TTL_STATS_INS_MAX (16)
+
+/**
+ * EMV Terminal Transport Layer (TTL) statistics for a single instruction (INS)
+ *
+ * A command is a single invocation of @ref emv_ttl_trx() while an exchange
+ * is a single invocation of @ref emv_cardreader_t.trx. Exchanges caused by
+ * procedure bytes, GET RESPONSE or Le correction are accounted to the
+ * instruction of the original command.
+ */
+struct emv_ttl_ins_stats_t {
+	uint8_t ins; ///< Instruction byte (INS) of command
+	unsigned int commands; ///< Number of commands
+	unsigned int exchanges; ///< Number of C-TPDU/R-TPDU or C-APDU/R-APDU exchanges
+	unsigned int get_response; ///< Number of GET RESPONSE exchanges caused by status 61XX or warnings
+	unsigned int le_retries; ///< Number of exchanges repeated due to status 6CXX
+	unsigned int errors; ///< Number of failed card reader exchanges
+	uint64_t tx_bytes; ///< Number of bytes transmitted to card reader
+	uint64_t rx_bytes; ///< Number of bytes received from card reader
+	uint64_t trx_ns; ///< Total time in nanoseconds spent inside card reader transceive function
+	struct emv_metrics_histogram_t latency; ///< Histogram of time spent inside card reader transceive function per command
+};
+
+/**
+ * EMV Terminal Transport Layer (TTL) statistics
+ *
+ * Initialise or reset using @ref emv_ttl_stats_reset() and assign to
+ * @ref emv_ttl_ext_t.stats to enable. Commands for instructions in excess of
+ * @ref EMV_TTL_STATS_INS_MAX are accounted in @ref emv_ttl_stats_t.other.
+ */
+struct emv_ttl_stats_t {
+	unsigned int ins_count; ///< Number of populated entries in @ref emv_ttl_stats_t.ins
+	struct emv_ttl_ins_stats_t ins[EMV_TTL_STATS_INS_MAX]; ///< Statistics per instruction (INS) in order of first use
+	struct emv_ttl_ins_stats_t other; ///< Statistics for all remaining instructions
+};
+
+/// Default Information Field Size (IFS) for protocol T=1
+#define EMV_TTL_T1_IFS_DEFAULT (32)
+
+/// Maximum Information Field Size (IFS) for protocol T=1
+#define EMV_TTL_T1_IFS_MAX (254)
+
+/// Maximum length of protocol T=1 block in bytes
+#define EMV_TTL_T1_BLOCK_MAX (3 + EMV_TTL_T1_IFS_MAX + 2)
+
+/**
+ * @name Protocol T=1 Protocol Control Byte (PCB) values
+ * @remark See ISO 7816-3:2006, 11.3.2.2
+ * @anchor emv-ttl-t1-pcb
+ */
+/// @{
+#define EMV_TTL_T1_PCB_I_BLOCK                  (0x00) ///< PCB for Information block (I-block)
+#define EMV_TTL_T1_PCB_I_NS                     (0x40) ///< I-block send-sequence number N(S)
+#define EMV_TTL_T1_PCB_I_M                      (0x20) ///< I-block more-data bit (chaining)
+#define EMV_TTL_T1_PCB_R_BLOCK                  (0x80) ///< PCB for Receive ready block (R-block)
+#define EMV_TTL_T1_PCB_R_NR                     (0x10) ///< R-block send-sequence number N(R) of expected I-block
+#define EMV_TTL_T1_PCB_R_ERROR_MASK             (0x0F) ///< R-block error mask
+#define EMV_TTL_T1_PCB_R_ERROR_EDC              (0x01) ///< R-block error: EDC and/or parity error
+#define EMV_TTL_T1_PCB_R_ERROR_OTHER            (0x02) ///< R-block error: other errors
+#define EMV_TTL_T1_PCB_S_BLOCK                  (0xC0) ///< PCB for Supervisory block (S-block)
+#define EMV_TTL_T1_PCB_S_RESPONSE               (0x20) ///< S-block response bit
+#define EMV_TTL_T1_PCB_S_TYPE_MASK              (0x1F) ///< S-block type mask
+#define EMV_TTL_T1_PCB_S_RESYNCH                (0x00) ///< S-block type: RESYNCH
+#define EMV_TTL_T1_PCB_S_IFS                    (0x01) ///< S-block type: IFS
+#define EMV_TTL_T1_PCB_S_ABORT                  (0x02) ///< S-block type: ABORT
+#define EMV_TTL_T1_PCB_S_WTX                    (0x03) ///< S-block type: WTX
+/// @}
+
+/**
+ * EMV Terminal Transport Layer (TTL) state for protocol T=1
+ * @note Cleared by @ref emv_ttl_ext_attach() and populated by @ref emv_ttl_t1_init()
+ */
+struct emv_ttl_t1_t {
+	uint8_t ifsc; ///< Information Field Size for the Card (IFSC)
+	uint8_t ifsd; ///< Information Field Size for the interface Device (IFSD)
+	bool edc_crc; ///< Boolean indicating whether Error Detection Code (EDC) is CRC instead of LRC
+	uint8_t ns; ///< Send-sequence number N(S) of next I-block transmitted by the terminal
+	uint8_t nr; ///< Send-sequence number N(S) of next I-block expected from the card
+	uint8_t wtx; ///< Most recent Waiting Time Extension (WTX) multiplier requested by the card. Zero if none.
+	unsigned int wtx_count; ///< Number of Waiting Time Extension (WTX) requests by the card
+	unsigned int retransmissions; ///< Number of blocks retransmitted or requested again due to transmission errors
+};
+
 /// EMV Terminal Transport Layer context
 struct emv_ttl_t {
 	struct emv_cardreader_t cardreader;
 };
 
+/**
+ * EMV Terminal Transport Layer (TTL) extension
+ *
+ * Optional state that is explicitly attached to an existing TTL context using
+ * @ref emv_ttl_ext_attach(). A TTL context without an attached extension
+ * behaves exactly as before and only requires @ref emv_ttl_t.cardreader to
+ * be populated.
+ *
+ * @note The extension interposes on @ref emv_ttl_t.cardreader and retains
+ * the card reader populated by the caller in @ref emv_ttl_ext_t.cardreader.
+ * Use @ref emv_ttl_ext_detach() before modifying @ref emv_ttl_t.cardreader
+ * or releasing the extension.
+ */
+struct emv_ttl_ext_t {
+	/**
+	 * @brief Card reader populated by the caller before
+	 * @ref emv_ttl_ext_attach(). Do not modify while attached.
+	 */
+	struct emv_cardreader_t cardreader;
+
+	/**
+	 * @brief Optional card reader batch transceive function. NULL if not
+	 * supported.
+	 *
+	 * Invoked using the context of @ref emv_ttl_ext_t.cardreader. Only used
+	 * in @ref EMV_CARDREADER_MODE_APDU to submit sequences of READ RECORD
+	 * commands without waiting for a host round trip between them. Populate
+	 * after @ref emv_ttl_ext_attach(). See @ref emv_ttl_read_record_batch().
+	 */
+	emv_cardreader_trx_batch_t trx_batch;
+
+	/**
+	 * @brief Optional EMV kernel timing metrics. NULL to disable.
+	 *
+	 * When set, time spent inside @ref emv_cardreader_t.trx is added to
+	 * @ref emv_metrics_t.card_io_ns. Populated by the EMV kernel steps
+	 * according to @ref emv_ctx_t.metrics.
+	 */
+	struct emv_metrics_t* metrics;
+
+	/**
+	 * @brief Optional transport statistics per instruction (INS). NULL to
+	 * disable.
+	 *
+	 * Populate after @ref emv_ttl_ext_attach() using an object initialised by
+	 * @ref emv_ttl_stats_reset(). Use @ref emv_ttl_stats_reset() to reset
+	 * between transactions.
+	 */
+	struct emv_ttl_stats_t* stats;
+
+	/**
+	 * @brief Protocol T=1 state. Only used by
+	 * @ref EMV_CARDREADER_MODE_TPDU_T1.
+	 *
+	 * Cleared by @ref emv_ttl_ext_attach() such that @ref emv_ttl_trx()
+	 * fails until it is populated using @ref emv_ttl_t1_init() after the
+	 * card has been reset.
+	 */
+	struct emv_ttl_t1_t t1;
+};
+
 /**
  * @name Generate Application Cryptogram (GENAC) reference control parameter
  *       bit values
@@ -89,6 +286,60 @@ struct emv_ttl_t {
 #define EMV_TTL_GENAC_SIG_XDA                   (0x08) ///< Requested signature: XDA signature requested
 /// @}
 
+/**
+ * Attach EMV Terminal Transport Layer (TTL) extension to TTL context. The
+ * extension is cleared such that optional features are disabled and
+ * @ref emv_ttl_t.cardreader, which must already be populated, is retained in
+ * @ref emv_ttl_ext_t.cardreader. Populate optional members afterwards.
+ *
+ * @param ctx EMV Terminal Transport Layer context
+ * @param ext EMV Terminal Transport Layer extension. Must remain valid until
+ *            @ref emv_ttl_ext_detach().
+ * @return Zero for success. Less than zero for error.
+ */
+int emv_ttl_ext_attach(struct emv_ttl_t* ctx, struct emv_ttl_ext_t* ext);
+
+/**
+ * Detach EMV Terminal Transport Layer (TTL) extension from TTL context and
+ * restore @ref emv_ttl_t.cardreader populated by the caller
+ *
+ * @param ctx EMV Terminal Transport Layer context
+ * @return Zero for success. Less than zero for error. Greater than zero if no
+ *         extension is attached.
+ */
+int emv_ttl_ext_detach(struct emv_ttl_t* ctx);
+
+/**
+ * Retrieve EMV Terminal Transport Layer (TTL) extension attached to TTL
+ * context
+ *
+ * @param ctx EMV Terminal Transport Layer context
+ * @return Attached extension. NULL if none.
+ */
+struct emv_ttl_ext_t* emv_ttl_ext_get(const struct emv_ttl_t* ctx);
+
+/**
+ * Initialise protocol T=1 state using the card's Answer To Reset (ATR) and
+ * negotiate the maximum Information Field Size for the interface Device
+ * (IFSD) using an S(IFS request) block.
+ *
+ * This function must be called after each card reset and before
+ * @ref emv_ttl_trx() when the card reader mode is
+ * @ref EMV_CARDREADER_MODE_TPDU_T1. Protocol T=1 requires an extension
+ * attached using @ref emv_ttl_ext_attach() to hold the protocol state.
+ *
+ * @remark See ISO 7816-3:2006, 11.4
+ * @remark See EMV Contact Interface Specification v1.0, 9.2.4
+ *
+ * @param ctx EMV Terminal Transport Layer context
+ * @param atr_info Parsed ATR info of card
+ * @return Zero for success. Less than zero for error. Greater than zero for invalid reader response.
+ */
+int emv_ttl_t1_init(
+	struct emv_ttl_t* ctx,
+	const struct iso7816_atr_info_t* atr_info
+);
+
 /**
  * EMV Terminal Transport Layer (TTL) transceive function for sending a
  * Command Application Protocol Data Unit (C-APDU) and receiving a
@@ -178,6 +429,63 @@ int emv_ttl_read_record(
 	uint16_t* sw1sw2
 );
 
+/// Maximum number of READ RECORD commands submitted to @ref emv_ttl_ext_t.trx_batch at a time
+#define EMV_TTL_BATCH_MAX (32)
+
+/// Application record reference for @ref emv_ttl_read_record_batch()
+struct emv_ttl_record_ref_t {
+	uint8_t sfi; ///< Short File Identifier (SFI)
+	uint8_t record_number; ///< Record number
+};
+
+/**
+ * READ RECORD batch callback function type
+ *
+ * @param cb_ctx Callback context
+ * @param idx Index of record reference
+ * @param data Record data
+ * @param data_len Length of record data in bytes
+ * @param sw1sw2 Status bytes (SW1-SW2) in host endianness
+ * @return Zero to continue processing records. Non-zero to stop.
+ */
+typedef int (*emv_ttl_read_record_cb_t)(
+	void* cb_ctx,
+	size_t idx,
+	const void* data,
+	size_t data_len,
+	uint16_t sw1sw2
+);
+
+/**
+ * READ RECORD (0xB2) for a sequence of records
+ *
+ * If an extension with @ref emv_ttl_ext_t.trx_batch is attached, the READ RECORD commands are
+ * submitted in batches of up to @ref EMV_TTL_BATCH_MAX and the callback is
+ * invoked as each response arrives. Responses that require GET RESPONSE or Le correction are repeated
+ * individually. Otherwise this function falls back to
+ * @ref emv_ttl_read_record() for each record. Either way, the callback is
+ * invoked for each record in order.
+ *
+ * @remark EMV 4.4 Book 1, 11.2
+ * @remark EMV 4.4 Book 3, 6.5.11
+ *
+ * @param ctx EMV Terminal Transport Layer context
+ * @param records Application record references
+ * @param count Number of application record references
+ * @param cb Callback function for each record
+ * @param cb_ctx Callback context
+ * @return Zero for success. Less than zero for error. Greater than zero for
+ *         invalid reader response. Otherwise the non-zero value returned by
+ *         the callback.
+ */
+int emv_ttl_read_record_batch(
+	struct emv_ttl_t* ctx,
+	const struct emv_ttl_record_ref_t* records,
+	size_t count,
+	emv_ttl_read_record_cb_t cb,
+	void* cb_ctx
+);
+
 /**
  * GET PROCESSING OPTIONS (0xA8) for current application
  * @remark EMV 4.4 Book 3, 6.5.8
@@ -263,6 +571,27 @@ int emv_ttl_genac(
 	uint16_t* sw1sw2
 );
 
+/**
+ * Reset EMV Terminal Transport Layer (TTL) statistics
+ *
+ * @param stats EMV TTL statistics
+ * @return Zero for success. Less than zero for error.
+ */
+int emv_ttl_stats_reset(struct emv_ttl_stats_t* stats);
+
+/**
+ * Find EMV Terminal Transport Layer (TTL) statistics for a specific
+ * instruction (INS)
+ *
+ * @param stats EMV TTL statistics
+ * @param ins Instruction byte (INS)
+ * @return Statistics for instruction. Do NOT free. NULL if not found.
+ */
+const struct emv_ttl_ins_stats_t* emv_ttl_stats_find(
+	const struct emv_ttl_stats_t* stats,
+	uint8_t ins
+);
+
 __END_DECLS
 
 #endif
@@ -0,0 +1,477 @@
+/**
+ * @file emv_txn_journal.c
+ * @brief Persistent transaction journal for terminal risk management
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_txn_journal.h"
+#include "emv_utils_config.h"
+#include "emv.h"
+#include "emv_txn_log.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h> // For malloc() and free()
+#include <string.h>
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define EMV_TXN_JOURNAL_MAGIC "EMVTXNJ"
+#define EMV_TXN_JOURNAL_VERSION (1)
+#define EMV_TXN_JOURNAL_BYTE_ORDER (0x01020304)
+#define EMV_TXN_JOURNAL_SLOT_SIZE (64)
+#define EMV_TXN_JOURNAL_HEADER_SIZE (2 * EMV_TXN_JOURNAL_SLOT_SIZE)
+#define EMV_TXN_JOURNAL_INITIAL_CAPACITY (4096)
+
+// Header slot. Both slots are at the start of the file, followed by the
+// records, and the valid slot with the latest generation is current.
+struct emv_txn_journal_header_t {
+	char magic[8];
+	uint16_t version;
+	uint16_t record_size;
+	uint32_t byte_order; // Indicates byte order of header and records
+	uint64_t generation;
+	uint64_t count; // Number of committed records
+	uint32_t reserved;
+	uint32_t checksum; // Checksum of the preceding fields
+};
+
+struct emv_txn_journal_t {
+	int fd;
+	uint8_t* base;
+	size_t map_len;
+	size_t page_size;
+
+	size_t group_commit;
+	uint64_t generation;
+	size_t capacity;
+	size_t committed;
+	size_t count;
+};
+
+#ifdef HAVE_MMAP
+
+static uint32_t emv_txn_journal_checksum(const struct emv_txn_journal_header_t* header)
+{
+	const uint8_t* ptr = (const uint8_t*)header;
+	uint32_t checksum = 2166136261U;
+
+	// FNV-1a
+	for (size_t i = 0; i < offsetof(struct emv_txn_journal_header_t, checksum); ++i) {
+		checksum ^= ptr[i];
+		checksum *= 16777619U;
+	}
+
+	return checksum;
+}
+
+static inline struct emv_txn_journal_header_t* emv_txn_journal_slot(
+	const struct emv_txn_journal_t* journal,
+	uint64_t generation
+)
+{
+	// Each generation uses the other slot than the previous generation
+	return (struct emv_txn_journal_header_t*)(journal->base + (generation & 1) * EMV_TXN_JOURNAL_SLOT_SIZE);
+}
+
+static inline struct emv_txn_log_entry_t* emv_txn_journal_records(
+	const struct emv_txn_journal_t* journal
+)
+{
+	return (struct emv_txn_log_entry_t*)(journal->base + EMV_TXN_JOURNAL_HEADER_SIZE);
+}
+
+static int emv_txn_journal_sync(
+	struct emv_txn_journal_t* journal,
+	size_t offset,
+	size_t len
+)
+{
+	size_t start;
+
+	// msync() requires the address to be aligned to the page size
+	start = offset - (offset % journal->page_size);
+	if (msync(journal->base + start, offset + len - start, MS_SYNC)) {
+		return EMV_TXN_JOURNAL_ERROR_IO;
+	}
+
+	return 0;
+}
+
+static int emv_txn_journal_write_header(
+	struct emv_txn_journal_t* journal,
+	uint64_t generation,
+	size_t count
+)
+{
+	struct emv_txn_journal_header_t header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, EMV_TXN_JOURNAL_MAGIC, sizeof(header.magic));
+	header.version = EMV_TXN_JOURNAL_VERSION;
+	header.record_size = sizeof(struct emv_txn_log_entry_t);
+	header.byte_order = EMV_TXN_JOURNAL_BYTE_ORDER;
+	header.generation = generation;
+	header.count = count;
+	header.checksum = emv_txn_journal_checksum(&header);
+
+	memcpy(emv_txn_journal_slot(journal, generation), &header, sizeof(header));
+	return emv_txn_journal_sync(
+		journal,
+		(generation & 1) * EMV_TXN_JOURNAL_SLOT_SIZE,
+		sizeof(header)
+	);
+}
+
+static bool emv_txn_journal_header_is_valid(const struct emv_txn_journal_header_t* header)
+{
+	return
+		memcmp(header->magic, EMV_TXN_JOURNAL_MAGIC, sizeof(header->magic)) == 0 &&
+		header->checksum == emv_txn_journal_checksum(header);
+}
+
+static int emv_txn_journal_map(struct emv_txn_journal_t* journal, size_t len)
+{
+	void* ptr;
+	uint8_t* prev_base;
+	size_t prev_map_len;
+
+	// Map the new length before releasing the current mapping such that the
+	// journal remains usable if the new mapping fails
+	ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, journal->fd, 0);
+	if (ptr == MAP_FAILED) {
+		return EMV_TXN_JOURNAL_ERROR_IO;
+	}
+
+	prev_base = journal->base;
+	prev_map_len = journal->map_len;
+	journal->base = ptr;
+	journal->map_len = len;
+	journal->capacity = (len - EMV_TXN_JOURNAL_HEADER_SIZE) / sizeof(struct emv_txn_log_entry_t);
+
+	if (prev_base) {
+		munmap(prev_base, prev_map_len);
+	}
+
+	return 0;
+}
+
+static int emv_txn_journal_grow(struct emv_txn_journal_t* journal)
+{
+	size_t capacity;
+	size_t len;
+
+	// Double the capacity such that appending is amortised constant time
+	capacity = journal->capacity ? journal->capacity * 2 : EMV_TXN_JOURNAL_INITIAL_CAPACITY;
+	if (capacity > (SIZE_MAX - EMV_TXN_JOURNAL_HEADER_SIZE) / sizeof(struct emv_txn_log_entry_t)) {
+		return EMV_TXN_JOURNAL_ERROR_IO;
+	}
+	len = EMV_TXN_JOURNAL_HEADER_SIZE + capacity * sizeof(struct emv_txn_log_entry_t);
+
+	if (ftruncate(journal->fd, len)) {
+		return EMV_TXN_JOURNAL_ERROR_IO;
+	}
+
+	return emv_txn_journal_map(journal, len);
+}
+
+static int emv_txn_journal_recover(struct emv_txn_journal_t* journal)
+{
+	const struct emv_txn_journal_header_t* header = NULL;
+
+	for (unsigned int i = 0; i < 2; ++i) {
+		const struct emv_txn_journal_header_t* slot;
+
+		slot = emv_txn_journal_slot(journal, i);
+		if (!emv_txn_journal_header_is_valid(slot)) {
+			// Slot was interrupted while it was written
+			continue;
+		}
+		if (!header || slot->generation > header->generation) {
+			header = slot;
+		}
+	}
+	if (!header) {
+		return EMV_TXN_JOURNAL_ERROR_INVALID_FILE;
+	}
+
+	if (header->version != EMV_TXN_JOURNAL_VERSION ||
+		header->record_size != sizeof(struct emv_txn_log_entry_t) ||
+		header->byte_order != EMV_TXN_JOURNAL_BYTE_ORDER ||
+		header->count > journal->capacity
+	) {
+		return EMV_TXN_JOURNAL_ERROR_INVALID_FILE;
+	}
+
+	// Records after the committed records were not synced and are discarded
+	journal->generation = header->generation;
+	journal->committed = header->count;
+	journal->count = header->count;
+
+	return 0;
+}
+
+int emv_txn_journal_open(
+	const char* filename,
+	size_t group_commit,
+	struct emv_txn_journal_t** journal
+)
+{
+	int r;
+	struct stat st;
+	struct emv_txn_journal_t* j;
+
+	if (!filename || !journal) {
+		return EMV_TXN_JOURNAL_ERROR_INVALID_PARAMETER;
+	}
+	*journal = NULL;
+
+	j = malloc(sizeof(*j));
+	if (!j) {
+		return EMV_TXN_JOURNAL_ERROR_IO;
+	}
+	memset(j, 0, sizeof(*j));
+	j->group_commit = group_commit;
+	j->page_size = sysconf(_SC_PAGESIZE);
+
+	j->fd = open(filename, O_RDWR | O_CREAT, 0644);
+	if (j->fd < 0) {
+		free(j);
+		return EMV_TXN_JOURNAL_ERROR_IO;
+	}
+	if (fstat(j->fd, &st)) {
+		r = EMV_TXN_JOURNAL_ERROR_IO;
+		goto error;
+	}
+
+	if (st.st_size == 0) {
+		// Create new journal
+		r = emv_txn_journal_grow(j);
+		if (r) {
+			goto error;
+		}
+		j->generation = 1;
+		r = emv_txn_journal_write_header(j, j->generation, 0);
+		if (r) {
+			goto error;
+		}
+
+	} else {
+		if ((size_t)st.st_size < EMV_TXN_JOURNAL_HEADER_SIZE) {
+			r = EMV_TXN_JOURNAL_ERROR_INVALID_FILE;
+			goto error;
+		}
+
+		r = emv_txn_journal_map(j, st.st_size);
+		if (r) {
+			goto error;
+		}
+		r = emv_txn_journal_recover(j);
+		if (r) {
+			goto error;
+		}
+	}
+
+	*journal = j;
+	return 0;
+
+error:
+	if (j->base) {
+		munmap(j->base, j->map_len);
+	}
+	close(j->fd);
+	free(j);
+	return r;
+}
+
+int emv_txn_journal_close(struct emv_txn_journal_t* journal)
+{
+	int r;
+
+	if (!journal) {
+		return EMV_TXN_JOURNAL_ERROR_INVALID_PARAMETER;
+	}
+
+	r = emv_txn_journal_commit(journal);
+
+	munmap(journal->base, journal->map_len);
+	if (close(journal->fd) && !r) {
+		r = EMV_TXN_JOURNAL_ERROR_IO;
+	}
+	free(journal);
+
+	return r;
+}
+
+int emv_txn_journal_append(
+	struct emv_txn_journal_t* journal,
+	const struct emv_txn_log_entry_t* entry
+)
+{
+	int r;
+
+	if (!journal || !entry) {
+		return EMV_TXN_JOURNAL_ERROR_INVALID_PARAMETER;
+	}
+
+	if (journal->count == journal->capacity) {
+		r = emv_txn_journal_grow(journal);
+		if (r) {
+			return r;
+		}
+	}
+
+	emv_txn_journal_records(journal)[journal->count] = *entry;
+	++journal->count;
+
+	if (journal->group_commit &&
+		journal->count - journal->committed >= journal->group_commit
+	) {
+		return emv_txn_journal_commit(journal);
+	}
+
+	return 0;
+}
+
+int emv_txn_journal_commit(struct emv_txn_journal_t* journal)
+{
+	int r;
+
+	if (!journal) {
+		return EMV_TXN_JOURNAL_ERROR_INVALID_PARAMETER;
+	}
+	if (journal->count == journal->committed) {
+		return 0;
+	}
+
+	// Sync the records before the header that commits them such that the
+	// header never refers to records that are not durable
+	r = emv_txn_journal_sync(
+		journal,
+		EMV_TXN_JOURNAL_HEADER_SIZE + journal->committed * sizeof(struct emv_txn_log_entry_t),
+		(journal->count - journal->committed) * sizeof(struct emv_txn_log_entry_t)
+	);
+	if (r) {
+		return r;
+	}
+	r = emv_txn_journal_write_header(journal, journal->generation + 1, journal->count);
+	if (r) {
+		return r;
+	}
+
+	++journal->generation;
+	journal->committed = journal->count;
+
+	return 0;
+}
+
+#else // HAVE_MMAP
+
+int emv_txn_journal_open(
+	const char* filename,
+	size_t group_commit,
+	struct emv_txn_journal_t** journal
+)
+{
+	(void)filename;
+	(void)group_commit;
+	if (journal) {
+		*journal = NULL;
+	}
+
+	// Memory mapping not available
+	return EMV_TXN_JOURNAL_ERROR_UNSUPPORTED;
+}
+
+int emv_txn_journal_close(struct emv_txn_journal_t* journal)
+{
+	(void)journal;
+	return EMV_TXN_JOURNAL_ERROR_UNSUPPORTED;
+}
+
+int emv_txn_journal_append(
+	struct emv_txn_journal_t* journal,
+	const struct emv_txn_log_entry_t* entry
+)
+{
+	(void)journal;
+	(void)entry;
+	return EMV_TXN_JOURNAL_ERROR_UNSUPPORTED;
+}
+
+int emv_txn_journal_commit(struct emv_txn_journal_t* journal)
+{
+	(void)journal;
+	return EMV_TXN_JOURNAL_ERROR_UNSUPPORTED;
+}
+
+#endif // HAVE_MMAP
+
+size_t emv_txn_journal_count(const struct emv_txn_journal_t* journal)
+{
+	if (!journal) {
+		return 0;
+	}
+
+	return journal->count;
+}
+
+const struct emv_txn_log_entry_t* emv_txn_journal_entries(
+	const struct emv_txn_journal_t* journal
+)
+{
+	if (!journal || !journal->count) {
+		return NULL;
+	}
+
+	return (const struct emv_txn_log_entry_t*)(journal->base + EMV_TXN_JOURNAL_HEADER_SIZE);
+}
+
+int emv_txn_journal_build_txn_log(
+	const struct emv_txn_journal_t* journal,
+	struct emv_txn_log_t* log
+)
+{
+	const struct emv_txn_log_entry_t* entries;
+	size_t max_entries;
+	size_t first = 0;
+
+	if (!journal || !log) {
+		return EMV_TXN_JOURNAL_ERROR_INVALID_PARAMETER;
+	}
+
+	// Older records would be evicted by the transaction log anyway
+	entries = emv_txn_journal_entries(journal);
+	max_entries = emv_txn_log_max_entries(log);
+	if (journal->count > max_entries) {
+		first = journal->count - max_entries;
+	}
+
+	for (size_t i = first; i < journal->count; ++i) {
+		// Records with invalid dates cannot be indexed and are ignored
+		emv_txn_log_add(log, &entries[i]);
+	}
+
+	return 0;
+}
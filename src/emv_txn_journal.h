@@ -0,0 +1,165 @@
+/**
+ * @file emv_txn_journal.h
+ * @brief Persistent transaction journal for terminal risk management
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EMV_TXN_JOURNAL_H
+#define EMV_TXN_JOURNAL_H
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+
+__BEGIN_DECLS
+
+// Forward declarations
+struct emv_txn_log_entry_t;
+struct emv_txn_log_t;
+
+/**
+ * Persistent journal of previously approved transactions
+ *
+ * The journal is a memory mapped file that consists of a header followed by
+ * fixed size records that are only ever appended. Each record is a
+ * @ref emv_txn_log_entry_t using the layout of the host such that the records
+ * can be provided directly to @ref emv_terminal_risk_management() and the
+ * header indicates the layout to prevent the use of a journal by an
+ * incompatible host.
+ *
+ * The header consists of two checksummed slots that indicate the number of
+ * committed records. Appended records are only committed when
+ * @ref emv_txn_journal_commit() is used, or when the number of appended
+ * records reaches the group commit size, after which the records are synced
+ * before the next header slot is written and synced. If the journal is
+ * interrupted, the slot with the latest valid header determines the committed
+ * records when the journal is opened again, without reading the records.
+ *
+ * The journal is not synchronised and the file must only be opened by a
+ * single journal at a time.
+ */
+struct emv_txn_journal_t;
+
+/**
+ * Transaction journal errors
+ * These errors indicate that the journal could not be used and must have
+ * values less than zero.
+ */
+enum emv_txn_journal_error_t {
+	EMV_TXN_JOURNAL_ERROR_INVALID_PARAMETER = -1, ///< Invalid function parameter
+	EMV_TXN_JOURNAL_ERROR_IO = -2, ///< File or memory mapping error
+	EMV_TXN_JOURNAL_ERROR_INVALID_FILE = -3, ///< File is not a valid journal or has an incompatible layout
+	EMV_TXN_JOURNAL_ERROR_UNSUPPORTED = -4, ///< Journal not supported by this platform
+};
+
+/**
+ * Open transaction journal. The file is created if it does not exist.
+ *
+ * @param filename Journal filename
+ * @param group_commit Number of appended records after which they are
+ *                     committed. Zero to only commit records when
+ *                     @ref emv_txn_journal_commit() is used.
+ * @param journal Transaction journal output. Use
+ *                @ref emv_txn_journal_close() to close it.
+ *
+ * @return Zero for success. Less than zero for error.
+ *         See @ref emv_txn_journal_error_t
+ */
+int emv_txn_journal_open(
+	const char* filename,
+	size_t group_commit,
+	struct emv_txn_journal_t** journal
+);
+
+/**
+ * Commit appended records and close transaction journal
+ *
+ * @param journal Transaction journal
+ *
+ * @return Zero for success. Less than zero for error.
+ *         See @ref emv_txn_journal_error_t
+ */
+int emv_txn_journal_close(struct emv_txn_journal_t* journal);
+
+/**
+ * Append record to transaction journal. The record is only durable after it
+ * is committed.
+ *
+ * @param journal Transaction journal
+ * @param entry Transaction log entry
+ *
+ * @return Zero for success. Less than zero for error.
+ *         See @ref emv_txn_journal_error_t
+ */
+int emv_txn_journal_append(
+	struct emv_txn_journal_t* journal,
+	const struct emv_txn_log_entry_t* entry
+);
+
+/**
+ * Commit appended records such that they are durable
+ *
+ * @param journal Transaction journal
+ *
+ * @return Zero for success. Less than zero for error.
+ *         See @ref emv_txn_journal_error_t
+ */
+int emv_txn_journal_commit(struct emv_txn_journal_t* journal);
+
+/**
+ * Retrieve number of records in transaction journal, including appended
+ * records that are not yet committed
+ *
+ * @param journal Transaction journal
+ * @return Number of records
+ */
+size_t emv_txn_journal_count(const struct emv_txn_journal_t* journal);
+
+/**
+ * Retrieve records of transaction journal, including appended records that are
+ * not yet committed, in the order in which they were appended. The records
+ * are suitable for @ref emv_terminal_risk_management().
+ *
+ * @param journal Transaction journal
+ * @return Records. The records remain valid until the next record is
+ *         appended or the journal is closed. NULL if empty.
+ */
+const struct emv_txn_log_entry_t* emv_txn_journal_entries(
+	const struct emv_txn_journal_t* journal
+);
+
+/**
+ * Rebuild indexed transaction log from the latest records of the transaction
+ * journal. Only the latest records that fit in the transaction log are added
+ * and therefore the time needed does not depend on the size of the journal.
+ * The transaction log is suitable for
+ * @ref emv_terminal_risk_management_with_txn_log().
+ *
+ * @param journal Transaction journal
+ * @param log Empty transaction log. See @ref emv_txn_log_create().
+ *
+ * @return Zero for success. Less than zero for error.
+ *         See @ref emv_txn_journal_error_t
+ */
+int emv_txn_journal_build_txn_log(
+	const struct emv_txn_journal_t* journal,
+	struct emv_txn_log_t* log
+);
+
+__END_DECLS
+
+#endif
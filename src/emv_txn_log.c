@@ -0,0 +1,364 @@
+/**
+ * @file emv_txn_log.c
+ * @brief Indexed transaction log for terminal risk management
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_txn_log.h"
+#include "emv.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h> // For malloc() and free()
+#include <string.h>
+
+#define EMV_TXN_LOG_PAN_LEN (sizeof(((struct emv_txn_log_entry_t*)0)->pan))
+#define EMV_TXN_LOG_BUCKET_EMPTY (SIZE_MAX)
+
+struct emv_txn_log_t {
+	size_t max_entries;
+	unsigned int max_age;
+
+	// Entries are stored in a ring starting with the oldest entry
+	struct emv_txn_log_entry_t* entry;
+	size_t first;
+	size_t count;
+
+	// Open addressing hash table, using linear probing, of which each bucket
+	// is either empty or the index of the latest entry of a PAN
+	size_t* bucket;
+	size_t bucket_mask;
+};
+
+static inline unsigned int emv_txn_log_format_n_to_uint(uint8_t x)
+{
+	return (x >> 4) * 10 + (x & 0xF);
+}
+
+static bool emv_txn_log_date_to_days(const uint8_t* date, long* days)
+{
+	unsigned int year;
+	unsigned int month;
+	unsigned int day;
+	unsigned int era_year;
+	unsigned int day_of_year;
+
+	if ((date[0] >> 4) > 9 || (date[0] & 0xF) > 9 ||
+		(date[1] >> 4) > 9 || (date[1] & 0xF) > 9 ||
+		(date[2] >> 4) > 9 || (date[2] & 0xF) > 9
+	) {
+		return false;
+	}
+	year = emv_txn_log_format_n_to_uint(date[0]);
+	month = emv_txn_log_format_n_to_uint(date[1]);
+	day = emv_txn_log_format_n_to_uint(date[2]);
+	if (month < 1 || month > 12 || day < 1 || day > 31) {
+		return false;
+	}
+
+	// See EMV 4.4 Book 4, 6.7.3
+	if (year < 50) {
+		year += 2000;
+	} else {
+		year += 1900;
+	}
+
+	// Count days since 1 March 1600 such that leap days are at the end of
+	// each year
+	if (month <= 2) {
+		year -= 1;
+		month += 9;
+	} else {
+		month -= 3;
+	}
+	era_year = year - 1600;
+	day_of_year = (153 * month + 2) / 5 + day - 1;
+	*days = (long)era_year * 365 + era_year / 4 - era_year / 100 + era_year / 400 + day_of_year;
+
+	return true;
+}
+
+// Normalise PAN in EMV format 'cn' such that all nibbles following the first
+// 'F' nibble are also 'F'. Returns false if the PAN contains non-decimal
+// digits or is not padded with 'F', such as when it is padded with zeros.
+static bool emv_txn_log_normalise_pan(
+	const uint8_t* pan,
+	size_t pan_len,
+	uint8_t* out
+)
+{
+	bool padding = false;
+
+	// PAN is at most 19 digits and therefore a normalised PAN always ends
+	// with at least one 'F' nibble
+	// See ISO/IEC 7812-1:2017, 4.4
+	for (size_t i = 0; i < EMV_TXN_LOG_PAN_LEN * 2; ++i) {
+		uint8_t digit = 0xF;
+
+		if (i / 2 < pan_len) {
+			digit = (pan[i / 2] >> ((i & 1) ? 0 : 4)) & 0xF;
+		}
+		if (digit == 0xF) {
+			padding = true;
+		} else if (padding) {
+			// Ignore anything following the padding
+			digit = 0xF;
+		} else if (digit > 9) {
+			return false;
+		}
+
+		if (i & 1) {
+			out[i / 2] |= digit;
+		} else {
+			out[i / 2] = digit << 4;
+		}
+	}
+
+	return padding && out[0] >> 4 != 0xF;
+}
+
+static inline size_t emv_txn_log_hash(const uint8_t* pan)
+{
+	uint32_t hash = 2166136261U;
+
+	// FNV-1a
+	for (size_t i = 0; i < EMV_TXN_LOG_PAN_LEN; ++i) {
+		hash ^= pan[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+// Find bucket of PAN or the empty bucket at which it would be inserted
+static size_t emv_txn_log_find_bucket(const struct emv_txn_log_t* log, const uint8_t* pan)
+{
+	size_t i = emv_txn_log_hash(pan) & log->bucket_mask;
+
+	while (log->bucket[i] != EMV_TXN_LOG_BUCKET_EMPTY &&
+		memcmp(log->entry[log->bucket[i]].pan, pan, EMV_TXN_LOG_PAN_LEN) != 0
+	) {
+		i = (i + 1) & log->bucket_mask;
+	}
+
+	return i;
+}
+
+static void emv_txn_log_remove_bucket(struct emv_txn_log_t* log, size_t i)
+{
+	size_t j = i;
+
+	// Move later buckets of the same probe sequence backwards such that no
+	// empty bucket is left between a bucket and its home bucket
+	while (true) {
+		size_t home;
+
+		log->bucket[i] = EMV_TXN_LOG_BUCKET_EMPTY;
+		do {
+			j = (j + 1) & log->bucket_mask;
+			if (log->bucket[j] == EMV_TXN_LOG_BUCKET_EMPTY) {
+				return;
+			}
+			home = emv_txn_log_hash(log->entry[log->bucket[j]].pan) & log->bucket_mask;
+		} while (((j - home) & log->bucket_mask) < ((j - i) & log->bucket_mask));
+
+		log->bucket[i] = log->bucket[j];
+		i = j;
+	}
+}
+
+static void emv_txn_log_evict_first(struct emv_txn_log_t* log)
+{
+	size_t i;
+
+	// Only remove the bucket of the PAN if the evicted entry is the latest
+	// entry of the PAN. Otherwise a newer entry of the PAN remains.
+	i = emv_txn_log_find_bucket(log, log->entry[log->first].pan);
+	if (log->bucket[i] == log->first) {
+		emv_txn_log_remove_bucket(log, i);
+	}
+
+	log->first = (log->first + 1) % log->max_entries;
+	--log->count;
+}
+
+struct emv_txn_log_t* emv_txn_log_create(size_t max_entries, unsigned int max_age)
+{
+	struct emv_txn_log_t* log;
+	size_t bucket_count;
+
+	if (!max_entries || max_entries > SIZE_MAX / 4 / sizeof(log->bucket[0])) {
+		return NULL;
+	}
+
+	// Use at least twice as many buckets as entries to limit probing
+	bucket_count = 1;
+	while (bucket_count < max_entries * 2) {
+		bucket_count <<= 1;
+	}
+
+	log = malloc(sizeof(*log));
+	if (!log) {
+		return NULL;
+	}
+	memset(log, 0, sizeof(*log));
+	log->max_entries = max_entries;
+	log->max_age = max_age;
+	log->bucket_mask = bucket_count - 1;
+
+	log->entry = malloc(max_entries * sizeof(log->entry[0]));
+	log->bucket = malloc(bucket_count * sizeof(log->bucket[0]));
+	if (!log->entry || !log->bucket) {
+		emv_txn_log_free(log);
+		return NULL;
+	}
+	for (size_t i = 0; i < bucket_count; ++i) {
+		log->bucket[i] = EMV_TXN_LOG_BUCKET_EMPTY;
+	}
+
+	return log;
+}
+
+void emv_txn_log_free(struct emv_txn_log_t* log)
+{
+	if (!log) {
+		return;
+	}
+
+	free(log->bucket);
+	free(log->entry);
+	free(log);
+}
+
+int emv_txn_log_add(
+	struct emv_txn_log_t* log,
+	const struct emv_txn_log_entry_t* entry
+)
+{
+	int r;
+	uint8_t pan[EMV_TXN_LOG_PAN_LEN];
+	size_t idx;
+	size_t i;
+
+	if (!log || !entry) {
+		return -1;
+	}
+
+	// Normalise the PAN padding such that the index agrees with a prefix
+	// comparison of the PAN provided by the card
+	if (!emv_txn_log_normalise_pan(entry->pan, sizeof(entry->pan), pan)) {
+		return -3;
+	}
+
+	r = emv_txn_log_evict(log, entry->txn_date);
+	if (r < 0) {
+		return r;
+	}
+	if (log->count == log->max_entries) {
+		emv_txn_log_evict_first(log);
+	}
+
+	idx = (log->first + log->count) % log->max_entries;
+	log->entry[idx] = *entry;
+	memcpy(log->entry[idx].pan, pan, sizeof(pan));
+	++log->count;
+
+	// The new entry is the latest entry of the PAN
+	i = emv_txn_log_find_bucket(log, pan);
+	log->bucket[i] = idx;
+
+	return 0;
+}
+
+int emv_txn_log_evict(struct emv_txn_log_t* log, const uint8_t* txn_date)
+{
+	long days;
+	int count = 0;
+
+	if (!log || !txn_date) {
+		return -1;
+	}
+	if (!emv_txn_log_date_to_days(txn_date, &days)) {
+		return -2;
+	}
+	if (!log->max_age) {
+		return 0;
+	}
+
+	// Entries are expected to be ordered by date and therefore eviction
+	// stops at the first entry that is not too old
+	while (log->count) {
+		long entry_days;
+
+		if (emv_txn_log_date_to_days(log->entry[log->first].txn_date, &entry_days) &&
+			days - entry_days <= (long)log->max_age
+		) {
+			break;
+		}
+
+		emv_txn_log_evict_first(log);
+		++count;
+	}
+
+	return count;
+}
+
+size_t emv_txn_log_count(const struct emv_txn_log_t* log)
+{
+	if (!log) {
+		return 0;
+	}
+
+	return log->count;
+}
+
+size_t emv_txn_log_max_entries(const struct emv_txn_log_t* log)
+{
+	if (!log) {
+		return 0;
+	}
+
+	return log->max_entries;
+}
+
+const struct emv_txn_log_entry_t* emv_txn_log_find_latest(
+	const struct emv_txn_log_t* log,
+	const uint8_t* pan,
+	size_t pan_len
+)
+{
+	uint8_t key[EMV_TXN_LOG_PAN_LEN];
+	size_t i;
+
+	if (!log || !pan || !pan_len || pan_len > sizeof(key)) {
+		return NULL;
+	}
+
+	// Pad the PAN as required by EMV format 'cn' such that it can be
+	// compared to the normalised PAN of the entries
+	if (!emv_txn_log_normalise_pan(pan, pan_len, key)) {
+		return NULL;
+	}
+
+	i = emv_txn_log_find_bucket(log, key);
+	if (log->bucket[i] == EMV_TXN_LOG_BUCKET_EMPTY) {
+		return NULL;
+	}
+
+	return &log->entry[log->bucket[i]];
+}
@@ -0,0 +1,131 @@
+/**
+ * @file emv_txn_log.h
+ * @brief Indexed transaction log for terminal risk management
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EMV_TXN_LOG_H
+#define EMV_TXN_LOG_H
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+#include <stdint.h>
+
+__BEGIN_DECLS
+
+// Forward declarations
+struct emv_txn_log_entry_t;
+
+/**
+ * Transaction log of previously approved transactions
+ *
+ * The entries are retained in the order in which they were added, using a
+ * fixed number of entries that is specified when the transaction log is
+ * created, and the oldest entry is evicted when a new entry is added to a full
+ * transaction log. Entries may also be evicted when they are older than the
+ * maximum age that is specified when the transaction log is created.
+ *
+ * The entries are indexed by Primary Account Number (PAN) such that the
+ * latest entry for a PAN is found without comparing the other entries.
+ *
+ * The transaction log is not synchronised. It may be used by multiple threads
+ * to find entries, but it must not be modified at the same time.
+ */
+struct emv_txn_log_t;
+
+/**
+ * Create transaction log
+ *
+ * @param max_entries Maximum number of entries. Must be non-zero.
+ * @param max_age Maximum age of entries in days, relative to the Transaction
+ *                Date of the latest entry or the date provided to
+ *                @ref emv_txn_log_evict(). Zero for no maximum age.
+ * @return Transaction log. Use @ref emv_txn_log_free() to free it. NULL for
+ *         error.
+ */
+struct emv_txn_log_t* emv_txn_log_create(size_t max_entries, unsigned int max_age);
+
+/**
+ * Free transaction log
+ * @param log Transaction log
+ */
+void emv_txn_log_free(struct emv_txn_log_t* log);
+
+/**
+ * Add entry to transaction log. Entries should be added in the order of
+ * their Transaction Dates. If the transaction log is full, the oldest entry is
+ * evicted. If the transaction log has a maximum age, entries that are older
+ * than the maximum age relative to the Transaction Date of the new entry are
+ * also evicted.
+ *
+ * @param log Transaction log
+ * @param entry Transaction log entry. The PAN must be padded with 'F' as
+ *              required by EMV format 'cn'. Anything following the first
+ *              'F' nibble is ignored.
+ * @return Zero for success. Less than zero for error, including a PAN that
+ *         is not padded with 'F'.
+ */
+int emv_txn_log_add(
+	struct emv_txn_log_t* log,
+	const struct emv_txn_log_entry_t* entry
+);
+
+/**
+ * Evict entries that are older than the maximum age of the transaction log,
+ * relative to the provided date
+ *
+ * @param log Transaction log
+ * @param txn_date Transaction date in EMV format 'n' as YYMMDD. Must be 3 bytes.
+ * @return Number of evicted entries. Less than zero for error.
+ */
+int emv_txn_log_evict(struct emv_txn_log_t* log, const uint8_t* txn_date);
+
+/**
+ * Retrieve number of entries in transaction log
+ * @param log Transaction log
+ * @return Number of entries
+ */
+size_t emv_txn_log_count(const struct emv_txn_log_t* log);
+
+/**
+ * Retrieve maximum number of entries in transaction log
+ * @param log Transaction log
+ * @return Maximum number of entries
+ */
+size_t emv_txn_log_max_entries(const struct emv_txn_log_t* log);
+
+/**
+ * Find latest entry for Primary Account Number (PAN). The Application PAN
+ * Sequence Number is not compared.
+ *
+ * @param log Transaction log
+ * @param pan Application Primary Account Number (PAN) in EMV format 'cn'.
+ *            See @ref EMV_TAG_5A_APPLICATION_PAN.
+ * @param pan_len Length of PAN in bytes. Must be 1 to 10 bytes.
+ * @return Transaction log entry. The entry remains valid until the
+ *         transaction log is modified. NULL if not found.
+ */
+const struct emv_txn_log_entry_t* emv_txn_log_find_latest(
+	const struct emv_txn_log_t* log,
+	const uint8_t* pan,
+	size_t pan_len
+);
+
+__END_DECLS
+
+#endif
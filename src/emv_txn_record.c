@@ -0,0 +1,334 @@
+/**
+ * @file emv_txn_record.c
+ * @brief Compact binary record of EMV transaction data
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_txn_record.h"
+#include "emv_tlv.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h> // For malloc(), free() and qsort()
+#include <string.h>
+
+static const uint8_t emv_txn_record_magic[] = { 'E', 'M', 'V', 'R' };
+
+// Field to encode while the directory is sorted
+struct emv_txn_record_field_t {
+	const struct emv_tlv_t* tlv;
+	unsigned int source;
+	size_t seq; // Order within source to sort duplicate fields stably
+};
+
+static inline uint32_t emv_txn_record_get_u32(const uint8_t* ptr)
+{
+	return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+static inline uint16_t emv_txn_record_get_u16(const uint8_t* ptr)
+{
+	return ptr[0] | (ptr[1] << 8);
+}
+
+static inline void emv_txn_record_put_u32(uint8_t* ptr, uint32_t x)
+{
+	ptr[0] = x;
+	ptr[1] = x >> 8;
+	ptr[2] = x >> 16;
+	ptr[3] = x >> 24;
+}
+
+static inline void emv_txn_record_put_u16(uint8_t* ptr, uint16_t x)
+{
+	ptr[0] = x;
+	ptr[1] = x >> 8;
+}
+
+static int emv_txn_record_field_compare(const void* a, const void* b)
+{
+	const struct emv_txn_record_field_t* field_a = a;
+	const struct emv_txn_record_field_t* field_b = b;
+
+	if (field_a->tlv->tag != field_b->tlv->tag) {
+		return field_a->tlv->tag < field_b->tlv->tag ? -1 : 1;
+	}
+	if (field_a->source != field_b->source) {
+		return field_a->source < field_b->source ? -1 : 1;
+	}
+	if (field_a->seq != field_b->seq) {
+		return field_a->seq < field_b->seq ? -1 : 1;
+	}
+	return 0;
+}
+
+int emv_txn_record_encode(
+	const struct emv_tlv_sources_t* sources,
+	void* buf,
+	size_t* len
+)
+{
+	size_t count = 0;
+	size_t blob_len = 0;
+	size_t record_len;
+	struct emv_txn_record_field_t* fields = NULL;
+	uint8_t* ptr = buf;
+	uint8_t* dir;
+	uint8_t* blob;
+
+	if (!sources || !len || sources->count > sizeof(sources->list) / sizeof(sources->list[0])) {
+		return -1;
+	}
+
+	for (unsigned int i = 0; i < sources->count; ++i) {
+		const struct emv_tlv_t* tlv;
+
+		if (!sources->list[i]) {
+			continue;
+		}
+		for (tlv = sources->list[i]->front; tlv != NULL; tlv = tlv->next) {
+			if (tlv->length > UINT16_MAX) {
+				// Field too long for directory entry
+				return 1;
+			}
+			++count;
+			blob_len += tlv->length;
+		}
+	}
+	if (count > UINT32_MAX || blob_len > UINT32_MAX) {
+		return 1;
+	}
+
+	record_len = EMV_TXN_RECORD_HEADER_SIZE + count * EMV_TXN_RECORD_ENTRY_SIZE + blob_len;
+	if (!buf) {
+		*len = record_len;
+		return 0;
+	}
+	if (*len < record_len) {
+		*len = record_len;
+		return 1;
+	}
+
+	// Sort fields by tag and then by source
+	fields = malloc(count * sizeof(fields[0]) + 1);
+	if (!fields) {
+		return -2;
+	}
+	count = 0;
+	for (unsigned int i = 0; i < sources->count; ++i) {
+		const struct emv_tlv_t* tlv;
+		size_t seq = 0;
+
+		if (!sources->list[i]) {
+			continue;
+		}
+		for (tlv = sources->list[i]->front; tlv != NULL; tlv = tlv->next) {
+			fields[count].tlv = tlv;
+			fields[count].source = i;
+			fields[count].seq = seq++;
+			++count;
+		}
+	}
+	qsort(fields, count, sizeof(fields[0]), &emv_txn_record_field_compare);
+
+	memcpy(ptr, emv_txn_record_magic, sizeof(emv_txn_record_magic));
+	ptr[4] = EMV_TXN_RECORD_VERSION;
+	ptr[5] = sources->count;
+	emv_txn_record_put_u16(ptr + 6, 0);
+	emv_txn_record_put_u32(ptr + 8, count);
+	emv_txn_record_put_u32(ptr + 12, blob_len);
+
+	// Values are stored in directory order such that consecutive lookups of
+	// nearby tags access nearby values
+	dir = ptr + EMV_TXN_RECORD_HEADER_SIZE;
+	blob = dir + count * EMV_TXN_RECORD_ENTRY_SIZE;
+	blob_len = 0;
+	for (size_t i = 0; i < count; ++i) {
+		const struct emv_tlv_t* tlv = fields[i].tlv;
+		uint8_t* entry = dir + i * EMV_TXN_RECORD_ENTRY_SIZE;
+
+		emv_txn_record_put_u32(entry, tlv->tag);
+		emv_txn_record_put_u32(entry + 4, blob_len);
+		emv_txn_record_put_u16(entry + 8, tlv->length);
+		entry[10] = fields[i].source;
+		entry[11] = tlv->flags;
+
+		if (tlv->length) {
+			memcpy(blob + blob_len, tlv->value, tlv->length);
+			blob_len += tlv->length;
+		}
+	}
+	*len = record_len;
+	free(fields);
+
+	return 0;
+}
+
+int emv_txn_record_init(
+	const void* ptr,
+	size_t len,
+	struct emv_txn_record_t* record
+)
+{
+	const uint8_t* buf = ptr;
+	size_t count;
+	size_t blob_len;
+	unsigned int source_count;
+
+	if (!ptr || !record) {
+		return -1;
+	}
+	memset(record, 0, sizeof(*record));
+
+	if (len < EMV_TXN_RECORD_HEADER_SIZE ||
+		memcmp(buf, emv_txn_record_magic, sizeof(emv_txn_record_magic)) != 0 ||
+		buf[4] != EMV_TXN_RECORD_VERSION
+	) {
+		return 1;
+	}
+	source_count = buf[5];
+	count = emv_txn_record_get_u32(buf + 8);
+	blob_len = emv_txn_record_get_u32(buf + 12);
+	if (count > (len - EMV_TXN_RECORD_HEADER_SIZE) / EMV_TXN_RECORD_ENTRY_SIZE ||
+		blob_len > len - EMV_TXN_RECORD_HEADER_SIZE - count * EMV_TXN_RECORD_ENTRY_SIZE
+	) {
+		return 2;
+	}
+
+	// Validate directory such that lookups need not validate entries
+	for (size_t i = 0; i < count; ++i) {
+		const uint8_t* entry = buf + EMV_TXN_RECORD_HEADER_SIZE + i * EMV_TXN_RECORD_ENTRY_SIZE;
+		uint32_t offset = emv_txn_record_get_u32(entry + 4);
+		uint16_t length = emv_txn_record_get_u16(entry + 8);
+
+		if (offset > blob_len || length > blob_len - offset ||
+			entry[10] >= source_count
+		) {
+			return 3;
+		}
+
+		if (i) {
+			const uint8_t* prev = entry - EMV_TXN_RECORD_ENTRY_SIZE;
+			uint32_t tag = emv_txn_record_get_u32(entry);
+			uint32_t prev_tag = emv_txn_record_get_u32(prev);
+
+			if (tag < prev_tag || (tag == prev_tag && entry[10] < prev[10])) {
+				// Directory is not sorted
+				return 4;
+			}
+		}
+	}
+
+	record->dir = buf + EMV_TXN_RECORD_HEADER_SIZE;
+	record->blob = record->dir + count * EMV_TXN_RECORD_ENTRY_SIZE;
+	record->count = count;
+	record->blob_len = blob_len;
+	record->source_count = source_count;
+
+	return 0;
+}
+
+size_t emv_txn_record_get_length(const struct emv_txn_record_t* record)
+{
+	if (!record || !record->dir) {
+		return 0;
+	}
+
+	return EMV_TXN_RECORD_HEADER_SIZE + record->count * EMV_TXN_RECORD_ENTRY_SIZE + record->blob_len;
+}
+
+size_t emv_txn_record_get_count(const struct emv_txn_record_t* record)
+{
+	if (!record) {
+		return 0;
+	}
+
+	return record->count;
+}
+
+unsigned int emv_txn_record_get_source_count(const struct emv_txn_record_t* record)
+{
+	if (!record) {
+		return 0;
+	}
+
+	return record->source_count;
+}
+
+int emv_txn_record_get_field(
+	const struct emv_txn_record_t* record,
+	size_t index,
+	unsigned int* source,
+	struct emv_tlv_t* tlv
+)
+{
+	const uint8_t* entry;
+
+	if (!record || !tlv || index >= record->count) {
+		return -1;
+	}
+
+	entry = record->dir + index * EMV_TXN_RECORD_ENTRY_SIZE;
+	memset(tlv, 0, sizeof(*tlv));
+	tlv->tag = emv_txn_record_get_u32(entry);
+	tlv->length = emv_txn_record_get_u16(entry + 8);
+	tlv->value = (uint8_t*)record->blob + emv_txn_record_get_u32(entry + 4);
+	tlv->flags = entry[11];
+	if (source) {
+		*source = entry[10];
+	}
+
+	return 0;
+}
+
+int emv_txn_record_find(
+	const struct emv_txn_record_t* record,
+	unsigned int tag,
+	unsigned int* source,
+	struct emv_tlv_t* tlv
+)
+{
+	size_t lo;
+	size_t hi;
+
+	if (!record || !tlv) {
+		return -1;
+	}
+
+	// Find first entry with tag such that the source with the highest
+	// precedence is found
+	lo = 0;
+	hi = record->count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (emv_txn_record_get_u32(record->dir + mid * EMV_TXN_RECORD_ENTRY_SIZE) < tag) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == record->count ||
+		emv_txn_record_get_u32(record->dir + lo * EMV_TXN_RECORD_ENTRY_SIZE) != tag
+	) {
+		// Not found
+		return 1;
+	}
+
+	return emv_txn_record_get_field(record, lo, source, tlv);
+}
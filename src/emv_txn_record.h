@@ -0,0 +1,184 @@
+/**
+ * @file emv_txn_record.h
+ * @brief Compact binary record of EMV transaction data
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EMV_TXN_RECORD_H
+#define EMV_TXN_RECORD_H
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+#include <stdint.h>
+
+__BEGIN_DECLS
+
+// Forward declarations
+struct emv_tlv_t;
+struct emv_tlv_sources_t;
+
+/**
+ * @name EMV transaction record format
+ *
+ * An EMV transaction record consists of a header, a directory of fields and a
+ * blob of field values. All integers are little endian.
+ *
+ * The header consists of:
+ * - Magic "EMVR" (4 bytes)
+ * - Version (1 byte)
+ * - Number of sources (1 byte)
+ * - Reserved (2 bytes)
+ * - Number of directory entries (4 bytes)
+ * - Length of value blob (4 bytes)
+ *
+ * Each directory entry consists of:
+ * - EMV tag (4 bytes)
+ * - Offset of value in value blob (4 bytes)
+ * - Length of value (2 bytes)
+ * - Index of source (1 byte)
+ * - EMV field specific flags (1 byte)
+ *
+ * The directory is sorted by tag and then by source such that a field is
+ * found using a binary search and such that the first field with a tag is
+ * the field of the source with the highest precedence.
+ * @{
+ */
+#define EMV_TXN_RECORD_VERSION (1) ///< EMV transaction record format version
+#define EMV_TXN_RECORD_HEADER_SIZE (16) ///< Size of EMV transaction record header
+#define EMV_TXN_RECORD_ENTRY_SIZE (12) ///< Size of EMV transaction record directory entry
+/// @}
+
+/**
+ * EMV transaction record reader
+ * @note The reader refers to the record and does not copy it
+ */
+struct emv_txn_record_t {
+	/// @cond INTERNAL
+	const uint8_t* dir;
+	const uint8_t* blob;
+	size_t count;
+	size_t blob_len;
+	unsigned int source_count;
+	/// @endcond
+};
+
+/**
+ * Encode EMV transaction record from EMV TLV sources. Use
+ * @ref emv_tlv_sources_init_from_ctx() to encode the EMV processing context
+ * with the same precedence as it is used during processing.
+ *
+ * @param sources EMV TLV sources. The index of each source list is the
+ *                source index in the record.
+ * @param buf Output buffer. NULL to only determine the length.
+ * @param len Length of output buffer in bytes. Length of record in bytes on
+ *            output.
+ *
+ * @return Zero for success.
+ * @return Less than zero for error.
+ * @return Greater than zero if output buffer is too small or if a field
+ *         cannot be encoded.
+ */
+int emv_txn_record_encode(
+	const struct emv_tlv_sources_t* sources,
+	void* buf,
+	size_t* len
+);
+
+/**
+ * Initialise EMV transaction record reader. The header and directory are
+ * validated such that fields can be accessed without further validation.
+ *
+ * @param ptr EMV transaction record
+ * @param len Length of buffer in bytes. May be more than the length of the
+ *            record such that consecutive records can be read.
+ * @param record EMV transaction record reader output
+ *
+ * @return Zero for success.
+ * @return Less than zero for error.
+ * @return Greater than zero for invalid record.
+ */
+int emv_txn_record_init(
+	const void* ptr,
+	size_t len,
+	struct emv_txn_record_t* record
+);
+
+/**
+ * Retrieve length of EMV transaction record in bytes
+ * @param record EMV transaction record reader
+ * @return Length of record in bytes
+ */
+size_t emv_txn_record_get_length(const struct emv_txn_record_t* record);
+
+/**
+ * Retrieve number of fields in EMV transaction record
+ * @param record EMV transaction record reader
+ * @return Number of fields
+ */
+size_t emv_txn_record_get_count(const struct emv_txn_record_t* record);
+
+/**
+ * Retrieve number of sources in EMV transaction record
+ * @param record EMV transaction record reader
+ * @return Number of sources
+ */
+unsigned int emv_txn_record_get_source_count(const struct emv_txn_record_t* record);
+
+/**
+ * Retrieve field of EMV transaction record by directory index. Fields are
+ * ordered by tag and then by source.
+ *
+ * @param record EMV transaction record reader
+ * @param index Directory index
+ * @param source Index of source output. NULL to ignore.
+ * @param tlv EMV TLV field output. The value refers to the record and the
+ *            field is not part of any list.
+ *
+ * @return Zero for success. Less than zero for error.
+ */
+int emv_txn_record_get_field(
+	const struct emv_txn_record_t* record,
+	size_t index,
+	unsigned int* source,
+	struct emv_tlv_t* tlv
+);
+
+/**
+ * Find field of EMV transaction record. If multiple sources provide the
+ * field, the field of the source with the highest precedence is found.
+ *
+ * @param record EMV transaction record reader
+ * @param tag EMV tag to find
+ * @param source Index of source output. NULL to ignore.
+ * @param tlv EMV TLV field output. The value refers to the record and the
+ *            field is not part of any list.
+ *
+ * @return Zero if found.
+ * @return Less than zero for error.
+ * @return Greater than zero if not found.
+ */
+int emv_txn_record_find(
+	const struct emv_txn_record_t* record,
+	unsigned int tag,
+	unsigned int* source,
+	struct emv_tlv_t* tlv
+);
+
+__END_DECLS
+
+#endif
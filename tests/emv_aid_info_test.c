@@ -106,6 +106,39 @@ int main(void)
 		return 1;
 	}
 
+	// Test JCB
+	r = emv_aid_get_info((uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x65, 0x10, 0x10 }, 7, &info);
+	if (r) {
+		fprintf(stderr, "emv_aid_get_info() failed; r=%d\n", r);
+		return 1;
+	}
+	if (info.scheme != EMV_CARD_SCHEME_JCB || info.product != EMV_CARD_PRODUCT_UNKNOWN) {
+		fprintf(stderr, "emv_aid_get_info() failed to identify scheme or product\n");
+		return 1;
+	}
+
+	// Test girocard
+	r = emv_aid_get_info((uint8_t[]){ 0xA0, 0x00, 0x00, 0x03, 0x59, 0x10, 0x10, 0x02, 0x80, 0x01 }, 10, &info);
+	if (r) {
+		fprintf(stderr, "emv_aid_get_info() failed; r=%d\n", r);
+		return 1;
+	}
+	if (info.scheme != EMV_CARD_SCHEME_DK || info.product != EMV_CARD_PRODUCT_DK_GIROCARD) {
+		fprintf(stderr, "emv_aid_get_info() failed to identify scheme or product\n");
+		return 1;
+	}
+
+	// Test truncated girocard AID
+	r = emv_aid_get_info((uint8_t[]){ 0xA0, 0x00, 0x00, 0x03, 0x59, 0x10, 0x10 }, 7, &info);
+	if (r) {
+		fprintf(stderr, "emv_aid_get_info() failed; r=%d\n", r);
+		return 1;
+	}
+	if (info.scheme != EMV_CARD_SCHEME_UNKNOWN || info.product != EMV_CARD_PRODUCT_UNKNOWN) {
+		fprintf(stderr, "emv_aid_get_info() failed to indicate that scheme and product are unknown\n");
+		return 1;
+	}
+
 	// Test unknown card scheme
 	r = emv_aid_get_info((uint8_t[]){ 0xA0, 0x00, 0x00, 0x99, 0x12, 0x23, 0x45 }, 7, &info);
 	if (r) {
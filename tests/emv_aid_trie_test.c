@@ -0,0 +1,244 @@
+/**
+ * @file emv_aid_trie_test.c
+ * @brief Unit tests for AID prefix trie
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_aid_trie.h"
+#include "emv_app.h"
+#include "emv_tlv.h"
+#include "emv_tags.h"
+#include "emv_fields.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RANDOM_AID_COUNT (300)
+#define RANDOM_APP_COUNT (5000)
+
+// Bytes from which random AIDs are composed such that many AIDs share
+// prefixes and many applications match
+static const uint8_t random_aid_bytes[] = { 0xA0, 0x00, 0x03, 0x10 };
+
+static void random_aid(uint8_t* aid, size_t* aid_len)
+{
+	*aid_len = 5 + rand() % 4;
+	for (size_t i = 0; i < *aid_len; ++i) {
+		aid[i] = random_aid_bytes[rand() % sizeof(random_aid_bytes)];
+	}
+}
+
+// Reference implementation of best match by comparing every supported AID
+static const struct emv_tlv_t* find_best_match(
+	const struct emv_tlv_list_t* supported_aids,
+	const uint8_t* aid,
+	size_t aid_len
+)
+{
+	const struct emv_tlv_t* match = NULL;
+
+	for (const struct emv_tlv_t* tlv = supported_aids->front; tlv != NULL; tlv = tlv->next) {
+		if (tlv->flags == EMV_ASI_EXACT_MATCH &&
+			tlv->length == aid_len &&
+			memcmp(tlv->value, aid, aid_len) == 0
+		) {
+			// First exact match is best
+			return tlv;
+		}
+
+		if (tlv->flags == EMV_ASI_PARTIAL_MATCH &&
+			tlv->length <= aid_len &&
+			memcmp(tlv->value, aid, tlv->length) == 0 &&
+			(!match || tlv->length > match->length)
+		) {
+			// First of the longest partial matches is best, unless an exact
+			// match is found later
+			match = tlv;
+		}
+	}
+
+	return match;
+}
+
+int main(void)
+{
+	int r;
+	struct emv_tlv_list_t supported_aids = EMV_TLV_LIST_INIT;
+	struct emv_aid_trie_t* trie = NULL;
+	const struct emv_tlv_t* visa;
+	const struct emv_tlv_t* visa_credit;
+	const struct emv_tlv_t* visa_electron;
+	const struct emv_tlv_t* visa_electron_partial;
+	const struct emv_tlv_t* tlv;
+	struct emv_tlv_t app_aid;
+	struct emv_app_t app;
+
+	// Test empty trie
+	trie = emv_aid_trie_create(NULL, 0);
+	if (!trie) {
+		fprintf(stderr, "emv_aid_trie_create() failed for empty trie\n");
+		r = 1;
+		goto exit;
+	}
+	if (emv_aid_trie_find(trie, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03 }, 5)) {
+		fprintf(stderr, "emv_aid_trie_find() unexpectedly found AID in empty trie\n");
+		r = 1;
+		goto exit;
+	}
+	emv_aid_trie_free(trie);
+	trie = NULL;
+
+	// Test invalid entry
+	trie = emv_aid_trie_create(
+		(struct emv_aid_trie_entry_t[]){
+			{ (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03 }, 5, 0x02, &supported_aids },
+		},
+		1
+	);
+	if (trie) {
+		fprintf(stderr, "emv_aid_trie_create() unexpectedly accepted invalid ASI\n");
+		r = 1;
+		goto exit;
+	}
+
+	// Populate supported AIDs
+	emv_tlv_list_push(&supported_aids, EMV_TAG_9F06_AID, 5, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03 }, EMV_ASI_PARTIAL_MATCH);
+	visa = supported_aids.back;
+	emv_tlv_list_push(&supported_aids, EMV_TAG_9F06_AID, 7, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10 }, EMV_ASI_PARTIAL_MATCH);
+	visa_credit = supported_aids.back;
+	emv_tlv_list_push(&supported_aids, EMV_TAG_9F06_AID, 7, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x10 }, EMV_ASI_EXACT_MATCH);
+	visa_electron = supported_aids.back;
+	emv_tlv_list_push(&supported_aids, EMV_TAG_9F06_AID, 7, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x10 }, EMV_ASI_PARTIAL_MATCH);
+	visa_electron_partial = supported_aids.back;
+	emv_tlv_list_push(&supported_aids, EMV_TAG_9F06_AID, 7, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x04, 0x10, 0x10 }, EMV_ASI_EXACT_MATCH);
+
+	trie = emv_aid_trie_create_from_list(&supported_aids);
+	if (!trie) {
+		fprintf(stderr, "emv_aid_trie_create_from_list() failed\n");
+		r = 1;
+		goto exit;
+	}
+
+	// Test longest partial match
+	tlv = emv_aid_trie_find(trie, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10, 0x01 }, 8);
+	if (tlv != visa_credit) {
+		fprintf(stderr, "emv_aid_trie_find() failed to find longest partial match\n");
+		r = 1;
+		goto exit;
+	}
+	tlv = emv_aid_trie_find(trie, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x80, 0x10 }, 7);
+	if (tlv != visa) {
+		fprintf(stderr, "emv_aid_trie_find() failed to find shorter partial match\n");
+		r = 1;
+		goto exit;
+	}
+
+	// Test that exact match is preferred over partial match
+	tlv = emv_aid_trie_find(trie, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x10 }, 7);
+	if (tlv != visa_electron) {
+		fprintf(stderr, "emv_aid_trie_find() failed to prefer exact match\n");
+		r = 1;
+		goto exit;
+	}
+	tlv = emv_aid_trie_find(trie, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x10, 0x01 }, 8);
+	if (tlv != visa_electron_partial) {
+		fprintf(stderr, "emv_aid_trie_find() failed to find partial match of exact match AID\n");
+		r = 1;
+		goto exit;
+	}
+
+	// Test that exact match is required
+	tlv = emv_aid_trie_find(trie, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x04, 0x10, 0x10, 0x01 }, 8);
+	if (tlv) {
+		fprintf(stderr, "emv_aid_trie_find() unexpectedly found partial match of exact match AID\n");
+		r = 1;
+		goto exit;
+	}
+	tlv = emv_aid_trie_find(trie, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x04 }, 5);
+	if (tlv) {
+		fprintf(stderr, "emv_aid_trie_find() unexpectedly found match of AID prefix\n");
+		r = 1;
+		goto exit;
+	}
+
+	emv_aid_trie_free(trie);
+	trie = NULL;
+	emv_tlv_list_clear(&supported_aids);
+
+	// Test random supported AIDs against reference implementation
+	srand(1);
+	for (unsigned int i = 0; i < RANDOM_AID_COUNT; ++i) {
+		uint8_t aid[16];
+		size_t aid_len;
+
+		random_aid(aid, &aid_len);
+		emv_tlv_list_push(
+			&supported_aids,
+			EMV_TAG_9F06_AID,
+			aid_len,
+			aid,
+			rand() % 2 ? EMV_ASI_PARTIAL_MATCH : EMV_ASI_EXACT_MATCH
+		);
+	}
+	trie = emv_aid_trie_create_from_list(&supported_aids);
+	if (!trie) {
+		fprintf(stderr, "emv_aid_trie_create_from_list() failed\n");
+		r = 1;
+		goto exit;
+	}
+
+	memset(&app, 0, sizeof(app));
+	memset(&app_aid, 0, sizeof(app_aid));
+	app.aid = &app_aid;
+	for (unsigned int i = 0; i < RANDOM_APP_COUNT; ++i) {
+		uint8_t aid[16];
+		size_t aid_len;
+		const struct emv_tlv_t* expected;
+
+		random_aid(aid, &aid_len);
+		app_aid.tag = EMV_TAG_4F_APPLICATION_DF_NAME;
+		app_aid.length = aid_len;
+		app_aid.value = aid;
+
+		expected = find_best_match(&supported_aids, aid, aid_len);
+		tlv = emv_app_find_supported_aid(&app, trie);
+		if (tlv != expected) {
+			fprintf(stderr, "emv_app_find_supported_aid() found %p instead of %p\n", (const void*)tlv, (const void*)expected);
+			r = 1;
+			goto exit;
+		}
+		if (emv_app_is_supported(&app, &supported_aids) != (tlv != NULL)) {
+			fprintf(stderr, "emv_app_find_supported_aid() differs from emv_app_is_supported()\n");
+			r = 1;
+			goto exit;
+		}
+	}
+
+	printf("Success\n");
+	r = 0;
+	goto exit;
+
+exit:
+	emv_aid_trie_free(trie);
+	emv_tlv_list_clear(&supported_aids);
+
+	return r;
+}
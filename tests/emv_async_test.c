@@ -0,0 +1,438 @@
+/**
+ * @file emv_async_test.c
+ * @brief Unit tests for resumable EMV kernel sessions
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_async.h"
+#include "emv.h"
+#include "emv_icc_sim.h"
+#include "emv_app.h"
+#include "emv_ttl.h"
+#include "emv_tlv.h"
+#include "emv_tags.h"
+#include "emv_fields.h"
+#include "emv_rsa.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SESSION_COUNT (128)
+
+// Painted region below session stack used to detect stack overflow
+#define STACK_GUARD_SIZE (65536)
+#define STACK_PAINT (0xA5)
+
+struct test_session_t {
+	struct emv_icc_sim_t sim;
+	struct emv_ttl_t ttl;
+	struct emv_ctx_t emv;
+	struct emv_async_t async;
+	void* stack;
+	unsigned int exchanges;
+};
+
+static int test_session_init(
+	struct test_session_t* session,
+	enum emv_icc_sim_oda_t oda,
+	void* stack,
+	size_t stack_size
+)
+{
+	int r;
+	struct emv_icc_sim_config_t config;
+
+	memset(&session->ttl, 0, sizeof(session->ttl));
+	session->ttl.cardreader.mode = EMV_CARDREADER_MODE_APDU;
+	r = emv_ctx_init(&session->emv, &session->ttl);
+	if (r) {
+		fprintf(stderr, "emv_ctx_init() failed; r=%d\n", r);
+		return r;
+	}
+
+	emv_icc_sim_config_init(&config, oda);
+	r = emv_icc_sim_init(&session->sim, &config);
+	if (r) {
+		fprintf(stderr, "emv_icc_sim_init() failed; r=%d\n", r);
+		return r;
+	}
+	session->emv.capk_list = session->sim.capk;
+	session->emv.capk_count = session->sim.capk_count;
+
+	// Supported applications
+	emv_tlv_list_push(&session->emv.supported_aids, EMV_TAG_9F06_AID, 6, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10 }, EMV_ASI_PARTIAL_MATCH); // Visa
+
+	// Terminal configuration
+	emv_tlv_list_push(&session->emv.config, EMV_TAG_9F1A_TERMINAL_COUNTRY_CODE, 2, (uint8_t[]){ 0x05, 0x28 }, 0);
+	emv_tlv_list_push(&session->emv.config, EMV_TAG_9F33_TERMINAL_CAPABILITIES, 3, (uint8_t[]){ 0xE0, 0xF8, EMV_TERM_CAPS_SECURITY_SDA | EMV_TERM_CAPS_SECURITY_DDA | EMV_TERM_CAPS_SECURITY_CDA }, 0);
+	emv_tlv_list_push(&session->emv.config, EMV_TAG_9F49_DDOL, 3, (uint8_t[]){ 0x9F, 0x37, 0x04 }, 0);
+	emv_tlv_list_push(&session->emv.config, EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT, 4, (uint8_t[]){ 0x00, 0x00, 0x27, 0x10 }, 0);
+
+	// Transaction parameters
+	emv_tlv_list_push(&session->emv.params, EMV_TAG_9A_TRANSACTION_DATE, 3, (uint8_t[]){ 0x26, 0x10, 0x18 }, 0);
+	emv_tlv_list_push(&session->emv.params, EMV_TAG_9F21_TRANSACTION_TIME, 3, (uint8_t[]){ 0x12, 0x34, 0x56 }, 0);
+	emv_tlv_list_push(&session->emv.params, EMV_TAG_5F2A_TRANSACTION_CURRENCY_CODE, 2, (uint8_t[]){ 0x09, 0x78 }, 0);
+	emv_tlv_list_push(&session->emv.params, EMV_TAG_5F36_TRANSACTION_CURRENCY_EXPONENT, 1, (uint8_t[]){ 0x02 }, 0);
+	emv_tlv_list_push(&session->emv.params, EMV_TAG_9C_TRANSACTION_TYPE, 1, (uint8_t[]){ 0x00 }, 0);
+	emv_tlv_list_push(&session->emv.params, EMV_TAG_9F41_TRANSACTION_SEQUENCE_COUNTER, 4, (uint8_t[]){ 0x00, 0x00, 0x00, 0x01 }, 0);
+	emv_tlv_list_push(&session->emv.params, EMV_TAG_81_AMOUNT_AUTHORISED_BINARY, 4, (uint8_t[]){ 0x00, 0x00, 0x04, 0xD2 }, 0);
+	emv_tlv_list_push(&session->emv.params, EMV_TAG_9F02_AMOUNT_AUTHORISED_NUMERIC, 6, (uint8_t[]){ 0x00, 0x00, 0x00, 0x00, 0x12, 0x34 }, 0);
+
+	session->stack = stack;
+	r = emv_async_init(&session->async, &session->ttl, session->stack, stack_size);
+	if (r) {
+		fprintf(stderr, "emv_async_init() failed; r=%d\n", r);
+		return r;
+	}
+	session->exchanges = 0;
+
+	return 0;
+}
+
+static void test_session_clear(struct test_session_t* session)
+{
+	emv_async_clear(&session->async);
+	emv_ctx_clear(&session->emv);
+	session->stack = NULL;
+}
+
+static int test_txn(void* arg)
+{
+	int r;
+	struct test_session_t* session = arg;
+	struct emv_app_list_t app_list = EMV_APP_LIST_INIT;
+
+	r = emv_build_candidate_list(&session->emv, &app_list);
+	if (r) {
+		goto exit;
+	}
+	r = emv_select_application(&session->emv, &app_list, 0);
+	if (r) {
+		goto exit;
+	}
+	r = emv_initiate_application_processing(&session->emv, EMV_POS_ENTRY_MODE_ICC_WITH_CVV);
+	if (r) {
+		goto exit;
+	}
+	r = emv_read_application_data(&session->emv);
+	if (r) {
+		goto exit;
+	}
+	r = emv_offline_data_authentication(&session->emv);
+	if (r) {
+		goto exit;
+	}
+	r = emv_card_action_analysis(&session->emv);
+	if (r) {
+		goto exit;
+	}
+
+exit:
+	emv_app_list_clear(&app_list);
+	return r;
+}
+
+// Transmit pending C-APDU to virtual ICC and resume session with response
+static int test_session_exchange(struct test_session_t* session)
+{
+	int r;
+	uint8_t rx_buf[EMV_RAPDU_MAX];
+	size_t rx_buf_len = sizeof(rx_buf);
+
+	r = emv_icc_sim_trx(
+		&session->sim,
+		session->async.tx_buf,
+		session->async.tx_buf_len,
+		rx_buf,
+		&rx_buf_len
+	);
+	if (r) {
+		fprintf(stderr, "emv_icc_sim_trx() failed; r=%d\n", r);
+		return -1;
+	}
+	++session->exchanges;
+
+	return emv_async_resume(&session->async, rx_buf, rx_buf_len);
+}
+
+// Run complete transaction on a session stack of EMV_ASYNC_STACK_MIN bytes
+// and determine the stack usage using a painted stack and guard region
+static int test_stack_min(enum emv_icc_sim_oda_t oda, size_t* stack_used)
+{
+	int r;
+	uint8_t* buf;
+	uint8_t* stack;
+	struct test_session_t session;
+
+	buf = malloc(STACK_GUARD_SIZE + EMV_ASYNC_STACK_MIN);
+	if (!buf) {
+		fprintf(stderr, "malloc() failed\n");
+		return -1;
+	}
+	memset(buf, STACK_PAINT, STACK_GUARD_SIZE + EMV_ASYNC_STACK_MIN);
+	stack = buf + STACK_GUARD_SIZE;
+
+	memset(&session, 0, sizeof(session));
+	r = test_session_init(&session, oda, stack, EMV_ASYNC_STACK_MIN);
+	if (r) {
+		fprintf(stderr, "test_session_init() failed; r=%d\n", r);
+		goto exit;
+	}
+
+	r = emv_async_start(&session.async, &test_txn, &session);
+	while (r == EMV_ASYNC_STATE_NEED_RESPONSE) {
+		r = test_session_exchange(&session);
+	}
+	if (r != EMV_ASYNC_STATE_DONE || session.async.result) {
+		fprintf(stderr, "Session failed; r=%d; result=%d\n", r, session.async.result);
+		r = -1;
+		goto exit;
+	}
+	if (session.emv.tvr->value[0] & (
+		EMV_TVR_OFFLINE_DATA_AUTH_NOT_PERFORMED |
+		EMV_TVR_SDA_FAILED |
+		EMV_TVR_DDA_FAILED |
+		EMV_TVR_CDA_FAILED
+	) && oda != EMV_ICC_SIM_ODA_NONE) {
+		fprintf(stderr, "Offline data authentication failed\n");
+		r = -1;
+		goto exit;
+	}
+
+	// The stack grows downwards on all supported platforms and therefore
+	// the lowest modified byte determines the stack usage
+	*stack_used = 0;
+	for (size_t i = 0; i < STACK_GUARD_SIZE + EMV_ASYNC_STACK_MIN; ++i) {
+		if (buf[i] != STACK_PAINT) {
+			*stack_used = STACK_GUARD_SIZE + EMV_ASYNC_STACK_MIN - i;
+			break;
+		}
+	}
+	if (*stack_used > EMV_ASYNC_STACK_MIN) {
+		fprintf(stderr, "Session stack overflow; stack_used=%zu\n", *stack_used);
+		r = -1;
+		goto exit;
+	}
+
+	r = 0;
+	goto exit;
+
+exit:
+	test_session_clear(&session);
+	free(buf);
+	return r;
+}
+
+int main(void)
+{
+	int r;
+	struct test_session_t* sessions = NULL;
+	void* stacks = NULL;
+	unsigned int pending;
+	unsigned int passes;
+	unsigned int max_pending;
+
+	if (!emv_async_is_supported()) {
+		printf("Resumable sessions not supported by this platform\n");
+		return 0;
+	}
+
+	printf("\nTesting offline data authentication on minimum session stack...\n");
+	for (unsigned int i = 0; i < 2; ++i) {
+		static const enum emv_rsa_backend_t backends[] = {
+			EMV_RSA_BACKEND_CRYPTO,
+			EMV_RSA_BACKEND_BUILTIN,
+		};
+		enum emv_rsa_backend_t default_backend = emv_rsa_get_backend();
+
+		emv_rsa_set_backend(backends[i]);
+		for (unsigned int oda = EMV_ICC_SIM_ODA_NONE; oda <= EMV_ICC_SIM_ODA_CDA; ++oda) {
+			size_t stack_used;
+
+			r = test_stack_min(oda, &stack_used);
+			if (r) {
+				fprintf(stderr, "test_stack_min() failed; backend=%u; oda=%u; r=%d\n", i, oda, r);
+				emv_rsa_set_backend(default_backend);
+				return 1;
+			}
+			printf("RSA backend %u, ODA %u: %zu of %u stack bytes used\n", i, oda, stack_used, EMV_ASYNC_STACK_MIN);
+		}
+		emv_rsa_set_backend(default_backend);
+	}
+	printf("Success\n");
+
+	sessions = calloc(SESSION_COUNT, sizeof(sessions[0]));
+	stacks = malloc(SESSION_COUNT * EMV_ASYNC_STACK_DEFAULT);
+	if (!sessions || !stacks) {
+		fprintf(stderr, "malloc() failed\n");
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 0; i < SESSION_COUNT; ++i) {
+		r = test_session_init(
+			&sessions[i],
+			i % 4,
+			(uint8_t*)stacks + (i * EMV_ASYNC_STACK_DEFAULT),
+			EMV_ASYNC_STACK_DEFAULT
+		);
+		if (r) {
+			fprintf(stderr, "test_session_init() failed; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+	}
+
+	printf("\nTesting invalid state...\n");
+	r = emv_async_resume(&sessions[0].async, (uint8_t[]){ 0x90, 0x00 }, 2);
+	if (r != EMV_ASYNC_ERROR_INVALID_STATE) {
+		fprintf(stderr, "emv_async_resume() did not return EMV_ASYNC_ERROR_INVALID_STATE; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting %u concurrent sessions driven by a single thread...\n", SESSION_COUNT);
+	for (unsigned int i = 0; i < SESSION_COUNT; ++i) {
+		r = emv_async_start(&sessions[i].async, &test_txn, &sessions[i]);
+		if (r != EMV_ASYNC_STATE_NEED_RESPONSE) {
+			fprintf(stderr, "emv_async_start() did not return EMV_ASYNC_STATE_NEED_RESPONSE; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+	}
+
+	// Round robin exchanges such that all sessions are interleaved
+	passes = 0;
+	max_pending = 0;
+	do {
+		pending = 0;
+		for (unsigned int i = 0; i < SESSION_COUNT; ++i) {
+			if (sessions[i].async.state != EMV_ASYNC_STATE_NEED_RESPONSE) {
+				continue;
+			}
+			++pending;
+
+			r = test_session_exchange(&sessions[i]);
+			if (r < 0) {
+				fprintf(stderr, "Session %u exchange failed; r=%d\n", i, r);
+				r = 1;
+				goto exit;
+			}
+		}
+		if (pending > max_pending) {
+			max_pending = pending;
+		}
+		++passes;
+	} while (pending);
+
+	if (max_pending != SESSION_COUNT) {
+		fprintf(stderr, "Sessions were not concurrent; max_pending=%u\n", max_pending);
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 0; i < SESSION_COUNT; ++i) {
+		const struct test_session_t* session = &sessions[i];
+
+		if (session->async.state != EMV_ASYNC_STATE_DONE) {
+			fprintf(stderr, "Session %u not done; state=%d\n", i, session->async.state);
+			r = 1;
+			goto exit;
+		}
+		if (session->async.result) {
+			fprintf(stderr, "Session %u failed; result=%d\n", i, session->async.result);
+			r = 1;
+			goto exit;
+		}
+		if (session->emv.tvr->value[0] & (
+			EMV_TVR_OFFLINE_DATA_AUTH_NOT_PERFORMED |
+			EMV_TVR_SDA_FAILED |
+			EMV_TVR_DDA_FAILED |
+			EMV_TVR_CDA_FAILED
+		) && i % 4 != EMV_ICC_SIM_ODA_NONE) {
+			fprintf(stderr, "Session %u offline data authentication failed\n", i);
+			r = 1;
+			goto exit;
+		}
+		if (!emv_tlv_list_find_const(&session->emv.icc, EMV_TAG_9F26_APPLICATION_CRYPTOGRAM)) {
+			fprintf(stderr, "Session %u has no application cryptogram\n", i);
+			r = 1;
+			goto exit;
+		}
+		if (session->exchanges != sessions[i % 4].exchanges) {
+			fprintf(stderr, "Session %u has unexpected number of exchanges %u\n", i, session->exchanges);
+			r = 1;
+			goto exit;
+		}
+	}
+	printf("%u passes\n", passes);
+	printf("Success\n");
+
+	printf("\nTesting cancellation of pending session...\n");
+	emv_icc_sim_reset(&sessions[1].sim);
+	r = emv_ctx_reset(&sessions[1].emv);
+	if (r) {
+		fprintf(stderr, "emv_ctx_reset() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_async_start(&sessions[1].async, &test_txn, &sessions[1]);
+	if (r != EMV_ASYNC_STATE_NEED_RESPONSE) {
+		fprintf(stderr, "emv_async_start() did not return EMV_ASYNC_STATE_NEED_RESPONSE; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 0; i < 3; ++i) {
+		r = test_session_exchange(&sessions[1]);
+		if (r != EMV_ASYNC_STATE_NEED_RESPONSE) {
+			fprintf(stderr, "Session exchange did not return EMV_ASYNC_STATE_NEED_RESPONSE; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+	}
+	r = emv_async_cancel(&sessions[1].async);
+	if (r) {
+		fprintf(stderr, "emv_async_cancel() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (sessions[1].async.state != EMV_ASYNC_STATE_DONE || !sessions[1].async.result) {
+		fprintf(stderr, "Cancelled session did not fail; state=%d; result=%d\n", sessions[1].async.state, sessions[1].async.result);
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	if (sessions) {
+		for (unsigned int i = 0; i < SESSION_COUNT; ++i) {
+			test_session_clear(&sessions[i]);
+		}
+		free(sessions);
+	}
+	free(stacks);
+
+	return r;
+}
@@ -0,0 +1,1023 @@
+/**
+ * @file emv_bench.c
+ * @brief EMV kernel benchmark suite
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv.h"
+#include "emv_icc_sim.h"
+#include "emv_cardreader_emul.h"
+#include "emv_metrics.h"
+#include "emv_ttl.h"
+#include "emv_tlv.h"
+#include "emv_dol.h"
+#include "emv_app.h"
+#include "emv_capk.h"
+#include "emv_rsa.h"
+#include "emv_oda.h"
+#include "emv_rand.h"
+#include "emv_strings.h"
+#include "emv_tags.h"
+#include "emv_fields.h"
+
+#include "crypto_rand.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DEFAULT_SAMPLES (200)
+#define BENCH_WARMUP_OPS (3)
+
+// Minimum duration of a single sample. Fast operations are repeated in
+// batches such that timer overhead does not dominate the measurement.
+#define BENCH_MIN_SAMPLE_NS (20000)
+#define BENCH_MAX_BATCH (100000)
+
+#ifdef HAVE___LIBC_MALLOC
+// Count heap allocations by interposing the C library allocator. This is only
+// used by the benchmark executable and does not affect the libraries.
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+// Worker threads of some scenarios also allocate and are counted as well
+static atomic_uint_fast64_t bench_alloc_count = 0;
+
+void* malloc(size_t size)
+{
+	atomic_fetch_add_explicit(&bench_alloc_count, 1, memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+	atomic_fetch_add_explicit(&bench_alloc_count, 1, memory_order_relaxed);
+	return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+	atomic_fetch_add_explicit(&bench_alloc_count, 1, memory_order_relaxed);
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+typedef int (*bench_func_t)(void* ctx);
+
+struct bench_t {
+	const char* name;
+	bench_func_t func;
+	void* ctx;
+};
+
+struct bench_result_t {
+	unsigned int samples;
+	uint64_t ops;
+	uint64_t total_ns;
+	uint64_t allocs;
+	unsigned int batch; // Operations per sample
+
+	// Distribution of the average time per operation of each sample
+	uint64_t sample_min_ns;
+	uint64_t sample_p50_ns;
+	uint64_t sample_p90_ns;
+	uint64_t sample_p99_ns;
+	uint64_t sample_max_ns;
+};
+
+enum bench_format_t {
+	BENCH_FORMAT_JSON,
+	BENCH_FORMAT_CSV,
+};
+
+// Transaction driven by virtual ICC
+struct bench_txn_t {
+	struct emv_ttl_t ttl;
+	struct emv_ttl_ext_t ttl_ext;
+	struct emv_ctx_t emv;
+	struct emv_dol_plan_cache_t dol_plan_cache;
+	struct emv_icc_sim_t sim;
+	struct emv_cardreader_emul_latency_ctx_t latency;
+};
+
+// Modelled card reader host round trip latency
+#define BENCH_RTT_LATENCY_US (50)
+
+// Transaction driven by card reader emulator
+struct bench_emul_t {
+	struct emv_cardreader_emul_ctx_t emul_ctx;
+	struct emv_ttl_t ttl;
+	struct emv_ctx_t emv;
+	struct emv_dol_plan_cache_t dol_plan_cache;
+};
+
+// RSA public key operation for a specific backend, modulus and exponent
+struct bench_rsa_t {
+	enum emv_rsa_backend_t backend;
+	bool precomputed;
+	size_t modulus_len;
+	uint8_t modulus[1984 / 8];
+	const uint8_t* exponent;
+	size_t exponent_len;
+	struct emv_rsa_key_t key;
+	uint8_t input[1984 / 8];
+};
+
+// Modulus lengths in bits of RSA public key operation benchmarks
+static const unsigned int bench_rsa_bits[] = { 1024, 1408, 1984 };
+#define BENCH_RSA_BITS_COUNT (sizeof(bench_rsa_bits) / sizeof(bench_rsa_bits[0]))
+
+static const uint8_t bench_rsa_exponent_3[] = { 0x03 };
+static const uint8_t bench_rsa_exponent_65537[] = { 0x01, 0x00, 0x01 };
+
+// Crypto backend, built-in backend and built-in backend with precomputed
+// key parameters for each exponent
+#define BENCH_RSA_VARIANT_COUNT (6)
+#define BENCH_RSA_COUNT (BENCH_RSA_BITS_COUNT * BENCH_RSA_VARIANT_COUNT)
+
+// Inputs for individual kernel functions
+struct bench_data_t {
+	struct bench_txn_t* sda;
+	struct bench_txn_t* cda;
+	struct emv_tlv_sources_t sources;
+	const struct emv_tlv_t* cdol1;
+	struct emv_dol_plan_cache_t dol_plan_cache;
+	const struct emv_capk_t* capk;
+	const struct emv_tlv_t* issuer_cert;
+	const struct emv_tlv_t* ssad;
+	const struct emv_tlv_t* icc_cert;
+	const struct emv_tlv_t* sdad;
+	const struct emv_tlv_t* un;
+	struct emv_oda_ctx_t sda_oda;
+	struct emv_oda_ctx_t cda_oda;
+	struct emv_rsa_issuer_pkey_t sda_issuer_pkey;
+	struct emv_rsa_issuer_pkey_t cda_issuer_pkey;
+	struct emv_rsa_icc_pkey_t icc_pkey;
+};
+
+static const uint8_t test_gpo_response[] = {
+	0x77, 0x12, 0x82, 0x02, 0x39, 0x00, 0x94, 0x0C, 0x08, 0x01, 0x01, 0x00,
+	0x10, 0x01, 0x03, 0x01, 0x18, 0x01, 0x02, 0x00,
+};
+
+static int bench_ctx_init(
+	struct emv_ctx_t* emv,
+	struct emv_ttl_t* ttl,
+	struct emv_dol_plan_cache_t* dol_plan_cache
+)
+{
+	int r;
+
+	r = emv_ctx_init(emv, ttl);
+	if (r) {
+		return r;
+	}
+
+	// Reuse DOL plans across transactions
+	memset(dol_plan_cache, 0, sizeof(*dol_plan_cache));
+	emv->dol_plan_cache = dol_plan_cache;
+
+	// Supported applications
+	emv_tlv_list_push(&emv->supported_aids, EMV_TAG_9F06_AID, 6, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10 }, EMV_ASI_PARTIAL_MATCH); // Visa
+
+	// Terminal configuration
+	emv_tlv_list_push(&emv->config, EMV_TAG_9F1A_TERMINAL_COUNTRY_CODE, 2, (uint8_t[]){ 0x05, 0x28 }, 0);
+	emv_tlv_list_push(&emv->config, EMV_TAG_9F33_TERMINAL_CAPABILITIES, 3, (uint8_t[]){ 0xE0, 0xF8, EMV_TERM_CAPS_SECURITY_SDA | EMV_TERM_CAPS_SECURITY_DDA | EMV_TERM_CAPS_SECURITY_CDA }, 0);
+	emv_tlv_list_push(&emv->config, EMV_TAG_9F49_DDOL, 3, (uint8_t[]){ 0x9F, 0x37, 0x04 }, 0);
+	emv_tlv_list_push(&emv->config, EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT, 4, (uint8_t[]){ 0x00, 0x00, 0x27, 0x10 }, 0);
+
+	return 0;
+}
+
+static int bench_txn_init(struct bench_txn_t* txn, enum emv_icc_sim_oda_t oda)
+{
+	int r;
+	struct emv_icc_sim_config_t config;
+
+	memset(&txn->ttl, 0, sizeof(txn->ttl));
+	r = bench_ctx_init(&txn->emv, &txn->ttl, &txn->dol_plan_cache);
+	if (r) {
+		return r;
+	}
+
+	emv_icc_sim_config_init(&config, oda);
+	r = emv_icc_sim_init(&txn->sim, &config);
+	if (r) {
+		return r;
+	}
+
+	txn->ttl.cardreader.mode = EMV_CARDREADER_MODE_APDU;
+	txn->ttl.cardreader.ctx = &txn->sim;
+	txn->ttl.cardreader.trx = &emv_icc_sim_trx;
+	txn->emv.capk_list = txn->sim.capk;
+	txn->emv.capk_count = txn->sim.capk_count;
+
+	return 0;
+}
+
+static int bench_txn_rtt_init(
+	struct bench_txn_t* txn,
+	enum emv_icc_sim_oda_t oda,
+	bool batch
+)
+{
+	int r;
+
+	r = bench_txn_init(txn, oda);
+	if (r) {
+		return r;
+	}
+
+	// Route virtual ICC through latency emulator
+	memset(&txn->latency, 0, sizeof(txn->latency));
+	txn->latency.trx = &emv_icc_sim_trx;
+	txn->latency.trx_ctx = &txn->sim;
+	txn->latency.latency_us = BENCH_RTT_LATENCY_US;
+	txn->ttl.cardreader.ctx = &txn->latency;
+	txn->ttl.cardreader.trx = &emv_cardreader_emul_latency;
+	if (batch) {
+		r = emv_ttl_ext_attach(&txn->ttl, &txn->ttl_ext);
+		if (r) {
+			return r;
+		}
+		txn->ttl_ext.trx_batch = &emv_cardreader_emul_latency_batch;
+	}
+
+	return 0;
+}
+
+static int bench_txn(void* ctx)
+{
+	int r;
+	struct bench_txn_t* txn = ctx;
+
+	r = emv_icc_sim_transaction(&txn->emv, &txn->sim);
+	if (r) {
+		return r;
+	}
+
+	// Offline data authentication must succeed for the measurement to be
+	// meaningful
+	if (txn->emv.tvr->value[0] & (
+		EMV_TVR_SDA_FAILED |
+		EMV_TVR_DDA_FAILED |
+		EMV_TVR_CDA_FAILED
+	)) {
+		return 1;
+	}
+
+	return 0;
+}
+
+static int bench_emul_candidate_list(void* ctx)
+{
+	int r;
+	struct bench_emul_t* emul = ctx;
+	struct emv_app_list_t app_list = EMV_APP_LIST_INIT;
+
+	emul->emul_ctx.xpdu_list = emv_cardreader_emul_pse_app_supported;
+	emul->emul_ctx.xpdu_current = NULL;
+	r = emv_build_candidate_list(&emul->emv, &app_list);
+	if (!r && emv_app_list_is_empty(&app_list)) {
+		r = 1;
+	}
+	emv_app_list_clear(&app_list);
+
+	return r;
+}
+
+static int bench_tlv_parse(void* ctx)
+{
+	int r;
+	struct bench_data_t* data = ctx;
+	const struct emv_icc_sim_app_t* app = &data->cda->sim.app[0];
+	struct emv_tlv_list_t list = EMV_TLV_LIST_INIT;
+
+	r = emv_tlv_parse(test_gpo_response, sizeof(test_gpo_response), &list);
+	for (unsigned int i = 0; !r && i < EMV_ICC_SIM_RECORD_MAX; ++i) {
+		r = emv_tlv_parse(app->record[i], app->record_len[i], &list);
+	}
+	emv_tlv_list_clear(&list);
+
+	return r;
+}
+
+static int bench_dol_build_data(void* ctx)
+{
+	struct bench_data_t* data = ctx;
+	uint8_t buf[EMV_CAPDU_DATA_MAX];
+	size_t buf_len = sizeof(buf);
+
+	return emv_dol_build_data(
+		data->cdol1->value,
+		data->cdol1->length,
+		&data->sources,
+		buf,
+		&buf_len
+	);
+}
+
+static int bench_dol_plan_build_data(void* ctx)
+{
+	struct bench_data_t* data = ctx;
+	uint8_t buf[EMV_CAPDU_DATA_MAX];
+	size_t buf_len = sizeof(buf);
+
+	return emv_dol_plan_cache_build_data(
+		&data->dol_plan_cache,
+		data->cdol1->value,
+		data->cdol1->length,
+		&data->sources,
+		buf,
+		&buf_len
+	);
+}
+
+static int bench_tlv_get_info(void* ctx)
+{
+	int r;
+	struct bench_data_t* data = ctx;
+	struct emv_tlv_sources_itr_t itr;
+	const struct emv_tlv_t* tlv;
+	struct emv_tlv_info_t info;
+	char value_str[2048];
+
+	// Stringify every field of a completed transaction
+	r = emv_tlv_sources_itr_init(&data->sources, &itr);
+	if (r) {
+		return r;
+	}
+	while ((tlv = emv_tlv_sources_itr_next_const(&itr))) {
+		emv_tlv_get_info(tlv, &data->sources, &info, value_str, sizeof(value_str));
+	}
+
+	return 0;
+}
+
+static int bench_rsa_issuer_pkey(void* ctx)
+{
+	struct bench_data_t* data = ctx;
+	struct emv_rsa_issuer_pkey_t pkey;
+
+	return emv_rsa_retrieve_issuer_pkey(
+		data->issuer_cert->value,
+		data->issuer_cert->length,
+		data->capk,
+		&data->cda->emv.icc,
+		&data->cda->emv.params,
+		&pkey
+	);
+}
+
+static int bench_rsa_ssad(void* ctx)
+{
+	struct bench_data_t* data = ctx;
+	struct emv_rsa_ssad_t ssad;
+
+	return emv_rsa_retrieve_ssad(
+		data->ssad->value,
+		data->ssad->length,
+		&data->sda_issuer_pkey,
+		&data->sda_oda,
+		&ssad
+	);
+}
+
+static int bench_rsa_icc_pkey(void* ctx)
+{
+	struct bench_data_t* data = ctx;
+	struct emv_rsa_icc_pkey_t pkey;
+
+	return emv_rsa_retrieve_icc_pkey(
+		data->icc_cert->value,
+		data->icc_cert->length,
+		&data->cda_issuer_pkey,
+		&data->cda->emv.icc,
+		&data->cda->emv.params,
+		&data->cda_oda,
+		&pkey
+	);
+}
+
+static int bench_rsa_sdad(void* ctx)
+{
+	struct bench_data_t* data = ctx;
+	struct emv_rsa_sdad_t sdad;
+
+	return emv_rsa_retrieve_sdad(
+		data->sdad->value,
+		data->sdad->length,
+		&data->icc_pkey,
+		data->un->value,
+		data->un->length,
+		&sdad
+	);
+}
+
+static int bench_rsa_mod_exp(void* ctx)
+{
+	int r;
+	struct bench_rsa_t* rsa = ctx;
+	enum emv_rsa_backend_t backend = emv_rsa_get_backend();
+	uint8_t output[1984 / 8];
+
+	emv_rsa_set_backend(rsa->backend);
+	r = emv_rsa_mod_exp(
+		rsa->precomputed ? &rsa->key : NULL,
+		rsa->modulus,
+		rsa->modulus_len,
+		rsa->exponent,
+		rsa->exponent_len,
+		rsa->input,
+		output
+	);
+	emv_rsa_set_backend(backend);
+
+	return r;
+}
+
+static int bench_rand_un_crypto(void* ctx)
+{
+	uint8_t un[4];
+
+	// Unpredictable Number directly from the crypto library
+	crypto_rand(un, sizeof(un));
+	return 0;
+}
+
+static int bench_rand_un(void* ctx)
+{
+	uint8_t un[4];
+
+	// Unpredictable Number from the buffered generator used by the kernel
+	return emv_rand(un, sizeof(un));
+}
+
+// Deterministic seed material for reproducible benchmarks
+static void bench_seed_func(void* ctx, void* buf, size_t len)
+{
+	uint64_t* seed = ctx;
+	uint8_t* ptr = buf;
+
+	for (size_t i = 0; i < len; ++i) {
+		// splitmix64
+		uint64_t z = (*seed += 0x9E3779B97F4A7C15);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+		ptr[i] = z ^ (z >> 31);
+	}
+}
+
+static int bench_rsa_init(
+	struct bench_rsa_t* rsa,
+	char* name,
+	size_t name_len,
+	unsigned int bits,
+	unsigned int variant
+)
+{
+	static const char* backend_str[] = { "crypto", "builtin", "builtin_key" };
+	uint32_t seed = bits;
+
+	memset(rsa, 0, sizeof(*rsa));
+	rsa->backend = variant % 3 ? EMV_RSA_BACKEND_BUILTIN : EMV_RSA_BACKEND_CRYPTO;
+	rsa->precomputed = variant % 3 == 2;
+	rsa->modulus_len = bits / 8;
+	if (variant < 3) {
+		rsa->exponent = bench_rsa_exponent_3;
+		rsa->exponent_len = sizeof(bench_rsa_exponent_3);
+	} else {
+		rsa->exponent = bench_rsa_exponent_65537;
+		rsa->exponent_len = sizeof(bench_rsa_exponent_65537);
+	}
+
+	// The cost of a public key operation does not depend on whether the
+	// modulus is a valid RSA modulus, therefore use deterministic pseudo
+	// random data with the top and bottom bits set
+	for (size_t i = 0; i < rsa->modulus_len; ++i) {
+		seed = seed * 1103515245 + 12345;
+		rsa->modulus[i] = seed >> 16;
+		seed = seed * 1103515245 + 12345;
+		rsa->input[i] = seed >> 16;
+	}
+	rsa->modulus[0] |= 0x80;
+	rsa->modulus[rsa->modulus_len - 1] |= 0x01;
+	rsa->input[0] &= 0x7F;
+
+	snprintf(name, name_len, "rsa_mod_exp_%u_e%s_%s",
+		bits,
+		variant < 3 ? "3" : "65537",
+		backend_str[variant % 3]
+	);
+
+	return emv_rsa_key_init(
+		&rsa->key,
+		rsa->modulus,
+		rsa->modulus_len,
+		rsa->exponent,
+		rsa->exponent_len
+	);
+}
+
+static int bench_oda_init(struct emv_oda_ctx_t* oda, const struct bench_txn_t* txn)
+{
+	int r;
+	const struct emv_icc_sim_app_t* app = &txn->sim.app[0];
+	const uint8_t* record = app->record[0];
+	size_t hdr_len;
+
+	// The kernel releases the ODA record buffer once offline data
+	// authentication is complete, therefore rebuild it from the simulated
+	// application's signed record template followed by the AIP
+	r = emv_oda_init(oda);
+	if (r) {
+		return r;
+	}
+	r = emv_oda_prepare_records(oda, app->afl, app->afl_len);
+	if (r) {
+		return r;
+	}
+	hdr_len = 2 + ((record[1] & 0x80) ? (record[1] & 0x7F) : 0);
+	r = emv_oda_append_record(oda, record + hdr_len, app->record_len[0] - hdr_len);
+	if (r) {
+		return r;
+	}
+	return emv_oda_append_record(oda, app->aip, sizeof(app->aip));
+}
+
+static int bench_data_init(
+	struct bench_data_t* data,
+	struct bench_txn_t* sda,
+	struct bench_txn_t* cda
+)
+{
+	int r;
+
+	memset(data, 0, sizeof(*data));
+	data->sda = sda;
+	data->cda = cda;
+
+	// Complete one transaction of each kind to obtain realistic inputs
+	r = bench_txn(sda);
+	if (r) {
+		fprintf(stderr, "SDA transaction failed; r=%d\n", r);
+		return r;
+	}
+	r = bench_txn(cda);
+	if (r) {
+		fprintf(stderr, "CDA transaction failed; r=%d\n", r);
+		return r;
+	}
+
+	r = emv_tlv_sources_init_from_ctx(&data->sources, &cda->emv);
+	if (r) {
+		return r;
+	}
+	r = bench_oda_init(&data->sda_oda, sda);
+	if (r) {
+		return r;
+	}
+	r = bench_oda_init(&data->cda_oda, cda);
+	if (r) {
+		return r;
+	}
+
+	data->cdol1 = emv_tlv_list_find_const(&cda->emv.icc, EMV_TAG_8C_CDOL1);
+	data->issuer_cert = emv_tlv_list_find_const(&cda->emv.icc, EMV_TAG_90_ISSUER_PUBLIC_KEY_CERTIFICATE);
+	data->ssad = emv_tlv_list_find_const(&sda->emv.icc, EMV_TAG_93_SIGNED_STATIC_APPLICATION_DATA);
+	data->icc_cert = emv_tlv_list_find_const(&cda->emv.icc, EMV_TAG_9F46_ICC_PUBLIC_KEY_CERTIFICATE);
+	data->sdad = emv_tlv_list_find_const(&cda->emv.icc, EMV_TAG_9F4B_SIGNED_DYNAMIC_APPLICATION_DATA);
+	data->un = emv_tlv_list_find_const(&cda->emv.terminal, EMV_TAG_9F37_UNPREDICTABLE_NUMBER);
+	data->capk = emv_capk_list_lookup(
+		cda->sim.capk,
+		cda->sim.capk_count,
+		cda->emv.aid->value,
+		emv_tlv_list_find_const(&cda->emv.icc, EMV_TAG_8F_CERTIFICATION_AUTHORITY_PUBLIC_KEY_INDEX)->value[0]
+	);
+	if (!data->cdol1 ||
+		!data->issuer_cert ||
+		!data->ssad ||
+		!data->icc_cert ||
+		!data->sdad ||
+		!data->un ||
+		!data->capk
+	) {
+		fprintf(stderr, "Transaction data not found\n");
+		return 1;
+	}
+
+	r = emv_rsa_retrieve_issuer_pkey(
+		emv_tlv_list_find_const(&sda->emv.icc, EMV_TAG_90_ISSUER_PUBLIC_KEY_CERTIFICATE)->value,
+		emv_tlv_list_find_const(&sda->emv.icc, EMV_TAG_90_ISSUER_PUBLIC_KEY_CERTIFICATE)->length,
+		data->capk,
+		&sda->emv.icc,
+		&sda->emv.params,
+		&data->sda_issuer_pkey
+	);
+	if (r) {
+		fprintf(stderr, "emv_rsa_retrieve_issuer_pkey() failed; r=%d\n", r);
+		return r;
+	}
+	r = emv_rsa_retrieve_issuer_pkey(
+		data->issuer_cert->value,
+		data->issuer_cert->length,
+		data->capk,
+		&cda->emv.icc,
+		&cda->emv.params,
+		&data->cda_issuer_pkey
+	);
+	if (r) {
+		fprintf(stderr, "emv_rsa_retrieve_issuer_pkey() failed; r=%d\n", r);
+		return r;
+	}
+	r = emv_rsa_retrieve_icc_pkey(
+		data->icc_cert->value,
+		data->icc_cert->length,
+		&data->cda_issuer_pkey,
+		&cda->emv.icc,
+		&cda->emv.params,
+		&data->cda_oda,
+		&data->icc_pkey
+	);
+	if (r) {
+		fprintf(stderr, "emv_rsa_retrieve_icc_pkey() failed; r=%d\n", r);
+		return r;
+	}
+
+	return 0;
+}
+
+static uint64_t bench_get_alloc_count(void)
+{
+#ifdef HAVE___LIBC_MALLOC
+	return atomic_load_explicit(&bench_alloc_count, memory_order_relaxed);
+#else
+	return 0;
+#endif
+}
+
+static int bench_compare_u64(const void* a, const void* b)
+{
+	uint64_t x = *(const uint64_t*)a;
+	uint64_t y = *(const uint64_t*)b;
+
+	return (x > y) - (x < y);
+}
+
+static uint64_t bench_percentile(const uint64_t* sorted, unsigned int count, unsigned int percentile)
+{
+	// Nearest rank method
+	unsigned int rank = (percentile * count + 99) / 100;
+
+	if (!rank) {
+		rank = 1;
+	}
+	return sorted[rank - 1];
+}
+
+static int bench_run(
+	const struct bench_t* bench,
+	unsigned int samples,
+	struct bench_result_t* result
+)
+{
+	int r;
+	uint64_t* sample_ns;
+	unsigned int batch = 1;
+	uint64_t start_ns;
+	uint64_t allocs;
+
+	memset(result, 0, sizeof(*result));
+	sample_ns = calloc(samples, sizeof(*sample_ns));
+	if (!sample_ns) {
+		return -1;
+	}
+
+	// Warm up caches and determine batch size
+	for (unsigned int i = 0; i < BENCH_WARMUP_OPS; ++i) {
+		r = bench->func(bench->ctx);
+		if (r) {
+			goto exit;
+		}
+	}
+	while (batch < BENCH_MAX_BATCH) {
+		start_ns = emv_metrics_get_time_ns();
+		for (unsigned int i = 0; i < batch; ++i) {
+			r = bench->func(bench->ctx);
+			if (r) {
+				goto exit;
+			}
+		}
+		if (emv_metrics_get_time_ns() - start_ns >= BENCH_MIN_SAMPLE_NS) {
+			break;
+		}
+		batch *= 2;
+	}
+
+	allocs = bench_get_alloc_count();
+	for (unsigned int s = 0; s < samples; ++s) {
+		uint64_t duration_ns;
+
+		start_ns = emv_metrics_get_time_ns();
+		for (unsigned int i = 0; i < batch; ++i) {
+			r = bench->func(bench->ctx);
+			if (r) {
+				goto exit;
+			}
+		}
+		duration_ns = emv_metrics_get_time_ns() - start_ns;
+
+		result->total_ns += duration_ns;
+		sample_ns[s] = duration_ns / batch;
+	}
+	result->allocs = bench_get_alloc_count() - allocs;
+	result->samples = samples;
+	result->ops = (uint64_t)samples * batch;
+	result->batch = batch;
+
+	// Each sample is the average of a batch of operations and therefore
+	// these are not percentiles of individual operations unless the batch
+	// consists of a single operation
+	qsort(sample_ns, samples, sizeof(*sample_ns), &bench_compare_u64);
+	result->sample_min_ns = sample_ns[0];
+	result->sample_p50_ns = bench_percentile(sample_ns, samples, 50);
+	result->sample_p90_ns = bench_percentile(sample_ns, samples, 90);
+	result->sample_p99_ns = bench_percentile(sample_ns, samples, 99);
+	result->sample_max_ns = sample_ns[samples - 1];
+
+	r = 0;
+	goto exit;
+
+exit:
+	free(sample_ns);
+	return r;
+}
+
+static void bench_print_result(
+	enum bench_format_t format,
+	const char* name,
+	const struct bench_result_t* result,
+	bool first
+)
+{
+	char allocs_str[32];
+
+#ifdef HAVE___LIBC_MALLOC
+	snprintf(allocs_str, sizeof(allocs_str), "%.2f", (double)result->allocs / result->ops);
+#else
+	// Allocation counting is not available on this platform
+	snprintf(allocs_str, sizeof(allocs_str), "%s", format == BENCH_FORMAT_JSON ? "null" : "");
+#endif
+
+	if (format == BENCH_FORMAT_CSV) {
+		printf("%s,%u,%u,%llu,%.1f,%s,%llu,%llu,%llu,%llu,%llu\n",
+			name,
+			result->samples,
+			result->batch,
+			(unsigned long long)result->ops,
+			(double)result->total_ns / result->ops,
+			allocs_str,
+			(unsigned long long)result->sample_min_ns,
+			(unsigned long long)result->sample_p50_ns,
+			(unsigned long long)result->sample_p90_ns,
+			(unsigned long long)result->sample_p99_ns,
+			(unsigned long long)result->sample_max_ns
+		);
+		return;
+	}
+
+	printf("%s\n    {\"name\": \"%s\", \"samples\": %u, \"batch\": %u, \"ops\": %llu, "
+		"\"ns_per_op\": %.1f, \"allocs_per_op\": %s, "
+		"\"sample_min_ns\": %llu, \"sample_p50_ns\": %llu, \"sample_p90_ns\": %llu, \"sample_p99_ns\": %llu, \"sample_max_ns\": %llu}",
+		first ? "" : ",",
+		name,
+		result->samples,
+		result->batch,
+		(unsigned long long)result->ops,
+		(double)result->total_ns / result->ops,
+		allocs_str,
+		(unsigned long long)result->sample_min_ns,
+		(unsigned long long)result->sample_p50_ns,
+		(unsigned long long)result->sample_p90_ns,
+		(unsigned long long)result->sample_p99_ns,
+		(unsigned long long)result->sample_max_ns
+	);
+}
+
+static void print_usage(const char* argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [--samples N] [--filter SUBSTRING] [--format json|csv] [--seed N] [--list]\n",
+		argv0
+	);
+}
+
+int main(int argc, char** argv)
+{
+	int r;
+	unsigned int samples = BENCH_DEFAULT_SAMPLES;
+	const char* filter = NULL;
+	enum bench_format_t format = BENCH_FORMAT_JSON;
+	bool list_only = false;
+	bool first = true;
+	static uint64_t seed;
+	static struct bench_txn_t txn[4];
+	static struct bench_txn_t txn_rtt[2];
+	static struct bench_txn_t data_txn[2];
+	static struct bench_emul_t emul;
+	static struct bench_data_t data;
+	static struct bench_rsa_t rsa[BENCH_RSA_COUNT];
+	static char rsa_name[BENCH_RSA_COUNT][64];
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+			samples = strtoul(argv[++i], NULL, 0);
+		} else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			++i;
+			if (strcmp(argv[i], "json") == 0) {
+				format = BENCH_FORMAT_JSON;
+			} else if (strcmp(argv[i], "csv") == 0) {
+				format = BENCH_FORMAT_CSV;
+			} else {
+				print_usage(argv[0]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = strtoull(argv[++i], NULL, 0);
+			emv_rand_set_seed_func(&bench_seed_func, &seed);
+		} else if (strcmp(argv[i], "--list") == 0) {
+			list_only = true;
+		} else {
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!samples) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	// Virtual ICC transactions for each offline data authentication method
+	for (unsigned int oda = EMV_ICC_SIM_ODA_NONE; oda <= EMV_ICC_SIM_ODA_CDA; ++oda) {
+		r = bench_txn_init(&txn[oda], oda);
+		if (r) {
+			fprintf(stderr, "bench_txn_init() failed; r=%d\n", r);
+			return 1;
+		}
+	}
+
+	// Virtual ICC transactions with modelled card reader latency, without
+	// and with batched READ RECORD commands
+	r = bench_txn_rtt_init(&txn_rtt[0], EMV_ICC_SIM_ODA_CDA, false);
+	if (!r) {
+		r = bench_txn_rtt_init(&txn_rtt[1], EMV_ICC_SIM_ODA_CDA, true);
+	}
+	if (r) {
+		fprintf(stderr, "bench_txn_rtt_init() failed; r=%d\n", r);
+		return 1;
+	}
+
+	// Card reader emulator session
+	memset(&emul.ttl, 0, sizeof(emul.ttl));
+	emul.ttl.cardreader.mode = EMV_CARDREADER_MODE_APDU;
+	emul.ttl.cardreader.ctx = &emul.emul_ctx;
+	emul.ttl.cardreader.trx = &emv_cardreader_emul;
+	r = bench_ctx_init(&emul.emv, &emul.ttl, &emul.dol_plan_cache);
+	if (r) {
+		fprintf(stderr, "bench_ctx_init() failed; r=%d\n", r);
+		return 1;
+	}
+
+	// Separate transactions provide the inputs for individual kernel
+	// functions such that they are not modified by the transaction benchmarks
+	r = bench_txn_init(&data_txn[0], EMV_ICC_SIM_ODA_SDA);
+	if (!r) {
+		r = bench_txn_init(&data_txn[1], EMV_ICC_SIM_ODA_CDA);
+	}
+	if (r) {
+		fprintf(stderr, "bench_txn_init() failed; r=%d\n", r);
+		return 1;
+	}
+	r = bench_data_init(&data, &data_txn[0], &data_txn[1]);
+	if (r) {
+		fprintf(stderr, "bench_data_init() failed; r=%d\n", r);
+		return 1;
+	}
+
+	// RSA public key operations for each backend, modulus length and
+	// exponent
+	for (unsigned int i = 0; i < BENCH_RSA_COUNT; ++i) {
+		r = bench_rsa_init(
+			&rsa[i],
+			rsa_name[i],
+			sizeof(rsa_name[i]),
+			bench_rsa_bits[i / BENCH_RSA_VARIANT_COUNT],
+			i % BENCH_RSA_VARIANT_COUNT
+		);
+		if (r) {
+			fprintf(stderr, "bench_rsa_init() failed; r=%d\n", r);
+			return 1;
+		}
+	}
+
+	const struct bench_t bench_list[] = {
+		{ "tlv_parse", &bench_tlv_parse, &data },
+		{ "dol_build_data", &bench_dol_build_data, &data },
+		{ "dol_plan_build_data", &bench_dol_plan_build_data, &data },
+		{ "tlv_get_info", &bench_tlv_get_info, &data },
+		{ "rand_un_crypto", &bench_rand_un_crypto, NULL },
+		{ "rand_un", &bench_rand_un, NULL },
+		{ "rsa_retrieve_issuer_pkey", &bench_rsa_issuer_pkey, &data },
+		{ "rsa_retrieve_ssad", &bench_rsa_ssad, &data },
+		{ "rsa_retrieve_icc_pkey", &bench_rsa_icc_pkey, &data },
+		{ "rsa_retrieve_sdad", &bench_rsa_sdad, &data },
+		{ "emul_build_candidate_list", &bench_emul_candidate_list, &emul },
+		{ "txn_no_oda", &bench_txn, &txn[EMV_ICC_SIM_ODA_NONE] },
+		{ "txn_sda", &bench_txn, &txn[EMV_ICC_SIM_ODA_SDA] },
+		{ "txn_dda", &bench_txn, &txn[EMV_ICC_SIM_ODA_DDA] },
+		{ "txn_cda", &bench_txn, &txn[EMV_ICC_SIM_ODA_CDA] },
+		{ "txn_cda_rtt", &bench_txn, &txn_rtt[0] },
+		{ "txn_cda_rtt_batch", &bench_txn, &txn_rtt[1] },
+	};
+	struct bench_t rsa_bench_list[BENCH_RSA_COUNT];
+
+	for (unsigned int i = 0; i < BENCH_RSA_COUNT; ++i) {
+		rsa_bench_list[i] = (struct bench_t){ rsa_name[i], &bench_rsa_mod_exp, &rsa[i] };
+	}
+
+	if (format == BENCH_FORMAT_JSON && !list_only) {
+		printf("{\n  \"benchmarks\": [");
+	} else if (format == BENCH_FORMAT_CSV && !list_only) {
+		printf("name,samples,batch,ops,ns_per_op,allocs_per_op,sample_min_ns,sample_p50_ns,sample_p90_ns,sample_p99_ns,sample_max_ns\n");
+	}
+
+	const size_t bench_count = sizeof(bench_list) / sizeof(bench_list[0]);
+	for (size_t i = 0; i < bench_count + BENCH_RSA_COUNT; ++i) {
+		const struct bench_t* bench = i < bench_count ? &bench_list[i] : &rsa_bench_list[i - bench_count];
+		struct bench_result_t result;
+
+		if (filter && !strstr(bench->name, filter)) {
+			continue;
+		}
+		if (list_only) {
+			printf("%s\n", bench->name);
+			continue;
+		}
+
+		r = bench_run(bench, samples, &result);
+		if (r) {
+			fprintf(stderr, "\nBenchmark %s failed; r=%d\n", bench->name, r);
+			r = 1;
+			goto exit;
+		}
+		bench_print_result(format, bench->name, &result, first);
+		fflush(stdout);
+		first = false;
+	}
+
+	if (format == BENCH_FORMAT_JSON && !list_only) {
+		printf("\n  ]\n}\n");
+	}
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	for (unsigned int i = 0; i < sizeof(txn) / sizeof(txn[0]); ++i) {
+		emv_ctx_clear(&txn[i].emv);
+	}
+	for (unsigned int i = 0; i < sizeof(txn_rtt) / sizeof(txn_rtt[0]); ++i) {
+		emv_ctx_clear(&txn_rtt[i].emv);
+	}
+	for (unsigned int i = 0; i < sizeof(data_txn) / sizeof(data_txn[0]); ++i) {
+		emv_ctx_clear(&data_txn[i].emv);
+	}
+	emv_ctx_clear(&emul.emv);
+	emv_oda_clear(&data.sda_oda);
+	emv_oda_clear(&data.cda_oda);
+
+	return r;
+}
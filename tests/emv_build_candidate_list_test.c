@@ -191,22 +191,6 @@ static const struct xpdu_t test_pse_app_not_supported[] = {
 	{ 0 }
 };
 
-static const struct xpdu_t test_pse_app_supported[] = {
-	{
-		20, (uint8_t[]){ 0x00, 0xA4, 0x04, 0x00, 0x0E, 0x31, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46, 0x30, 0x31, 0x00 }, // SELECT 1PAY.SYS.DDF01
-		36, (uint8_t[]){ 0x6F, 0x20, 0x84, 0x0E, 0x31, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46, 0x30, 0x31, 0xA5, 0x0E, 0x88, 0x01, 0x01, 0x5F, 0x2D, 0x04, 0x6E, 0x6C, 0x65, 0x6E, 0x9F, 0x11, 0x01, 0x01, 0x90, 0x00 }, // FCI
-	},
-	{
-		5, (uint8_t[]){ 0x00, 0xB2, 0x01, 0x0C, 0x00 }, // READ RECORD 1,1
-		45, (uint8_t[]){ 0x70, 0x29, 0x61, 0x27, 0x4F, 0x07, 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10, 0x50, 0x0B, 0x56, 0x49, 0x53, 0x41, 0x20, 0x43, 0x52, 0x45, 0x44, 0x49, 0x54, 0x87, 0x01, 0x01, 0x9F, 0x12, 0x0B, 0x56, 0x49, 0x53, 0x41, 0x20, 0x43, 0x52, 0x45, 0x44, 0x49, 0x54, 0x90, 0x00 }, // AEF
-	},
-	{
-		5, (uint8_t[]){ 0x00, 0xB2, 0x02, 0x0C, 0x00 }, // READ RECORD 1,2
-		2, (uint8_t[]){ 0x6A, 0x83 }, // Record not found
-	},
-	{ 0 }
-};
-
 static const struct xpdu_t test_pse_multi_app_supported[] = {
 	{
 		20, (uint8_t[]){ 0x00, 0xA4, 0x04, 0x00, 0x0E, 0x31, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46, 0x30, 0x31, 0x00 }, // SELECT 1PAY.SYS.DDF01
@@ -565,7 +549,7 @@ int main(void)
 	printf("Success\n");
 
 	printf("\nTesting PSE app supported...\n");
-	emul_ctx.xpdu_list = test_pse_app_supported;
+	emul_ctx.xpdu_list = emv_cardreader_emul_pse_app_supported;
 	emul_ctx.xpdu_current = NULL;
 	emv_app_list_clear(&app_list);
 	r = emv_build_candidate_list(&emv, &app_list);
@@ -2,7 +2,7 @@
  * @file emv_cardreader_emul.c
  * @brief Basic card reader emulation for unit tests
  *
- * Copyright 2024 Leon Lynch
+ * Copyright 2024, 2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -21,9 +21,27 @@
 
 #include "emv_cardreader_emul.h"
 
+#include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+
+const struct xpdu_t emv_cardreader_emul_pse_app_supported[] = {
+	{
+		20, (uint8_t[]){ 0x00, 0xA4, 0x04, 0x00, 0x0E, 0x31, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46, 0x30, 0x31, 0x00 }, // SELECT 1PAY.SYS.DDF01
+		36, (uint8_t[]){ 0x6F, 0x20, 0x84, 0x0E, 0x31, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46, 0x30, 0x31, 0xA5, 0x0E, 0x88, 0x01, 0x01, 0x5F, 0x2D, 0x04, 0x6E, 0x6C, 0x65, 0x6E, 0x9F, 0x11, 0x01, 0x01, 0x90, 0x00 }, // FCI
+	},
+	{
+		5, (uint8_t[]){ 0x00, 0xB2, 0x01, 0x0C, 0x00 }, // READ RECORD 1,1
+		45, (uint8_t[]){ 0x70, 0x29, 0x61, 0x27, 0x4F, 0x07, 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10, 0x50, 0x0B, 0x56, 0x49, 0x53, 0x41, 0x20, 0x43, 0x52, 0x45, 0x44, 0x49, 0x54, 0x87, 0x01, 0x01, 0x9F, 0x12, 0x0B, 0x56, 0x49, 0x53, 0x41, 0x20, 0x43, 0x52, 0x45, 0x44, 0x49, 0x54, 0x90, 0x00 }, // AEF
+	},
+	{
+		5, (uint8_t[]){ 0x00, 0xB2, 0x02, 0x0C, 0x00 }, // READ RECORD 1,2
+		2, (uint8_t[]){ 0x6A, 0x83 }, // Record not found
+	},
+	{ 0 }
+};
 
 int emv_cardreader_emul(
 	void* ctx,
@@ -67,3 +85,370 @@ int emv_cardreader_emul(
 
 	return 0;
 }
+
+// Protocol T=1 Protocol Control Byte (PCB) values
+// See ISO 7816-3:2006, 11.3.2.2
+#define T1_PCB_I_NS (0x40)
+#define T1_PCB_I_M (0x20)
+#define T1_PCB_R_BLOCK (0x80)
+#define T1_PCB_R_NR (0x10)
+#define T1_PCB_R_ERROR_MASK (0x0F)
+#define T1_PCB_S_BLOCK (0xC0)
+#define T1_PCB_S_RESPONSE (0x20)
+#define T1_PCB_S_IFS (0x01)
+#define T1_PCB_S_WTX (0x03)
+
+static size_t emv_cardreader_emul_t1_edc(
+	const struct emv_cardreader_emul_t1_ctx_t* t1_ctx,
+	const uint8_t* buf,
+	size_t len,
+	uint8_t* edc
+)
+{
+	if (t1_ctx->edc_crc) {
+		// CRC-16 with polynomial 1021 and initial value FFFF
+		uint16_t crc = 0xFFFF;
+		for (size_t i = 0; i < len; ++i) {
+			crc ^= (uint16_t)buf[i] << 8;
+			for (unsigned int j = 0; j < 8; ++j) {
+				crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+			}
+		}
+		edc[0] = crc >> 8;
+		edc[1] = crc & 0xFF;
+		return 2;
+	} else {
+		uint8_t lrc = 0;
+		for (size_t i = 0; i < len; ++i) {
+			lrc ^= buf[i];
+		}
+		edc[0] = lrc;
+		return 1;
+	}
+}
+
+static size_t emv_cardreader_emul_t1_build_block(
+	const struct emv_cardreader_emul_t1_ctx_t* t1_ctx,
+	uint8_t pcb,
+	const uint8_t* inf,
+	size_t inf_len,
+	uint8_t* block
+)
+{
+	block[0] = 0x00; // NAD
+	block[1] = pcb;
+	block[2] = inf_len;
+	if (inf_len) {
+		memcpy(block + 3, inf, inf_len);
+	}
+	return 3 + inf_len + emv_cardreader_emul_t1_edc(t1_ctx, block, 3 + inf_len, block + 3 + inf_len);
+}
+
+static void emv_cardreader_emul_t1_build_response(struct emv_cardreader_emul_t1_ctx_t* t1_ctx)
+{
+	uint8_t pcb = 0;
+	size_t inf_len = t1_ctx->r_apdu_len - t1_ctx->r_apdu_offset;
+
+	// Chain response according to IFSD
+	if (inf_len > t1_ctx->ifsd) {
+		inf_len = t1_ctx->ifsd;
+		pcb |= T1_PCB_I_M;
+	}
+	if (t1_ctx->ns) {
+		pcb |= T1_PCB_I_NS;
+	}
+	t1_ctx->ns ^= 1;
+
+	t1_ctx->pending_block_len = emv_cardreader_emul_t1_build_block(
+		t1_ctx,
+		pcb,
+		t1_ctx->r_apdu + t1_ctx->r_apdu_offset,
+		inf_len,
+		t1_ctx->pending_block
+	);
+	t1_ctx->r_apdu_offset += inf_len;
+	t1_ctx->r_apdu_chaining = (pcb & T1_PCB_I_M) != 0;
+}
+
+static void emv_cardreader_emul_t1_send(
+	struct emv_cardreader_emul_t1_ctx_t* t1_ctx,
+	const uint8_t* block,
+	size_t block_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+)
+{
+	if (block != t1_ctx->last_block) {
+		memcpy(t1_ctx->last_block, block, block_len);
+		t1_ctx->last_block_len = block_len;
+	}
+
+	memcpy(rx_buf, block, block_len);
+	*rx_buf_len = block_len;
+
+	if (t1_ctx->edc_errors) {
+		// Corrupt EDC of transmitted copy only
+		((uint8_t*)rx_buf)[block_len - 1] ^= 0xA5;
+		t1_ctx->edc_errors--;
+	}
+}
+
+static void emv_cardreader_emul_t1_send_next(
+	struct emv_cardreader_emul_t1_ctx_t* t1_ctx,
+	void* rx_buf,
+	size_t* rx_buf_len
+)
+{
+	uint8_t block[3 + 1 + 2];
+	size_t block_len;
+
+	if (t1_ctx->ifs_request) {
+		block_len = emv_cardreader_emul_t1_build_block(
+			t1_ctx,
+			T1_PCB_S_BLOCK | T1_PCB_S_IFS,
+			&t1_ctx->ifs_request,
+			1,
+			block
+		);
+		emv_cardreader_emul_t1_send(t1_ctx, block, block_len, rx_buf, rx_buf_len);
+		return;
+	}
+
+	if (t1_ctx->wtx_remaining) {
+		uint8_t multiplier = t1_ctx->wtx_remaining--;
+		block_len = emv_cardreader_emul_t1_build_block(
+			t1_ctx,
+			T1_PCB_S_BLOCK | T1_PCB_S_WTX,
+			&multiplier,
+			1,
+			block
+		);
+		emv_cardreader_emul_t1_send(t1_ctx, block, block_len, rx_buf, rx_buf_len);
+		return;
+	}
+
+	emv_cardreader_emul_t1_send(
+		t1_ctx,
+		t1_ctx->pending_block,
+		t1_ctx->pending_block_len,
+		rx_buf,
+		rx_buf_len
+	);
+}
+
+int emv_cardreader_emul_t1(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+) {
+	struct emv_cardreader_emul_t1_ctx_t* t1_ctx = ctx;
+	const uint8_t* block = tx_buf;
+	uint8_t edc[2];
+	size_t edc_len;
+	uint8_t pcb;
+	uint8_t inf_len;
+	const uint8_t* inf;
+	uint8_t r_block[3 + 1 + 2];
+	size_t r_block_len;
+
+	// NOTE: This function calls exit() on error for the same reasons as
+	// emv_cardreader_emul()
+
+	if (!t1_ctx->ifsd) {
+		// Default IFSD before negotiation
+		t1_ctx->ifsd = 32;
+	}
+	t1_ctx->block_count++;
+
+	edc_len = t1_ctx->edc_crc ? 2 : 1;
+	if (tx_buf_len < 3 + edc_len ||
+		block[0] != 0x00 ||
+		tx_buf_len != 3 + block[2] + edc_len
+	) {
+		fprintf(stderr, "Invalid block length\n");
+		exit(1);
+		return -104;
+	}
+	emv_cardreader_emul_t1_edc(t1_ctx, block, tx_buf_len - edc_len, edc);
+	if (memcmp(edc, block + tx_buf_len - edc_len, edc_len) != 0) {
+		fprintf(stderr, "Invalid block EDC\n");
+		exit(1);
+		return -105;
+	}
+	pcb = block[1];
+	inf_len = block[2];
+	inf = block + 3;
+
+	if ((pcb & T1_PCB_R_BLOCK) == 0) {
+		// I-block
+		if (!!(pcb & T1_PCB_I_NS) != t1_ctx->nr) {
+			fprintf(stderr, "Incorrect I-block sequence number\n");
+			exit(1);
+			return -106;
+		}
+		if (inf_len > t1_ctx->ifsc ||
+			t1_ctx->c_apdu_len + inf_len > sizeof(t1_ctx->c_apdu)
+		) {
+			fprintf(stderr, "Incorrect I-block length\n");
+			exit(1);
+			return -107;
+		}
+		t1_ctx->nr ^= 1;
+		memcpy(t1_ctx->c_apdu + t1_ctx->c_apdu_len, inf, inf_len);
+		t1_ctx->c_apdu_len += inf_len;
+
+		if (pcb & T1_PCB_I_M) {
+			// Acknowledge chained I-block
+			r_block_len = emv_cardreader_emul_t1_build_block(
+				t1_ctx,
+				T1_PCB_R_BLOCK | (t1_ctx->nr ? T1_PCB_R_NR : 0),
+				NULL,
+				0,
+				r_block
+			);
+			emv_cardreader_emul_t1_send(t1_ctx, r_block, r_block_len, rx_buf, rx_buf_len);
+			return 0;
+		}
+
+		// Process complete C-APDU
+		t1_ctx->r_apdu_len = sizeof(t1_ctx->r_apdu);
+		emv_cardreader_emul(
+			&t1_ctx->apdu,
+			t1_ctx->c_apdu,
+			t1_ctx->c_apdu_len,
+			t1_ctx->r_apdu,
+			&t1_ctx->r_apdu_len
+		);
+		t1_ctx->c_apdu_len = 0;
+		t1_ctx->r_apdu_offset = 0;
+		t1_ctx->wtx_remaining = t1_ctx->wtx;
+		emv_cardreader_emul_t1_build_response(t1_ctx);
+		emv_cardreader_emul_t1_send_next(t1_ctx, rx_buf, rx_buf_len);
+		return 0;
+	}
+
+	if ((pcb & T1_PCB_S_BLOCK) == T1_PCB_R_BLOCK) {
+		// R-block
+		if ((pcb & T1_PCB_R_ERROR_MASK) == 0 &&
+			t1_ctx->r_apdu_chaining &&
+			!!(pcb & T1_PCB_R_NR) == t1_ctx->ns
+		) {
+			// Terminal acknowledged chained I-block
+			emv_cardreader_emul_t1_build_response(t1_ctx);
+			emv_cardreader_emul_t1_send_next(t1_ctx, rx_buf, rx_buf_len);
+			return 0;
+		}
+
+		// Retransmit most recent block
+		emv_cardreader_emul_t1_send(
+			t1_ctx,
+			t1_ctx->last_block,
+			t1_ctx->last_block_len,
+			rx_buf,
+			rx_buf_len
+		);
+		return 0;
+	}
+
+	// S-block
+	if (pcb == (T1_PCB_S_BLOCK | T1_PCB_S_IFS) && inf_len == 1) {
+		// IFS request from terminal
+		t1_ctx->ifsd = inf[0];
+		r_block_len = emv_cardreader_emul_t1_build_block(
+			t1_ctx,
+			pcb | T1_PCB_S_RESPONSE,
+			inf,
+			inf_len,
+			r_block
+		);
+		emv_cardreader_emul_t1_send(t1_ctx, r_block, r_block_len, rx_buf, rx_buf_len);
+		return 0;
+	}
+	if (pcb == (T1_PCB_S_BLOCK | T1_PCB_S_RESPONSE | T1_PCB_S_IFS) &&
+		inf_len == 1 &&
+		inf[0] == t1_ctx->ifs_request
+	) {
+		// IFS response from terminal
+		t1_ctx->ifsc = t1_ctx->ifs_request;
+		t1_ctx->ifs_request = 0;
+		emv_cardreader_emul_t1_send_next(t1_ctx, rx_buf, rx_buf_len);
+		return 0;
+	}
+	if (pcb == (T1_PCB_S_BLOCK | T1_PCB_S_RESPONSE | T1_PCB_S_WTX) && inf_len == 1) {
+		// WTX response from terminal
+		emv_cardreader_emul_t1_send_next(t1_ctx, rx_buf, rx_buf_len);
+		return 0;
+	}
+
+	fprintf(stderr, "Unexpected S-block\n");
+	exit(1);
+	return -108;
+}
+
+static void emv_cardreader_emul_round_trip(struct emv_cardreader_emul_latency_ctx_t* latency_ctx)
+{
+	struct timespec req;
+	struct timespec rem;
+
+	latency_ctx->round_trips++;
+	if (!latency_ctx->latency_us) {
+		return;
+	}
+
+	// Sleep rather than busy wait such that other threads can use the CPU
+	// while the host round trip is pending
+	req.tv_sec = latency_ctx->latency_us / 1000000;
+	req.tv_nsec = (long)(latency_ctx->latency_us % 1000000) * 1000;
+	while (nanosleep(&req, &rem) && errno == EINTR) {
+		req = rem;
+	}
+}
+
+int emv_cardreader_emul_latency(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+) {
+	struct emv_cardreader_emul_latency_ctx_t* latency_ctx = ctx;
+
+	emv_cardreader_emul_round_trip(latency_ctx);
+	latency_ctx->frames++;
+
+	return latency_ctx->trx(latency_ctx->trx_ctx, tx_buf, tx_buf_len, rx_buf, rx_buf_len);
+}
+
+int emv_cardreader_emul_latency_batch(
+	void* ctx,
+	const void* const* tx_bufs,
+	const size_t* tx_buf_lens,
+	size_t count,
+	int (*cb)(void* cb_ctx, size_t idx, const void* rx_buf, size_t rx_buf_len),
+	void* cb_ctx
+) {
+	struct emv_cardreader_emul_latency_ctx_t* latency_ctx = ctx;
+	int r;
+
+	emv_cardreader_emul_round_trip(latency_ctx);
+
+	for (size_t i = 0; i < count; ++i) {
+		uint8_t rx_buf[258];
+		size_t rx_buf_len = sizeof(rx_buf);
+
+		latency_ctx->frames++;
+		r = latency_ctx->trx(latency_ctx->trx_ctx, tx_bufs[i], tx_buf_lens[i], rx_buf, &rx_buf_len);
+		if (r) {
+			return r;
+		}
+
+		r = cb(cb_ctx, i, rx_buf, rx_buf_len);
+		if (r) {
+			return r;
+		}
+	}
+
+	return 0;
+}
@@ -2,7 +2,7 @@
  * @file emv_cardreader_emul.h
  * @brief Basic card reader emulation for unit tests
  *
- * Copyright 2024 Leon Lynch
+ * Copyright 2024, 2026 Leon Lynch
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -22,6 +22,7 @@
 #ifndef EMV_CARDREADER_EMUL_H
 #define EMV_CARDREADER_EMUL_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -39,6 +40,12 @@ struct emv_cardreader_emul_ctx_t {
 	const struct xpdu_t* xpdu_current;
 };
 
+/**
+ * APDU exchanges for a PSE containing a single supported application
+ * (A0000000031010) in the first record and no further records
+ */
+extern const struct xpdu_t emv_cardreader_emul_pse_app_supported[];
+
 /**
  * Emulate card reader transceive
  *
@@ -56,4 +63,112 @@ int emv_cardreader_emul(
 	size_t* rx_buf_len
 );
 
+/**
+ * Protocol T=1 block-level card emulator context
+ *
+ * The emulated card reassembles chained I-blocks into a C-APDU, obtains the
+ * R-APDU from the APDU exchanges in @ref apdu and returns it using I-blocks
+ * that are chained according to the current IFSD. The emulator can be
+ * configured to inject Waiting Time Extension (WTX) requests, IFS requests
+ * and EDC errors.
+ */
+struct emv_cardreader_emul_t1_ctx_t {
+	struct emv_cardreader_emul_ctx_t apdu; ///< APDU exchanges
+	uint8_t ifsc; ///< Information Field Size for the Card (IFSC) as indicated by ATR
+	bool edc_crc; ///< Boolean indicating whether Error Detection Code (EDC) is CRC instead of LRC
+	unsigned int wtx; ///< Number of S(WTX request) blocks to send before each response
+	uint8_t ifs_request; ///< New IFSC to request using S(IFS request) before the next response. Zero if none.
+	unsigned int edc_errors; ///< Number of subsequent blocks to send with invalid EDC
+
+	// Emulator state
+	uint8_t ifsd;
+	uint8_t ns;
+	uint8_t nr;
+	uint8_t c_apdu[262];
+	size_t c_apdu_len;
+	uint8_t r_apdu[258];
+	size_t r_apdu_len;
+	size_t r_apdu_offset;
+	bool r_apdu_chaining;
+	uint8_t pending_block[3 + 254 + 2];
+	size_t pending_block_len;
+	uint8_t last_block[3 + 254 + 2];
+	size_t last_block_len;
+	unsigned int wtx_remaining;
+	unsigned int block_count; ///< Number of blocks received by the emulated card
+};
+
+/**
+ * Emulate card reader transceive of protocol T=1 blocks
+ *
+ * @param ctx Protocol T=1 block-level card emulator context
+ * @param tx_buf Transmit buffer
+ * @param tx_buf_len Length of transmit buffer in bytes
+ * @param rx_buf Receive buffer
+ * @param rx_buf_len Length of receive buffer in bytes
+ */
+int emv_cardreader_emul_t1(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+);
+
+/**
+ * Card reader latency emulator context
+ *
+ * Wraps another transceive function and models a fixed host round trip for
+ * each invocation of @ref emv_cardreader_emul_latency() and for each batch
+ * submitted using @ref emv_cardreader_emul_latency_batch().
+ */
+struct emv_cardreader_emul_latency_ctx_t {
+	/// Wrapped transceive function
+	int (*trx)(void* ctx, const void* tx_buf, size_t tx_buf_len, void* rx_buf, size_t* rx_buf_len);
+	void* trx_ctx; ///< Wrapped transceive function context
+	unsigned int latency_us; ///< Host round trip latency in microseconds
+	unsigned int round_trips; ///< Number of host round trips
+	unsigned int frames; ///< Number of frames transmitted
+};
+
+/**
+ * Emulate card reader transceive with host round trip latency
+ *
+ * @param ctx Card reader latency emulator context
+ * @param tx_buf Transmit buffer
+ * @param tx_buf_len Length of transmit buffer in bytes
+ * @param rx_buf Receive buffer
+ * @param rx_buf_len Length of receive buffer in bytes
+ */
+int emv_cardreader_emul_latency(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+);
+
+/**
+ * Emulate card reader batch transceive with a single host round trip latency
+ *
+ * Frames are passed to the wrapped transceive function one at a time and
+ * each response is passed to the callback before the next frame is
+ * transmitted. Frames following an aborted response are not transmitted.
+ *
+ * @param ctx Card reader latency emulator context
+ * @param tx_bufs Transmit buffers
+ * @param tx_buf_lens Lengths of transmit buffers in bytes
+ * @param count Number of transmit buffers
+ * @param cb Callback function for each response
+ * @param cb_ctx Callback context
+ */
+int emv_cardreader_emul_latency_batch(
+	void* ctx,
+	const void* const* tx_bufs,
+	const size_t* tx_buf_lens,
+	size_t count,
+	int (*cb)(void* cb_ctx, size_t idx, const void* rx_buf, size_t rx_buf_len),
+	void* cb_ctx
+);
+
 #endif
@@ -0,0 +1,367 @@
+/**
+ * @file emv_config_test.c
+ * @brief Unit tests for shared immutable terminal configuration
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_config.h"
+#include "emv.h"
+#include "emv_icc_sim.h"
+#include "emv_ttl.h"
+#include "emv_tlv.h"
+#include "emv_app.h"
+#include "emv_tags.h"
+#include "emv_fields.h"
+
+#include "print_helpers.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_CTX_COUNT (3)
+
+static const uint8_t test_floor_limit1[] = { 0x00, 0x00, 0x27, 0x10 };
+static const uint8_t test_floor_limit2[] = { 0x00, 0x00, 0x4E, 0x20 };
+
+static int populate_config(
+	struct emv_tlv_list_t* config,
+	struct emv_tlv_list_t* supported_aids,
+	const uint8_t* floor_limit
+)
+{
+	int r;
+
+	r = emv_tlv_list_push(supported_aids, EMV_TAG_9F06_AID, 6, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10 }, EMV_ASI_PARTIAL_MATCH); // Visa
+	if (r) {
+		return r;
+	}
+	r = emv_tlv_list_push(supported_aids, EMV_TAG_9F06_AID, 7, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x10 }, EMV_ASI_EXACT_MATCH); // Visa Electron
+	if (r) {
+		return r;
+	}
+
+	// Intentionally not in tag order to test the index
+	r = emv_tlv_list_push(config, EMV_TAG_9F49_DDOL, 3, (uint8_t[]){ 0x9F, 0x37, 0x04 }, 0);
+	if (r) {
+		return r;
+	}
+	r = emv_tlv_list_push(config, EMV_TAG_9F33_TERMINAL_CAPABILITIES, 3, (uint8_t[]){ 0xE0, 0xF8, EMV_TERM_CAPS_SECURITY_SDA | EMV_TERM_CAPS_SECURITY_DDA | EMV_TERM_CAPS_SECURITY_CDA }, 0);
+	if (r) {
+		return r;
+	}
+	r = emv_tlv_list_push(config, EMV_TAG_9F1A_TERMINAL_COUNTRY_CODE, 2, (uint8_t[]){ 0x05, 0x28 }, 0);
+	if (r) {
+		return r;
+	}
+	r = emv_tlv_list_push(config, EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT, 4, floor_limit, 0);
+	if (r) {
+		return r;
+	}
+
+	return 0;
+}
+
+static int do_transaction(struct emv_ctx_t* emv, struct emv_icc_sim_t* sim)
+{
+	int r;
+
+	r = emv_icc_sim_transaction(emv, sim);
+	if (r) {
+		return 1;
+	}
+	if (emv->tvr->value[0] & (
+		EMV_TVR_OFFLINE_DATA_AUTH_NOT_PERFORMED |
+		EMV_TVR_DDA_FAILED
+	)) {
+		fprintf(stderr, "TVR indicates ODA failure\n");
+		print_buf("TVR", emv->tvr->value, emv->tvr->length);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int test_config_matches(const struct emv_config_t* config, const uint8_t* floor_limit)
+{
+	const struct emv_tlv_t* tlv;
+	const unsigned int tags[] = {
+		EMV_TAG_9F1A_TERMINAL_COUNTRY_CODE,
+		EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT,
+		EMV_TAG_9F33_TERMINAL_CAPABILITIES,
+		EMV_TAG_9F49_DDOL,
+	};
+
+	for (size_t i = 0; i < sizeof(tags) / sizeof(tags[0]); ++i) {
+		tlv = emv_config_find_const(config, tags[i]);
+		if (!tlv || tlv->tag != tags[i]) {
+			fprintf(stderr, "emv_config_find_const() failed to find %04X\n", tags[i]);
+			return 1;
+		}
+		if (tlv != emv_tlv_list_find_const(emv_config_get_tlv_list(config), tags[i])) {
+			fprintf(stderr, "Index and list differ for %04X\n", tags[i]);
+			return 1;
+		}
+	}
+	if (emv_config_find_const(config, EMV_TAG_9F35_TERMINAL_TYPE)) {
+		fprintf(stderr, "emv_config_find_const() found absent field\n");
+		return 1;
+	}
+
+	tlv = emv_config_find_const(config, EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT);
+	if (memcmp(tlv->value, floor_limit, 4) != 0) {
+		fprintf(stderr, "Incorrect floor limit\n");
+		print_buf("9F1B", tlv->value, tlv->length);
+		return 1;
+	}
+
+	tlv = emv_config_get_supported_aids(config)->front;
+	if (!tlv || tlv->length != 6 || tlv->flags != EMV_ASI_PARTIAL_MATCH ||
+		!tlv->next || tlv->next->length != 7 || tlv->next->flags != EMV_ASI_EXACT_MATCH ||
+		tlv->next->next
+	) {
+		fprintf(stderr, "Incorrect supported AIDs\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	int r;
+	struct emv_tlv_list_t config_list = EMV_TLV_LIST_INIT;
+	struct emv_tlv_list_t aid_list = EMV_TLV_LIST_INIT;
+	struct emv_config_t* config = NULL;
+	struct emv_config_t* config2 = NULL;
+	struct emv_config_t* acquired = NULL;
+	struct emv_config_slot_t* slot = NULL;
+	struct emv_icc_sim_config_t sim_config;
+	struct emv_icc_sim_t sim;
+	struct emv_ttl_t ttl[TEST_CTX_COUNT];
+	struct emv_ctx_t emv[TEST_CTX_COUNT];
+
+	memset(ttl, 0, sizeof(ttl));
+	for (unsigned int i = 0; i < TEST_CTX_COUNT; ++i) {
+		emv_ctx_init(&emv[i], &ttl[i]);
+	}
+
+	printf("\nTesting invalid configuration...\n");
+	emv_tlv_list_push(&config_list, EMV_TAG_9F33_TERMINAL_CAPABILITIES, 2, (uint8_t[]){ 0xE0, 0xF8 }, 0);
+	config = emv_config_create(&config_list, NULL);
+	if (config) {
+		fprintf(stderr, "emv_config_create() accepted invalid field length\n");
+		r = 1;
+		goto exit;
+	}
+	emv_tlv_list_clear(&config_list);
+	emv_tlv_list_push(&config_list, EMV_TAG_9F1A_TERMINAL_COUNTRY_CODE, 2, (uint8_t[]){ 0x05, 0x28 }, 0);
+	emv_tlv_list_push(&config_list, EMV_TAG_9F1A_TERMINAL_COUNTRY_CODE, 2, (uint8_t[]){ 0x08, 0x40 }, 0);
+	config = emv_config_create(&config_list, NULL);
+	if (config) {
+		fprintf(stderr, "emv_config_create() accepted duplicate field\n");
+		r = 1;
+		goto exit;
+	}
+	emv_tlv_list_clear(&config_list);
+	emv_tlv_list_push(&aid_list, EMV_TAG_9F06_AID, 4, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00 }, EMV_ASI_PARTIAL_MATCH);
+	config = emv_config_create(&config_list, &aid_list);
+	if (config) {
+		fprintf(stderr, "emv_config_create() accepted invalid AID\n");
+		r = 1;
+		goto exit;
+	}
+	emv_tlv_list_clear(&aid_list);
+	printf("Success\n");
+
+	printf("\nTesting configuration index...\n");
+	r = populate_config(&config_list, &aid_list, test_floor_limit1);
+	if (r) {
+		fprintf(stderr, "populate_config() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	config = emv_config_create(&config_list, &aid_list);
+	if (!config) {
+		fprintf(stderr, "emv_config_create() failed\n");
+		r = 1;
+		goto exit;
+	}
+	// Configuration must not depend on the lists from which it was created
+	emv_tlv_list_clear(&config_list);
+	emv_tlv_list_clear(&aid_list);
+	r = test_config_matches(config, test_floor_limit1);
+	if (r) {
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting configuration shared by multiple contexts...\n");
+	// Terminal configuration of the context overrides the shared
+	// configuration without modifying either
+	emv_tlv_list_push(&emv[0].config, EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT, sizeof(test_floor_limit2), test_floor_limit2, 0);
+	r = emv_ctx_set_config(&emv[0], config);
+	if (r) {
+		fprintf(stderr, "emv_ctx_set_config() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (emv_config_find_from_ctx(&emv[0], EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT) !=
+		emv[0].config.front ||
+		emv[0].config.front->next ||
+		!emv_tlv_list_is_empty(&emv[0].supported_aids)
+	) {
+		fprintf(stderr, "emv_ctx_set_config() modified context configuration\n");
+		r = 1;
+		goto exit;
+	}
+	r = test_config_matches(config, test_floor_limit1);
+	if (r) {
+		goto exit;
+	}
+	emv_tlv_list_clear(&emv[0].config);
+
+	emv_icc_sim_config_init(&sim_config, EMV_ICC_SIM_ODA_DDA);
+	r = emv_icc_sim_init(&sim, &sim_config);
+	if (r) {
+		fprintf(stderr, "emv_icc_sim_init() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 0; i < TEST_CTX_COUNT; ++i) {
+		r = emv_ctx_set_config(&emv[i], config);
+		if (r) {
+			fprintf(stderr, "emv_ctx_set_config() failed; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+		ttl[i].cardreader.mode = EMV_CARDREADER_MODE_APDU;
+		ttl[i].cardreader.ctx = &sim;
+		ttl[i].cardreader.trx = &emv_icc_sim_trx;
+		emv[i].capk_list = sim.capk;
+		emv[i].capk_count = sim.capk_count;
+	}
+
+	// Contexts must remain usable after the creator released its reference
+	// and after other contexts were cleared
+	emv_config_unref(config);
+	config = NULL;
+	for (unsigned int i = 0; i < TEST_CTX_COUNT; ++i) {
+		r = do_transaction(&emv[i], &sim);
+		if (r) {
+			goto exit;
+		}
+		if (emv_config_find_from_ctx(&emv[i], EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT) !=
+			emv_config_find_const(emv[i].shared_config, EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT)
+		) {
+			fprintf(stderr, "emv_config_find_from_ctx() failed\n");
+			r = 1;
+			goto exit;
+		}
+	}
+	emv_ctx_clear(&emv[0]);
+	r = do_transaction(&emv[1], &sim);
+	if (r) {
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting configuration versions...\n");
+	slot = emv_config_slot_create(emv[1].shared_config);
+	if (!slot) {
+		fprintf(stderr, "emv_config_slot_create() failed\n");
+		r = 1;
+		goto exit;
+	}
+	acquired = emv_config_slot_acquire(slot);
+	if (acquired != emv[1].shared_config) {
+		fprintf(stderr, "emv_config_slot_acquire() failed\n");
+		r = 1;
+		goto exit;
+	}
+
+	r = populate_config(&config_list, &aid_list, test_floor_limit2);
+	if (r) {
+		fprintf(stderr, "populate_config() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	config2 = emv_config_create(&config_list, &aid_list);
+	if (!config2) {
+		fprintf(stderr, "emv_config_create() failed\n");
+		r = 1;
+		goto exit;
+	}
+	r = emv_config_slot_publish(slot, config2);
+	if (r) {
+		fprintf(stderr, "emv_config_slot_publish() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	emv_config_unref(config2);
+	config2 = NULL;
+
+	// Previous version must remain valid until it is released
+	r = test_config_matches(acquired, test_floor_limit1);
+	if (r) {
+		goto exit;
+	}
+	emv_config_unref(acquired);
+	acquired = NULL;
+
+	// Swap in new version between transactions
+	for (unsigned int i = 1; i < TEST_CTX_COUNT; ++i) {
+		acquired = emv_config_slot_acquire(slot);
+		r = emv_ctx_set_config(&emv[i], acquired);
+		emv_config_unref(acquired);
+		acquired = NULL;
+		if (r) {
+			fprintf(stderr, "emv_ctx_set_config() failed; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+		r = test_config_matches(emv[i].shared_config, test_floor_limit2);
+		if (r) {
+			goto exit;
+		}
+		r = do_transaction(&emv[i], &sim);
+		if (r) {
+			goto exit;
+		}
+	}
+	printf("Success\n");
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	for (unsigned int i = 0; i < TEST_CTX_COUNT; ++i) {
+		emv_ctx_clear(&emv[i]);
+	}
+	emv_config_unref(acquired);
+	emv_config_unref(config2);
+	emv_config_unref(config);
+	emv_config_slot_free(slot);
+	emv_tlv_list_clear(&config_list);
+	emv_tlv_list_clear(&aid_list);
+
+	return r;
+}
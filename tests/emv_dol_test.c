@@ -2,7 +2,7 @@
  * @file emv_dol_test.c
  * @brief Unit tests for Data Object List (DOL) processing
  *
- * Copyright 2024-2025 Leon Lynch
+ * Copyright 2024-2026 Leon Lynch
  *
  * This program is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -163,6 +163,12 @@ int main(void)
 	struct emv_tlv_list_t source1 = EMV_TLV_LIST_INIT;
 	struct emv_tlv_list_t source2 = EMV_TLV_LIST_INIT;
 	const struct emv_tlv_sources_t sources = { 2, { &source1, &source2 } };
+	struct emv_dol_plan_t plan;
+	struct emv_dol_plan_cache_t cache;
+	const struct emv_dol_plan_t* cached_plan;
+	uint8_t test11_dol[sizeof(test7_dol) * 12];
+	uint8_t test11_data[sizeof(test7_data) * 12];
+	uint8_t data_large[sizeof(test11_data)];
 
 	printf("\nTest 1: Iterate valid DOL\n");
 	r = emv_dol_itr_init(test1_dol, sizeof(test1_dol), &itr);
@@ -323,6 +329,169 @@ int main(void)
 	}
 	printf("Success\n");
 
+	printf("\nTest 8: Build DOL data using compiled plan\n");
+	r = emv_dol_plan_compile(test7_dol, sizeof(test7_dol), &plan);
+	if (r) {
+		fprintf(stderr, "emv_dol_plan_compile() failed; r=%d\n", r);
+		return 1;
+	}
+	if (plan.count != 11 || plan.data_len != sizeof(test7_data)) {
+		fprintf(stderr, "emv_dol_plan_compile() failed; count=%u; data_len=%zu\n", plan.count, plan.data_len);
+		return 1;
+	}
+	if (!emv_dol_plan_matches(&plan, test7_dol, sizeof(test7_dol)) ||
+		emv_dol_plan_matches(&plan, test6_dol, sizeof(test6_dol))
+	) {
+		fprintf(stderr, "emv_dol_plan_matches() failed\n");
+		return 1;
+	}
+	for (size_t i = 0; i < sizeof(data); ++i) { data[i] = i; }
+	data_len = sizeof(test7_data) - 1;
+	r = emv_dol_plan_build_data(&plan, &sources, data, &data_len);
+	if (r != 1) {
+		fprintf(stderr, "emv_dol_plan_build_data() did not detect output too small; r=%d\n", r);
+		return 1;
+	}
+	data_len = sizeof(data);
+	r = emv_dol_plan_build_data(&plan, &sources, data, &data_len);
+	if (r) {
+		fprintf(stderr, "emv_dol_plan_build_data() failed; r=%d\n", r);
+		return 1;
+	}
+	if (data_len != sizeof(test7_data) ||
+		memcmp(data, test7_data, sizeof(test7_data)) != 0
+	) {
+		fprintf(stderr, "emv_dol_plan_build_data() failed; incorrect output data\n");
+		print_buf("data", data, data_len);
+		print_buf("test7_data", test7_data, sizeof(test7_data));
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTest 9: Compile invalid DOL\n");
+	r = emv_dol_plan_compile(test3_dol, sizeof(test3_dol), &plan);
+	if (r >= 0) {
+		fprintf(stderr, "emv_dol_plan_compile() did not fail; r=%d\n", r);
+		return 1;
+	}
+	if (emv_dol_plan_matches(&plan, test3_dol, sizeof(test3_dol))) {
+		fprintf(stderr, "emv_dol_plan_matches() matched invalid plan\n");
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTest 10: Build DOL data using plan cache\n");
+	memset(&cache, 0, sizeof(cache));
+	cached_plan = emv_dol_plan_cache_get(&cache, test7_dol, sizeof(test7_dol));
+	if (!cached_plan) {
+		fprintf(stderr, "emv_dol_plan_cache_get() failed\n");
+		return 1;
+	}
+	for (size_t i = 0; i < EMV_DOL_PLAN_CACHE_SIZE * 2; ++i) {
+		// Alternate between DOLs without evicting either of them
+		if (emv_dol_plan_cache_get(&cache, test6_dol, sizeof(test6_dol)) == cached_plan ||
+			emv_dol_plan_cache_get(&cache, test7_dol, sizeof(test7_dol)) != cached_plan
+		) {
+			fprintf(stderr, "emv_dol_plan_cache_get() failed; unexpected plan\n");
+			return 1;
+		}
+	}
+	for (size_t i = 0; i < sizeof(data); ++i) { data[i] = i; }
+	data_len = sizeof(data);
+	r = emv_dol_plan_cache_build_data(&cache, test7_dol, sizeof(test7_dol), &sources, data, &data_len);
+	if (r) {
+		fprintf(stderr, "emv_dol_plan_cache_build_data() failed; r=%d\n", r);
+		return 1;
+	}
+	if (data_len != sizeof(test7_data) ||
+		memcmp(data, test7_data, sizeof(test7_data)) != 0
+	) {
+		fprintf(stderr, "emv_dol_plan_cache_build_data() failed; incorrect output data\n");
+		print_buf("data", data, data_len);
+		print_buf("test7_data", test7_data, sizeof(test7_data));
+		return 1;
+	}
+	data_len = sizeof(data);
+	r = emv_dol_plan_cache_build_data(&cache, test3_dol, sizeof(test3_dol), &sources, data, &data_len);
+	if (r >= 0) {
+		fprintf(stderr, "emv_dol_plan_cache_build_data() did not fail for invalid DOL; r=%d\n", r);
+		return 1;
+	}
+	data_len = 8;
+	r = emv_dol_plan_cache_build_data(&cache, test3_dol, sizeof(test3_dol), &sources, data, &data_len);
+	if (r != 1) {
+		fprintf(stderr, "emv_dol_plan_cache_build_data() did not report output data length too small before invalid DOL entry; r=%d\n", r);
+		return 1;
+	}
+	r = emv_dol_plan_cache_build_data(NULL, test7_dol, sizeof(test7_dol), &sources, data, &data_len);
+	if (r != 1) {
+		fprintf(stderr, "emv_dol_plan_cache_build_data() without cache did not report output data length too small; r=%d\n", r);
+		return 1;
+	}
+	data_len = sizeof(data);
+	r = emv_dol_plan_cache_build_data(NULL, test7_dol, sizeof(test7_dol), &sources, data, &data_len);
+	if (r) {
+		fprintf(stderr, "emv_dol_plan_cache_build_data() without cache failed; r=%d\n", r);
+		return 1;
+	}
+	if (data_len != sizeof(test7_data) ||
+		memcmp(data, test7_data, sizeof(test7_data)) != 0
+	) {
+		fprintf(stderr, "emv_dol_plan_cache_build_data() without cache failed; incorrect output data\n");
+		print_buf("data", data, data_len);
+		print_buf("test7_data", test7_data, sizeof(test7_data));
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTest 11: Build DOL data for DOL exceeding plan maximum\n");
+	for (size_t i = 0; i < 12; ++i) {
+		memcpy(test11_dol + (i * sizeof(test7_dol)), test7_dol, sizeof(test7_dol));
+		memcpy(test11_data + (i * sizeof(test7_data)), test7_data, sizeof(test7_data));
+	}
+	r = emv_dol_plan_compile(test11_dol, sizeof(test11_dol), &plan);
+	if (r <= 0) {
+		fprintf(stderr, "emv_dol_plan_compile() did not reject DOL; r=%d\n", r);
+		return 1;
+	}
+	memset(data_large, 0xA5, sizeof(data_large));
+	data_len = sizeof(data_large);
+	r = emv_dol_build_data(test11_dol, sizeof(test11_dol), &sources, data_large, &data_len);
+	if (r) {
+		fprintf(stderr, "emv_dol_build_data() failed; r=%d\n", r);
+		return 1;
+	}
+	if (data_len != sizeof(test11_data) ||
+		memcmp(data_large, test11_data, sizeof(test11_data)) != 0
+	) {
+		fprintf(stderr, "emv_dol_build_data() failed; incorrect output data\n");
+		print_buf("data", data_large, data_len);
+		print_buf("test11_data", test11_data, sizeof(test11_data));
+		return 1;
+	}
+	memset(data_large, 0xA5, sizeof(data_large));
+	data_len = sizeof(data_large);
+	r = emv_dol_plan_cache_build_data(&cache, test11_dol, sizeof(test11_dol), &sources, data_large, &data_len);
+	if (r) {
+		fprintf(stderr, "emv_dol_plan_cache_build_data() failed; r=%d\n", r);
+		return 1;
+	}
+	if (data_len != sizeof(test11_data) ||
+		memcmp(data_large, test11_data, sizeof(test11_data)) != 0
+	) {
+		fprintf(stderr, "emv_dol_plan_cache_build_data() failed; incorrect output data\n");
+		print_buf("data", data_large, data_len);
+		print_buf("test11_data", test11_data, sizeof(test11_data));
+		return 1;
+	}
+	data_len = sizeof(data_large) - 1;
+	r = emv_dol_build_data(test11_dol, sizeof(test11_dol), &sources, data_large, &data_len);
+	if (r != 1) {
+		fprintf(stderr, "emv_dol_build_data() did not detect output too small; r=%d\n", r);
+		return 1;
+	}
+	printf("Success\n");
+
 	emv_tlv_list_clear(&source1);
 	emv_tlv_list_clear(&source2);
 	return 0;
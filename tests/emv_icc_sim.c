@@ -0,0 +1,1357 @@
+/**
+ * @file emv_icc_sim.c
+ * @brief Virtual ICC that computes dynamic responses for kernel testing
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_icc_sim.h"
+#include "emv.h"
+#include "emv_app.h"
+#include "emv_tags.h"
+#include "emv_fields.h"
+#include "emv_dol.h"
+
+#include "crypto_rsa.h"
+#include "crypto_sha.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Built-in test certificate hierarchy. These keys are for testing only and
+// use public exponent 3 such that signature verification is fast.
+static const uint8_t test_exponent[] = { 0x03 };
+
+// 1024-bit test key
+static const uint8_t test_ca_modulus[] = {
+	0xB4, 0xB3, 0xDD, 0x3C, 0x04, 0xE5, 0xEE, 0x1F, 0x0A, 0x8C, 0x01, 0x62, 0x52, 0x0E, 0x43, 0xA4,
+	0x98, 0x36, 0x34, 0x8A, 0x0B, 0x11, 0x51, 0x2F, 0x34, 0x77, 0x72, 0x3A, 0xE3, 0xC5, 0x34, 0xF0,
+	0x0A, 0x09, 0x8C, 0x2F, 0x48, 0xB0, 0x70, 0xE2, 0xCA, 0x70, 0x1B, 0x1A, 0x17, 0xE0, 0xC3, 0x2D,
+	0x8D, 0x2F, 0x79, 0x3A, 0xEB, 0x9B, 0x52, 0x09, 0x77, 0xE3, 0xC8, 0x8C, 0x46, 0xD4, 0xEC, 0x17,
+	0xE7, 0x83, 0x90, 0x3E, 0xF8, 0x1E, 0x16, 0x0C, 0x39, 0x42, 0x30, 0x2C, 0x46, 0x59, 0x49, 0x65,
+	0xDA, 0x72, 0xF6, 0x19, 0x00, 0x73, 0xC0, 0x61, 0x00, 0xFF, 0xE8, 0x62, 0x7E, 0x6C, 0x9F, 0xE3,
+	0xEC, 0x70, 0xC7, 0xC6, 0x4A, 0x99, 0x3A, 0x73, 0x3C, 0xEA, 0x1D, 0x79, 0x67, 0xC9, 0x19, 0xE3,
+	0xBE, 0xDB, 0xFE, 0xAC, 0x46, 0x73, 0xA9, 0xE6, 0xB6, 0x72, 0xC4, 0x4D, 0x2E, 0x8C, 0x1D, 0xDD,
+};
+static const uint8_t test_ca_private_exponent[] = {
+	0x78, 0x77, 0xE8, 0xD2, 0xAD, 0xEE, 0x9E, 0xBF, 0x5C, 0x5D, 0x56, 0x41, 0x8C, 0x09, 0x82, 0x6D,
+	0xBA, 0xCE, 0xCD, 0xB1, 0x5C, 0xB6, 0x36, 0x1F, 0x78, 0x4F, 0xA1, 0x7C, 0x97, 0xD8, 0xCD, 0xF5,
+	0x5C, 0x06, 0x5D, 0x74, 0xDB, 0x20, 0x4B, 0x41, 0xDC, 0x4A, 0xBC, 0xBC, 0x0F, 0xEB, 0x2C, 0xC9,
+	0x08, 0xCA, 0x50, 0xD1, 0xF2, 0x67, 0x8C, 0x06, 0x4F, 0xED, 0x30, 0x5D, 0x84, 0x8D, 0xF2, 0xB9,
+	0x7B, 0x70, 0xA8, 0x4D, 0x63, 0xEC, 0x0D, 0xC9, 0xDC, 0xB9, 0xE8, 0x4F, 0x66, 0x11, 0x01, 0xD7,
+	0x4D, 0xC2, 0x4E, 0x5B, 0x17, 0x77, 0x67, 0xB8, 0x1C, 0x10, 0x3C, 0x4D, 0x8F, 0x0C, 0x14, 0x93,
+	0x9B, 0x4D, 0xD4, 0xCA, 0x75, 0x6C, 0xD3, 0x62, 0xAB, 0x3C, 0xBC, 0xC7, 0x56, 0xAD, 0x56, 0x50,
+	0x43, 0x3B, 0x32, 0xB4, 0x5B, 0xDA, 0xD6, 0xE5, 0x13, 0x29, 0x44, 0xD6, 0xAF, 0x7B, 0xEE, 0x6B,
+};
+
+// 1024-bit test key
+static const uint8_t test_issuer_modulus[] = {
+	0xB9, 0x22, 0x09, 0x20, 0x4B, 0x41, 0x99, 0xFC, 0xF6, 0xB4, 0x31, 0x11, 0x63, 0x78, 0x45, 0xFF,
+	0xB5, 0x5A, 0xCE, 0x6D, 0x50, 0x1E, 0x52, 0xA1, 0x2E, 0x41, 0x27, 0xE7, 0xE8, 0x3D, 0x8E, 0x92,
+	0xED, 0x4E, 0x9C, 0xF8, 0x4B, 0x36, 0x06, 0x1C, 0x36, 0xFF, 0x7B, 0xCB, 0x0C, 0x3A, 0x16, 0x17,
+	0xB8, 0x1B, 0xDC, 0x93, 0x1E, 0xC6, 0x9D, 0xAE, 0x7B, 0xD0, 0x8C, 0xC1, 0x61, 0x38, 0x32, 0xC4,
+	0x8A, 0x39, 0xA8, 0x5B, 0xF6, 0x75, 0x5A, 0x82, 0x7C, 0x70, 0xD6, 0x24, 0x48, 0x04, 0xC1, 0x9A,
+	0x08, 0x99, 0xDA, 0x31, 0x3F, 0x20, 0x2B, 0x3D, 0x79, 0xF5, 0x48, 0x3D, 0x05, 0xFD, 0x32, 0x88,
+	0xDC, 0x1A, 0xBF, 0x51, 0xD5, 0xAE, 0x8E, 0xFE, 0x74, 0x21, 0xF3, 0x2A, 0x31, 0xF0, 0x7B, 0xEC,
+	0x7A, 0x3C, 0xD0, 0x14, 0xDB, 0xD3, 0x66, 0xB8, 0xEC, 0x20, 0x80, 0xE4, 0x94, 0x99, 0x50, 0x2B,
+};
+static const uint8_t test_issuer_private_exponent[] = {
+	0x7B, 0x6C, 0x06, 0x15, 0x87, 0x81, 0x11, 0x53, 0x4F, 0x22, 0xCB, 0x60, 0xEC, 0xFA, 0xD9, 0x55,
+	0x23, 0x91, 0xDE, 0xF3, 0x8A, 0xBE, 0xE1, 0xC0, 0xC9, 0x80, 0xC5, 0x45, 0x45, 0x7E, 0x5F, 0x0C,
+	0x9E, 0x34, 0x68, 0xA5, 0x87, 0x79, 0x59, 0x68, 0x24, 0xAA, 0x52, 0x87, 0x5D, 0x7C, 0x0E, 0xBA,
+	0x7A, 0xBD, 0x3D, 0xB7, 0x69, 0xD9, 0xBE, 0x74, 0x52, 0x8B, 0x08, 0x80, 0xEB, 0x7A, 0xCC, 0x81,
+	0xE3, 0xD5, 0x08, 0x62, 0xA3, 0xA1, 0x73, 0x25, 0x73, 0x59, 0x01, 0x70, 0x69, 0x13, 0x65, 0xE8,
+	0x90, 0x24, 0xBD, 0x9A, 0xD1, 0x4A, 0x67, 0x76, 0x58, 0x75, 0x43, 0x89, 0xC8, 0x5A, 0x3F, 0x48,
+	0x70, 0x0A, 0xB8, 0xFA, 0xDE, 0xF3, 0x29, 0xE6, 0x0E, 0x13, 0xD1, 0xEC, 0x16, 0xF8, 0xA0, 0xC1,
+	0x35, 0x92, 0x02, 0x22, 0xBE, 0xE8, 0xA9, 0xE5, 0x08, 0x95, 0x31, 0x9A, 0x65, 0x10, 0xD3, 0xEB,
+};
+
+// 768-bit test key
+static const uint8_t test_icc_modulus[] = {
+	0xBA, 0xBD, 0x78, 0xA2, 0xE3, 0x93, 0x04, 0x54, 0x58, 0xA0, 0x53, 0x9E, 0xB8, 0xFA, 0x59, 0x60,
+	0x27, 0x3D, 0x5F, 0x8A, 0xC1, 0x77, 0x83, 0x07, 0xD9, 0x07, 0x07, 0x98, 0x42, 0xCF, 0xEE, 0xE0,
+	0xA7, 0xC5, 0x08, 0xAF, 0xCE, 0x93, 0x6C, 0xA4, 0x35, 0xF5, 0xAD, 0xC9, 0xC8, 0xF0, 0xF1, 0xCE,
+	0x45, 0xD0, 0xB2, 0x73, 0x6D, 0x04, 0x1F, 0xCC, 0x20, 0xD5, 0x4A, 0xDC, 0x66, 0xFA, 0x30, 0x75,
+	0x7B, 0xF9, 0xCB, 0x27, 0x0C, 0x72, 0x33, 0xF8, 0x6F, 0x4C, 0xD5, 0x94, 0x6A, 0xAC, 0xFD, 0x6E,
+	0x83, 0x91, 0xD9, 0xE5, 0xA1, 0xFE, 0x24, 0xEB, 0x0D, 0x0D, 0xCC, 0x2A, 0x91, 0x8B, 0xCB, 0x03,
+};
+static const uint8_t test_icc_private_exponent[] = {
+	0x7C, 0x7E, 0x50, 0x6C, 0x97, 0xB7, 0x58, 0x38, 0x3B, 0x15, 0x8D, 0x14, 0x7B, 0x51, 0x90, 0xEA,
+	0xC4, 0xD3, 0x95, 0x07, 0x2B, 0xA5, 0x02, 0x05, 0x3B, 0x5A, 0x05, 0x10, 0x2C, 0x8A, 0x9F, 0x40,
+	0x6F, 0xD8, 0xB0, 0x75, 0x34, 0x62, 0x48, 0x6D, 0x79, 0x4E, 0x73, 0xDB, 0xDB, 0x4B, 0x4B, 0xDD,
+	0xB5, 0x0D, 0x26, 0x87, 0xFF, 0x7B, 0xEE, 0xAF, 0xB4, 0xD5, 0x69, 0x41, 0x5D, 0x14, 0x96, 0xDE,
+	0xC5, 0x97, 0x8A, 0x55, 0x5C, 0x49, 0x2E, 0xFB, 0x4C, 0x8E, 0x94, 0x9F, 0x7F, 0xA6, 0xD5, 0x13,
+	0x30, 0x71, 0x50, 0x79, 0xF8, 0xA6, 0x9D, 0x55, 0x5A, 0x99, 0x48, 0x3C, 0xDB, 0xAD, 0x8A, 0xBB,
+};
+
+static const struct emv_icc_sim_rsa_key_t test_ca_key = {
+	test_ca_modulus, sizeof(test_ca_modulus),
+	test_exponent, sizeof(test_exponent),
+	test_ca_private_exponent,
+};
+
+static const struct emv_icc_sim_rsa_key_t test_issuer_key = {
+	test_issuer_modulus, sizeof(test_issuer_modulus),
+	test_exponent, sizeof(test_exponent),
+	test_issuer_private_exponent,
+};
+
+static const struct emv_icc_sim_rsa_key_t test_icc_key = {
+	test_icc_modulus, sizeof(test_icc_modulus),
+	test_exponent, sizeof(test_exponent),
+	test_icc_private_exponent,
+};
+
+// Default application
+static const uint8_t test_aid[] = { 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10 };
+static const uint8_t test_pan[] = { 0x47, 0x61, 0x73, 0x90, 0x01, 0x01, 0x00, 0x10 };
+
+// Data object lists presented by every simulated application
+static const uint8_t sim_pdol[] = { 0x9F, 0x1A, 0x02, 0x9F, 0x37, 0x04 };
+static const uint8_t sim_cdol1[] = {
+	0x9F, 0x02, 0x06, 0x9F, 0x03, 0x06, 0x9F, 0x1A, 0x02, 0x95, 0x05,
+	0x5F, 0x2A, 0x02, 0x9A, 0x03, 0x9C, 0x01, 0x9F, 0x37, 0x04,
+};
+static const uint8_t sim_cdol2[] = { 0x8A, 0x02, 0x95, 0x05, 0x9F, 0x37, 0x04 };
+static const uint8_t sim_ddol[] = { 0x9F, 0x37, 0x04 };
+
+static const uint8_t sim_pse_name[] = "1PAY.SYS.DDF01";
+static const uint8_t sim_iad[] = { 0x06, 0x01, 0x0A, 0x03, 0xA0, 0x00, 0x00 };
+static const uint8_t sim_cert_exp[] = { 0x12, 0x49 }; // MMYY
+static const uint8_t sim_cert_sn[] = { 0x00, 0x00, 0x01 };
+static const uint8_t sim_dac[] = { 0xDA, 0xC0 };
+
+// Key used to derive application cryptograms. The simulated cryptogram is
+// not verified by the terminal and therefore only needs to be unique per
+// transaction.
+static const uint8_t sim_ac_key[] = {
+	0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+	0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10,
+};
+
+#define SIM_HASH_LEN (SHA1_SIZE)
+#define SIM_AC_LEN (8)
+#define SIM_DYNAMIC_NUMBER_LEN (8)
+
+// Helper struct for building BER encoded responses
+struct emv_icc_sim_buf_t {
+	uint8_t* ptr;
+	size_t size;
+	size_t len;
+};
+
+// Helper struct for hash inputs that follow a signed data block
+struct emv_icc_sim_data_t {
+	const void* ptr;
+	size_t len;
+};
+
+static int emv_icc_sim_buf_append(
+	struct emv_icc_sim_buf_t* buf,
+	const void* ptr,
+	size_t len
+)
+{
+	if (len > buf->size - buf->len) {
+		return -1;
+	}
+	if (len) {
+		memcpy(buf->ptr + buf->len, ptr, len);
+		buf->len += len;
+	}
+
+	return 0;
+}
+
+static int emv_icc_sim_buf_put(
+	struct emv_icc_sim_buf_t* buf,
+	unsigned int tag,
+	const void* value,
+	size_t len
+)
+{
+	uint8_t hdr[5];
+	size_t hdr_len = 0;
+
+	if (tag > 0xFF) {
+		hdr[hdr_len++] = tag >> 8;
+	}
+	hdr[hdr_len++] = tag;
+
+	if (len < 0x80) {
+		hdr[hdr_len++] = len;
+	} else if (len <= 0xFF) {
+		hdr[hdr_len++] = 0x81;
+		hdr[hdr_len++] = len;
+	} else if (len <= 0xFFFF) {
+		hdr[hdr_len++] = 0x82;
+		hdr[hdr_len++] = len >> 8;
+		hdr[hdr_len++] = len;
+	} else {
+		return -1;
+	}
+
+	if (emv_icc_sim_buf_append(buf, hdr, hdr_len)) {
+		return -1;
+	}
+	return emv_icc_sim_buf_append(buf, value, len);
+}
+
+static int emv_icc_sim_dol_find(
+	const uint8_t* dol,
+	size_t dol_len,
+	unsigned int tag,
+	size_t* offset
+)
+{
+	int r;
+	struct emv_dol_itr_t itr;
+	struct emv_dol_entry_t entry;
+	size_t pos = 0;
+
+	r = emv_dol_itr_init(dol, dol_len, &itr);
+	if (r) {
+		return -1;
+	}
+	while ((r = emv_dol_itr_next(&itr, &entry)) > 0) {
+		if (entry.tag == tag) {
+			*offset = pos;
+			return 0;
+		}
+		pos += entry.length;
+	}
+
+	return -1;
+}
+
+static int emv_icc_sim_sign(
+	const struct emv_icc_sim_rsa_key_t* key,
+	uint8_t* block,
+	const struct emv_icc_sim_data_t* data,
+	size_t data_count,
+	uint8_t* sig
+)
+{
+	int r;
+	size_t n = key->modulus_len;
+	crypto_sha1_ctx_t sha1_ctx;
+
+	// The caller populates the header and body of the data block. This
+	// function appends the hash and trailer, and then applies the private
+	// key. See EMV 4.4 Book 2, Annex A2.1
+	r = crypto_sha1_init(&sha1_ctx);
+	if (r) {
+		return -1;
+	}
+	r = crypto_sha1_update(&sha1_ctx, block + 1, n - SIM_HASH_LEN - 2);
+	for (size_t i = 0; !r && i < data_count; ++i) {
+		if (data[i].len) {
+			r = crypto_sha1_update(&sha1_ctx, data[i].ptr, data[i].len);
+		}
+	}
+	if (!r) {
+		r = crypto_sha1_finish(&sha1_ctx, block + n - SIM_HASH_LEN - 1);
+	}
+	crypto_sha1_free(&sha1_ctx);
+	if (r) {
+		return -1;
+	}
+	block[n - 1] = 0xBC;
+
+	r = crypto_rsa_mod_exp(
+		key->modulus,
+		n,
+		key->private_exponent,
+		n,
+		block,
+		sig
+	);
+	if (r) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int emv_icc_sim_build_issuer_cert(
+	const struct emv_icc_sim_config_t* config,
+	const struct emv_icc_sim_rsa_key_t* ca_key,
+	const struct emv_icc_sim_rsa_key_t* issuer_key,
+	struct emv_icc_sim_buf_t* record
+)
+{
+	int r;
+	uint8_t block[EMV_RAPDU_DATA_MAX];
+	uint8_t cert[EMV_RAPDU_DATA_MAX];
+	size_t n = ca_key->modulus_len;
+	size_t leftmost_len = n - 36;
+	size_t remainder_len = 0;
+
+	if (n < 64 || n > sizeof(block) ||
+		issuer_key->modulus_len > 248 ||
+		issuer_key->exponent_len > 3
+	) {
+		return -1;
+	}
+
+	// Issuer Public Key Certificate
+	// See EMV 4.4 Book 2, 5.3, Table 6
+	memset(block, 0xBB, n);
+	block[0] = 0x6A;
+	block[1] = 0x02;
+	memset(block + 2, 0xFF, 4);
+	memcpy(block + 2, config->pan, 3); // Leftmost 6 PAN digits
+	memcpy(block + 6, sim_cert_exp, sizeof(sim_cert_exp));
+	memcpy(block + 8, sim_cert_sn, sizeof(sim_cert_sn));
+	block[11] = EMV_PKEY_HASH_SHA1;
+	block[12] = EMV_PKEY_SIG_RSA_SHA1;
+	block[13] = issuer_key->modulus_len;
+	block[14] = issuer_key->exponent_len;
+	if (issuer_key->modulus_len > leftmost_len) {
+		remainder_len = issuer_key->modulus_len - leftmost_len;
+		memcpy(block + 15, issuer_key->modulus, leftmost_len);
+	} else {
+		memcpy(block + 15, issuer_key->modulus, issuer_key->modulus_len);
+	}
+
+	r = emv_icc_sim_sign(
+		ca_key,
+		block,
+		(struct emv_icc_sim_data_t[]){
+			{ remainder_len ? issuer_key->modulus + leftmost_len : NULL, remainder_len },
+			{ issuer_key->exponent, issuer_key->exponent_len },
+		},
+		2,
+		cert
+	);
+	if (r) {
+		return r;
+	}
+
+	if (emv_icc_sim_buf_put(record, EMV_TAG_8F_CERTIFICATION_AUTHORITY_PUBLIC_KEY_INDEX, &config->capk_index, 1) ||
+		emv_icc_sim_buf_put(record, EMV_TAG_90_ISSUER_PUBLIC_KEY_CERTIFICATE, cert, n) ||
+		(remainder_len && emv_icc_sim_buf_put(record, EMV_TAG_92_ISSUER_PUBLIC_KEY_REMAINDER, issuer_key->modulus + leftmost_len, remainder_len)) ||
+		emv_icc_sim_buf_put(record, EMV_TAG_9F32_ISSUER_PUBLIC_KEY_EXPONENT, issuer_key->exponent, issuer_key->exponent_len)
+	) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int emv_icc_sim_build_ssad(
+	const struct emv_icc_sim_rsa_key_t* issuer_key,
+	const uint8_t* static_data,
+	size_t static_data_len,
+	struct emv_icc_sim_buf_t* record
+)
+{
+	int r;
+	uint8_t block[EMV_RAPDU_DATA_MAX];
+	uint8_t ssad[EMV_RAPDU_DATA_MAX];
+	size_t n = issuer_key->modulus_len;
+
+	// Signed Static Application Data
+	// See EMV 4.4 Book 2, 5.4, Table 7
+	memset(block, 0xBB, n);
+	block[0] = 0x6A;
+	block[1] = 0x03;
+	block[2] = EMV_PKEY_HASH_SHA1;
+	memcpy(block + 3, sim_dac, sizeof(sim_dac));
+
+	r = emv_icc_sim_sign(
+		issuer_key,
+		block,
+		(struct emv_icc_sim_data_t[]){
+			{ static_data, static_data_len },
+		},
+		1,
+		ssad
+	);
+	if (r) {
+		return r;
+	}
+
+	return emv_icc_sim_buf_put(record, EMV_TAG_93_SIGNED_STATIC_APPLICATION_DATA, ssad, n);
+}
+
+static int emv_icc_sim_build_icc_cert(
+	const struct emv_icc_sim_config_t* config,
+	const struct emv_icc_sim_rsa_key_t* issuer_key,
+	const struct emv_icc_sim_rsa_key_t* icc_key,
+	const uint8_t* static_data,
+	size_t static_data_len,
+	struct emv_icc_sim_buf_t* record
+)
+{
+	int r;
+	uint8_t block[EMV_RAPDU_DATA_MAX];
+	uint8_t cert[EMV_RAPDU_DATA_MAX];
+	size_t n = issuer_key->modulus_len;
+	size_t leftmost_len = n - 42;
+	size_t remainder_len = 0;
+
+	if (icc_key->modulus_len > 248 ||
+		icc_key->exponent_len > 3
+	) {
+		return -1;
+	}
+
+	// ICC Public Key Certificate
+	// See EMV 4.4 Book 2, 6.3, Table 14
+	memset(block, 0xBB, n);
+	block[0] = 0x6A;
+	block[1] = 0x04;
+	memset(block + 2, 0xFF, 10);
+	memcpy(block + 2, config->pan, config->pan_len);
+	memcpy(block + 12, sim_cert_exp, sizeof(sim_cert_exp));
+	memcpy(block + 14, sim_cert_sn, sizeof(sim_cert_sn));
+	block[17] = EMV_PKEY_HASH_SHA1;
+	block[18] = EMV_PKEY_SIG_RSA_SHA1;
+	block[19] = icc_key->modulus_len;
+	block[20] = icc_key->exponent_len;
+	if (icc_key->modulus_len > leftmost_len) {
+		remainder_len = icc_key->modulus_len - leftmost_len;
+		memcpy(block + 21, icc_key->modulus, leftmost_len);
+	} else {
+		memcpy(block + 21, icc_key->modulus, icc_key->modulus_len);
+	}
+
+	r = emv_icc_sim_sign(
+		issuer_key,
+		block,
+		(struct emv_icc_sim_data_t[]){
+			{ remainder_len ? icc_key->modulus + leftmost_len : NULL, remainder_len },
+			{ icc_key->exponent, icc_key->exponent_len },
+			{ static_data, static_data_len },
+		},
+		3,
+		cert
+	);
+	if (r) {
+		return r;
+	}
+
+	if (emv_icc_sim_buf_put(record, EMV_TAG_9F46_ICC_PUBLIC_KEY_CERTIFICATE, cert, n) ||
+		emv_icc_sim_buf_put(record, EMV_TAG_9F47_ICC_PUBLIC_KEY_EXPONENT, icc_key->exponent, icc_key->exponent_len) ||
+		(remainder_len && emv_icc_sim_buf_put(record, EMV_TAG_9F48_ICC_PUBLIC_KEY_REMAINDER, icc_key->modulus + leftmost_len, remainder_len)) ||
+		emv_icc_sim_buf_put(record, EMV_TAG_9F49_DDOL, sim_ddol, sizeof(sim_ddol))
+	) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int emv_icc_sim_wrap_record(
+	uint8_t* record,
+	size_t* record_len,
+	const struct emv_icc_sim_buf_t* value
+)
+{
+	struct emv_icc_sim_buf_t buf = { record, EMV_RAPDU_DATA_MAX, 0 };
+
+	if (emv_icc_sim_buf_put(&buf, EMV_TAG_70_DATA_TEMPLATE, value->ptr, value->len)) {
+		return -1;
+	}
+	*record_len = buf.len;
+
+	return 0;
+}
+
+static int emv_icc_sim_app_init(
+	struct emv_icc_sim_app_t* app,
+	const struct emv_icc_sim_app_config_t* app_config,
+	const struct emv_icc_sim_config_t* config,
+	const struct emv_icc_sim_rsa_key_t* ca_key,
+	const struct emv_icc_sim_rsa_key_t* issuer_key,
+	const struct emv_icc_sim_rsa_key_t* icc_key
+)
+{
+	int r;
+	uint8_t tmp[EMV_RAPDU_DATA_MAX];
+	struct emv_icc_sim_buf_t buf;
+	uint8_t a5[EMV_RAPDU_DATA_MAX];
+	struct emv_icc_sim_buf_t a5_buf = { a5, sizeof(a5), 0 };
+	uint8_t static_data[EMV_RAPDU_DATA_MAX + sizeof(app->aip)];
+	size_t static_data_len;
+
+	if (!app_config->aid ||
+		app_config->aid_len < 5 ||
+		app_config->aid_len > sizeof(app->aid)
+	) {
+		return -1;
+	}
+
+	memset(app, 0, sizeof(*app));
+	memcpy(app->aid, app_config->aid, app_config->aid_len);
+	app->aid_len = app_config->aid_len;
+	app->oda = app_config->oda;
+
+	// File Control Information (FCI)
+	// See EMV 4.4 Book 1, 11.3.4, Table 8
+	if (app_config->label &&
+		emv_icc_sim_buf_put(&a5_buf, EMV_TAG_50_APPLICATION_LABEL, app_config->label, strlen(app_config->label))
+	) {
+		return -1;
+	}
+	if (emv_icc_sim_buf_put(&a5_buf, EMV_TAG_87_APPLICATION_PRIORITY_INDICATOR, &app_config->priority, 1) ||
+		emv_icc_sim_buf_put(&a5_buf, EMV_TAG_9F38_PDOL, sim_pdol, sizeof(sim_pdol))
+	) {
+		return -1;
+	}
+	buf = (struct emv_icc_sim_buf_t){ tmp, sizeof(tmp), 0 };
+	if (emv_icc_sim_buf_put(&buf, EMV_TAG_84_DF_NAME, app->aid, app->aid_len) ||
+		emv_icc_sim_buf_put(&buf, EMV_TAG_A5_FCI_PROPRIETARY_TEMPLATE, a5, a5_buf.len)
+	) {
+		return -1;
+	}
+	{
+		struct emv_icc_sim_buf_t fci_buf = { app->fci, sizeof(app->fci), 0 };
+		if (emv_icc_sim_buf_put(&fci_buf, EMV_TAG_6F_FCI_TEMPLATE, tmp, buf.len)) {
+			return -1;
+		}
+		app->fci_len = fci_buf.len;
+	}
+
+	// Application Interchange Profile (AIP)
+	switch (app->oda) {
+		case EMV_ICC_SIM_ODA_NONE:
+			break;
+
+		case EMV_ICC_SIM_ODA_SDA:
+			app->aip[0] = EMV_AIP_SDA_SUPPORTED;
+			break;
+
+		case EMV_ICC_SIM_ODA_DDA:
+			app->aip[0] = EMV_AIP_DDA_SUPPORTED;
+			break;
+
+		case EMV_ICC_SIM_ODA_CDA:
+			app->aip[0] = EMV_AIP_DDA_SUPPORTED | EMV_AIP_CDA_SUPPORTED;
+			break;
+
+		default:
+			return -1;
+	}
+
+	// First record contains the application data and is the only record
+	// that is included in the static data to be authenticated
+	buf = (struct emv_icc_sim_buf_t){ tmp, sizeof(tmp), 0 };
+	if (emv_icc_sim_buf_put(&buf, EMV_TAG_5A_APPLICATION_PAN, config->pan, config->pan_len) ||
+		emv_icc_sim_buf_put(&buf, EMV_TAG_5F24_APPLICATION_EXPIRATION_DATE, config->expiration_date, sizeof(config->expiration_date)) ||
+		emv_icc_sim_buf_put(&buf, EMV_TAG_5F34_APPLICATION_PAN_SEQUENCE_NUMBER, &config->pan_seq, 1) ||
+		emv_icc_sim_buf_put(&buf, EMV_TAG_8C_CDOL1, sim_cdol1, sizeof(sim_cdol1)) ||
+		emv_icc_sim_buf_put(&buf, EMV_TAG_8D_CDOL2, sim_cdol2, sizeof(sim_cdol2)) ||
+		(app->oda != EMV_ICC_SIM_ODA_NONE && emv_icc_sim_buf_put(&buf, EMV_TAG_9F4A_SDA_TAG_LIST, (uint8_t[]){ EMV_TAG_82_APPLICATION_INTERCHANGE_PROFILE }, 1)) ||
+		emv_icc_sim_buf_append(&buf, config->record_data, config->record_data_len) ||
+		emv_icc_sim_wrap_record(app->record[0], &app->record_len[0], &buf)
+	) {
+		return -1;
+	}
+
+	// Static data to be authenticated consists of the record template value
+	// followed by the AIP as specified by the SDA Tag List (field 9F4A)
+	// See EMV 4.4 Book 3, 10.3
+	memcpy(static_data, buf.ptr, buf.len);
+	memcpy(static_data + buf.len, app->aip, sizeof(app->aip));
+	static_data_len = buf.len + sizeof(app->aip);
+
+	if (app->oda == EMV_ICC_SIM_ODA_NONE) {
+		// Application File Locator (AFL) for SFI 1, record 1
+		memcpy(app->afl, (uint8_t[]){ 0x08, 0x01, 0x01, 0x00 }, 4);
+		app->afl_len = 4;
+		return 0;
+	}
+
+	// Second record contains the issuer public key certificate
+	buf = (struct emv_icc_sim_buf_t){ tmp, sizeof(tmp), 0 };
+	r = emv_icc_sim_build_issuer_cert(config, ca_key, issuer_key, &buf);
+	if (r) {
+		return r;
+	}
+	if (emv_icc_sim_wrap_record(app->record[1], &app->record_len[1], &buf)) {
+		return -1;
+	}
+
+	// Third record contains either the signed static application data or
+	// the ICC public key certificate
+	buf = (struct emv_icc_sim_buf_t){ tmp, sizeof(tmp), 0 };
+	if (app->oda == EMV_ICC_SIM_ODA_SDA) {
+		r = emv_icc_sim_build_ssad(issuer_key, static_data, static_data_len, &buf);
+	} else {
+		r = emv_icc_sim_build_icc_cert(config, issuer_key, icc_key, static_data, static_data_len, &buf);
+	}
+	if (r) {
+		return r;
+	}
+	if (emv_icc_sim_wrap_record(app->record[2], &app->record_len[2], &buf)) {
+		return -1;
+	}
+
+	// Application File Locator (AFL) for SFI 1, record 1 (signed) and
+	// SFI 2, records 1 - 2
+	memcpy(app->afl, (uint8_t[]){ 0x08, 0x01, 0x01, 0x01, 0x10, 0x01, 0x02, 0x00 }, 8);
+	app->afl_len = 8;
+
+	return 0;
+}
+
+static int emv_icc_sim_capk_init(
+	struct emv_capk_t* capk,
+	uint8_t* capk_hash,
+	const uint8_t* rid,
+	uint8_t index,
+	const struct emv_icc_sim_rsa_key_t* ca_key
+)
+{
+	int r;
+	crypto_sha1_ctx_t sha1_ctx;
+
+	capk->rid = rid;
+	capk->index = index;
+	capk->hash_id = EMV_PKEY_HASH_SHA1;
+	capk->modulus = ca_key->modulus;
+	capk->modulus_len = ca_key->modulus_len;
+	capk->exponent = ca_key->exponent;
+	capk->exponent_len = ca_key->exponent_len;
+	capk->hash = capk_hash;
+	capk->hash_len = SIM_HASH_LEN;
+
+	r = crypto_sha1_init(&sha1_ctx);
+	if (!r) {
+		r = crypto_sha1_update(&sha1_ctx, rid, EMV_CAPK_RID_LEN);
+	}
+	if (!r) {
+		r = crypto_sha1_update(&sha1_ctx, &index, sizeof(index));
+	}
+	if (!r) {
+		r = crypto_sha1_update(&sha1_ctx, ca_key->modulus, ca_key->modulus_len);
+	}
+	if (!r) {
+		r = crypto_sha1_update(&sha1_ctx, ca_key->exponent, ca_key->exponent_len);
+	}
+	if (!r) {
+		r = crypto_sha1_finish(&sha1_ctx, capk_hash);
+	}
+	crypto_sha1_free(&sha1_ctx);
+	if (r) {
+		return -1;
+	}
+
+	return 0;
+}
+
+void emv_icc_sim_config_init(
+	struct emv_icc_sim_config_t* config,
+	enum emv_icc_sim_oda_t oda
+)
+{
+	memset(config, 0, sizeof(*config));
+
+	config->app[0].aid = test_aid;
+	config->app[0].aid_len = sizeof(test_aid);
+	config->app[0].label = "VISA CREDIT";
+	config->app[0].priority = 0x01;
+	config->app[0].oda = oda;
+	config->app_count = 1;
+	config->pse = true;
+
+	config->pan = test_pan;
+	config->pan_len = sizeof(test_pan);
+	config->pan_seq = 0x01;
+	config->expiration_date[0] = 0x49;
+	config->expiration_date[1] = 0x12;
+	config->expiration_date[2] = 0x31;
+
+	config->capk_index = 0xFA;
+}
+
+int emv_icc_sim_init(
+	struct emv_icc_sim_t* sim,
+	const struct emv_icc_sim_config_t* config
+)
+{
+	int r;
+	const struct emv_icc_sim_rsa_key_t* ca_key;
+	const struct emv_icc_sim_rsa_key_t* issuer_key;
+	uint8_t dir[EMV_RAPDU_DATA_MAX];
+	struct emv_icc_sim_buf_t dir_buf = { dir, sizeof(dir), 0 };
+
+	if (!sim || !config) {
+		return -1;
+	}
+	if (!config->app_count || config->app_count > EMV_ICC_SIM_APP_MAX) {
+		return -1;
+	}
+	if (!config->pan || config->pan_len < 6 || config->pan_len > 10) {
+		return -1;
+	}
+	if (config->record_data_len && !config->record_data) {
+		return -1;
+	}
+
+	memset(sim, 0, sizeof(*sim));
+	ca_key = config->ca_key ? config->ca_key : &test_ca_key;
+	issuer_key = config->issuer_key ? config->issuer_key : &test_issuer_key;
+	sim->icc_key = config->icc_key ? config->icc_key : &test_icc_key;
+	if (issuer_key->modulus_len > ca_key->modulus_len ||
+		sim->icc_key->modulus_len > issuer_key->modulus_len ||
+		issuer_key->modulus_len < 64 ||
+		sim->icc_key->modulus_len < 64
+	) {
+		return -1;
+	}
+
+	for (unsigned int i = 0; i < config->app_count; ++i) {
+		const struct emv_icc_sim_app_config_t* app_config = &config->app[i];
+		struct emv_icc_sim_app_t* app = &sim->app[i];
+		uint8_t entry[EMV_RAPDU_DATA_MAX];
+		struct emv_icc_sim_buf_t entry_buf = { entry, sizeof(entry), 0 };
+
+		r = emv_icc_sim_app_init(app, app_config, config, ca_key, issuer_key, sim->icc_key);
+		if (r) {
+			return r;
+		}
+
+		r = emv_icc_sim_capk_init(
+			&sim->capk[i],
+			app->capk_hash,
+			app->aid,
+			config->capk_index,
+			ca_key
+		);
+		if (r) {
+			return r;
+		}
+
+		// Payment System Directory entry
+		// See EMV 4.4 Book 1, 12.2.3, Table 12
+		if (emv_icc_sim_buf_put(&entry_buf, EMV_TAG_4F_APPLICATION_DF_NAME, app->aid, app->aid_len) ||
+			(app_config->label && emv_icc_sim_buf_put(&entry_buf, EMV_TAG_50_APPLICATION_LABEL, app_config->label, strlen(app_config->label))) ||
+			emv_icc_sim_buf_put(&entry_buf, EMV_TAG_87_APPLICATION_PRIORITY_INDICATOR, &app_config->priority, 1) ||
+			emv_icc_sim_buf_put(&dir_buf, EMV_TAG_61_APPLICATION_TEMPLATE, entry, entry_buf.len)
+		) {
+			return -1;
+		}
+	}
+	sim->app_count = config->app_count;
+	sim->capk_count = config->app_count;
+
+	sim->pse = config->pse;
+	if (sim->pse) {
+		struct emv_icc_sim_buf_t buf = { sim->dir_record, sizeof(sim->dir_record), 0 };
+
+		if (emv_icc_sim_buf_put(&buf, EMV_TAG_70_DATA_TEMPLATE, dir, dir_buf.len)) {
+			return -1;
+		}
+		sim->dir_record_len = buf.len;
+	}
+
+	return 0;
+}
+
+void emv_icc_sim_reset(struct emv_icc_sim_t* sim)
+{
+	sim->selected = EMV_ICC_SIM_SELECTED_NONE;
+	sim->app_idx = 0;
+	sim->select_next = 0;
+	sim->gpo_done = false;
+	sim->genac_count = 0;
+	sim->pdol_data_len = 0;
+	sim->cdol1_data_len = 0;
+}
+
+static int emv_icc_sim_sign_dynamic(
+	struct emv_icc_sim_t* sim,
+	const uint8_t* dynamic_data,
+	size_t dynamic_data_len,
+	const uint8_t* hash_data,
+	size_t hash_data_len,
+	uint8_t* sdad
+)
+{
+	uint8_t block[EMV_RAPDU_DATA_MAX];
+	size_t n = sim->icc_key->modulus_len;
+
+	if (dynamic_data_len > n - 25) {
+		return -1;
+	}
+
+	// Signed Dynamic Application Data
+	// See EMV 4.4 Book 2, 6.5.1, Table 17
+	memset(block, 0xBB, n);
+	block[0] = 0x6A;
+	block[1] = 0x05;
+	block[2] = EMV_PKEY_HASH_SHA1;
+	block[3] = dynamic_data_len;
+	memcpy(block + 4, dynamic_data, dynamic_data_len);
+
+	++sim->sign_count;
+	return emv_icc_sim_sign(
+		sim->icc_key,
+		block,
+		(struct emv_icc_sim_data_t[]){
+			{ hash_data, hash_data_len },
+		},
+		1,
+		sdad
+	);
+}
+
+static size_t emv_icc_sim_next_dynamic_number(struct emv_icc_sim_t* sim, uint8_t* buf)
+{
+	uint64_t dn = ++sim->dynamic_number;
+
+	for (int i = SIM_DYNAMIC_NUMBER_LEN - 1; i >= 0; --i) {
+		buf[i] = dn;
+		dn >>= 8;
+	}
+
+	return SIM_DYNAMIC_NUMBER_LEN;
+}
+
+static uint16_t emv_icc_sim_select(
+	struct emv_icc_sim_t* sim,
+	uint8_t p2,
+	const uint8_t* data,
+	size_t data_len,
+	struct emv_icc_sim_buf_t* rx
+)
+{
+	unsigned int start = 0;
+
+	emv_icc_sim_reset(sim);
+
+	if (data_len == sizeof(sim_pse_name) - 1 &&
+		memcmp(data, sim_pse_name, data_len) == 0
+	) {
+		uint8_t a5[3] = { EMV_TAG_88_SFI, 0x01, 0x01 };
+		uint8_t tmp[32];
+		struct emv_icc_sim_buf_t buf = { tmp, sizeof(tmp), 0 };
+
+		if (!sim->pse) {
+			return 0x6A82;
+		}
+
+		if (emv_icc_sim_buf_put(&buf, EMV_TAG_84_DF_NAME, data, data_len) ||
+			emv_icc_sim_buf_put(&buf, EMV_TAG_A5_FCI_PROPRIETARY_TEMPLATE, a5, sizeof(a5)) ||
+			emv_icc_sim_buf_put(rx, EMV_TAG_6F_FCI_TEMPLATE, tmp, buf.len)
+		) {
+			return 0x6F00;
+		}
+		sim->selected = EMV_ICC_SIM_SELECTED_PSE;
+		return 0x9000;
+	}
+
+	if ((p2 & 0x03) == 0x02) {
+		// Select next occurrence
+		start = sim->select_next;
+	}
+	for (unsigned int i = start; i < sim->app_count; ++i) {
+		const struct emv_icc_sim_app_t* app = &sim->app[i];
+
+		// Allow partial selection by prefix
+		// See EMV 4.4 Book 1, 12.3.1
+		if (data_len <= app->aid_len &&
+			memcmp(data, app->aid, data_len) == 0
+		) {
+			if (emv_icc_sim_buf_append(rx, app->fci, app->fci_len)) {
+				return 0x6F00;
+			}
+			sim->selected = EMV_ICC_SIM_SELECTED_APP;
+			sim->app_idx = i;
+			sim->select_next = i + 1;
+			return 0x9000;
+		}
+	}
+
+	return 0x6A82;
+}
+
+static uint16_t emv_icc_sim_read_record(
+	struct emv_icc_sim_t* sim,
+	uint8_t p1,
+	uint8_t p2,
+	struct emv_icc_sim_buf_t* rx
+)
+{
+	uint8_t sfi = p2 >> 3;
+	const uint8_t* record = NULL;
+	size_t record_len = 0;
+
+	if ((p2 & 0x07) != 0x04) {
+		return 0x6A86;
+	}
+
+	if (sim->selected == EMV_ICC_SIM_SELECTED_PSE) {
+		if (sfi == 1 && p1 == 1) {
+			record = sim->dir_record;
+			record_len = sim->dir_record_len;
+		}
+	} else if (sim->selected == EMV_ICC_SIM_SELECTED_APP) {
+		const struct emv_icc_sim_app_t* app = &sim->app[sim->app_idx];
+
+		if (sfi == 1 && p1 == 1) {
+			record = app->record[0];
+			record_len = app->record_len[0];
+		} else if (sfi == 2 && (p1 == 1 || p1 == 2)) {
+			record = app->record[p1];
+			record_len = app->record_len[p1];
+		}
+	} else {
+		return 0x6985;
+	}
+
+	if (!record_len) {
+		return 0x6A83;
+	}
+	if (emv_icc_sim_buf_append(rx, record, record_len)) {
+		return 0x6F00;
+	}
+
+	return 0x9000;
+}
+
+static uint16_t emv_icc_sim_gpo(
+	struct emv_icc_sim_t* sim,
+	const uint8_t* data,
+	size_t data_len,
+	struct emv_icc_sim_buf_t* rx
+)
+{
+	const struct emv_icc_sim_app_t* app;
+	int pdol_data_len = emv_dol_compute_data_length(sim_pdol, sizeof(sim_pdol));
+	uint8_t tmp[32];
+	struct emv_icc_sim_buf_t buf = { tmp, sizeof(tmp), 0 };
+
+	if (sim->selected != EMV_ICC_SIM_SELECTED_APP || sim->gpo_done) {
+		return 0x6985;
+	}
+	app = &sim->app[sim->app_idx];
+
+	// Command Template (field 83) containing PDOL data
+	if (data_len != 2 + (size_t)pdol_data_len ||
+		data[0] != 0x83 ||
+		data[1] != pdol_data_len
+	) {
+		return 0x6700;
+	}
+	memcpy(sim->pdol_data, data + 2, pdol_data_len);
+	sim->pdol_data_len = pdol_data_len;
+
+	++sim->atc;
+	sim->gpo_done = true;
+
+	if (emv_icc_sim_buf_put(&buf, EMV_TAG_82_APPLICATION_INTERCHANGE_PROFILE, app->aip, sizeof(app->aip)) ||
+		emv_icc_sim_buf_put(&buf, EMV_TAG_94_APPLICATION_FILE_LOCATOR, app->afl, app->afl_len) ||
+		emv_icc_sim_buf_put(rx, EMV_TAG_77_RESPONSE_MESSAGE_TEMPLATE_FORMAT_2, tmp, buf.len)
+	) {
+		return 0x6F00;
+	}
+
+	return 0x9000;
+}
+
+static uint16_t emv_icc_sim_get_data(
+	struct emv_icc_sim_t* sim,
+	uint8_t p1,
+	uint8_t p2,
+	struct emv_icc_sim_buf_t* rx
+)
+{
+	unsigned int tag = (p1 << 8) | p2;
+	uint8_t value[2];
+	size_t value_len;
+
+	switch (tag) {
+		case EMV_TAG_9F36_APPLICATION_TRANSACTION_COUNTER:
+			value[0] = sim->atc >> 8;
+			value[1] = sim->atc;
+			value_len = 2;
+			break;
+
+		case EMV_TAG_9F13_LAST_ONLINE_ATC_REGISTER:
+			value[0] = 0;
+			value[1] = 0;
+			value_len = 2;
+			break;
+
+		case EMV_TAG_9F17_PIN_TRY_COUNTER:
+			value[0] = 3;
+			value_len = 1;
+			break;
+
+		default:
+			return 0x6A88;
+	}
+
+	if (emv_icc_sim_buf_put(rx, tag, value, value_len)) {
+		return 0x6F00;
+	}
+
+	return 0x9000;
+}
+
+static uint16_t emv_icc_sim_internal_authenticate(
+	struct emv_icc_sim_t* sim,
+	const uint8_t* data,
+	size_t data_len,
+	struct emv_icc_sim_buf_t* rx
+)
+{
+	const struct emv_icc_sim_app_t* app;
+	uint8_t dynamic_data[1 + SIM_DYNAMIC_NUMBER_LEN];
+	uint8_t sdad[EMV_RAPDU_DATA_MAX];
+
+	if (sim->selected != EMV_ICC_SIM_SELECTED_APP || !sim->gpo_done) {
+		return 0x6985;
+	}
+	app = &sim->app[sim->app_idx];
+	if (app->oda != EMV_ICC_SIM_ODA_DDA && app->oda != EMV_ICC_SIM_ODA_CDA) {
+		return 0x6D00;
+	}
+
+	// ICC Dynamic Data for DDA
+	// See EMV 4.4 Book 2, 6.5.1, Table 18
+	dynamic_data[0] = emv_icc_sim_next_dynamic_number(sim, dynamic_data + 1);
+
+	if (emv_icc_sim_sign_dynamic(sim, dynamic_data, sizeof(dynamic_data), data, data_len, sdad)) {
+		return 0x6F00;
+	}
+	if (emv_icc_sim_buf_put(rx, EMV_TAG_80_RESPONSE_MESSAGE_TEMPLATE_FORMAT_1, sdad, sim->icc_key->modulus_len)) {
+		return 0x6F00;
+	}
+
+	return 0x9000;
+}
+
+static uint16_t emv_icc_sim_genac(
+	struct emv_icc_sim_t* sim,
+	uint8_t p1,
+	const uint8_t* data,
+	size_t data_len,
+	struct emv_icc_sim_buf_t* rx
+)
+{
+	int r;
+	const struct emv_icc_sim_app_t* app;
+	const uint8_t* dol;
+	size_t dol_len;
+	size_t un_offset;
+	uint8_t atc[2];
+	uint8_t cid;
+	uint8_t ac[SIM_HASH_LEN];
+	uint8_t fields[64];
+	struct emv_icc_sim_buf_t fields_buf = { fields, sizeof(fields), 0 };
+	crypto_sha1_ctx_t sha1_ctx;
+
+	if (sim->selected != EMV_ICC_SIM_SELECTED_APP ||
+		!sim->gpo_done ||
+		sim->genac_count > 1
+	) {
+		return 0x6985;
+	}
+	app = &sim->app[sim->app_idx];
+
+	if ((p1 & EMV_TTL_GENAC_TYPE_MASK) == EMV_TTL_GENAC_TYPE_MASK) {
+		// Reserved cryptogram type
+		return 0x6A86;
+	}
+	if ((p1 & EMV_TTL_GENAC_SIG_MASK) == EMV_TTL_GENAC_SIG_XDA ||
+		((p1 & EMV_TTL_GENAC_SIG_MASK) == EMV_TTL_GENAC_SIG_CDA && app->oda != EMV_ICC_SIM_ODA_CDA)
+	) {
+		return 0x6A86;
+	}
+
+	if (sim->genac_count == 0) {
+		dol = sim_cdol1;
+		dol_len = sizeof(sim_cdol1);
+	} else {
+		dol = sim_cdol2;
+		dol_len = sizeof(sim_cdol2);
+	}
+	if ((int)data_len != emv_dol_compute_data_length(dol, dol_len)) {
+		return 0x6700;
+	}
+	if (emv_icc_sim_dol_find(dol, dol_len, EMV_TAG_9F37_UNPREDICTABLE_NUMBER, &un_offset)) {
+		return 0x6F00;
+	}
+
+	// Card always honours the requested cryptogram type
+	cid = p1 & EMV_TTL_GENAC_TYPE_MASK;
+	atc[0] = sim->atc >> 8;
+	atc[1] = sim->atc;
+
+	// Simulated Application Cryptogram (AC)
+	r = crypto_sha1_init(&sha1_ctx);
+	if (!r) {
+		r = crypto_sha1_update(&sha1_ctx, sim_ac_key, sizeof(sim_ac_key));
+	}
+	if (!r) {
+		r = crypto_sha1_update(&sha1_ctx, atc, sizeof(atc));
+	}
+	if (!r) {
+		r = crypto_sha1_update(&sha1_ctx, &cid, sizeof(cid));
+	}
+	if (!r) {
+		r = crypto_sha1_update(&sha1_ctx, data, data_len);
+	}
+	if (!r) {
+		r = crypto_sha1_finish(&sha1_ctx, ac);
+	}
+	crypto_sha1_free(&sha1_ctx);
+	if (r) {
+		return 0x6F00;
+	}
+
+	if (sim->genac_count == 0) {
+		memcpy(sim->cdol1_data, data, data_len);
+		sim->cdol1_data_len = data_len;
+	}
+	++sim->genac_count;
+
+	if ((p1 & EMV_TTL_GENAC_SIG_MASK) == EMV_TTL_GENAC_SIG_NONE) {
+		if (emv_icc_sim_buf_put(&fields_buf, EMV_TAG_9F27_CRYPTOGRAM_INFORMATION_DATA, &cid, 1) ||
+			emv_icc_sim_buf_put(&fields_buf, EMV_TAG_9F36_APPLICATION_TRANSACTION_COUNTER, atc, sizeof(atc)) ||
+			emv_icc_sim_buf_put(&fields_buf, EMV_TAG_9F26_APPLICATION_CRYPTOGRAM, ac, SIM_AC_LEN) ||
+			emv_icc_sim_buf_put(&fields_buf, EMV_TAG_9F10_ISSUER_APPLICATION_DATA, sim_iad, sizeof(sim_iad)) ||
+			emv_icc_sim_buf_put(rx, EMV_TAG_77_RESPONSE_MESSAGE_TEMPLATE_FORMAT_2, fields, fields_buf.len)
+		) {
+			return 0x6F00;
+		}
+	} else {
+		uint8_t dynamic_data[1 + SIM_DYNAMIC_NUMBER_LEN + 1 + SIM_AC_LEN + SIM_HASH_LEN];
+		uint8_t* ptr = dynamic_data;
+		uint8_t sdad[EMV_RAPDU_DATA_MAX];
+		uint8_t response[EMV_RAPDU_DATA_MAX];
+		struct emv_icc_sim_buf_t response_buf = { response, sizeof(response), 0 };
+
+		// Fields that are not included in the signature
+		if (emv_icc_sim_buf_put(&fields_buf, EMV_TAG_9F27_CRYPTOGRAM_INFORMATION_DATA, &cid, 1) ||
+			emv_icc_sim_buf_put(&fields_buf, EMV_TAG_9F36_APPLICATION_TRANSACTION_COUNTER, atc, sizeof(atc)) ||
+			emv_icc_sim_buf_put(&fields_buf, EMV_TAG_9F10_ISSUER_APPLICATION_DATA, sim_iad, sizeof(sim_iad))
+		) {
+			return 0x6F00;
+		}
+
+		// ICC Dynamic Data for CDA
+		// See EMV 4.4 Book 2, 6.6.1, Table 19
+		*ptr = emv_icc_sim_next_dynamic_number(sim, ptr + 1);
+		ptr += 1 + SIM_DYNAMIC_NUMBER_LEN;
+		*ptr++ = cid;
+		memcpy(ptr, ac, SIM_AC_LEN);
+		ptr += SIM_AC_LEN;
+
+		// Transaction Data Hash Code
+		// See EMV 4.4 Book 2, 6.6.1, step 5
+		r = crypto_sha1_init(&sha1_ctx);
+		if (!r) {
+			r = crypto_sha1_update(&sha1_ctx, sim->pdol_data, sim->pdol_data_len);
+		}
+		if (!r) {
+			r = crypto_sha1_update(&sha1_ctx, sim->cdol1_data, sim->cdol1_data_len);
+		}
+		if (!r && sim->genac_count > 1) {
+			r = crypto_sha1_update(&sha1_ctx, data, data_len);
+		}
+		if (!r) {
+			r = crypto_sha1_update(&sha1_ctx, fields, fields_buf.len);
+		}
+		if (!r) {
+			r = crypto_sha1_finish(&sha1_ctx, ptr);
+		}
+		crypto_sha1_free(&sha1_ctx);
+		if (r) {
+			return 0x6F00;
+		}
+
+		if (emv_icc_sim_sign_dynamic(sim, dynamic_data, sizeof(dynamic_data), data + un_offset, 4, sdad)) {
+			return 0x6F00;
+		}
+
+		if (emv_icc_sim_buf_append(&response_buf, fields, fields_buf.len) ||
+			emv_icc_sim_buf_put(&response_buf, EMV_TAG_9F4B_SIGNED_DYNAMIC_APPLICATION_DATA, sdad, sim->icc_key->modulus_len) ||
+			emv_icc_sim_buf_put(rx, EMV_TAG_77_RESPONSE_MESSAGE_TEMPLATE_FORMAT_2, response, response_buf.len)
+		) {
+			return 0x6F00;
+		}
+	}
+
+	return 0x9000;
+}
+
+int emv_icc_sim_trx(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+)
+{
+	struct emv_icc_sim_t* sim = ctx;
+	const uint8_t* c_apdu = tx_buf;
+	const uint8_t* data = NULL;
+	size_t data_len = 0;
+	uint8_t r_apdu_data[EMV_RAPDU_DATA_MAX];
+	struct emv_icc_sim_buf_t rx = { r_apdu_data, sizeof(r_apdu_data), 0 };
+	uint16_t sw1sw2;
+
+	if (!sim || !tx_buf || !rx_buf || !rx_buf_len) {
+		return -1;
+	}
+	if (tx_buf_len < 4) {
+		return -2;
+	}
+
+	// Determine C-APDU case
+	// See ISO 7816-3:2006, 12.1.3
+	if (tx_buf_len > 5) {
+		data_len = c_apdu[4];
+		if (!data_len || tx_buf_len < 5 + data_len || tx_buf_len > 6 + data_len) {
+			return -2;
+		}
+		data = c_apdu + 5;
+	}
+
+	if (c_apdu[0] == 0x00 && c_apdu[1] == 0xA4 && c_apdu[2] == 0x04) {
+		sw1sw2 = emv_icc_sim_select(sim, c_apdu[3], data, data_len, &rx);
+	} else if (c_apdu[0] == 0x00 && c_apdu[1] == 0xB2) {
+		sw1sw2 = emv_icc_sim_read_record(sim, c_apdu[2], c_apdu[3], &rx);
+	} else if (c_apdu[0] == 0x80 && c_apdu[1] == 0xA8) {
+		sw1sw2 = emv_icc_sim_gpo(sim, data, data_len, &rx);
+	} else if (c_apdu[0] == 0x80 && c_apdu[1] == 0xCA) {
+		sw1sw2 = emv_icc_sim_get_data(sim, c_apdu[2], c_apdu[3], &rx);
+	} else if (c_apdu[0] == 0x00 && c_apdu[1] == 0x88) {
+		sw1sw2 = emv_icc_sim_internal_authenticate(sim, data, data_len, &rx);
+	} else if (c_apdu[0] == 0x80 && c_apdu[1] == 0xAE) {
+		sw1sw2 = emv_icc_sim_genac(sim, c_apdu[2], data, data_len, &rx);
+	} else {
+		sw1sw2 = 0x6D00;
+	}
+
+	if (sw1sw2 != 0x9000) {
+		// No response data for error status
+		rx.len = 0;
+	}
+	if (*rx_buf_len < rx.len + 2) {
+		return -3;
+	}
+	memcpy(rx_buf, r_apdu_data, rx.len);
+	((uint8_t*)rx_buf)[rx.len] = sw1sw2 >> 8;
+	((uint8_t*)rx_buf)[rx.len + 1] = sw1sw2;
+	*rx_buf_len = rx.len + 2;
+
+	return 0;
+}
+
+int emv_icc_sim_populate_params(struct emv_ctx_t* emv)
+{
+	int r;
+
+	r = emv_tlv_list_push(&emv->params, EMV_TAG_9A_TRANSACTION_DATE, 3, (uint8_t[]){ 0x26, 0x10, 0x18 }, 0);
+	if (r) {
+		return r;
+	}
+	r = emv_tlv_list_push(&emv->params, EMV_TAG_9F21_TRANSACTION_TIME, 3, (uint8_t[]){ 0x12, 0x34, 0x56 }, 0);
+	if (r) {
+		return r;
+	}
+	r = emv_tlv_list_push(&emv->params, EMV_TAG_5F2A_TRANSACTION_CURRENCY_CODE, 2, (uint8_t[]){ 0x09, 0x78 }, 0);
+	if (r) {
+		return r;
+	}
+	r = emv_tlv_list_push(&emv->params, EMV_TAG_5F36_TRANSACTION_CURRENCY_EXPONENT, 1, (uint8_t[]){ 0x02 }, 0);
+	if (r) {
+		return r;
+	}
+	r = emv_tlv_list_push(&emv->params, EMV_TAG_9C_TRANSACTION_TYPE, 1, (uint8_t[]){ 0x00 }, 0);
+	if (r) {
+		return r;
+	}
+	r = emv_tlv_list_push(&emv->params, EMV_TAG_9F41_TRANSACTION_SEQUENCE_COUNTER, 4, (uint8_t[]){ 0x00, 0x00, 0x00, 0x01 }, 0);
+	if (r) {
+		return r;
+	}
+	r = emv_tlv_list_push(&emv->params, EMV_TAG_81_AMOUNT_AUTHORISED_BINARY, 4, (uint8_t[]){ 0x00, 0x00, 0x04, 0xD2 }, 0);
+	if (r) {
+		return r;
+	}
+	r = emv_tlv_list_push(&emv->params, EMV_TAG_9F02_AMOUNT_AUTHORISED_NUMERIC, 6, (uint8_t[]){ 0x00, 0x00, 0x00, 0x00, 0x12, 0x34 }, 0);
+	if (r) {
+		return r;
+	}
+
+	return 0;
+}
+
+int emv_icc_sim_transaction(struct emv_ctx_t* emv, struct emv_icc_sim_t* sim)
+{
+	int r;
+	struct emv_app_list_t app_list = EMV_APP_LIST_INIT;
+
+	emv_icc_sim_reset(sim);
+	r = emv_ctx_reset(emv);
+	if (r) {
+		fprintf(stderr, "emv_ctx_reset() failed; r=%d\n", r);
+		return r;
+	}
+	r = emv_icc_sim_populate_params(emv);
+	if (r) {
+		fprintf(stderr, "emv_icc_sim_populate_params() failed; r=%d\n", r);
+		return r;
+	}
+
+	r = emv_build_candidate_list(emv, &app_list);
+	if (r) {
+		fprintf(stderr, "emv_build_candidate_list() failed; error %d: %s\n", r, r < 0 ? emv_error_get_string(r) : emv_outcome_get_string(r));
+		goto exit;
+	}
+	r = emv_select_application(emv, &app_list, 0);
+	if (r) {
+		fprintf(stderr, "emv_select_application() failed; error %d: %s\n", r, r < 0 ? emv_error_get_string(r) : emv_outcome_get_string(r));
+		goto exit;
+	}
+	r = emv_initiate_application_processing(emv, EMV_POS_ENTRY_MODE_ICC_WITH_CVV);
+	if (r) {
+		fprintf(stderr, "emv_initiate_application_processing() failed; error %d: %s\n", r, r < 0 ? emv_error_get_string(r) : emv_outcome_get_string(r));
+		goto exit;
+	}
+	r = emv_read_application_data(emv);
+	if (r) {
+		fprintf(stderr, "emv_read_application_data() failed; error %d: %s\n", r, r < 0 ? emv_error_get_string(r) : emv_outcome_get_string(r));
+		goto exit;
+	}
+	r = emv_offline_data_authentication(emv);
+	if (r) {
+		fprintf(stderr, "emv_offline_data_authentication() failed; error %d: %s\n", r, r < 0 ? emv_error_get_string(r) : emv_outcome_get_string(r));
+		goto exit;
+	}
+	r = emv_card_action_analysis(emv);
+	if (r) {
+		fprintf(stderr, "emv_card_action_analysis() failed; error %d: %s\n", r, r < 0 ? emv_error_get_string(r) : emv_outcome_get_string(r));
+		goto exit;
+	}
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	emv_app_list_clear(&app_list);
+	return r;
+}
@@ -0,0 +1,236 @@
+/**
+ * @file emv_icc_sim.h
+ * @brief Virtual ICC that computes dynamic responses for kernel testing
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EMV_ICC_SIM_H
+#define EMV_ICC_SIM_H
+
+#include "emv_capk.h"
+#include "emv_ttl.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Forward declarations
+struct emv_ctx_t;
+
+#define EMV_ICC_SIM_APP_MAX (4) ///< Maximum number of applications
+#define EMV_ICC_SIM_RECORD_MAX (3) ///< Maximum number of application records
+
+/// Offline Data Authentication (ODA) method supported by simulated application
+enum emv_icc_sim_oda_t {
+	EMV_ICC_SIM_ODA_NONE = 0, ///< No offline data authentication
+	EMV_ICC_SIM_ODA_SDA, ///< Static Data Authentication (SDA)
+	EMV_ICC_SIM_ODA_DDA, ///< Dynamic Data Authentication (DDA)
+	EMV_ICC_SIM_ODA_CDA, ///< Combined DDA/Application Cryptogram Generation (CDA)
+};
+
+/**
+ * RSA key pair used by the simulated certificate hierarchy
+ * @note The private exponent must have the same length as the modulus
+ */
+struct emv_icc_sim_rsa_key_t {
+	const uint8_t* modulus; ///< Modulus
+	size_t modulus_len; ///< Length of modulus in bytes
+	const uint8_t* exponent; ///< Public exponent
+	size_t exponent_len; ///< Length of public exponent in bytes
+	const uint8_t* private_exponent; ///< Private exponent
+};
+
+/// Simulated application configuration
+struct emv_icc_sim_app_config_t {
+	const uint8_t* aid; ///< Application Identifier (AID). Must be 5 to 16 bytes.
+	size_t aid_len; ///< Length of Application Identifier (AID) in bytes
+	const char* label; ///< Application Label
+	uint8_t priority; ///< Application Priority Indicator
+	enum emv_icc_sim_oda_t oda; ///< Offline Data Authentication (ODA) method
+};
+
+/// Simulated card configuration
+struct emv_icc_sim_config_t {
+	struct emv_icc_sim_app_config_t app[EMV_ICC_SIM_APP_MAX]; ///< Applications
+	unsigned int app_count; ///< Number of applications
+	bool pse; ///< Whether Payment System Environment (PSE) is available
+
+	const uint8_t* pan; ///< Application PAN in EMV format "cn". Must be 6 to 10 bytes.
+	size_t pan_len; ///< Length of Application PAN in bytes
+	uint8_t pan_seq; ///< Application PAN Sequence Number
+	uint8_t expiration_date[3]; ///< Application Expiration Date (YYMMDD)
+
+	/**
+	 * Optional encoded fields to append to the signed application record.
+	 * These fields are included in the static data to be authenticated.
+	 */
+	const uint8_t* record_data;
+	size_t record_data_len; ///< Length of @ref record_data in bytes
+
+	uint8_t capk_index; ///< Certificate Authority Public Key (CAPK) index
+	const struct emv_icc_sim_rsa_key_t* ca_key; ///< Certificate authority key. NULL for built-in test key.
+	const struct emv_icc_sim_rsa_key_t* issuer_key; ///< Issuer key. NULL for built-in test key.
+	const struct emv_icc_sim_rsa_key_t* icc_key; ///< ICC key. NULL for built-in test key.
+};
+
+/// @cond INTERNAL
+struct emv_icc_sim_app_t {
+	uint8_t aid[16];
+	size_t aid_len;
+	enum emv_icc_sim_oda_t oda;
+	uint8_t aip[2];
+	uint8_t afl[8];
+	size_t afl_len;
+	uint8_t fci[EMV_RAPDU_DATA_MAX];
+	size_t fci_len;
+	uint8_t record[EMV_ICC_SIM_RECORD_MAX][EMV_RAPDU_DATA_MAX];
+	size_t record_len[EMV_ICC_SIM_RECORD_MAX];
+	uint8_t capk_hash[20];
+};
+/// @endcond
+
+/**
+ * Virtual ICC
+ *
+ * Use @ref emv_icc_sim_trx() and the simulator object as the transceive
+ * function and context of @ref emv_cardreader_t, using
+ * @ref EMV_CARDREADER_MODE_APDU. The simulator signs certificates during
+ * initialisation and computes Signed Dynamic Application Data (SDAD) and
+ * application cryptograms for each transaction, such that all offline data
+ * authentication methods succeed without recorded responses.
+ */
+struct emv_icc_sim_t {
+	/**
+	 * Certificate Authority Public Keys (CAPKs) of the simulated hierarchy,
+	 * one for each application. Use as @ref emv_ctx_t.capk_list with
+	 * @ref capk_count as @ref emv_ctx_t.capk_count.
+	 */
+	struct emv_capk_t capk[EMV_ICC_SIM_APP_MAX];
+	size_t capk_count; ///< Number of CAPKs
+
+	/// @cond INTERNAL
+	struct emv_icc_sim_app_t app[EMV_ICC_SIM_APP_MAX];
+	unsigned int app_count;
+	bool pse;
+	uint8_t dir_record[EMV_RAPDU_DATA_MAX];
+	size_t dir_record_len;
+	const struct emv_icc_sim_rsa_key_t* icc_key;
+
+	// Card session state
+	enum {
+		EMV_ICC_SIM_SELECTED_NONE = 0,
+		EMV_ICC_SIM_SELECTED_PSE,
+		EMV_ICC_SIM_SELECTED_APP,
+	} selected;
+	unsigned int app_idx;
+	unsigned int select_next;
+	bool gpo_done;
+	unsigned int genac_count;
+	uint8_t pdol_data[EMV_CAPDU_DATA_MAX];
+	size_t pdol_data_len;
+	uint8_t cdol1_data[EMV_CAPDU_DATA_MAX];
+	size_t cdol1_data_len;
+	/// @endcond
+
+	uint16_t atc; ///< Application Transaction Counter (ATC)
+	uint64_t dynamic_number; ///< Counter from which ICC Dynamic Numbers are derived
+	unsigned int sign_count; ///< Number of dynamic signatures computed
+};
+
+/**
+ * Populate simulated card configuration with defaults
+ *
+ * The default configuration provides a single application using the built-in
+ * test certificate hierarchy and the specified offline data authentication
+ * method.
+ *
+ * @param config Simulated card configuration output
+ * @param oda Offline Data Authentication (ODA) method
+ */
+void emv_icc_sim_config_init(
+	struct emv_icc_sim_config_t* config,
+	enum emv_icc_sim_oda_t oda
+);
+
+/**
+ * Initialise virtual ICC and sign the certificates of the simulated
+ * hierarchy
+ *
+ * @param sim Virtual ICC
+ * @param config Simulated card configuration. The RSA keys must remain valid
+ *               while the virtual ICC is in use.
+ * @return Zero for success. Less than zero for error.
+ */
+int emv_icc_sim_init(
+	struct emv_icc_sim_t* sim,
+	const struct emv_icc_sim_config_t* config
+);
+
+/**
+ * Reset virtual ICC session state, as if the card was powered down and up
+ * again. The Application Transaction Counter (ATC) is preserved.
+ *
+ * @param sim Virtual ICC
+ */
+void emv_icc_sim_reset(struct emv_icc_sim_t* sim);
+
+/**
+ * Populate transaction parameters of EMV processing context with the fixed
+ * values used for transactions with the virtual ICC
+ *
+ * @param emv EMV processing context
+ * @return Zero for success. Non-zero for error.
+ */
+int emv_icc_sim_populate_params(struct emv_ctx_t* emv);
+
+/**
+ * Perform transaction with the virtual ICC, from building the candidate list
+ * up to and including card action analysis. The virtual ICC and the EMV
+ * processing context are reset and the transaction parameters are populated
+ * using @ref emv_icc_sim_populate_params() before the transaction.
+ *
+ * @note The card reader of the EMV processing context must already be routed
+ * to the virtual ICC
+ *
+ * @param emv EMV processing context
+ * @param sim Virtual ICC
+ * @return Zero for success. Otherwise the error or outcome of the EMV
+ *         kernel step that failed.
+ */
+int emv_icc_sim_transaction(struct emv_ctx_t* emv, struct emv_icc_sim_t* sim);
+
+/**
+ * Virtual ICC transceive function
+ * @note This function has the same signature as @ref emv_cardreader_trx_t
+ *
+ * @param ctx Virtual ICC
+ * @param tx_buf Transmit buffer
+ * @param tx_buf_len Length of transmit buffer in bytes
+ * @param rx_buf Receive buffer
+ * @param rx_buf_len Length of receive buffer in bytes
+ * @return Zero for success. Less than zero for error.
+ */
+int emv_icc_sim_trx(
+	void* ctx,
+	const void* tx_buf,
+	size_t tx_buf_len,
+	void* rx_buf,
+	size_t* rx_buf_len
+);
+
+#endif
@@ -0,0 +1,190 @@
+/**
+ * @file emv_icc_sim_test.c
+ * @brief Unit tests for full EMV transactions using virtual ICC
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv.h"
+#include "emv_icc_sim.h"
+#include "emv_ttl.h"
+#include "emv_tlv.h"
+#include "emv_app.h"
+#include "emv_tags.h"
+#include "emv_fields.h"
+#include "emv_debug.h"
+
+#include "print_helpers.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Number of transactions to perform for each simulated card
+#define TEST_TXN_COUNT (3)
+
+static const char* oda_str[] = { "no ODA", "SDA", "DDA", "CDA" };
+
+static int test_sim(struct emv_ctx_t* emv, struct emv_ttl_t* ttl, enum emv_icc_sim_oda_t oda)
+{
+	int r;
+	struct emv_icc_sim_config_t config;
+	struct emv_icc_sim_t sim;
+	uint8_t last_icc_dn[8] = { 0 };
+	uint8_t last_ac[8] = { 0 };
+
+	emv_icc_sim_config_init(&config, oda);
+	r = emv_icc_sim_init(&sim, &config);
+	if (r) {
+		fprintf(stderr, "emv_icc_sim_init() failed; r=%d\n", r);
+		return 1;
+	}
+
+	ttl->cardreader.mode = EMV_CARDREADER_MODE_APDU;
+	ttl->cardreader.ctx = &sim;
+	ttl->cardreader.trx = &emv_icc_sim_trx;
+	emv->capk_list = sim.capk;
+	emv->capk_count = sim.capk_count;
+
+	for (unsigned int i = 0; i < TEST_TXN_COUNT; ++i) {
+		const struct emv_tlv_t* tlv;
+
+		r = emv_icc_sim_transaction(emv, &sim);
+		if (r) {
+			return 1;
+		}
+
+		if (oda == EMV_ICC_SIM_ODA_NONE) {
+			if (!(emv->tvr->value[0] & EMV_TVR_OFFLINE_DATA_AUTH_NOT_PERFORMED)) {
+				fprintf(stderr, "TVR does not indicate that ODA was not performed\n");
+				print_buf("TVR", emv->tvr->value, emv->tvr->length);
+				return 1;
+			}
+		} else {
+			if (emv->tvr->value[0] & (
+				EMV_TVR_OFFLINE_DATA_AUTH_NOT_PERFORMED |
+				EMV_TVR_SDA_FAILED |
+				EMV_TVR_DDA_FAILED |
+				EMV_TVR_CDA_FAILED
+			)) {
+				fprintf(stderr, "TVR indicates ODA failure\n");
+				print_buf("TVR", emv->tvr->value, emv->tvr->length);
+				return 1;
+			}
+			if (!(emv->tsi->value[0] & EMV_TSI_OFFLINE_DATA_AUTH_PERFORMED)) {
+				fprintf(stderr, "TSI does not indicate that ODA was performed\n");
+				return 1;
+			}
+		}
+
+		if (oda == EMV_ICC_SIM_ODA_DDA || oda == EMV_ICC_SIM_ODA_CDA) {
+			// Each transaction must provide a new ICC Dynamic Number
+			tlv = emv_tlv_list_find_const(&emv->icc, EMV_TAG_9F4C_ICC_DYNAMIC_NUMBER);
+			if (!tlv || tlv->length != sizeof(last_icc_dn)) {
+				fprintf(stderr, "ICC Dynamic Number not found\n");
+				return 1;
+			}
+			if (memcmp(tlv->value, last_icc_dn, sizeof(last_icc_dn)) == 0) {
+				fprintf(stderr, "ICC Dynamic Number was repeated\n");
+				return 1;
+			}
+			memcpy(last_icc_dn, tlv->value, sizeof(last_icc_dn));
+		}
+
+		if (oda != EMV_ICC_SIM_ODA_CDA) {
+			// Each transaction must provide a new Application Cryptogram
+			tlv = emv_tlv_list_find_const(&emv->icc, EMV_TAG_9F26_APPLICATION_CRYPTOGRAM);
+			if (!tlv || tlv->length != sizeof(last_ac)) {
+				fprintf(stderr, "Application Cryptogram not found\n");
+				return 1;
+			}
+			if (memcmp(tlv->value, last_ac, sizeof(last_ac)) == 0) {
+				fprintf(stderr, "Application Cryptogram was repeated\n");
+				return 1;
+			}
+			memcpy(last_ac, tlv->value, sizeof(last_ac));
+		}
+	}
+
+	if (sim.atc != TEST_TXN_COUNT) {
+		fprintf(stderr, "Incorrect ATC %u\n", sim.atc);
+		return 1;
+	}
+	if (oda == EMV_ICC_SIM_ODA_DDA || oda == EMV_ICC_SIM_ODA_CDA) {
+		// DDA signs INTERNAL AUTHENTICATE and CDA signs GENERATE AC
+		if (sim.sign_count != TEST_TXN_COUNT) {
+			fprintf(stderr, "Incorrect number of dynamic signatures %u\n", sim.sign_count);
+			return 1;
+		}
+	} else if (sim.sign_count) {
+		fprintf(stderr, "Unexpected dynamic signatures\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	int r;
+	struct emv_ttl_t ttl = { { 0, NULL, NULL } };
+	struct emv_ctx_t emv;
+
+	r = emv_ctx_init(&emv, &ttl);
+	if (r) {
+		fprintf(stderr, "emv_ctx_init() failed; r=%d\n", r);
+		return 1;
+	}
+
+	r = emv_debug_init(
+		EMV_DEBUG_SOURCE_ALL,
+		EMV_DEBUG_LEVEL_ERROR,
+		&print_emv_debug
+	);
+	if (r) {
+		printf("Failed to initialise EMV debugging\n");
+		return 1;
+	}
+
+	// Supported applications
+	emv_tlv_list_push(&emv.supported_aids, EMV_TAG_9F06_AID, 6, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10 }, EMV_ASI_PARTIAL_MATCH); // Visa
+
+	// Terminal configuration
+	emv_tlv_list_push(&emv.config, EMV_TAG_9F1A_TERMINAL_COUNTRY_CODE, 2, (uint8_t[]){ 0x05, 0x28 }, 0);
+	emv_tlv_list_push(&emv.config, EMV_TAG_9F33_TERMINAL_CAPABILITIES, 3, (uint8_t[]){ 0xE0, 0xF8, EMV_TERM_CAPS_SECURITY_SDA | EMV_TERM_CAPS_SECURITY_DDA | EMV_TERM_CAPS_SECURITY_CDA }, 0);
+	emv_tlv_list_push(&emv.config, EMV_TAG_9F49_DDOL, 3, (uint8_t[]){ 0x9F, 0x37, 0x04 }, 0);
+	emv_tlv_list_push(&emv.config, EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT, 4, (uint8_t[]){ 0x00, 0x00, 0x27, 0x10 }, 0);
+
+	for (unsigned int oda = EMV_ICC_SIM_ODA_NONE; oda <= EMV_ICC_SIM_ODA_CDA; ++oda) {
+		printf("\nTesting virtual ICC with %s...\n", oda_str[oda]);
+		r = test_sim(&emv, &ttl, oda);
+		if (r) {
+			goto exit;
+		}
+		printf("Success\n");
+	}
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	emv_ctx_clear(&emv);
+
+	return r;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file emv_metrics_test.c
+ * @brief Unit tests for EMV kernel timing metrics
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv.h"
+#include "emv_metrics.h"
+#include "emv_cardreader_emul.h"
+#include "emv_ttl.h"
+#include "emv_tlv.h"
+#include "emv_app.h"
+#include "emv_tags.h"
+#include "emv_fields.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Emulated card reader delay per exchange
+#define TEST_TRX_DELAY_US (2000)
+#define TEST_TRX_DELAY_NS (TEST_TRX_DELAY_US * 1000ULL)
+
+static const struct xpdu_t test_nothing_found[] = {
+	{
+		20, (uint8_t[]){ 0x00, 0xA4, 0x04, 0x00, 0x0E, 0x31, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46, 0x30, 0x31, 0x00 }, // SELECT 1PAY.SYS.DDF01
+		2, (uint8_t[]){ 0x6A, 0x82 }, // File or application not found
+	},
+	{
+		12, (uint8_t[]){ 0x00, 0xA4, 0x04, 0x00, 0x06, 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x00 }, // SELECT A00000000310
+		2, (uint8_t[]){ 0x6A, 0x82 }, // File or application not found
+	},
+	{
+		12, (uint8_t[]){ 0x00, 0xA4, 0x04, 0x00, 0x06, 0xA0, 0x00, 0x00, 0x00, 0x04, 0x10, 0x00 }, // SELECT A00000000410
+		2, (uint8_t[]){ 0x6A, 0x82 }, // File or application not found
+	},
+	{ 0 }
+};
+
+static int test_histogram(void)
+{
+	struct emv_metrics_histogram_t hist;
+	uint64_t p;
+
+	memset(&hist, 0, sizeof(hist));
+	if (emv_metrics_histogram_percentile(&hist, 50) != 0) {
+		fprintf(stderr, "Empty histogram percentile is not zero\n");
+		return 1;
+	}
+
+	// 90 samples of 1.5us, 9 samples of 100us and 1 sample of 5ms
+	for (unsigned int i = 0; i < 90; ++i) {
+		emv_metrics_histogram_add(&hist, 1500);
+	}
+	for (unsigned int i = 0; i < 9; ++i) {
+		emv_metrics_histogram_add(&hist, 100000);
+	}
+	emv_metrics_histogram_add(&hist, 5000000);
+
+	if (hist.count != 100 ||
+		hist.min_ns != 1500 ||
+		hist.max_ns != 5000000 ||
+		hist.sum_ns != 90 * 1500 + 9 * 100000 + 5000000
+	) {
+		fprintf(stderr, "Incorrect histogram summary\n");
+		return 1;
+	}
+	if (hist.bucket[1] != 90 || hist.bucket[7] != 9 || hist.bucket[13] != 1) {
+		fprintf(stderr, "Incorrect histogram buckets\n");
+		return 1;
+	}
+
+	p = emv_metrics_histogram_percentile(&hist, 50);
+	if (p != 2000) {
+		fprintf(stderr, "Incorrect p50 %llu\n", (unsigned long long)p);
+		return 1;
+	}
+	p = emv_metrics_histogram_percentile(&hist, 99);
+	if (p != 128000) {
+		fprintf(stderr, "Incorrect p99 %llu\n", (unsigned long long)p);
+		return 1;
+	}
+	p = emv_metrics_histogram_percentile(&hist, 100);
+	if (p != 5000000) {
+		fprintf(stderr, "Incorrect p100 %llu\n", (unsigned long long)p);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	int r;
+	struct emv_cardreader_emul_ctx_t emul_ctx;
+	struct emv_cardreader_emul_latency_ctx_t latency_ctx;
+	struct emv_ttl_t ttl = { { 0, NULL, NULL } };
+	struct emv_ttl_ext_t ttl_ext;
+	struct emv_ctx_t emv;
+	struct emv_metrics_t metrics;
+	struct emv_app_list_t app_list = EMV_APP_LIST_INIT;
+	const struct emv_metrics_timing_t* timing;
+
+	ttl.cardreader.mode = EMV_CARDREADER_MODE_APDU;
+	memset(&latency_ctx, 0, sizeof(latency_ctx));
+	latency_ctx.trx = &emv_cardreader_emul;
+	latency_ctx.trx_ctx = &emul_ctx;
+	latency_ctx.latency_us = TEST_TRX_DELAY_US;
+	ttl.cardreader.ctx = &latency_ctx;
+	ttl.cardreader.trx = &emv_cardreader_emul_latency;
+	r = emv_ttl_ext_attach(&ttl, &ttl_ext);
+	if (r) {
+		fprintf(stderr, "emv_ttl_ext_attach() failed; r=%d\n", r);
+		return 1;
+	}
+
+	r = emv_ctx_init(&emv, &ttl);
+	if (r) {
+		fprintf(stderr, "emv_ctx_init() failed; r=%d\n", r);
+		return 1;
+	}
+
+	printf("\nTesting metrics histogram...\n");
+	r = test_histogram();
+	if (r) {
+		goto exit;
+	}
+	printf("Success\n");
+
+	// Supported applications
+	emv_tlv_list_push(&emv.supported_aids, EMV_TAG_9F06_AID, 6, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10 }, EMV_ASI_PARTIAL_MATCH); // Visa
+	emv_tlv_list_push(&emv.supported_aids, EMV_TAG_9F06_AID, 6, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x04, 0x10 }, EMV_ASI_PARTIAL_MATCH); // Mastercard
+
+	printf("\nTesting metrics disabled...\n");
+	emul_ctx.xpdu_list = test_nothing_found;
+	emul_ctx.xpdu_current = NULL;
+	r = emv_build_candidate_list(&emv, &app_list);
+	if (r != EMV_OUTCOME_NOT_ACCEPTED) {
+		fprintf(stderr, "Unexpected emv_build_candidate_list() result; error %d: %s\n", r, r < 0 ? emv_error_get_string(r) : emv_outcome_get_string(r));
+		r = 1;
+		goto exit;
+	}
+	if (ttl_ext.metrics) {
+		fprintf(stderr, "TTL metrics unexpectedly enabled\n");
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting metrics for candidate list...\n");
+	emv_metrics_init(&metrics);
+	emv.metrics = &metrics;
+	for (unsigned int i = 0; i < 2; ++i) {
+		emul_ctx.xpdu_list = test_nothing_found;
+		emul_ctx.xpdu_current = NULL;
+		r = emv_build_candidate_list(&emv, &app_list);
+		if (r != EMV_OUTCOME_NOT_ACCEPTED) {
+			fprintf(stderr, "Unexpected emv_build_candidate_list() result; error %d: %s\n", r, r < 0 ? emv_error_get_string(r) : emv_outcome_get_string(r));
+			r = 1;
+			goto exit;
+		}
+	}
+	timing = &metrics.step[EMV_METRICS_STEP_BUILD_CANDIDATE_LIST];
+	if (timing->count != 2) {
+		fprintf(stderr, "Incorrect step count %u\n", timing->count);
+		r = 1;
+		goto exit;
+	}
+	if (timing->card_io_ns < 6 * TEST_TRX_DELAY_NS) {
+		fprintf(stderr, "Card I/O time %llu too small\n", (unsigned long long)timing->card_io_ns);
+		r = 1;
+		goto exit;
+	}
+	if (timing->total_ns != timing->card_io_ns + timing->cpu_ns) {
+		fprintf(stderr, "Total time is not the sum of card I/O and CPU time\n");
+		r = 1;
+		goto exit;
+	}
+	if (metrics.total[EMV_METRICS_STEP_BUILD_CANDIDATE_LIST].count != 2 ||
+		metrics.card_io[EMV_METRICS_STEP_BUILD_CANDIDATE_LIST].count != 2 ||
+		metrics.cpu[EMV_METRICS_STEP_BUILD_CANDIDATE_LIST].count != 2
+	) {
+		fprintf(stderr, "Incorrect histogram sample count\n");
+		r = 1;
+		goto exit;
+	}
+	if (metrics.card_io[EMV_METRICS_STEP_BUILD_CANDIDATE_LIST].min_ns < 3 * TEST_TRX_DELAY_NS) {
+		fprintf(stderr, "Card I/O histogram minimum too small\n");
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 0; i < EMV_METRICS_STEP_COUNT; ++i) {
+		if (i != EMV_METRICS_STEP_BUILD_CANDIDATE_LIST && metrics.step[i].count) {
+			fprintf(stderr, "Unexpected timing for step %s\n", emv_metrics_step_get_string(i));
+			r = 1;
+			goto exit;
+		}
+	}
+	printf("Success\n");
+
+	printf("\nTesting metrics reset...\n");
+	r = emv_ctx_reset(&emv);
+	if (r) {
+		fprintf(stderr, "emv_ctx_reset() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (metrics.step[EMV_METRICS_STEP_BUILD_CANDIDATE_LIST].count != 0) {
+		fprintf(stderr, "Transaction timings not cleared\n");
+		r = 1;
+		goto exit;
+	}
+	if (metrics.total[EMV_METRICS_STEP_BUILD_CANDIDATE_LIST].count != 2) {
+		fprintf(stderr, "Histograms unexpectedly cleared\n");
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	emv_app_list_clear(&app_list);
+	emv_ctx_clear(&emv);
+
+	return r;
+}
@@ -0,0 +1,497 @@
+/**
+ * @file emv_oda_verify_test.c
+ * @brief Unit tests for offline verification of logged EMV ODA transactions
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_oda_verify.h"
+#include "emv.h"
+#include "emv_icc_sim.h"
+#include "emv_ttl.h"
+#include "emv_tlv.h"
+#include "emv_app.h"
+#include "emv_tags.h"
+#include "emv_fields.h"
+#include "emv_debug.h"
+
+#include "print_helpers.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Number of copies of each logged transaction in the batch
+#define TEST_BATCH_COPIES (50)
+
+static const char* oda_str[] = { "no ODA", "SDA", "DDA", "CDA" };
+
+// Logged transaction data
+struct test_log_t {
+	enum emv_oda_method_t method;
+	uint8_t icc[2048];
+	size_t icc_len;
+	uint8_t terminal[1024];
+	size_t terminal_len;
+	uint8_t params[256];
+	size_t params_len;
+	uint8_t records[2048];
+	size_t records_len;
+	uint8_t pdol_data[256];
+	size_t pdol_data_len;
+	uint8_t cdol1_data[256];
+	size_t cdol1_data_len;
+	uint8_t genac_data[256];
+	size_t genac_data_len;
+};
+
+static int encode_list(const struct emv_tlv_list_t* list, uint8_t* buf, size_t buf_size, size_t* len)
+{
+	size_t offset = 0;
+
+	for (const struct emv_tlv_t* tlv = list->front; tlv != NULL; tlv = tlv->next) {
+		// Tag, length and value
+		if (buf_size - offset < 3 + 3 + tlv->length) {
+			return -1;
+		}
+		if (tlv->tag > 0xFFFF) {
+			buf[offset++] = tlv->tag >> 16;
+		}
+		if (tlv->tag > 0xFF) {
+			buf[offset++] = tlv->tag >> 8;
+		}
+		buf[offset++] = tlv->tag;
+		if (tlv->length > 0xFF) {
+			buf[offset++] = 0x82;
+			buf[offset++] = tlv->length >> 8;
+		} else if (tlv->length > 0x7F) {
+			buf[offset++] = 0x81;
+		}
+		buf[offset++] = tlv->length;
+		memcpy(buf + offset, tlv->value, tlv->length);
+		offset += tlv->length;
+	}
+
+	*len = offset;
+	return 0;
+}
+
+static int log_transaction(
+	struct emv_ctx_t* emv,
+	struct emv_icc_sim_t* sim,
+	struct test_log_t* log
+)
+{
+	int r;
+	struct emv_app_list_t app_list = EMV_APP_LIST_INIT;
+
+	memset(log, 0, sizeof(*log));
+	emv_icc_sim_reset(sim);
+	r = emv_ctx_reset(emv);
+	if (r) {
+		fprintf(stderr, "emv_ctx_reset() failed; r=%d\n", r);
+		return 1;
+	}
+	r = emv_icc_sim_populate_params(emv);
+	if (r) {
+		fprintf(stderr, "emv_icc_sim_populate_params() failed; r=%d\n", r);
+		return 1;
+	}
+
+	r = emv_build_candidate_list(emv, &app_list);
+	if (r) {
+		fprintf(stderr, "emv_build_candidate_list() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_select_application(emv, &app_list, 0);
+	if (r) {
+		fprintf(stderr, "emv_select_application() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_initiate_application_processing(emv, EMV_POS_ENTRY_MODE_ICC_WITH_CVV);
+	if (r) {
+		fprintf(stderr, "emv_initiate_application_processing() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_read_application_data(emv);
+	if (r) {
+		fprintf(stderr, "emv_read_application_data() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+
+	// Application records are released by offline data authentication
+	if (emv->oda.record_buf_len > sizeof(log->records)) {
+		fprintf(stderr, "Application records too large\n");
+		r = 1;
+		goto exit;
+	}
+	if (emv->oda.record_buf_len) {
+		memcpy(log->records, emv->oda.record_buf, emv->oda.record_buf_len);
+	}
+	log->records_len = emv->oda.record_buf_len;
+
+	r = emv_offline_data_authentication(emv);
+	if (r) {
+		fprintf(stderr, "emv_offline_data_authentication() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_card_action_analysis(emv);
+	if (r) {
+		fprintf(stderr, "emv_card_action_analysis() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+
+	log->method = emv->oda.method;
+	r = encode_list(&emv->icc, log->icc, sizeof(log->icc), &log->icc_len);
+	if (r) {
+		fprintf(stderr, "encode_list() failed for ICC data\n");
+		r = 1;
+		goto exit;
+	}
+	r = encode_list(&emv->terminal, log->terminal, sizeof(log->terminal), &log->terminal_len);
+	if (r) {
+		fprintf(stderr, "encode_list() failed for terminal data\n");
+		r = 1;
+		goto exit;
+	}
+	r = encode_list(&emv->params, log->params, sizeof(log->params), &log->params_len);
+	if (r) {
+		fprintf(stderr, "encode_list() failed for params\n");
+		r = 1;
+		goto exit;
+	}
+	memcpy(log->pdol_data, emv->oda.pdol_data, emv->oda.pdol_data_len);
+	log->pdol_data_len = emv->oda.pdol_data_len;
+	memcpy(log->cdol1_data, emv->oda.cdol1_data, emv->oda.cdol1_data_len);
+	log->cdol1_data_len = emv->oda.cdol1_data_len;
+	memcpy(log->genac_data, emv->oda.genac_data, emv->oda.genac_data_len);
+	log->genac_data_len = emv->oda.genac_data_len;
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	emv_app_list_clear(&app_list);
+	return r;
+}
+
+static void input_from_log(
+	const struct test_log_t* log,
+	enum emv_oda_method_t method,
+	struct emv_oda_verify_input_t* input
+)
+{
+	memset(input, 0, sizeof(*input));
+	input->method = method;
+	input->icc = log->icc;
+	input->icc_len = log->icc_len;
+	input->terminal = log->terminal;
+	input->terminal_len = log->terminal_len;
+	input->params = log->params;
+	input->params_len = log->params_len;
+	input->records = log->records;
+	input->records_len = log->records_len;
+	input->pdol_data = log->pdol_data;
+	input->pdol_data_len = log->pdol_data_len;
+	input->cdol1_data = log->cdol1_data;
+	input->cdol1_data_len = log->cdol1_data_len;
+	input->genac_data = log->genac_data;
+	input->genac_data_len = log->genac_data_len;
+}
+
+static int verify_log(
+	struct emv_oda_verify_ctx_t* ctx,
+	const struct test_log_t* log,
+	enum emv_oda_method_t method,
+	struct emv_oda_verify_result_t* result
+)
+{
+	int r;
+	struct emv_oda_verify_input_t input;
+
+	input_from_log(log, method, &input);
+	r = emv_oda_verify(ctx, &input, result);
+	if (r) {
+		fprintf(stderr, "emv_oda_verify() failed; r=%d\n", r);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int check_result(
+	const struct emv_oda_verify_result_t* result,
+	int expected_r,
+	enum emv_oda_method_t expected_method,
+	uint8_t expected_tvr0
+)
+{
+	if (result->r != expected_r) {
+		fprintf(stderr, "Unexpected verdict %d; expected %d\n", result->r, expected_r);
+		return 1;
+	}
+	if (result->method != expected_method) {
+		fprintf(stderr, "Unexpected ODA method %u; expected %u\n", result->method, expected_method);
+		return 1;
+	}
+	if (result->tvr[0] != expected_tvr0) {
+		fprintf(stderr, "Unexpected TVR\n");
+		print_buf("TVR", result->tvr, sizeof(result->tvr));
+		return 1;
+	}
+	if (!(result->tsi[0] & EMV_TSI_OFFLINE_DATA_AUTH_PERFORMED)) {
+		fprintf(stderr, "TSI does not indicate that ODA was performed\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	int r;
+	struct emv_ttl_t ttl = { { 0, NULL, NULL } };
+	struct emv_ctx_t emv;
+	struct emv_icc_sim_config_t config[3];
+	struct emv_icc_sim_t sim[3];
+	struct test_log_t log[3];
+	struct emv_oda_verify_ctx_t verify;
+	struct emv_oda_verify_result_t result;
+	struct test_log_t tampered;
+	static const uint8_t expected_tvr0[3] = { EMV_TVR_SDA_SELECTED, 0, 0 };
+	static const uint8_t failed_tvr0[3] = {
+		EMV_TVR_SDA_SELECTED | EMV_TVR_SDA_FAILED,
+		EMV_TVR_DDA_FAILED,
+		EMV_TVR_CDA_FAILED,
+	};
+	struct emv_oda_verify_input_t* batch_input = NULL;
+	struct emv_oda_verify_result_t* batch_result = NULL;
+	size_t batch_count = 3 * TEST_BATCH_COPIES;
+	size_t ipk_count;
+
+	r = emv_ctx_init(&emv, &ttl);
+	if (r) {
+		fprintf(stderr, "emv_ctx_init() failed; r=%d\n", r);
+		return 1;
+	}
+	r = emv_oda_verify_init(&verify);
+	if (r) {
+		fprintf(stderr, "emv_oda_verify_init() failed; r=%d\n", r);
+		emv_ctx_clear(&emv);
+		return 1;
+	}
+
+	r = emv_debug_init(
+		EMV_DEBUG_SOURCE_ALL,
+		EMV_DEBUG_LEVEL_ERROR,
+		&print_emv_debug
+	);
+	if (r) {
+		printf("Failed to initialise EMV debugging\n");
+		r = 1;
+		goto exit;
+	}
+
+	// Supported applications
+	emv_tlv_list_push(&emv.supported_aids, EMV_TAG_9F06_AID, 6, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10 }, EMV_ASI_PARTIAL_MATCH); // Visa
+
+	// Terminal configuration
+	emv_tlv_list_push(&emv.config, EMV_TAG_9F1A_TERMINAL_COUNTRY_CODE, 2, (uint8_t[]){ 0x05, 0x28 }, 0);
+	emv_tlv_list_push(&emv.config, EMV_TAG_9F33_TERMINAL_CAPABILITIES, 3, (uint8_t[]){ 0xE0, 0xF8, EMV_TERM_CAPS_SECURITY_SDA | EMV_TERM_CAPS_SECURITY_DDA | EMV_TERM_CAPS_SECURITY_CDA }, 0);
+	emv_tlv_list_push(&emv.config, EMV_TAG_9F49_DDOL, 3, (uint8_t[]){ 0x9F, 0x37, 0x04 }, 0);
+	emv_tlv_list_push(&emv.config, EMV_TAG_9F1B_TERMINAL_FLOOR_LIMIT, 4, (uint8_t[]){ 0x00, 0x00, 0x27, 0x10 }, 0);
+	verify.config = &emv.config;
+
+	printf("\nTesting logged transactions...\n");
+	for (unsigned int i = 0; i < 3; ++i) {
+		enum emv_icc_sim_oda_t oda = EMV_ICC_SIM_ODA_SDA + i;
+
+		emv_icc_sim_config_init(&config[i], oda);
+		r = emv_icc_sim_init(&sim[i], &config[i]);
+		if (r) {
+			fprintf(stderr, "emv_icc_sim_init() failed; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+
+		ttl.cardreader.mode = EMV_CARDREADER_MODE_APDU;
+		ttl.cardreader.ctx = &sim[i];
+		ttl.cardreader.trx = &emv_icc_sim_trx;
+		emv.capk_list = sim[i].capk;
+		emv.capk_count = sim[i].capk_count;
+
+		r = log_transaction(&emv, &sim[i], &log[i]);
+		if (r) {
+			goto exit;
+		}
+		if (log[i].method != EMV_ODA_METHOD_SDA + i) {
+			fprintf(stderr, "Unexpected ODA method %u for %s\n", log[i].method, oda_str[oda]);
+			r = 1;
+			goto exit;
+		}
+	}
+	printf("Success\n");
+
+	// All simulated cards use the same CAPK
+	verify.capk_list = sim[0].capk;
+	verify.capk_count = sim[0].capk_count;
+
+	for (unsigned int i = 0; i < 3; ++i) {
+		printf("\nTesting verification of logged %s...\n", oda_str[EMV_ICC_SIM_ODA_SDA + i]);
+		r = verify_log(&verify, &log[i], log[i].method, &result);
+		if (r) {
+			goto exit;
+		}
+		r = check_result(&result, 0, log[i].method, expected_tvr0[i]);
+		if (r) {
+			goto exit;
+		}
+
+		// Method selection according to terminal configuration
+		r = verify_log(&verify, &log[i], EMV_ODA_METHOD_NONE, &result);
+		if (r) {
+			goto exit;
+		}
+		r = check_result(&result, 0, log[i].method, expected_tvr0[i]);
+		if (r) {
+			goto exit;
+		}
+		printf("Success\n");
+
+		printf("\nTesting verification of tampered %s...\n", oda_str[EMV_ICC_SIM_ODA_SDA + i]);
+		tampered = log[i];
+		if (log[i].method == EMV_ODA_METHOD_CDA) {
+			// CDA signs the CDOL1 data
+			tampered.cdol1_data[0] ^= 0x01;
+		} else {
+			tampered.records[tampered.records_len - 1] ^= 0x01;
+		}
+		r = verify_log(&verify, &tampered, log[i].method, &result);
+		if (r) {
+			goto exit;
+		}
+		if (result.r <= 0) {
+			fprintf(stderr, "Tampered %s not detected; r=%d\n", oda_str[EMV_ICC_SIM_ODA_SDA + i], result.r);
+			r = 1;
+			goto exit;
+		}
+		r = check_result(&result, result.r, log[i].method, failed_tvr0[i]);
+		if (r) {
+			goto exit;
+		}
+		printf("Success\n");
+	}
+
+	printf("\nTesting batch verification...\n");
+	batch_input = calloc(batch_count, sizeof(*batch_input));
+	batch_result = calloc(batch_count, sizeof(*batch_result));
+	if (!batch_input || !batch_result) {
+		fprintf(stderr, "calloc() failed\n");
+		r = 1;
+		goto exit;
+	}
+	for (size_t i = 0; i < batch_count; ++i) {
+		input_from_log(&log[i % 3], log[i % 3].method, &batch_input[i]);
+	}
+	// Tamper with a single transaction
+	tampered = log[1];
+	tampered.records[tampered.records_len - 1] ^= 0x01;
+	input_from_log(&tampered, tampered.method, &batch_input[batch_count / 2 + 1]);
+
+	emv_oda_verify_clear(&verify);
+	r = emv_oda_verify_init(&verify);
+	if (r) {
+		fprintf(stderr, "emv_oda_verify_init() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	verify.capk_list = sim[0].capk;
+	verify.capk_count = sim[0].capk_count;
+	verify.config = &emv.config;
+	verify.threads = 4;
+
+	r = emv_oda_verify_batch(&verify, batch_input, batch_count, batch_result);
+	if (r) {
+		fprintf(stderr, "emv_oda_verify_batch() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	for (size_t i = 0; i < batch_count; ++i) {
+		unsigned int idx = i % 3;
+
+		if (i == batch_count / 2 + 1) {
+			// Tampered transaction
+			if (batch_result[i].r <= 0) {
+				fprintf(stderr, "Tampered transaction %zu not detected; r=%d\n", i, batch_result[i].r);
+				r = 1;
+				goto exit;
+			}
+			r = check_result(&batch_result[i], batch_result[i].r, log[idx].method, failed_tvr0[idx]);
+		} else {
+			r = check_result(&batch_result[i], 0, log[idx].method, expected_tvr0[idx]);
+		}
+		if (r) {
+			fprintf(stderr, "Batch transaction %zu failed\n", i);
+			goto exit;
+		}
+	}
+
+	// Transactions of the same card must share the issuer public key
+	// retrieval
+	ipk_count = emv_oda_verify_get_issuer_pkey_count(&verify);
+	if (ipk_count < 1 || ipk_count > 3) {
+		fprintf(stderr, "Unexpected issuer public key retrieval count %zu\n", ipk_count);
+		r = 1;
+		goto exit;
+	}
+
+	// Repeated batch must not retrieve issuer public keys again
+	r = emv_oda_verify_batch(&verify, batch_input, batch_count, batch_result);
+	if (r) {
+		fprintf(stderr, "emv_oda_verify_batch() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (emv_oda_verify_get_issuer_pkey_count(&verify) != ipk_count) {
+		fprintf(stderr, "Issuer public key retrieved again\n");
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	free(batch_input);
+	free(batch_result);
+	emv_oda_verify_clear(&verify);
+	emv_ctx_clear(&emv);
+
+	return r;
+}
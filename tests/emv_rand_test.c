@@ -0,0 +1,248 @@
+/**
+ * @file emv_rand_test.c
+ * @brief Unit tests for buffered random number generation
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_rand.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "print_helpers.h"
+
+// ChaCha20 key and nonce
+// See RFC 8439, 2.3.2
+static const uint8_t test_kat_seed[EMV_RAND_SEED_LEN] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+	0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x4a,
+	0x00, 0x00, 0x00, 0x00,
+};
+
+// Second half of ChaCha20 block with block counter 1; the first half is
+// used as the next key
+// See RFC 8439, 2.3.2
+static const uint8_t test_kat_output[] = {
+	0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09,
+	0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+	0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9,
+	0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e,
+};
+
+struct test_seed_t {
+	const uint8_t* seed; // Fixed seed material or NULL for counter
+	uint32_t counter;
+	unsigned int count;
+};
+
+static void test_seed_func(void* ctx, void* buf, size_t len)
+{
+	struct test_seed_t* seed = ctx;
+	uint8_t* ptr = buf;
+
+	++seed->count;
+	if (seed->seed) {
+		memcpy(buf, seed->seed, len);
+		return;
+	}
+
+	// Deterministic seed material that differs for each reseed
+	for (size_t i = 0; i < len; ++i) {
+		ptr[i] = i;
+	}
+	ptr[0] = seed->counter;
+	ptr[1] = seed->counter >> 8;
+	++seed->counter;
+}
+
+int main(void)
+{
+	int r;
+	struct test_seed_t seed;
+	uint8_t buf1[3000];
+	uint8_t buf2[3000];
+	uint8_t kat_output[sizeof(test_kat_output)];
+	bool seen[100] = { false };
+
+	printf("\nTesting known answer...\n");
+	memset(&seed, 0, sizeof(seed));
+	seed.seed = test_kat_seed;
+	emv_rand_set_seed_func(&test_seed_func, &seed);
+	r = emv_rand(kat_output, sizeof(kat_output));
+	if (r) {
+		fprintf(stderr, "emv_rand() failed; r=%d\n", r);
+		goto exit;
+	}
+	if (memcmp(kat_output, test_kat_output, sizeof(test_kat_output)) != 0) {
+		fprintf(stderr, "Incorrect output\n");
+		print_buf("output", kat_output, sizeof(kat_output));
+		print_buf("expected", test_kat_output, sizeof(test_kat_output));
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting deterministic seeding...\n");
+	memset(&seed, 0, sizeof(seed));
+	emv_rand_set_seed_func(&test_seed_func, &seed);
+	r = emv_rand(buf1, sizeof(buf1));
+	if (r) {
+		fprintf(stderr, "emv_rand() failed; r=%d\n", r);
+		goto exit;
+	}
+
+	// Same seed material must produce the same output, regardless of the
+	// length of the individual outputs
+	memset(&seed, 0, sizeof(seed));
+	emv_rand_set_seed_func(&test_seed_func, &seed);
+	for (size_t i = 0; i < sizeof(buf2); i += 4) {
+		r = emv_rand(buf2 + i, 4);
+		if (r) {
+			fprintf(stderr, "emv_rand() failed; r=%d\n", r);
+			goto exit;
+		}
+	}
+	if (memcmp(buf1, buf2, sizeof(buf1)) != 0) {
+		fprintf(stderr, "Output is not reproducible\n");
+		r = 1;
+		goto exit;
+	}
+	if (seed.count != 1) {
+		fprintf(stderr, "Unexpected seed count %u\n", seed.count);
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting reseeding...\n");
+	emv_rand_reseed();
+	r = emv_rand(buf2, sizeof(buf2));
+	if (r) {
+		fprintf(stderr, "emv_rand() failed; r=%d\n", r);
+		goto exit;
+	}
+	if (seed.count != 2) {
+		fprintf(stderr, "Unexpected seed count %u\n", seed.count);
+		r = 1;
+		goto exit;
+	}
+	for (size_t i = 0; i < EMV_RAND_RESEED_INTERVAL; i += sizeof(buf2)) {
+		r = emv_rand(buf2, sizeof(buf2));
+		if (r) {
+			fprintf(stderr, "emv_rand() failed; r=%d\n", r);
+			goto exit;
+		}
+	}
+	if (seed.count != 3) {
+		fprintf(stderr, "Generator not reseeded after reseed interval; count=%u\n", seed.count);
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting health test of stuck seed material...\n");
+	memset(buf1, 0xA5, EMV_RAND_SEED_LEN);
+	memset(&seed, 0, sizeof(seed));
+	seed.seed = buf1;
+	emv_rand_set_seed_func(&test_seed_func, &seed);
+	r = emv_rand(buf2, 4);
+	if (r != EMV_RAND_ERROR_HEALTH_TEST_FAILED) {
+		fprintf(stderr, "Unexpected emv_rand() result; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting health test of repeated seed material...\n");
+	memset(&seed, 0, sizeof(seed));
+	seed.seed = test_kat_seed;
+	emv_rand_set_seed_func(&test_seed_func, &seed);
+	r = emv_rand(buf2, 4);
+	if (r) {
+		fprintf(stderr, "emv_rand() failed; r=%d\n", r);
+		goto exit;
+	}
+	emv_rand_reseed();
+	r = emv_rand(buf2, 4);
+	if (r != EMV_RAND_ERROR_HEALTH_TEST_FAILED) {
+		fprintf(stderr, "Unexpected emv_rand() result; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	// Generator must be instantiated again after failure
+	r = emv_rand(buf2, sizeof(kat_output));
+	if (r) {
+		fprintf(stderr, "emv_rand() failed; r=%d\n", r);
+		goto exit;
+	}
+	if (memcmp(buf2, test_kat_output, sizeof(test_kat_output)) != 0) {
+		fprintf(stderr, "Incorrect output after instantiation\n");
+		print_buf("output", buf2, sizeof(test_kat_output));
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting random byte range...\n");
+	emv_rand_set_seed_func(NULL, NULL);
+	r = emv_rand_byte(2, 1);
+	if (r != EMV_RAND_ERROR_INVALID_PARAMETER) {
+		fprintf(stderr, "Unexpected emv_rand_byte() result; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_rand_byte(0, 256);
+	if (r != EMV_RAND_ERROR_INVALID_PARAMETER) {
+		fprintf(stderr, "Unexpected emv_rand_byte() result; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 0; i < 10000; ++i) {
+		r = emv_rand_byte(1, 99);
+		if (r < 1 || r > 99) {
+			fprintf(stderr, "Unexpected emv_rand_byte() result; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+		seen[r] = true;
+	}
+	for (unsigned int i = 1; i <= 99; ++i) {
+		if (!seen[i]) {
+			fprintf(stderr, "Value %u never occurred\n", i);
+			r = 1;
+			goto exit;
+		}
+	}
+	printf("Success\n");
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	emv_rand_set_seed_func(NULL, NULL);
+	emv_rand_clear();
+
+	return r;
+}
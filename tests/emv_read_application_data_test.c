@@ -2,7 +2,7 @@
  * @file emv_read_application_data_test.c
  * @brief Unit tests for EMV Read Application Data
  *
- * Copyright 2024-2025 Leon Lynch
+ * Copyright 2024-2026 Leon Lynch
  *
  * This program is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -21,12 +21,14 @@
 
 #include "emv.h"
 #include "emv_cardreader_emul.h"
+#include "emv_oda.h"
 #include "emv_ttl.h"
 #include "emv_tal.h"
 #include "emv_tlv.h"
 #include "emv_tags.h"
 
 #include <stdio.h>
+#include <string.h>
 
 // For debug output
 #include "emv_debug.h"
@@ -247,6 +249,51 @@ static const struct xpdu_t test11_apdu_list[] = {
 	{ 0 }
 };
 
+static const struct xpdu_t test13_apdu_list[] = {
+	{
+		5, (uint8_t[]){ 0x00, 0xB2, 0x02, 0x0C, 0x00 }, // READ RECORD from SFI 1, record 2
+		55, (uint8_t[]) {
+			0x70, 0x33, 0x57, 0x11, 0x47, 0x61, 0x73, 0x90, 0x01, 0x01, 0x01, 0x19,
+			0xD2, 0x21, 0x22, 0x01, 0x17, 0x58, 0x92, 0x88, 0x89, 0x5F, 0x20, 0x0C,
+			0x45, 0x58, 0x50, 0x49, 0x52, 0x45, 0x44, 0x2F, 0x43, 0x41, 0x52, 0x44,
+			0x9F, 0x1F, 0x0E, 0x31, 0x37, 0x35, 0x38, 0x39, 0x30, 0x39, 0x36, 0x30,
+			0x30, 0x30, 0x30, 0x30, 0x30,
+			0x90, 0x00,
+		},
+	},
+	{
+		5, (uint8_t[]){ 0x00, 0xB2, 0x01, 0x14, 0x00 }, // READ RECORD from SFI 2, record 1
+		2, (uint8_t[]){ 0x6C, 0x48 }, // Wrong length; aborts batch
+	},
+	{
+		5, (uint8_t[]){ 0x00, 0xB2, 0x01, 0x14, 0x00 }, // READ RECORD from SFI 2, record 1
+		2, (uint8_t[]){ 0x6C, 0x48 }, // Wrong length
+	},
+	{
+		5, (uint8_t[]){ 0x00, 0xB2, 0x01, 0x14, 0x48 }, // READ RECORD from SFI 2, record 1
+		74, (uint8_t[]) {
+			0x70, 0x46, 0x5A, 0x08, 0x47, 0x61, 0x73, 0x90, 0x01, 0x01, 0x01, 0x19,
+			0x5F, 0x34, 0x01, 0x01, 0x5F, 0x24, 0x03, 0x22, 0x12, 0x31,
+			0x8C, 0x15, 0x9F, 0x02, 0x06, 0x9F, 0x03, 0x06, 0x9F, 0x1A, 0x02, 0x95, 0x05, 0x5F, 0x2A, 0x02, 0x9A, 0x03, 0x9C, 0x01, 0x9F, 0x37, 0x04,
+			0x8D, 0x19, 0x8A, 0x02, 0x9F, 0x02, 0x06, 0x9F, 0x03, 0x06, 0x9F, 0x1A, 0x02, 0x95, 0x05, 0x5F, 0x2A, 0x02, 0x9A, 0x03, 0x9C, 0x01, 0x9F, 0x37, 0x04, 0x91, 0x08,
+			0x90, 0x00,
+		},
+	},
+	{
+		5, (uint8_t[]){ 0x00, 0xB2, 0x02, 0x14, 0x00 }, // READ RECORD from SFI 2, record 2
+		23, (uint8_t[]){
+			0x70, 0x13, 0x8F, 0x01, 0x94, 0x92, 0x00, 0x9F, 0x32, 0x01, 0x03, 0x9F,
+			0x47, 0x01, 0x03, 0x9F, 0x49, 0x03, 0x9F, 0x37, 0x04,
+			0x90, 0x00,
+		},
+	},
+	{
+		5, (uint8_t[]){ 0x00, 0xB2, 0x01, 0x5C, 0x00 }, // READ RECORD from SFI 11, record 1
+		7, (uint8_t[]){ 0x70, 0x03, 0x01, 0x01, 0xFF, 0x90, 0x00 },
+	},
+	{ 0 }
+};
+
 static int populate_afl(
 	struct emv_ctx_t* emv,
 	const uint8_t* afl,
@@ -284,7 +331,9 @@ int main(void)
 {
 	int r;
 	struct emv_cardreader_emul_ctx_t emul_ctx;
-	struct emv_ttl_t ttl;
+	struct emv_cardreader_emul_latency_ctx_t latency_ctx;
+	struct emv_ttl_t ttl = { { 0, NULL, NULL } };
+	struct emv_ttl_ext_t ttl_ext;
 	struct emv_ctx_t emv;
 
 	ttl.cardreader.mode = EMV_CARDREADER_MODE_APDU;
@@ -597,6 +646,122 @@ int main(void)
 		r = 1;
 		goto exit;
 	}
+	// ODA record buffer should be sized according to the actual records
+	// instead of the maximum record length
+	if (emv.oda.record_buf_len != 75 ||
+		emv.oda.record_buf_size < emv.oda.record_buf_len ||
+		emv.oda.record_buf_size > 2 * EMV_RAPDU_DATA_MAX
+	) {
+		fprintf(stderr, "Unexpected ODA record buffer length %u and size %u\n", emv.oda.record_buf_len, emv.oda.record_buf_size);
+		r = 1;
+		goto exit;
+	}
+	emv_tlv_list_clear(&emv.icc);
+	printf("Success\n");
+
+	// Use latency emulator to count host round trips for the remaining tests
+	memset(&latency_ctx, 0, sizeof(latency_ctx));
+	latency_ctx.trx = &emv_cardreader_emul;
+	latency_ctx.trx_ctx = &emul_ctx;
+	ttl.cardreader.ctx = &latency_ctx;
+	ttl.cardreader.trx = &emv_cardreader_emul_latency;
+
+	printf("\nTest 12: Batched records...\n");
+	r = populate_afl(&emv, test11_afl, sizeof(test11_afl));
+	if (r) {
+		fprintf(stderr, "populate_afl() failed; r=%d", r);
+		r = 1;
+		goto exit;
+	}
+	emul_ctx.xpdu_list = test11_apdu_list;
+	emul_ctx.xpdu_current = NULL;
+	latency_ctx.round_trips = 0;
+	latency_ctx.frames = 0;
+	r = emv_read_application_data(&emv);
+	if (r) {
+		fprintf(stderr, "emv_read_application_data() failed; error %d: %s\n", r, r < 0 ? emv_error_get_string(r) : emv_outcome_get_string(r));
+		r = 1;
+		goto exit;
+	}
+	if (latency_ctx.round_trips != 4 || latency_ctx.frames != 4) {
+		fprintf(stderr, "Unexpected round trips %u and frames %u without batch transceive\n", latency_ctx.round_trips, latency_ctx.frames);
+		r = 1;
+		goto exit;
+	}
+	emv_tlv_list_clear(&emv.icc);
+	emv_oda_clear(&emv.oda);
+
+	r = populate_afl(&emv, test11_afl, sizeof(test11_afl));
+	if (r) {
+		fprintf(stderr, "populate_afl() failed; r=%d", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_ttl_ext_attach(&ttl, &ttl_ext);
+	if (r) {
+		fprintf(stderr, "emv_ttl_ext_attach() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	ttl_ext.trx_batch = &emv_cardreader_emul_latency_batch;
+	emul_ctx.xpdu_list = test11_apdu_list;
+	emul_ctx.xpdu_current = NULL;
+	latency_ctx.round_trips = 0;
+	latency_ctx.frames = 0;
+	r = emv_read_application_data(&emv);
+	if (r) {
+		fprintf(stderr, "emv_read_application_data() failed; error %d: %s\n", r, r < 0 ? emv_error_get_string(r) : emv_outcome_get_string(r));
+		r = 1;
+		goto exit;
+	}
+	if (emul_ctx.xpdu_current->c_xpdu_len != 0) {
+		fprintf(stderr, "Incomplete card interaction\n");
+		r = 1;
+		goto exit;
+	}
+	if (latency_ctx.round_trips != 1 || latency_ctx.frames != 4) {
+		fprintf(stderr, "Unexpected round trips %u and frames %u with batch transceive\n", latency_ctx.round_trips, latency_ctx.frames);
+		r = 1;
+		goto exit;
+	}
+	if (!emv_tlv_list_find_const(&emv.icc, EMV_TAG_5A_APPLICATION_PAN) ||
+		!emv_tlv_list_find_const(&emv.icc, EMV_TAG_8F_CERTIFICATION_AUTHORITY_PUBLIC_KEY_INDEX)
+	) {
+		fprintf(stderr, "Missing record fields\n");
+		r = 1;
+		goto exit;
+	}
+	emv_tlv_list_clear(&emv.icc);
+	emv_oda_clear(&emv.oda);
+	printf("Success\n");
+
+	printf("\nTest 13: Batched records with status 6CXX...\n");
+	r = populate_afl(&emv, test11_afl, sizeof(test11_afl));
+	if (r) {
+		fprintf(stderr, "populate_afl() failed; r=%d", r);
+		r = 1;
+		goto exit;
+	}
+	emul_ctx.xpdu_list = test13_apdu_list;
+	emul_ctx.xpdu_current = NULL;
+	latency_ctx.round_trips = 0;
+	latency_ctx.frames = 0;
+	r = emv_read_application_data(&emv);
+	if (r) {
+		fprintf(stderr, "emv_read_application_data() failed; error %d: %s\n", r, r < 0 ? emv_error_get_string(r) : emv_outcome_get_string(r));
+		r = 1;
+		goto exit;
+	}
+	if (emul_ctx.xpdu_current->c_xpdu_len != 0) {
+		fprintf(stderr, "Incomplete card interaction\n");
+		r = 1;
+		goto exit;
+	}
+	if (latency_ctx.round_trips != 4 || latency_ctx.frames != 6) {
+		fprintf(stderr, "Unexpected round trips %u and frames %u\n", latency_ctx.round_trips, latency_ctx.frames);
+		r = 1;
+		goto exit;
+	}
 	emv_tlv_list_clear(&emv.icc);
 	printf("Success\n");
 
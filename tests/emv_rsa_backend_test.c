@@ -0,0 +1,304 @@
+/**
+ * @file emv_rsa_backend_test.c
+ * @brief Unit tests for EMV RSA public key operation backends
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_rsa.h"
+#include "emv_capk.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "print_helpers.h"
+
+// Modulus lengths in bytes, including lengths that are not a multiple of the
+// built-in backend's limb size
+static const size_t test_modulus_len[] = { 64, 128, 145, 176, 192, 227, 248 };
+
+static const uint8_t test_exponent_3[] = { 0x03 };
+static const uint8_t test_exponent_65537[] = { 0x01, 0x00, 0x01 };
+static const uint8_t test_exponent_generic[] = { 0x01, 0x00, 0x03 };
+
+struct test_exponent_t {
+	const uint8_t* value;
+	size_t len;
+};
+
+static const struct test_exponent_t test_exponents[] = {
+	{ test_exponent_3, sizeof(test_exponent_3) },
+	{ test_exponent_65537, sizeof(test_exponent_65537) },
+	{ test_exponent_generic, sizeof(test_exponent_generic) },
+};
+
+// Deterministic pseudo random data such that failures are reproducible
+static uint32_t test_rand_state = 0x12345678;
+
+static void test_rand(uint8_t* buf, size_t len)
+{
+	for (size_t i = 0; i < len; ++i) {
+		// xorshift32
+		test_rand_state ^= test_rand_state << 13;
+		test_rand_state ^= test_rand_state >> 17;
+		test_rand_state ^= test_rand_state << 5;
+		buf[i] = test_rand_state;
+	}
+}
+
+static int test_mod_exp(
+	const struct emv_rsa_key_t* key,
+	const uint8_t* modulus,
+	size_t modulus_len,
+	const uint8_t* exponent,
+	size_t exponent_len,
+	const uint8_t* input
+)
+{
+	int r;
+	uint8_t expected[248];
+	uint8_t output[248];
+
+	emv_rsa_set_backend(EMV_RSA_BACKEND_CRYPTO);
+	r = emv_rsa_mod_exp(NULL, modulus, modulus_len, exponent, exponent_len, input, expected);
+	if (r) {
+		fprintf(stderr, "emv_rsa_mod_exp() failed for crypto backend; r=%d\n", r);
+		return 1;
+	}
+
+	emv_rsa_set_backend(EMV_RSA_BACKEND_BUILTIN);
+	memset(output, 0, sizeof(output));
+	r = emv_rsa_mod_exp(key, modulus, modulus_len, exponent, exponent_len, input, output);
+	if (r) {
+		fprintf(stderr, "emv_rsa_mod_exp() failed for built-in backend; r=%d\n", r);
+		return 1;
+	}
+	if (memcmp(output, expected, modulus_len) != 0) {
+		fprintf(stderr, "Built-in backend output is incorrect\n");
+		print_buf("modulus", modulus, modulus_len);
+		print_buf("exponent", exponent, exponent_len);
+		print_buf("input", input, modulus_len);
+		print_buf("output", output, modulus_len);
+		print_buf("expected", expected, modulus_len);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	int r;
+	enum emv_rsa_backend_t default_backend;
+	struct emv_rsa_key_t key;
+	uint8_t modulus[248];
+	uint8_t input[248];
+	struct emv_capk_itr_t itr;
+	const struct emv_capk_t* capk;
+	unsigned int capk_count = 0;
+
+	default_backend = emv_rsa_get_backend();
+
+	printf("\nTesting invalid backend...\n");
+	r = emv_rsa_set_backend(EMV_RSA_BACKEND_BUILTIN + 1);
+	if (r >= 0) {
+		fprintf(stderr, "Unexpected emv_rsa_set_backend() result; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (emv_rsa_get_backend() != default_backend) {
+		fprintf(stderr, "Backend changed unexpectedly\n");
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting invalid keys...\n");
+	memset(modulus, 0xFF, sizeof(modulus));
+	modulus[127] = 0xFE;
+	r = emv_rsa_key_init(&key, modulus, 128, test_exponent_3, sizeof(test_exponent_3));
+	if (r >= 0) {
+		fprintf(stderr, "Unexpected emv_rsa_key_init() result for even modulus; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	modulus[0] = 0x00;
+	modulus[127] = 0xFF;
+	r = emv_rsa_key_init(&key, modulus, 128, test_exponent_3, sizeof(test_exponent_3));
+	if (r >= 0) {
+		fprintf(stderr, "Unexpected emv_rsa_key_init() result for leading zero; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	modulus[0] = 0xFF;
+	r = emv_rsa_key_init(&key, modulus, 128, (uint8_t[]){ 0x00 }, 1);
+	if (r >= 0) {
+		fprintf(stderr, "Unexpected emv_rsa_key_init() result for zero exponent; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_rsa_key_init(&key, modulus, 249, test_exponent_3, sizeof(test_exponent_3));
+	if (r >= 0) {
+		fprintf(stderr, "Unexpected emv_rsa_key_init() result for oversized modulus; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting built-in backend against crypto backend...\n");
+	for (size_t i = 0; i < sizeof(test_modulus_len) / sizeof(test_modulus_len[0]); ++i) {
+		size_t modulus_len = test_modulus_len[i];
+
+		for (size_t j = 0; j < sizeof(test_exponents) / sizeof(test_exponents[0]); ++j) {
+			const struct test_exponent_t* exponent = &test_exponents[j];
+
+			// Random odd modulus without leading zero bits
+			test_rand(modulus, modulus_len);
+			modulus[0] |= 0x80;
+			modulus[modulus_len - 1] |= 0x01;
+
+			r = emv_rsa_key_init(&key, modulus, modulus_len, exponent->value, exponent->len);
+			if (r) {
+				fprintf(stderr, "emv_rsa_key_init() failed; r=%d\n", r);
+				r = 1;
+				goto exit;
+			}
+
+			for (unsigned int k = 0; k < 8; ++k) {
+				test_rand(input, modulus_len);
+				// Input less than modulus, as is the case for valid
+				// EMV certificates and signatures
+				input[0] &= 0x7F;
+
+				// With and without precomputed key parameters
+				r = test_mod_exp(&key, modulus, modulus_len, exponent->value, exponent->len, input);
+				if (r) {
+					goto exit;
+				}
+				r = test_mod_exp(NULL, modulus, modulus_len, exponent->value, exponent->len, input);
+				if (r) {
+					goto exit;
+				}
+			}
+
+			// Boundary inputs
+			memset(input, 0, modulus_len);
+			r = test_mod_exp(&key, modulus, modulus_len, exponent->value, exponent->len, input);
+			if (r) {
+				goto exit;
+			}
+			input[modulus_len - 1] = 0x01;
+			r = test_mod_exp(&key, modulus, modulus_len, exponent->value, exponent->len, input);
+			if (r) {
+				goto exit;
+			}
+			memcpy(input, modulus, modulus_len);
+			input[modulus_len - 1] &= 0xFE;
+			r = test_mod_exp(&key, modulus, modulus_len, exponent->value, exponent->len, input);
+			if (r) {
+				goto exit;
+			}
+		}
+	}
+	printf("Success\n");
+
+	printf("\nTesting input not less than modulus...\n");
+	emv_rsa_set_backend(EMV_RSA_BACKEND_BUILTIN);
+	test_rand(modulus, 128);
+	modulus[0] |= 0x80;
+	modulus[127] |= 0x01;
+	r = emv_rsa_key_init(&key, modulus, 128, test_exponent_3, sizeof(test_exponent_3));
+	if (r) {
+		fprintf(stderr, "emv_rsa_key_init() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 0; i < 2; ++i) {
+		uint8_t output[128];
+
+		// Input equal to modulus and input greater than modulus
+		if (i) {
+			memset(input, 0xFF, 128);
+		} else {
+			memcpy(input, modulus, 128);
+		}
+		r = emv_rsa_mod_exp(&key, modulus, 128, test_exponent_3, sizeof(test_exponent_3), input, output);
+		if (!r) {
+			fprintf(stderr, "emv_rsa_mod_exp() unexpectedly accepted input not less than modulus\n");
+			r = 1;
+			goto exit;
+		}
+		r = emv_rsa_mod_exp(NULL, modulus, 128, test_exponent_3, sizeof(test_exponent_3), input, output);
+		if (!r) {
+			fprintf(stderr, "emv_rsa_mod_exp() unexpectedly accepted input not less than modulus\n");
+			r = 1;
+			goto exit;
+		}
+	}
+	printf("Success\n");
+
+	printf("\nTesting precomputed static CAPK parameters...\n");
+	r = emv_capk_init();
+	if (r) {
+		fprintf(stderr, "emv_capk_init() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	emv_capk_itr_init(&itr);
+	while ((capk = emv_capk_itr_next(&itr))) {
+		const struct emv_rsa_key_t* capk_key;
+
+		capk_key = emv_capk_get_key(capk);
+		if (!capk_key) {
+			fprintf(stderr, "emv_capk_get_key() failed for CAPK %02X\n", capk->index);
+			r = 1;
+			goto exit;
+		}
+
+		test_rand(input, capk->modulus_len);
+		input[0] = 0x6A;
+		r = test_mod_exp(
+			capk_key,
+			capk->modulus,
+			capk->modulus_len,
+			capk->exponent,
+			capk->exponent_len,
+			input
+		);
+		if (r) {
+			goto exit;
+		}
+		++capk_count;
+	}
+	if (!capk_count) {
+		fprintf(stderr, "No CAPKs found\n");
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	emv_rsa_set_backend(default_backend);
+
+	return r;
+}
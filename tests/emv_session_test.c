@@ -0,0 +1,260 @@
+/**
+ * @file emv_session_test.c
+ * @brief Unit tests for card reader session recording and replay
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv.h"
+#include "emv_session.h"
+#include "emv_metrics.h"
+#include "emv_cardreader_emul.h"
+#include "emv_ttl.h"
+#include "emv_tlv.h"
+#include "emv_app.h"
+#include "emv_tags.h"
+#include "emv_fields.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#endif
+
+#define TEST_SESSION_FILE "emv_session_test.bin"
+
+// Emulated card reader delay per exchange
+#define TEST_TRX_DELAY_US (1000)
+#define TEST_TRX_DELAY_NS (TEST_TRX_DELAY_US * 1000ULL)
+
+static const struct xpdu_t test_pse_app_supported[] = {
+	{
+		20, (uint8_t[]){ 0x00, 0xA4, 0x04, 0x00, 0x0E, 0x31, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46, 0x30, 0x31, 0x00 }, // SELECT 1PAY.SYS.DDF01
+		36, (uint8_t[]){ 0x6F, 0x20, 0x84, 0x0E, 0x31, 0x50, 0x41, 0x59, 0x2E, 0x53, 0x59, 0x53, 0x2E, 0x44, 0x44, 0x46, 0x30, 0x31, 0xA5, 0x0E, 0x88, 0x01, 0x01, 0x5F, 0x2D, 0x04, 0x6E, 0x6C, 0x65, 0x6E, 0x9F, 0x11, 0x01, 0x01, 0x90, 0x00 }, // FCI
+	},
+	{
+		5, (uint8_t[]){ 0x00, 0xB2, 0x01, 0x0C, 0x00 }, // READ RECORD 1,1
+		45, (uint8_t[]){ 0x70, 0x29, 0x61, 0x27, 0x4F, 0x07, 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10, 0x50, 0x0B, 0x56, 0x49, 0x53, 0x41, 0x20, 0x43, 0x52, 0x45, 0x44, 0x49, 0x54, 0x87, 0x01, 0x01, 0x9F, 0x12, 0x0B, 0x56, 0x49, 0x53, 0x41, 0x20, 0x43, 0x52, 0x45, 0x44, 0x49, 0x54, 0x90, 0x00 }, // AEF
+	},
+	{
+		5, (uint8_t[]){ 0x00, 0xB2, 0x02, 0x0C, 0x00 }, // READ RECORD 1,2
+		2, (uint8_t[]){ 0x6A, 0x83 }, // Record not found
+	},
+	{ 0 }
+};
+
+static int verify_app_list(struct emv_app_list_t* app_list)
+{
+	static const uint8_t aid[] = { 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10 };
+
+	if (!app_list->front ||
+		app_list->front != app_list->back ||
+		app_list->front->aid->length != sizeof(aid) ||
+		memcmp(app_list->front->aid->value, aid, sizeof(aid)) != 0
+	) {
+		fprintf(stderr, "Incorrect candidate list\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	int r;
+	struct emv_cardreader_emul_ctx_t emul_ctx;
+	struct emv_cardreader_emul_latency_ctx_t latency_ctx;
+	struct emv_session_recorder_t rec;
+	struct emv_session_player_t player = { 0 };
+	struct emv_ttl_t ttl = { { 0, NULL, NULL } };
+	struct emv_ctx_t emv;
+	struct emv_app_list_t app_list = EMV_APP_LIST_INIT;
+	uint64_t start_ns;
+	uint64_t duration_ns;
+
+	r = emv_ctx_init(&emv, &ttl);
+	if (r) {
+		fprintf(stderr, "emv_ctx_init() failed; r=%d\n", r);
+		return 1;
+	}
+
+	// Supported applications
+	emv_tlv_list_push(&emv.supported_aids, EMV_TAG_9F06_AID, 6, (uint8_t[]){ 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10 }, EMV_ASI_PARTIAL_MATCH); // Visa
+
+	printf("\nTesting session recording...\n");
+	emul_ctx.xpdu_list = test_pse_app_supported;
+	emul_ctx.xpdu_current = NULL;
+	memset(&latency_ctx, 0, sizeof(latency_ctx));
+	latency_ctx.trx = &emv_cardreader_emul;
+	latency_ctx.trx_ctx = &emul_ctx;
+	latency_ctx.latency_us = TEST_TRX_DELAY_US;
+	r = emv_session_recorder_init(
+		&rec,
+		&(struct emv_cardreader_t){
+			EMV_CARDREADER_MODE_APDU,
+			&latency_ctx,
+			&emv_cardreader_emul_latency,
+		},
+		TEST_SESSION_FILE
+	);
+	if (r) {
+		fprintf(stderr, "emv_session_recorder_init() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	ttl.cardreader.mode = EMV_CARDREADER_MODE_APDU;
+	ttl.cardreader.ctx = &rec;
+	ttl.cardreader.trx = &emv_session_recorder_trx;
+	r = emv_build_candidate_list(&emv, &app_list);
+	if (r) {
+		fprintf(stderr, "emv_build_candidate_list() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_session_recorder_close(&rec);
+	if (r) {
+		fprintf(stderr, "emv_session_recorder_close() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (rec.exchange_count != 3) {
+		fprintf(stderr, "Incorrect number of recorded exchanges %u\n", rec.exchange_count);
+		r = 1;
+		goto exit;
+	}
+#if !defined(_WIN32)
+	{
+		struct stat st;
+
+		// Session file contains cardholder data and must only be
+		// accessible by its owner
+		if (stat(TEST_SESSION_FILE, &st) || (st.st_mode & (S_IRWXG | S_IRWXO))) {
+			fprintf(stderr, "Session file is accessible by others\n");
+			r = 1;
+			goto exit;
+		}
+	}
+#endif
+	r = verify_app_list(&app_list);
+	if (r) {
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting session replay at wire speed...\n");
+	r = emv_session_player_load(&player, TEST_SESSION_FILE, EMV_SESSION_REPLAY_WIRE_SPEED);
+	if (r) {
+		fprintf(stderr, "emv_session_player_load() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (player.mode != EMV_CARDREADER_MODE_APDU) {
+		fprintf(stderr, "Incorrect session card reader mode\n");
+		r = 1;
+		goto exit;
+	}
+	ttl.cardreader.ctx = &player;
+	ttl.cardreader.trx = &emv_session_player_trx;
+	for (unsigned int i = 0; i < 100; ++i) {
+		emv_app_list_clear(&app_list);
+		emv_session_player_rewind(&player);
+		r = emv_build_candidate_list(&emv, &app_list);
+		if (r) {
+			fprintf(stderr, "emv_build_candidate_list() failed; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+		if (!emv_session_player_is_complete(&player)) {
+			fprintf(stderr, "Incomplete session replay\n");
+			r = 1;
+			goto exit;
+		}
+		r = verify_app_list(&app_list);
+		if (r) {
+			goto exit;
+		}
+	}
+	printf("Success\n");
+
+	printf("\nTesting session replay with recorded timing...\n");
+	player.flags = EMV_SESSION_REPLAY_TRX_TIME | EMV_SESSION_REPLAY_GAP_TIME;
+	emv_app_list_clear(&app_list);
+	emv_session_player_rewind(&player);
+	start_ns = emv_metrics_get_time_ns();
+	r = emv_build_candidate_list(&emv, &app_list);
+	duration_ns = emv_metrics_get_time_ns() - start_ns;
+	if (r) {
+		fprintf(stderr, "emv_build_candidate_list() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (duration_ns < 3 * TEST_TRX_DELAY_NS) {
+		fprintf(stderr, "Replay duration %llu too short\n", (unsigned long long)duration_ns);
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	printf("\nTesting session replay mismatch...\n");
+	player.flags = EMV_SESSION_REPLAY_WIRE_SPEED;
+	emv_app_list_clear(&app_list);
+	emv_session_player_rewind(&player);
+	{
+		uint8_t c_apdu[] = { 0x00, 0xA4, 0x04, 0x00, 0x05, 0xA0, 0x00, 0x00, 0x00, 0x04, 0x00 };
+		uint8_t r_apdu[EMV_RAPDU_MAX];
+		size_t r_apdu_len = sizeof(r_apdu);
+
+		r = emv_session_player_trx(&player, c_apdu, sizeof(c_apdu), r_apdu, &r_apdu_len);
+		if (r != EMV_SESSION_ERROR_MISMATCH) {
+			fprintf(stderr, "Unexpected emv_session_player_trx() result; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+	}
+	printf("Success\n");
+
+	printf("\nTesting invalid session data...\n");
+	emv_session_player_free(&player);
+	r = emv_session_player_init(&player, "EMVS\x02\x01\x00\x00", 8, 0);
+	if (r != EMV_SESSION_ERROR_INVALID_FORMAT) {
+		fprintf(stderr, "Unexpected emv_session_player_init() result; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_session_player_init(&player, "EMVS\x01\x01\x00\x00\x00\x00", 10, 0);
+	if (r != EMV_SESSION_ERROR_INVALID_FORMAT) {
+		fprintf(stderr, "Unexpected emv_session_player_init() result; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	printf("Success\n");
+
+	// Success
+	r = 0;
+	goto exit;
+
+exit:
+	emv_session_player_free(&player);
+	emv_app_list_clear(&app_list);
+	emv_ctx_clear(&emv);
+	remove(TEST_SESSION_FILE);
+
+	return r;
+}
@@ -25,6 +25,7 @@
 #include "emv_tags.h"
 #include "emv_fields.h"
 #include "emv_ttl.h"
+#include "emv_txn_log.h"
 
 #include <stddef.h>
 #include <stdio.h>
@@ -541,6 +542,7 @@ int main(void)
 	struct emv_cardreader_emul_ctx_t emul_ctx;
 	struct emv_ttl_t ttl;
 	struct emv_ctx_t emv;
+	struct emv_txn_log_t* txn_log = NULL;
 
 	ttl.cardreader.mode = EMV_CARDREADER_MODE_APDU;
 	ttl.cardreader.ctx = &emul_ctx;
@@ -656,6 +658,52 @@ int main(void)
 			goto exit;
 		}
 
+		// Repeat test using indexed transaction log
+		txn_log = emv_txn_log_create(test[i].txn_log_cnt ? test[i].txn_log_cnt : 1, 0);
+		if (!txn_log) {
+			fprintf(stderr, "emv_txn_log_create() failed\n");
+			r = 1;
+			goto exit;
+		}
+		for (size_t j = 0; j < test[i].txn_log_cnt; ++j) {
+			r = emv_txn_log_add(txn_log, &test[i].txn_log[j]);
+			if (r) {
+				fprintf(stderr, "emv_txn_log_add() failed; r=%d\n", r);
+				r = 1;
+				goto exit;
+			}
+		}
+		r = populate_tlv_list(
+			test[i].icc_data,
+			&emv.icc
+		);
+		if (r) {
+			fprintf(stderr, "populate_tlv_list() failed; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+		memset(emv.tvr->value, 0, emv.tvr->length);
+		memset(emv.tsi->value, 0, emv.tsi->length);
+		emul_ctx.xpdu_list = test[i].xpdu_list;
+		emul_ctx.xpdu_current = NULL;
+		r = emv_terminal_risk_management_with_txn_log(&emv, txn_log);
+		if (r) {
+			fprintf(stderr, "emv_terminal_risk_management_with_txn_log() failed; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+		if (memcmp(emv.tvr->value, test[i].tvr, sizeof(test[i].tvr)) != 0 ||
+			memcmp(emv.tsi->value, test[i].tsi, sizeof(test[i].tsi)) != 0
+		) {
+			fprintf(stderr, "Incorrect TVR or TSI using indexed transaction log\n");
+			print_buf("TVR", emv.tvr->value, emv.tvr->length);
+			print_buf("TSI", emv.tsi->value, emv.tsi->length);
+			r = 1;
+			goto exit;
+		}
+		emv_txn_log_free(txn_log);
+		txn_log = NULL;
+
 		r = emv_ctx_clear(&emv);
 		if (r) {
 			fprintf(stderr, "emv_ctx_clear() failed; r=%d\n", r);
@@ -672,6 +720,7 @@ int main(void)
 	goto exit;
 
 exit:
+	emv_txn_log_free(txn_log);
 	emv_ctx_clear(&emv);
 
 	return r;
@@ -0,0 +1,347 @@
+/**
+ * @file emv_ttl_t1_test.c
+ * @brief Unit tests for EMV TTL APDU cases using protocol T=1
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_ttl.h"
+#include "emv_cardreader_emul.h"
+#include "iso7816.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// For debug output
+#include "emv_debug.h"
+#include "print_helpers.h"
+
+// ATR for protocol T=1 with IFSC=32 and LRC
+static const uint8_t test_atr_t1_lrc[] = { 0x3B, 0xE0, 0x00, 0xFF, 0x81, 0x31, 0x20, 0x45, 0xCA };
+
+// ATR for protocol T=1 with IFSC=32 and CRC
+static const uint8_t test_atr_t1_crc[] = { 0x3B, 0xE0, 0x00, 0xFF, 0x81, 0x71, 0x20, 0x45, 0x01, 0x8B };
+
+// APDU exchanges for case 1
+static const struct xpdu_t test_apdu_case_1[] = {
+	{
+		4, (uint8_t[]){ 0x12, 0x34, 0x56, 0x78 },
+		2, (uint8_t[]){ 0x90, 0x00 },
+	},
+	{ 0 }
+};
+
+// APDU exchanges for case 4 GENERATE AC
+static const struct xpdu_t test_apdu_case_4[] = {
+	{
+		10, (uint8_t[]){ 0x80, 0xAE, 0x80, 0x00, 0x04, 0x00, 0x00, 0x10, 0x00, 0x00 },
+		22, (uint8_t[]){ 0x77, 0x12, 0x9F, 0x27, 0x01, 0x80, 0x9F, 0x36, 0x02, 0x00, 0x01, 0x9F, 0x26, 0x08, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x90, 0x00 },
+	},
+	{ 0 }
+};
+
+static int test_t1_init(
+	struct emv_ttl_t* ttl,
+	struct emv_cardreader_emul_t1_ctx_t* emul_ctx,
+	const uint8_t* atr,
+	size_t atr_len
+)
+{
+	int r;
+	const struct emv_ttl_ext_t* ttl_ext = emv_ttl_ext_get(ttl);
+	struct iso7816_atr_info_t atr_info;
+
+	r = iso7816_atr_parse(atr, atr_len, &atr_info);
+	if (r) {
+		fprintf(stderr, "iso7816_atr_parse() failed; r=%d\n", r);
+		return 1;
+	}
+
+	memset(emul_ctx, 0, sizeof(*emul_ctx));
+	emul_ctx->ifsc = atr_info.protocol_T1.IFSI;
+	emul_ctx->edc_crc = atr_info.protocol_T1.error_detection_code == ISO7816_ERROR_DETECTION_CODE_CRC;
+
+	r = emv_ttl_t1_init(ttl, &atr_info);
+	if (r) {
+		fprintf(stderr, "emv_ttl_t1_init() failed; r=%d\n", r);
+		return 1;
+	}
+	if (ttl_ext->t1.ifsc != 32 || ttl_ext->t1.ifsd != EMV_TTL_T1_IFS_MAX) {
+		fprintf(stderr, "Incorrect IFSC=%u or IFSD=%u\n", ttl_ext->t1.ifsc, ttl_ext->t1.ifsd);
+		return 1;
+	}
+	if (emul_ctx->ifsd != EMV_TTL_T1_IFS_MAX) {
+		fprintf(stderr, "Emulated card has incorrect IFSD=%u\n", emul_ctx->ifsd);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int test_t1_trx(
+	struct emv_ttl_t* ttl,
+	struct emv_cardreader_emul_t1_ctx_t* emul_ctx,
+	const struct xpdu_t* xpdu_list,
+	unsigned int expected_exchanges
+)
+{
+	int r;
+	struct emv_ttl_ext_t* ttl_ext = emv_ttl_ext_get(ttl);
+	uint8_t r_apdu[EMV_RAPDU_MAX];
+	size_t r_apdu_len = sizeof(r_apdu);
+	uint16_t sw1sw2;
+	struct emv_ttl_stats_t stats;
+
+	emul_ctx->apdu.xpdu_list = xpdu_list;
+	emul_ctx->apdu.xpdu_current = NULL;
+	emv_ttl_stats_reset(&stats);
+	ttl_ext->stats = &stats;
+
+	r = emv_ttl_trx(
+		ttl,
+		xpdu_list->c_xpdu,
+		xpdu_list->c_xpdu_len,
+		r_apdu,
+		&r_apdu_len,
+		&sw1sw2
+	);
+	ttl_ext->stats = NULL;
+	if (r) {
+		fprintf(stderr, "emv_ttl_trx() failed; r=%d\n", r);
+		return 1;
+	}
+	if (r_apdu_len != xpdu_list->r_xpdu_len ||
+		memcmp(r_apdu, xpdu_list->r_xpdu, r_apdu_len) != 0
+	) {
+		fprintf(stderr, "emv_ttl_trx() failed; incorrect response data\n");
+		print_buf("r_apdu", r_apdu, r_apdu_len);
+		return 1;
+	}
+	if (sw1sw2 != 0x9000) {
+		fprintf(stderr, "Unexpected SW1-SW2 %04X\n", sw1sw2);
+		return 1;
+	}
+	if (emul_ctx->apdu.xpdu_current->c_xpdu_len) {
+		fprintf(stderr, "Incomplete APDU exchanges\n");
+		return 1;
+	}
+	if (stats.ins[0].exchanges != expected_exchanges) {
+		fprintf(stderr, "Unexpected block exchange count %u (expected %u)\n", stats.ins[0].exchanges, expected_exchanges);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	int r;
+
+	struct emv_ttl_t ttl;
+	struct emv_ttl_ext_t ttl_ext;
+	struct emv_cardreader_emul_t1_ctx_t emul_ctx;
+	ttl.cardreader.mode = EMV_CARDREADER_MODE_TPDU_T1;
+	ttl.cardreader.ctx = &emul_ctx;
+	ttl.cardreader.trx = &emv_cardreader_emul_t1;
+
+	uint8_t read_record_rapdu[EMV_RAPDU_MAX];
+	uint8_t long_capdu[5 + EMV_CAPDU_DATA_MAX];
+	struct xpdu_t test_apdu_case_2[2] = { 0 };
+	struct xpdu_t test_apdu_case_3[2] = { 0 };
+	uint8_t r_apdu[EMV_RAPDU_MAX];
+	size_t r_apdu_len;
+	uint16_t sw1sw2;
+
+	// Enable debug output
+	r = emv_debug_init(EMV_DEBUG_SOURCE_ALL, EMV_DEBUG_LEVEL_ALL, &print_emv_debug);
+	if (r) {
+		fprintf(stderr, "emv_debug_init() failed; r=%d\n", r);
+		return 1;
+	}
+
+	// Case 2 READ RECORD with maximum response length
+	for (size_t i = 0; i < EMV_RAPDU_DATA_MAX; ++i) {
+		read_record_rapdu[i] = i;
+	}
+	read_record_rapdu[EMV_RAPDU_DATA_MAX] = 0x90;
+	read_record_rapdu[EMV_RAPDU_DATA_MAX + 1] = 0x00;
+	test_apdu_case_2[0].c_xpdu_len = 5;
+	test_apdu_case_2[0].c_xpdu = (uint8_t[]){ 0x00, 0xB2, 0x01, 0x0C, 0x00 };
+	test_apdu_case_2[0].r_xpdu_len = sizeof(read_record_rapdu);
+	test_apdu_case_2[0].r_xpdu = read_record_rapdu;
+
+	// Case 3 command with maximum command length
+	memcpy(long_capdu, (uint8_t[]){ 0x80, 0xDA, 0x9F, 0x10, EMV_CAPDU_DATA_MAX }, 5);
+	for (size_t i = 0; i < EMV_CAPDU_DATA_MAX; ++i) {
+		long_capdu[5 + i] = ~i;
+	}
+	test_apdu_case_3[0].c_xpdu_len = sizeof(long_capdu);
+	test_apdu_case_3[0].c_xpdu = long_capdu;
+	test_apdu_case_3[0].r_xpdu_len = 2;
+	test_apdu_case_3[0].r_xpdu = (uint8_t[]){ 0x90, 0x00 };
+
+	printf("\nTesting protocol T=1 without TTL extension...\n");
+	memset(&emul_ctx, 0, sizeof(emul_ctx));
+	r_apdu_len = sizeof(r_apdu);
+	r = emv_ttl_trx(&ttl, test_apdu_case_1[0].c_xpdu, test_apdu_case_1[0].c_xpdu_len, r_apdu, &r_apdu_len, &sw1sw2);
+	if (r >= 0 || emul_ctx.block_count) {
+		fprintf(stderr, "emv_ttl_trx() did not reject missing protocol T=1 state; r=%d\n", r);
+		return 1;
+	}
+	r = emv_ttl_t1_init(&ttl, &(struct iso7816_atr_info_t){ 0 });
+	if (r >= 0 || emul_ctx.block_count) {
+		fprintf(stderr, "emv_ttl_t1_init() did not reject missing protocol T=1 state; r=%d\n", r);
+		return 1;
+	}
+	printf("Success\n");
+
+	r = emv_ttl_ext_attach(&ttl, &ttl_ext);
+	if (r) {
+		fprintf(stderr, "emv_ttl_ext_attach() failed; r=%d\n", r);
+		return 1;
+	}
+
+	printf("\nTesting transceive before protocol T=1 initialisation...\n");
+	memset(&emul_ctx, 0, sizeof(emul_ctx));
+	r_apdu_len = sizeof(r_apdu);
+	r = emv_ttl_trx(&ttl, test_apdu_case_1[0].c_xpdu, test_apdu_case_1[0].c_xpdu_len, r_apdu, &r_apdu_len, &sw1sw2);
+	if (r >= 0 || emul_ctx.block_count) {
+		fprintf(stderr, "emv_ttl_trx() did not reject uninitialised protocol T=1 state; r=%d\n", r);
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTesting IFSD negotiation (LRC)...\n");
+	r = test_t1_init(&ttl, &emul_ctx, test_atr_t1_lrc, sizeof(test_atr_t1_lrc));
+	if (r) {
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTesting APDU case 1 (T=1)...\n");
+	r = test_t1_trx(&ttl, &emul_ctx, test_apdu_case_1, 1);
+	if (r) {
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTesting APDU case 2 (T=1) with chained response...\n");
+	// I-block; I-block(M) + R-block; I-block
+	r = test_t1_trx(&ttl, &emul_ctx, test_apdu_case_2, 2);
+	if (r) {
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTesting APDU case 3 (T=1) with chained command...\n");
+	// 260 bytes using IFSC=32 requires 9 I-blocks
+	r = test_t1_trx(&ttl, &emul_ctx, test_apdu_case_3, 9);
+	if (r) {
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTesting APDU case 4 (T=1) with waiting time extensions...\n");
+	emul_ctx.wtx = 2;
+	r = test_t1_trx(&ttl, &emul_ctx, test_apdu_case_4, 3);
+	if (r) {
+		return 1;
+	}
+	if (ttl_ext.t1.wtx_count != 2 || ttl_ext.t1.wtx != 1) {
+		fprintf(stderr, "Incorrect WTX count %u or WTX multiplier %u\n", ttl_ext.t1.wtx_count, ttl_ext.t1.wtx);
+		return 1;
+	}
+	emul_ctx.wtx = 0;
+	printf("Success\n");
+
+	printf("\nTesting EDC error recovery (T=1)...\n");
+	emul_ctx.edc_errors = 2;
+	r = test_t1_trx(&ttl, &emul_ctx, test_apdu_case_2, 4);
+	if (r) {
+		return 1;
+	}
+	if (ttl_ext.t1.retransmissions != 2) {
+		fprintf(stderr, "Incorrect retransmission count %u\n", ttl_ext.t1.retransmissions);
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTesting IFS request from card (T=1)...\n");
+	emul_ctx.ifs_request = 0x40;
+	r = test_t1_trx(&ttl, &emul_ctx, test_apdu_case_1, 2);
+	if (r) {
+		return 1;
+	}
+	if (ttl_ext.t1.ifsc != 0x40) {
+		fprintf(stderr, "Incorrect IFSC=%u\n", ttl_ext.t1.ifsc);
+		return 1;
+	}
+	// 260 bytes using IFSC=64 requires 5 I-blocks
+	r = test_t1_trx(&ttl, &emul_ctx, test_apdu_case_3, 5);
+	if (r) {
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTesting repeated EDC errors (T=1)...\n");
+	emul_ctx.apdu.xpdu_list = test_apdu_case_1;
+	emul_ctx.apdu.xpdu_current = NULL;
+	emul_ctx.edc_errors = 4;
+	r_apdu_len = sizeof(r_apdu);
+	r = emv_ttl_trx(
+		&ttl,
+		test_apdu_case_1[0].c_xpdu,
+		test_apdu_case_1[0].c_xpdu_len,
+		r_apdu,
+		&r_apdu_len,
+		&sw1sw2
+	);
+	if (r <= 0) {
+		fprintf(stderr, "emv_ttl_trx() unexpectedly succeeded; r=%d\n", r);
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTesting IFSD negotiation (CRC)...\n");
+	r = test_t1_init(&ttl, &emul_ctx, test_atr_t1_crc, sizeof(test_atr_t1_crc));
+	if (r) {
+		return 1;
+	}
+	if (!ttl_ext.t1.edc_crc) {
+		fprintf(stderr, "EDC is not CRC\n");
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTesting APDU case 2 (T=1) with CRC...\n");
+	emul_ctx.edc_errors = 1;
+	r = test_t1_trx(&ttl, &emul_ctx, test_apdu_case_2, 3);
+	if (r) {
+		return 1;
+	}
+	printf("Success\n");
+
+	printf("\nTesting APDU case 3 (T=1) with CRC...\n");
+	r = test_t1_trx(&ttl, &emul_ctx, test_apdu_case_3, 9);
+	if (r) {
+		return 1;
+	}
+	printf("Success\n");
+
+	return 0;
+}
@@ -314,6 +314,9 @@ int main(void)
 	uint8_t data[EMV_RAPDU_DATA_MAX];
 	size_t data_len;
 	uint16_t sw1sw2;
+	struct emv_ttl_ext_t ttl_ext;
+	struct emv_ttl_stats_t stats;
+	const struct emv_ttl_ins_stats_t* ins_stats;
 
 	// Enable debug output
 	r = emv_debug_init(EMV_DEBUG_SOURCE_ALL, EMV_DEBUG_LEVEL_ALL, &print_emv_debug);
@@ -851,5 +854,80 @@ int main(void)
 	}
 	printf("Success\n");
 
+	// Test TTL statistics
+	printf("\nTesting TTL statistics ('61' and '6C' procedure bytes)...\n");
+	r = emv_ttl_ext_attach(&ttl, &ttl_ext);
+	if (r) {
+		fprintf(stderr, "emv_ttl_ext_attach() failed; r=%d\n", r);
+		return 1;
+	}
+	r = emv_ttl_stats_reset(&stats);
+	if (r) {
+		fprintf(stderr, "emv_ttl_stats_reset() failed; r=%d\n", r);
+		return 1;
+	}
+	ttl_ext.stats = &stats;
+
+	emul_ctx.xpdu_list = test_tpdu_case_2_normal_advanced;
+	emul_ctx.xpdu_current = NULL;
+	data_len = sizeof(data);
+	r = emv_ttl_read_record(&ttl, 1, 1, data, &data_len, &sw1sw2);
+	if (r || sw1sw2 != 0x9000) {
+		fprintf(stderr, "emv_ttl_read_record() failed; r=%d; sw1sw2=%04X\n", r, sw1sw2);
+		return 1;
+	}
+
+	emul_ctx.xpdu_list = test_tpdu_case_4_normal_advanced;
+	emul_ctx.xpdu_current = NULL;
+	data_len = sizeof(data);
+	r = emv_ttl_select_by_df_name(&ttl, PSE, sizeof(PSE) - 1, data, &data_len, &sw1sw2);
+	if (r || sw1sw2 != 0x9000) {
+		fprintf(stderr, "emv_ttl_select_by_df_name() failed; r=%d; sw1sw2=%04X\n", r, sw1sw2);
+		return 1;
+	}
+	r = emv_ttl_ext_detach(&ttl);
+	if (r || ttl.cardreader.ctx != &emul_ctx || ttl.cardreader.trx != &emv_cardreader_emul) {
+		fprintf(stderr, "emv_ttl_ext_detach() failed; r=%d\n", r);
+		return 1;
+	}
+
+	if (stats.ins_count != 2) {
+		fprintf(stderr, "Unexpected number of instructions %u\n", stats.ins_count);
+		return 1;
+	}
+	ins_stats = emv_ttl_stats_find(&stats, 0xB2);
+	if (!ins_stats ||
+		ins_stats->commands != 1 ||
+		ins_stats->exchanges != 4 ||
+		ins_stats->get_response != 2 ||
+		ins_stats->le_retries != 1 ||
+		ins_stats->errors != 0 ||
+		ins_stats->tx_bytes != 20 ||
+		ins_stats->rx_bytes != 38 ||
+		ins_stats->latency.count != 1
+	) {
+		fprintf(stderr, "Incorrect READ RECORD statistics\n");
+		return 1;
+	}
+	ins_stats = emv_ttl_stats_find(&stats, 0xA4);
+	if (!ins_stats ||
+		ins_stats->commands != 1 ||
+		ins_stats->exchanges != 4 ||
+		ins_stats->get_response != 2 ||
+		ins_stats->le_retries != 0 ||
+		ins_stats->errors != 0 ||
+		ins_stats->tx_bytes != 29 ||
+		ins_stats->rx_bytes != 47 ||
+		ins_stats->latency.count != 1
+	) {
+		fprintf(stderr, "Incorrect SELECT statistics\n");
+		return 1;
+	}
+	if (emv_ttl_stats_find(&stats, 0xC0)) {
+		fprintf(stderr, "GET RESPONSE unexpectedly accounted separately\n");
+		return 1;
+	}
+	printf("Success\n");
+
 	return 0;
 }
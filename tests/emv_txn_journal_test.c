@@ -0,0 +1,279 @@
+/**
+ * @file emv_txn_journal_test.c
+ * @brief Unit tests for persistent transaction journal
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_txn_journal.h"
+#include "emv_txn_log.h"
+#include "emv.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define JOURNAL_FILENAME "emv_txn_journal_test.dat"
+#define LARGE_ENTRY_COUNT (10000)
+#define PAN_COUNT (50)
+
+static void populate_entry(struct emv_txn_log_entry_t* entry, unsigned int i)
+{
+	unsigned int pan = i % PAN_COUNT;
+
+	memset(entry, 0, sizeof(*entry));
+	memset(entry->pan, 0xFF, sizeof(entry->pan));
+	entry->pan[0] = 0x54;
+	entry->pan[1] = 0x13;
+	entry->pan[2] = 0x33;
+	entry->pan[3] = 0x00;
+	entry->pan[4] = 0x89;
+	entry->pan[5] = 0x02;
+	entry->pan[6] = ((pan / 10) << 4) | (pan % 10);
+	entry->pan[7] = 0x11;
+	entry->pan_seq = 0x01;
+	entry->txn_date[0] = 0x25;
+	entry->txn_date[1] = 0x07;
+	entry->txn_date[2] = 0x01;
+	entry->transaction_amount = i;
+}
+
+static int verify_entries(const struct emv_txn_journal_t* journal, size_t count)
+{
+	const struct emv_txn_log_entry_t* entries;
+
+	if (emv_txn_journal_count(journal) != count) {
+		fprintf(stderr, "emv_txn_journal_count() returned %zu instead of %zu\n",
+			emv_txn_journal_count(journal), count
+		);
+		return 1;
+	}
+
+	entries = emv_txn_journal_entries(journal);
+	for (size_t i = 0; i < count; ++i) {
+		struct emv_txn_log_entry_t entry;
+
+		populate_entry(&entry, i);
+		if (memcmp(&entries[i], &entry, sizeof(entry)) != 0) {
+			fprintf(stderr, "Incorrect journal record %zu\n", i);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	int r;
+	struct emv_txn_journal_t* journal = NULL;
+	struct emv_txn_log_t* log = NULL;
+	struct emv_txn_log_entry_t entry;
+	const struct emv_txn_log_entry_t* found;
+	FILE* file;
+
+	remove(JOURNAL_FILENAME);
+
+	// Test new journal
+	r = emv_txn_journal_open(JOURNAL_FILENAME, 0, &journal);
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_open() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (emv_txn_journal_count(journal) != 0 || emv_txn_journal_entries(journal)) {
+		fprintf(stderr, "New journal is not empty\n");
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 0; i < 3; ++i) {
+		populate_entry(&entry, i);
+		r = emv_txn_journal_append(journal, &entry);
+		if (r) {
+			fprintf(stderr, "emv_txn_journal_append() failed; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+	}
+	r = emv_txn_journal_commit(journal);
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_commit() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 3; i < 5; ++i) {
+		populate_entry(&entry, i);
+		r = emv_txn_journal_append(journal, &entry);
+		if (r) {
+			fprintf(stderr, "emv_txn_journal_append() failed; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+	}
+	r = verify_entries(journal, 5);
+	if (r) {
+		goto exit;
+	}
+	r = emv_txn_journal_close(journal);
+	journal = NULL;
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_close() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+
+	// Test that closing the journal committed the remaining records
+	r = emv_txn_journal_open(JOURNAL_FILENAME, 0, &journal);
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_open() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = verify_entries(journal, 5);
+	if (r) {
+		goto exit;
+	}
+	r = emv_txn_journal_close(journal);
+	journal = NULL;
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_close() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+
+	// Interrupt the latest header, which is the third generation in the
+	// second slot, to test recovery of the previous commit
+	file = fopen(JOURNAL_FILENAME, "r+b");
+	if (!file) {
+		fprintf(stderr, "fopen() failed\n");
+		r = 1;
+		goto exit;
+	}
+	fseek(file, 64 + 20, SEEK_SET);
+	fputc(0xA5, file);
+	fclose(file);
+	r = emv_txn_journal_open(JOURNAL_FILENAME, 0, &journal);
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_open() failed to recover; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = verify_entries(journal, 3);
+	if (r) {
+		goto exit;
+	}
+
+	// Test group commit and growth of journal
+	r = emv_txn_journal_close(journal);
+	journal = NULL;
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_close() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_txn_journal_open(JOURNAL_FILENAME, 1000, &journal);
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_open() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 3; i < LARGE_ENTRY_COUNT; ++i) {
+		populate_entry(&entry, i);
+		r = emv_txn_journal_append(journal, &entry);
+		if (r) {
+			fprintf(stderr, "emv_txn_journal_append() failed; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+	}
+	r = emv_txn_journal_close(journal);
+	journal = NULL;
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_close() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_txn_journal_open(JOURNAL_FILENAME, 1000, &journal);
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_open() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = verify_entries(journal, LARGE_ENTRY_COUNT);
+	if (r) {
+		goto exit;
+	}
+
+	// Test indexed transaction log built from journal
+	log = emv_txn_log_create(PAN_COUNT * 2, 0);
+	if (!log) {
+		fprintf(stderr, "emv_txn_log_create() failed\n");
+		r = 1;
+		goto exit;
+	}
+	r = emv_txn_journal_build_txn_log(journal, log);
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_build_txn_log() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	populate_entry(&entry, 7);
+	found = emv_txn_log_find_latest(log, entry.pan, 8);
+	if (!found || found->transaction_amount != LARGE_ENTRY_COUNT - PAN_COUNT + 7) {
+		fprintf(stderr, "emv_txn_log_find_latest() failed to find latest record\n");
+		r = 1;
+		goto exit;
+	}
+	r = emv_txn_journal_close(journal);
+	journal = NULL;
+	if (r) {
+		fprintf(stderr, "emv_txn_journal_close() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+
+	// Test invalid journal
+	file = fopen(JOURNAL_FILENAME, "wb");
+	if (!file) {
+		fprintf(stderr, "fopen() failed\n");
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 0; i < 256; ++i) {
+		fputc(i, file);
+	}
+	fclose(file);
+	r = emv_txn_journal_open(JOURNAL_FILENAME, 0, &journal);
+	if (r != EMV_TXN_JOURNAL_ERROR_INVALID_FILE) {
+		fprintf(stderr, "emv_txn_journal_open() did not reject invalid journal; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+
+	printf("Success\n");
+	r = 0;
+	goto exit;
+
+exit:
+	if (journal) {
+		emv_txn_journal_close(journal);
+	}
+	emv_txn_log_free(log);
+	remove(JOURNAL_FILENAME);
+
+	return r;
+}
@@ -0,0 +1,352 @@
+/**
+ * @file emv_txn_log_test.c
+ * @brief Unit tests for indexed transaction log
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_txn_log.h"
+#include "emv.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RANDOM_MAX_ENTRIES (64)
+#define RANDOM_PAN_COUNT (100)
+#define RANDOM_ENTRY_COUNT (20000)
+
+static const uint8_t pan1[] = { 0x54, 0x13, 0x33, 0x00, 0x89, 0x02, 0x00, 0x11 };
+static const uint8_t pan2[] = { 0x47, 0x61, 0x73, 0x90, 0x01, 0x01, 0x01, 0x19 };
+static const uint8_t pan3[] = { 0x47, 0x61, 0x73, 0x90, 0x01, 0x01, 0x01, 0x19, 0x01, 0x5F };
+static const uint8_t pan4[] = { 0x54, 0x13, 0x33, 0x00, 0x89, 0x02, 0x00, 0x1F };
+
+static void populate_entry(
+	struct emv_txn_log_entry_t* entry,
+	const uint8_t* pan,
+	size_t pan_len,
+	uint8_t yy,
+	uint8_t mm,
+	uint8_t dd,
+	uint32_t amount
+)
+{
+	memset(entry, 0, sizeof(*entry));
+	memset(entry->pan, 0xFF, sizeof(entry->pan));
+	memcpy(entry->pan, pan, pan_len);
+	entry->pan_seq = 0x01;
+	entry->txn_date[0] = yy;
+	entry->txn_date[1] = mm;
+	entry->txn_date[2] = dd;
+	entry->transaction_amount = amount;
+}
+
+// Reference implementation of latest entry by comparing every entry
+static const struct emv_txn_log_entry_t* find_latest(
+	const struct emv_txn_log_entry_t* txn_log,
+	size_t txn_log_cnt,
+	const uint8_t* pan,
+	size_t pan_len
+)
+{
+	const struct emv_txn_log_entry_t* entry = NULL;
+
+	for (size_t i = 0; i < txn_log_cnt; ++i) {
+		if (memcmp(txn_log[i].pan, pan, pan_len) == 0) {
+			entry = &txn_log[i];
+		}
+	}
+
+	return entry;
+}
+
+int main(void)
+{
+	int r;
+	struct emv_txn_log_t* log = NULL;
+	struct emv_txn_log_entry_t entry;
+	const struct emv_txn_log_entry_t* found;
+	static uint8_t random_pan[RANDOM_PAN_COUNT][8];
+	static struct emv_txn_log_entry_t reference[RANDOM_ENTRY_COUNT];
+
+	// Test invalid maximum number of entries
+	log = emv_txn_log_create(0, 0);
+	if (log) {
+		fprintf(stderr, "emv_txn_log_create() unexpectedly accepted zero entries\n");
+		r = 1;
+		goto exit;
+	}
+
+	// Test latest entry of each PAN
+	log = emv_txn_log_create(3, 0);
+	if (!log) {
+		fprintf(stderr, "emv_txn_log_create() failed\n");
+		r = 1;
+		goto exit;
+	}
+	if (emv_txn_log_find_latest(log, pan1, sizeof(pan1))) {
+		fprintf(stderr, "emv_txn_log_find_latest() unexpectedly found entry in empty transaction log\n");
+		r = 1;
+		goto exit;
+	}
+	populate_entry(&entry, pan1, sizeof(pan1), 0x25, 0x07, 0x01, 1);
+	r = emv_txn_log_add(log, &entry);
+	if (r) {
+		fprintf(stderr, "emv_txn_log_add() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	populate_entry(&entry, pan1, sizeof(pan1), 0x25, 0x07, 0x02, 2);
+	r = emv_txn_log_add(log, &entry);
+	if (r) {
+		fprintf(stderr, "emv_txn_log_add() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	populate_entry(&entry, pan2, sizeof(pan2), 0x25, 0x07, 0x03, 3);
+	r = emv_txn_log_add(log, &entry);
+	if (r) {
+		fprintf(stderr, "emv_txn_log_add() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	found = emv_txn_log_find_latest(log, pan1, sizeof(pan1));
+	if (!found || found->transaction_amount != 2) {
+		fprintf(stderr, "emv_txn_log_find_latest() failed to find latest entry\n");
+		r = 1;
+		goto exit;
+	}
+	found = emv_txn_log_find_latest(log, pan2, sizeof(pan2));
+	if (!found || found->transaction_amount != 3) {
+		fprintf(stderr, "emv_txn_log_find_latest() failed to find latest entry\n");
+		r = 1;
+		goto exit;
+	}
+	if (emv_txn_log_find_latest(log, pan3, sizeof(pan3))) {
+		fprintf(stderr, "emv_txn_log_find_latest() unexpectedly found longer PAN\n");
+		r = 1;
+		goto exit;
+	}
+
+	// Test that oldest entry is evicted while newer entry of same PAN remains
+	populate_entry(&entry, pan3, sizeof(pan3), 0x25, 0x07, 0x04, 4);
+	r = emv_txn_log_add(log, &entry);
+	if (r) {
+		fprintf(stderr, "emv_txn_log_add() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (emv_txn_log_count(log) != 3) {
+		fprintf(stderr, "emv_txn_log_count() returned %zu instead of 3\n", emv_txn_log_count(log));
+		r = 1;
+		goto exit;
+	}
+	found = emv_txn_log_find_latest(log, pan1, sizeof(pan1));
+	if (!found || found->transaction_amount != 2) {
+		fprintf(stderr, "emv_txn_log_find_latest() failed to find remaining entry\n");
+		r = 1;
+		goto exit;
+	}
+	found = emv_txn_log_find_latest(log, pan3, sizeof(pan3));
+	if (!found || found->transaction_amount != 4) {
+		fprintf(stderr, "emv_txn_log_find_latest() failed to find new entry\n");
+		r = 1;
+		goto exit;
+	}
+
+	// Test that PAN is no longer found when its latest entry is evicted
+	populate_entry(&entry, pan2, sizeof(pan2), 0x25, 0x07, 0x05, 5);
+	r = emv_txn_log_add(log, &entry);
+	if (r) {
+		fprintf(stderr, "emv_txn_log_add() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (emv_txn_log_find_latest(log, pan1, sizeof(pan1))) {
+		fprintf(stderr, "emv_txn_log_find_latest() unexpectedly found evicted entry\n");
+		r = 1;
+		goto exit;
+	}
+	found = emv_txn_log_find_latest(log, pan2, sizeof(pan2));
+	if (!found || found->transaction_amount != 5) {
+		fprintf(stderr, "emv_txn_log_find_latest() failed to find latest entry\n");
+		r = 1;
+		goto exit;
+	}
+	emv_txn_log_free(log);
+	log = NULL;
+
+	// Test that unpadded PAN is rejected and that anything following the
+	// padding of PAN is ignored
+	log = emv_txn_log_create(3, 0);
+	if (!log) {
+		fprintf(stderr, "emv_txn_log_create() failed\n");
+		r = 1;
+		goto exit;
+	}
+	populate_entry(&entry, pan1, sizeof(pan1), 0x25, 0x07, 0x01, 1);
+	memset(entry.pan + sizeof(pan1), 0x00, sizeof(entry.pan) - sizeof(pan1));
+	r = emv_txn_log_add(log, &entry);
+	if (r >= 0) {
+		fprintf(stderr, "emv_txn_log_add() unexpectedly accepted unpadded PAN; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (emv_txn_log_count(log) != 0 || emv_txn_log_find_latest(log, pan1, sizeof(pan1))) {
+		fprintf(stderr, "emv_txn_log_add() unexpectedly added unpadded PAN\n");
+		r = 1;
+		goto exit;
+	}
+	populate_entry(&entry, pan4, sizeof(pan4), 0x25, 0x07, 0x02, 2);
+	memset(entry.pan + sizeof(pan4), 0x00, sizeof(entry.pan) - sizeof(pan4));
+	r = emv_txn_log_add(log, &entry);
+	if (r) {
+		fprintf(stderr, "emv_txn_log_add() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	found = emv_txn_log_find_latest(log, pan4, sizeof(pan4));
+	if (!found || found->transaction_amount != 2) {
+		fprintf(stderr, "emv_txn_log_find_latest() failed to find PAN with trailing data after padding\n");
+		r = 1;
+		goto exit;
+	}
+	if (emv_txn_log_find_latest(log, pan1, sizeof(pan1))) {
+		fprintf(stderr, "emv_txn_log_find_latest() unexpectedly found longer PAN\n");
+		r = 1;
+		goto exit;
+	}
+	emv_txn_log_free(log);
+	log = NULL;
+
+	// Test time based eviction across the end of a leap year February
+	log = emv_txn_log_create(10, 30);
+	if (!log) {
+		fprintf(stderr, "emv_txn_log_create() failed\n");
+		r = 1;
+		goto exit;
+	}
+	populate_entry(&entry, pan1, sizeof(pan1), 0x24, 0x01, 0x31, 1);
+	emv_txn_log_add(log, &entry);
+	populate_entry(&entry, pan2, sizeof(pan2), 0x24, 0x02, 0x01, 2);
+	emv_txn_log_add(log, &entry);
+	populate_entry(&entry, pan2, sizeof(pan2), 0x24, 0x02, 0x29, 3);
+	emv_txn_log_add(log, &entry);
+	if (emv_txn_log_count(log) != 3) {
+		fprintf(stderr, "emv_txn_log_count() returned %zu instead of 3\n", emv_txn_log_count(log));
+		r = 1;
+		goto exit;
+	}
+	// 2 March 2024 is 31 days after 31 January 2024 and 30 days after
+	// 1 February 2024
+	r = emv_txn_log_evict(log, (uint8_t[]){ 0x24, 0x03, 0x02 });
+	if (r != 1) {
+		fprintf(stderr, "emv_txn_log_evict() returned %d instead of 1\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (emv_txn_log_find_latest(log, pan1, sizeof(pan1))) {
+		fprintf(stderr, "emv_txn_log_find_latest() unexpectedly found expired entry\n");
+		r = 1;
+		goto exit;
+	}
+	populate_entry(&entry, pan1, sizeof(pan1), 0x24, 0x03, 0x30, 4);
+	r = emv_txn_log_add(log, &entry);
+	if (r) {
+		fprintf(stderr, "emv_txn_log_add() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (emv_txn_log_count(log) != 2) {
+		fprintf(stderr, "emv_txn_log_count() returned %zu instead of 2\n", emv_txn_log_count(log));
+		r = 1;
+		goto exit;
+	}
+	found = emv_txn_log_find_latest(log, pan2, sizeof(pan2));
+	if (!found || found->transaction_amount != 3) {
+		fprintf(stderr, "emv_txn_log_find_latest() failed to find remaining entry\n");
+		r = 1;
+		goto exit;
+	}
+
+	// Test invalid transaction date
+	populate_entry(&entry, pan1, sizeof(pan1), 0x24, 0x13, 0x01, 5);
+	r = emv_txn_log_add(log, &entry);
+	if (r >= 0) {
+		fprintf(stderr, "emv_txn_log_add() unexpectedly accepted invalid date\n");
+		r = 1;
+		goto exit;
+	}
+	emv_txn_log_free(log);
+	log = NULL;
+
+	// Test random entries against reference implementation
+	srand(1);
+	for (unsigned int i = 0; i < RANDOM_PAN_COUNT; ++i) {
+		for (unsigned int j = 0; j < sizeof(random_pan[i]); ++j) {
+			// Two decimal digits per byte as required by EMV format 'cn'
+			uint8_t digits = rand() % 100;
+			random_pan[i][j] = ((digits / 10) << 4) | (digits % 10);
+		}
+	}
+	log = emv_txn_log_create(RANDOM_MAX_ENTRIES, 0);
+	if (!log) {
+		fprintf(stderr, "emv_txn_log_create() failed\n");
+		r = 1;
+		goto exit;
+	}
+	for (unsigned int i = 0; i < RANDOM_ENTRY_COUNT; ++i) {
+		size_t first = i + 1 > RANDOM_MAX_ENTRIES ? i + 1 - RANDOM_MAX_ENTRIES : 0;
+		const uint8_t* pan;
+		const struct emv_txn_log_entry_t* expected;
+
+		populate_entry(
+			&reference[i],
+			random_pan[rand() % RANDOM_PAN_COUNT],
+			sizeof(random_pan[0]),
+			0x25, 0x07, 0x01,
+			i
+		);
+		r = emv_txn_log_add(log, &reference[i]);
+		if (r) {
+			fprintf(stderr, "emv_txn_log_add() failed; r=%d\n", r);
+			r = 1;
+			goto exit;
+		}
+
+		pan = random_pan[rand() % RANDOM_PAN_COUNT];
+		expected = find_latest(&reference[first], i + 1 - first, pan, sizeof(random_pan[0]));
+		found = emv_txn_log_find_latest(log, pan, sizeof(random_pan[0]));
+		if (!!found != !!expected ||
+			(found && found->transaction_amount != expected->transaction_amount)
+		) {
+			fprintf(stderr, "emv_txn_log_find_latest() differs from reference implementation\n");
+			r = 1;
+			goto exit;
+		}
+	}
+
+	printf("Success\n");
+	r = 0;
+	goto exit;
+
+exit:
+	emv_txn_log_free(log);
+
+	return r;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file emv_txn_record_test.c
+ * @brief Unit tests for EMV transaction record format
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv_txn_record.h"
+#include "emv_tlv.h"
+#include "emv_tags.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(void)
+{
+	int r;
+	struct emv_tlv_list_t terminal = EMV_TLV_LIST_INIT;
+	struct emv_tlv_list_t icc = EMV_TLV_LIST_INIT;
+	struct emv_tlv_list_t params = EMV_TLV_LIST_INIT;
+	struct emv_tlv_sources_t sources = EMV_TLV_SOURCES_INIT;
+	struct emv_tlv_sources_t empty_sources = EMV_TLV_SOURCES_INIT;
+	uint8_t* buf = NULL;
+	size_t buf_len = 0;
+	size_t len;
+	struct emv_txn_record_t record;
+	struct emv_tlv_t tlv;
+	unsigned int source;
+
+	// Populate sources in the same order as emv_tlv_sources_init_from_ctx()
+	emv_tlv_list_push(&terminal, EMV_TAG_95_TERMINAL_VERIFICATION_RESULTS, 5, (uint8_t[]){ 0x00, 0x00, 0x08, 0x80, 0x00 }, 0);
+	emv_tlv_list_push(&terminal, EMV_TAG_9F37_UNPREDICTABLE_NUMBER, 4, (uint8_t[]){ 0xDE, 0xAD, 0xBE, 0xEF }, 0);
+	emv_tlv_list_push(&icc, EMV_TAG_9F27_CRYPTOGRAM_INFORMATION_DATA, 1, (uint8_t[]){ 0x80 }, 0);
+	emv_tlv_list_push(&icc, EMV_TAG_5A_APPLICATION_PAN, 8, (uint8_t[]){ 0x54, 0x13, 0x33, 0x00, 0x89, 0x02, 0x00, 0x11 }, 0);
+	emv_tlv_list_push(&icc, EMV_TAG_9F37_UNPREDICTABLE_NUMBER, 4, (uint8_t[]){ 0x01, 0x02, 0x03, 0x04 }, 0);
+	emv_tlv_list_push(&icc, EMV_TAG_9F26_APPLICATION_CRYPTOGRAM, 8, (uint8_t[]){ 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 }, 0);
+	emv_tlv_list_push(&params, EMV_TAG_9F02_AMOUNT_AUTHORISED_NUMERIC, 6, (uint8_t[]){ 0x00, 0x00, 0x00, 0x01, 0x23, 0x45 }, 0);
+	emv_tlv_list_push(&params, EMV_TAG_9F03_AMOUNT_OTHER_NUMERIC, 0, NULL, 0);
+	sources.count = 4;
+	sources.list[0] = &terminal;
+	sources.list[1] = &icc;
+	sources.list[2] = &params;
+	sources.list[3] = NULL;
+
+	// Test length determination
+	r = emv_txn_record_encode(&sources, NULL, &buf_len);
+	if (r) {
+		fprintf(stderr, "emv_txn_record_encode() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (buf_len != EMV_TXN_RECORD_HEADER_SIZE + 8 * EMV_TXN_RECORD_ENTRY_SIZE + 36) {
+		fprintf(stderr, "emv_txn_record_encode() returned unexpected length %zu\n", buf_len);
+		r = 1;
+		goto exit;
+	}
+
+	// Test output buffer that is too small
+	buf = malloc(buf_len * 2);
+	len = buf_len - 1;
+	r = emv_txn_record_encode(&sources, buf, &len);
+	if (r <= 0 || len != buf_len) {
+		fprintf(stderr, "emv_txn_record_encode() did not reject small buffer; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+
+	// Encode two consecutive records
+	len = buf_len;
+	r = emv_txn_record_encode(&sources, buf, &len);
+	if (r || len != buf_len) {
+		fprintf(stderr, "emv_txn_record_encode() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_txn_record_encode(&empty_sources, NULL, &len);
+	if (r || len != EMV_TXN_RECORD_HEADER_SIZE) {
+		fprintf(stderr, "emv_txn_record_encode() failed for empty sources; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_txn_record_encode(&empty_sources, buf + buf_len, &len);
+	if (r) {
+		fprintf(stderr, "emv_txn_record_encode() failed for empty sources; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+
+	// Test reader
+	r = emv_txn_record_init(buf, buf_len + len, &record);
+	if (r) {
+		fprintf(stderr, "emv_txn_record_init() failed; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (emv_txn_record_get_length(&record) != buf_len ||
+		emv_txn_record_get_count(&record) != 8 ||
+		emv_txn_record_get_source_count(&record) != 4
+	) {
+		fprintf(stderr, "Incorrect record length, count or source count\n");
+		r = 1;
+		goto exit;
+	}
+	r = emv_txn_record_find(&record, EMV_TAG_9F26_APPLICATION_CRYPTOGRAM, &source, &tlv);
+	if (r ||
+		source != 1 ||
+		tlv.length != 8 ||
+		memcmp(tlv.value, (uint8_t[]){ 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 }, 8) != 0
+	) {
+		fprintf(stderr, "emv_txn_record_find() failed to find 9F26; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	if (tlv.value < buf || tlv.value >= buf + buf_len) {
+		fprintf(stderr, "emv_txn_record_find() did not refer to record\n");
+		r = 1;
+		goto exit;
+	}
+
+	// Test that the source with the highest precedence is found
+	r = emv_txn_record_find(&record, EMV_TAG_9F37_UNPREDICTABLE_NUMBER, &source, &tlv);
+	if (r ||
+		source != 0 ||
+		tlv.length != 4 ||
+		memcmp(tlv.value, (uint8_t[]){ 0xDE, 0xAD, 0xBE, 0xEF }, 4) != 0
+	) {
+		fprintf(stderr, "emv_txn_record_find() failed to find terminal 9F37; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_txn_record_find(&record, EMV_TAG_9F03_AMOUNT_OTHER_NUMERIC, &source, &tlv);
+	if (r || source != 2 || tlv.length != 0) {
+		fprintf(stderr, "emv_txn_record_find() failed to find empty 9F03; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	r = emv_txn_record_find(&record, EMV_TAG_9F10_ISSUER_APPLICATION_DATA, &source, &tlv);
+	if (r <= 0) {
+		fprintf(stderr, "emv_txn_record_find() unexpectedly found 9F10; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+
+	// Test that directory is sorted
+	for (size_t i = 1; i < emv_txn_record_get_count(&record); ++i) {
+		struct emv_tlv_t prev;
+
+		emv_txn_record_get_field(&record, i - 1, NULL, &prev);
+		emv_txn_record_get_field(&record, i, NULL, &tlv);
+		if (prev.tag > tlv.tag) {
+			fprintf(stderr, "Directory is not sorted\n");
+			r = 1;
+			goto exit;
+		}
+	}
+
+	// Test consecutive record
+	r = emv_txn_record_init(buf + buf_len, len, &record);
+	if (r || emv_txn_record_get_count(&record) != 0) {
+		fprintf(stderr, "emv_txn_record_init() failed for consecutive record; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+
+	// Test truncated and corrupted records
+	r = emv_txn_record_init(buf, buf_len - 1, &record);
+	if (r <= 0) {
+		fprintf(stderr, "emv_txn_record_init() did not reject truncated record; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	buf[EMV_TXN_RECORD_HEADER_SIZE + 10] = 4; // Invalid source of first entry
+	r = emv_txn_record_init(buf, buf_len, &record);
+	if (r <= 0) {
+		fprintf(stderr, "emv_txn_record_init() did not reject invalid source; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+	buf[0] = 'X';
+	r = emv_txn_record_init(buf, buf_len, &record);
+	if (r <= 0) {
+		fprintf(stderr, "emv_txn_record_init() did not reject invalid magic; r=%d\n", r);
+		r = 1;
+		goto exit;
+	}
+
+	printf("Success\n");
+	r = 0;
+	goto exit;
+
+exit:
+	free(buf);
+	emv_tlv_list_clear(&terminal);
+	emv_tlv_list_clear(&icc);
+	emv_tlv_list_clear(&params);
+
+	return r;
+}
@@ -19,7 +19,10 @@
  */
 
 #include "emv.h"
+#include "emv_tlv.h"
+#include "emv_txn_record.h"
 #include "iso7816.h"
+#include "iso8825_ber.h"
 #include "print_helpers.h"
 #include "emv_strings.h"
 #include "isocodes_lookup.h"
@@ -39,14 +42,27 @@
 #include <io.h>
 #endif
 
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 // Helper functions
 static error_t argp_parser_helper(int key, char* arg, struct argp_state* state);
 static int parse_hex(const char* hex, void* buf, size_t* buf_len);
 static void* load_from_file(FILE* file, size_t* len);
+static int load_hex_from_file(FILE* file, uint8_t** buf, size_t* len);
+static void* map_file(const char* path, size_t* len, bool* mapped);
+static void unmap_file(void* ptr, size_t len, bool mapped);
+static int parse_extract_columns(const char* str);
+static int extract_records(const uint8_t* ptr, size_t len);
 
 // Input data
 static uint8_t* data = NULL;
 static size_t data_len = 0;
+static bool data_mapped = false;
 static char* arg_str = NULL;
 static size_t arg_str_len = 0;
 
@@ -59,6 +75,8 @@ enum emv_decode_mode_t {
 	EMV_DECODE_TLV,
 	EMV_DECODE_DOL,
 	EMV_DECODE_TAG_LIST,
+	EMV_DECODE_TXN_RECORD,
+	EMV_DECODE_EXTRACT,
 	EMV_DECODE_MCC,
 	EMV_DECODE_TERM_TYPE,
 	EMV_DECODE_TERM_CAPS,
@@ -94,6 +112,8 @@ enum emv_decode_mode_t {
 	EMV_DECODE_ISO8859_13,
 	EMV_DECODE_ISO8859_14,
 	EMV_DECODE_ISO8859_15,
+	EMV_DECODE_FILE,
+	EMV_DECODE_HEX_FILE,
 	EMV_DECODE_IGNORE_PADDING,
 	EMV_DECODE_VERBOSE,
 	EMV_DECODE_VERSION,
@@ -104,6 +124,21 @@ static enum emv_decode_mode_t emv_decode_mode = EMV_DECODE_NONE;
 static bool ignore_padding = false;
 static bool verbose = false;
 
+// Extraction columns
+#define EXTRACT_MAX_COLUMNS (32)
+#define EXTRACT_MAX_DEPTH (16)
+enum extract_format_t {
+	EXTRACT_FORMAT_RAW,
+	EXTRACT_FORMAT_DECODED,
+	EXTRACT_FORMAT_MASKED,
+};
+struct extract_column_t {
+	unsigned int tag;
+	enum extract_format_t format;
+};
+static struct extract_column_t extract_columns[EXTRACT_MAX_COLUMNS];
+static unsigned int extract_column_count = 0;
+
 // Testing parameters
 static char* isocodes_path = NULL;
 static char* mcc_json = NULL;
@@ -119,6 +154,8 @@ static struct argp_option argp_options[] = {
 	{ "tlv", EMV_DECODE_TLV, NULL, 0, "Decode EMV TLV data" },
 	{ "dol", EMV_DECODE_DOL, NULL, 0, "Decode EMV Data Object List (DOL)" },
 	{ "tag-list", EMV_DECODE_TAG_LIST, NULL, 0, "Decode EMV Tag List" },
+	{ "txn-record", EMV_DECODE_TXN_RECORD, NULL, 0, "Decode EMV transaction records, such as those produced by emv_txn_record_encode(). Consecutive records are decoded until the end of INPUT" },
+	{ "extract", EMV_DECODE_EXTRACT, "TAG[,TAG...]", 0, "Extract only the specified EMV fields and print them as comma separated columns, one line per record. Append :decoded to a TAG for a human readable value or :masked to mask a PAN. INPUT is either EMV transaction records or EMV TLV data in which each constructed top-level field is a record" },
 
 	{ NULL, 0, NULL, 0, "Individual EMV fields:", 3 },
 	{ "mcc", EMV_DECODE_MCC, NULL, 0, "Decode Merchant Category Code (field 9F15)" },
@@ -176,6 +213,8 @@ static struct argp_option argp_options[] = {
 	{ "iso8859-14", EMV_DECODE_ISO8859_14, NULL, OPTION_HIDDEN },
 	{ "iso8859-15", EMV_DECODE_ISO8859_15, NULL, OPTION_HIDDEN },
 
+	{ "file", EMV_DECODE_FILE, "path", 0, "Read binary INPUT from file instead of the command line. The file is memory mapped where possible such that large files are parsed without reading them into memory first" },
+	{ "hex-file", EMV_DECODE_HEX_FILE, "path", 0, "Read INPUT as a string of hex digits from file instead of the command line. Whitespace is ignored" },
 	{ "ignore-padding", EMV_DECODE_IGNORE_PADDING, NULL, 0, "Ignore invalid data if the input aligns with either the DES or AES cipher block size and invalid data is less than the cipher block size. Only applies to --ber and --tlv" },
 	{ "verbose", EMV_DECODE_VERBOSE, NULL, 0, "Enable verbose output. This will prevent the truncation of content bytes for longer fields. Only applies to --ber and --tlv" },
 
@@ -196,7 +235,8 @@ static struct argp argp_config = {
 	"Decode data and print it in a human readable format."
 	"\v" // Print remaining text after options
 	"OPTION may only be _one_ of the above.\n\n"
-	"INPUT is either a string of hex digits representing binary data, or \"-\" to read from stdin",
+	"INPUT is either a string of hex digits representing binary data, or \"-\" to read from stdin. "
+	"INPUT must be omitted when either --file or --hex-file is specified.",
 };
 
 // argp parser helper function
@@ -206,6 +246,11 @@ static error_t argp_parser_helper(int key, char* arg, struct argp_state* state)
 
 	switch (key) {
 		case ARGP_KEY_ARG: {
+			if (data || arg_str) {
+				argp_error(state, "INPUT may only be specified once");
+				return EINVAL;
+			}
+
 			if (emv_decode_mode == EMV_DECODE_ISO3166_1 ||
 				emv_decode_mode == EMV_DECODE_ISO4217 ||
 				emv_decode_mode == EMV_DECODE_ISO639
@@ -253,16 +298,76 @@ static error_t argp_parser_helper(int key, char* arg, struct argp_state* state)
 		}
 
 		case ARGP_KEY_NO_ARGS: {
+			if (data &&
+				emv_decode_mode != EMV_DECODE_ISO3166_1 &&
+				emv_decode_mode != EMV_DECODE_ISO4217 &&
+				emv_decode_mode != EMV_DECODE_ISO639
+			) {
+				// INPUT was read from file
+				return 0;
+			}
+
 			argp_error(state, "INPUT is missing");
 			return ARGP_ERR_UNKNOWN;
 		}
 
+		case EMV_DECODE_FILE: {
+			if (data || arg_str) {
+				argp_error(state, "INPUT may only be specified once");
+				return EINVAL;
+			}
+
+			data = map_file(arg, &data_len, &data_mapped);
+			if (!data) {
+				argp_error(state, "Failed to read INPUT from file \"%s\"", arg);
+				return EINVAL;
+			}
+
+			return 0;
+		}
+
+		case EMV_DECODE_HEX_FILE: {
+			FILE* file;
+
+			if (data || arg_str) {
+				argp_error(state, "INPUT may only be specified once");
+				return EINVAL;
+			}
+
+			file = fopen(arg, "rb");
+			if (!file) {
+				argp_error(state, "Failed to open INPUT file \"%s\"", arg);
+				return EINVAL;
+			}
+			r = load_hex_from_file(file, &data, &data_len);
+			fclose(file);
+			if (r < 0) {
+				if (r == -2) {
+					argp_error(state, "INPUT must consist of hex digits");
+				} else {
+					argp_error(state, "Failed to read INPUT from file \"%s\"", arg);
+				}
+				return EINVAL;
+			}
+			if (r > 0) {
+				argp_error(state, "INPUT must have even number of hex digits");
+				return EINVAL;
+			}
+			if (!data_len) {
+				argp_error(state, "INPUT must consist of at least 1 byte (thus 2 hex digits)");
+				return EINVAL;
+			}
+
+			return 0;
+		}
+
 		case EMV_DECODE_ATR:
 		case EMV_DECODE_SW1SW2:
 		case EMV_DECODE_BER:
 		case EMV_DECODE_TLV:
 		case EMV_DECODE_DOL:
 		case EMV_DECODE_TAG_LIST:
+		case EMV_DECODE_TXN_RECORD:
 		case EMV_DECODE_MCC:
 		case EMV_DECODE_TERM_TYPE:
 		case EMV_DECODE_TERM_CAPS:
@@ -305,6 +410,21 @@ static error_t argp_parser_helper(int key, char* arg, struct argp_state* state)
 			emv_decode_mode = key;
 			return 0;
 
+		case EMV_DECODE_EXTRACT:
+			if (emv_decode_mode != EMV_DECODE_NONE) {
+				argp_error(state, "Only one decoding OPTION may be specified");
+				return EINVAL;
+			}
+
+			r = parse_extract_columns(arg);
+			if (r) {
+				argp_error(state, "Invalid TAG list \"%s\"", arg);
+				return EINVAL;
+			}
+
+			emv_decode_mode = key;
+			return 0;
+
 		case EMV_DECODE_ISO8859_X: {
 			printf("Use --iso8859-x where 'x' is the code page number, for example  --iso8859-5\n");
 			exit(EXIT_SUCCESS);
@@ -416,12 +536,23 @@ static void* load_from_file(FILE* file, size_t* len)
 #endif
 
 	do {
-		// Grow buffer
-		buf_len += block_size;
-		buf = realloc(buf, buf_len);
+		// Grow buffer exponentially when it is full to avoid reallocating
+		// large inputs for every block
+		if (total_len == buf_len) {
+			void* new_buf;
+
+			buf_len = buf_len ? buf_len * 2 : block_size;
+			new_buf = realloc(buf, buf_len);
+			if (!new_buf) {
+				free(buf);
+				*len = 0;
+				return NULL;
+			}
+			buf = new_buf;
+		}
 
 		// Read next block
-		total_len += fread(buf + total_len, 1, block_size, file);
+		total_len += fread(buf + total_len, 1, buf_len - total_len, file);
 		if (ferror(file)) {
 			free(buf);
 			*len = 0;
@@ -433,6 +564,486 @@ static void* load_from_file(FILE* file, size_t* len)
 	return buf;
 }
 
+// Hex file loader helper function
+static int load_hex_from_file(FILE* file, uint8_t** buf, size_t* len)
+{
+	uint8_t block[4096]; // Use common page size
+	size_t block_len;
+	size_t buf_len = 0;
+	size_t total_len = 0;
+	int nibble = -1;
+
+	*buf = NULL;
+	*len = 0;
+
+	// Decode hex digits one block at a time such that only the binary data,
+	// which is half the size of the hex digits, is held in memory
+	do {
+		block_len = fread(block, 1, sizeof(block), file);
+		if (ferror(file)) {
+			free(*buf);
+			*buf = NULL;
+			return -1;
+		}
+
+		// Ensure that the buffer has enough space for the whole block,
+		// including a pending digit from the previous block
+		if (total_len + (block_len + 1) / 2 > buf_len) {
+			uint8_t* new_buf;
+
+			buf_len = buf_len * 2 > total_len + (block_len + 1) / 2 ?
+				buf_len * 2 : total_len + (block_len + 1) / 2;
+			new_buf = realloc(*buf, buf_len);
+			if (!new_buf) {
+				free(*buf);
+				*buf = NULL;
+				return -1;
+			}
+			*buf = new_buf;
+		}
+
+		for (size_t i = 0; i < block_len; ++i) {
+			int c = block[i];
+			int value;
+
+			// Skip spaces
+			if (isspace(c)) {
+				continue;
+			}
+			// Only allow hex digits
+			if (!isxdigit(c)) {
+				free(*buf);
+				*buf = NULL;
+				return -2;
+			}
+
+			if (c >= '0' && c <= '9') {
+				value = c - '0';
+			} else {
+				value = (c | 0x20) - 'a' + 10;
+			}
+
+			if (nibble < 0) {
+				nibble = value;
+			} else {
+				(*buf)[total_len++] = (nibble << 4) | value;
+				nibble = -1;
+			}
+		}
+	} while (!feof(file));
+
+	*len = total_len;
+	if (nibble >= 0) {
+		// Uneven number of hex digits
+		return 1;
+	}
+
+	return 0;
+}
+
+// File mapping helper function
+static void* map_file(const char* path, size_t* len, bool* mapped)
+{
+#ifdef HAVE_MMAP
+	int fd;
+	struct stat st;
+	void* ptr;
+
+	*len = 0;
+	*mapped = false;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+		// Only map non-empty regular files
+		close(fd);
+		return NULL;
+	}
+
+	ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // Mapping remains valid after closing the file descriptor
+	if (ptr == MAP_FAILED) {
+		return NULL;
+	}
+
+#ifdef MADV_SEQUENTIAL
+	// Input is parsed from start to end
+	madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+	*len = st.st_size;
+	*mapped = true;
+	return ptr;
+
+#else
+	FILE* file;
+	void* buf;
+
+	*mapped = false;
+
+	// Memory mapping not available; read the whole file instead
+	file = fopen(path, "rb");
+	if (!file) {
+		*len = 0;
+		return NULL;
+	}
+	buf = load_from_file(file, len);
+	fclose(file);
+	if (buf && !*len) {
+		free(buf);
+		return NULL;
+	}
+
+	return buf;
+#endif
+}
+
+static void unmap_file(void* ptr, size_t len, bool mapped)
+{
+#ifdef HAVE_MMAP
+	if (mapped) {
+		munmap(ptr, len);
+		return;
+	}
+#endif
+
+	free(ptr);
+}
+
+// Extraction column parser helper function
+static int parse_extract_columns(const char* str)
+{
+	extract_column_count = 0;
+
+	while (*str) {
+		struct extract_column_t* column;
+		size_t tag_len;
+
+		if (extract_column_count >= EXTRACT_MAX_COLUMNS) {
+			return 1;
+		}
+		column = &extract_columns[extract_column_count];
+
+		// Tag must consist of whole bytes
+		tag_len = strspn(str, "0123456789ABCDEFabcdef");
+		if (tag_len < 2 || tag_len > 8 || (tag_len & 1)) {
+			return 1;
+		}
+		column->tag = strtoul(str, NULL, 16);
+		column->format = EXTRACT_FORMAT_RAW;
+		str += tag_len;
+
+		if (*str == ':') {
+			size_t format_len;
+
+			++str;
+			format_len = strcspn(str, ",");
+			if (format_len == 3 && strncmp(str, "raw", 3) == 0) {
+				column->format = EXTRACT_FORMAT_RAW;
+			} else if (format_len == 7 && strncmp(str, "decoded", 7) == 0) {
+				column->format = EXTRACT_FORMAT_DECODED;
+			} else if (format_len == 6 && strncmp(str, "masked", 6) == 0) {
+				column->format = EXTRACT_FORMAT_MASKED;
+			} else {
+				return 1;
+			}
+			str += format_len;
+		}
+		++extract_column_count;
+
+		if (*str == ',') {
+			++str;
+			if (!*str) {
+				// Trailing separator
+				return 1;
+			}
+		} else if (*str) {
+			return 1;
+		}
+	}
+
+	if (!extract_column_count) {
+		return 1;
+	}
+
+	return 0;
+}
+
+// Print extracted value as hex digits
+static void print_extract_hex(const uint8_t* value, size_t len)
+{
+	static const char hex_digits[] = "0123456789ABCDEF";
+
+	for (size_t i = 0; i < len; ++i) {
+		putchar(hex_digits[value[i] >> 4]);
+		putchar(hex_digits[value[i] & 0xF]);
+	}
+}
+
+// Print extracted value as masked PAN
+static void print_extract_masked(const uint8_t* value, size_t len)
+{
+	char digits[64];
+	size_t digit_count = 0;
+	size_t unmasked_front;
+	size_t unmasked_back;
+
+	// Stop at padding or at any other digit that is not decimal
+	for (size_t i = 0; i < len * 2 && digit_count < sizeof(digits); ++i) {
+		uint8_t nibble = (i & 1) ? value[i / 2] & 0xF : value[i / 2] >> 4;
+
+		if (nibble > 9) {
+			break;
+		}
+		digits[digit_count++] = '0' + nibble;
+	}
+
+	// Retain the first six and the last four digits of a PAN, which is
+	// the most that PCI DSS allows to be displayed, or only the last four
+	// digits of a shorter number. Numbers of four digits or less would
+	// otherwise be displayed in full and therefore only retain the last
+	// digit, unless there is only one digit.
+	unmasked_front = digit_count > 10 ? 6 : 0;
+	if (digit_count > 4) {
+		unmasked_back = 4;
+	} else if (digit_count > 1) {
+		unmasked_back = 1;
+	} else {
+		unmasked_back = 0;
+	}
+	for (size_t i = 0; i < digit_count; ++i) {
+		if (i < unmasked_front || i + unmasked_back >= digit_count) {
+			putchar(digits[i]);
+		} else {
+			putchar('*');
+		}
+	}
+}
+
+// Print extracted value as human readable string
+static void print_extract_decoded(const struct emv_tlv_t* tlv)
+{
+	struct emv_tlv_info_t info;
+	char value_str[2048];
+	size_t value_str_len;
+	bool quote;
+
+	emv_tlv_get_info(tlv, NULL, &info, value_str, sizeof(value_str));
+	if (!value_str[0]) {
+		// Human readable string not available
+		print_extract_hex(tlv->value, tlv->length);
+		return;
+	}
+
+	// String lists are terminated by a line break
+	value_str_len = strlen(value_str);
+	if (value_str[value_str_len - 1] == '\n') {
+		value_str[--value_str_len] = 0;
+	}
+
+	// Quote values that contain a separator or a quote
+	quote = strpbrk(value_str, ",\"") != NULL;
+	if (quote) {
+		putchar('"');
+	}
+	for (size_t i = 0; i < value_str_len; ++i) {
+		if (value_str[i] == '\n') {
+			// Separate string list entries on the same line
+			fputs("; ", stdout);
+		} else if (value_str[i] == '"') {
+			fputs("\"\"", stdout);
+		} else {
+			putchar(value_str[i]);
+		}
+	}
+	if (quote) {
+		putchar('"');
+	}
+}
+
+// Print extracted values as one line
+static void print_extract_row(const struct emv_tlv_t* values, const bool* found)
+{
+	for (unsigned int i = 0; i < extract_column_count; ++i) {
+		if (i) {
+			putchar(',');
+		}
+		if (!found[i]) {
+			continue;
+		}
+
+		switch (extract_columns[i].format) {
+			case EXTRACT_FORMAT_RAW:
+				print_extract_hex(values[i].value, values[i].length);
+				break;
+
+			case EXTRACT_FORMAT_DECODED:
+				print_extract_decoded(&values[i]);
+				break;
+
+			case EXTRACT_FORMAT_MASKED:
+				print_extract_masked(values[i].value, values[i].length);
+				break;
+		}
+	}
+	putchar('\n');
+}
+
+// Find extracted values in BER encoded record
+static int extract_ber_record(
+	const uint8_t* ptr,
+	size_t len,
+	struct emv_tlv_t* values,
+	bool* found
+)
+{
+	int r;
+	struct iso8825_ber_itr_t itr[EXTRACT_MAX_DEPTH];
+	unsigned int depth = 0;
+	unsigned int remaining = extract_column_count;
+	struct iso8825_tlv_t tlv;
+
+	r = iso8825_ber_itr_init(ptr, len, &itr[0]);
+	if (r) {
+		return r;
+	}
+
+	// Stop as soon as all values are found
+	while (remaining) {
+		bool selected = false;
+
+		r = iso8825_ber_itr_next(&itr[depth], &tlv);
+		if (r < 0) {
+			return r;
+		}
+		if (r == 0) {
+			// End of constructed field
+			if (!depth) {
+				break;
+			}
+			--depth;
+			continue;
+		}
+
+		for (unsigned int i = 0; i < extract_column_count; ++i) {
+			if (extract_columns[i].tag != tlv.tag) {
+				continue;
+			}
+			selected = true;
+
+			// First occurrence wins
+			if (!found[i]) {
+				values[i].ber = tlv;
+				found[i] = true;
+				--remaining;
+			}
+		}
+
+		// Only descend into constructed fields that are not selected. The
+		// iterator skips the values of all other fields without parsing them.
+		if (!selected &&
+			iso8825_ber_is_constructed(&tlv) &&
+			depth + 1 < EXTRACT_MAX_DEPTH
+		) {
+			++depth;
+			iso8825_ber_itr_init(tlv.value, tlv.length, &itr[depth]);
+		}
+	}
+
+	return 0;
+}
+
+// Extract selected fields from each record and print them
+static int extract_records(const uint8_t* ptr, size_t len)
+{
+	int r;
+	struct emv_tlv_t values[EXTRACT_MAX_COLUMNS];
+	bool found[EXTRACT_MAX_COLUMNS];
+	size_t record_idx = 0;
+
+	// Use large output buffer for large inputs
+	setvbuf(stdout, NULL, _IOFBF, 65536);
+
+	// Header line
+	for (unsigned int i = 0; i < extract_column_count; ++i) {
+		printf("%s%02X", i ? "," : "", extract_columns[i].tag);
+	}
+	putchar('\n');
+
+	memset(values, 0, sizeof(values));
+
+	if (len >= 4 && memcmp(ptr, "EMVR", 4) == 0) {
+		// Consecutive EMV transaction records
+		while (len) {
+			struct emv_txn_record_t record;
+
+			r = emv_txn_record_init(ptr, len, &record);
+			if (r) {
+				fflush(stdout);
+				fprintf(stderr, "Invalid transaction record %zu\n", record_idx + 1);
+				return 1;
+			}
+
+			for (unsigned int i = 0; i < extract_column_count; ++i) {
+				found[i] = emv_txn_record_find(&record, extract_columns[i].tag, NULL, &values[i]) == 0;
+			}
+			print_extract_row(values, found);
+
+			ptr += emv_txn_record_get_length(&record);
+			len -= emv_txn_record_get_length(&record);
+			++record_idx;
+		}
+
+	} else {
+		struct iso8825_ber_itr_t itr;
+		struct iso8825_tlv_t tlv;
+		bool all_constructed = true;
+
+		// Determine whether each top-level field is a record
+		iso8825_ber_itr_init(ptr, len, &itr);
+		while ((r = iso8825_ber_itr_next(&itr, &tlv)) > 0) {
+			if (!iso8825_ber_is_constructed(&tlv)) {
+				all_constructed = false;
+			}
+		}
+		if (r < 0) {
+			fflush(stdout);
+			fprintf(stderr, "Failed to parse BER data\n");
+			return 1;
+		}
+
+		if (!all_constructed) {
+			// Input is a single record
+			memset(found, 0, sizeof(found));
+			r = extract_ber_record(ptr, len, values, found);
+			if (r) {
+				fflush(stdout);
+				fprintf(stderr, "Failed to parse BER data\n");
+				return 1;
+			}
+			print_extract_row(values, found);
+			return 0;
+		}
+
+		iso8825_ber_itr_init(ptr, len, &itr);
+		while ((r = iso8825_ber_itr_next(&itr, &tlv)) > 0) {
+			memset(found, 0, sizeof(found));
+			r = extract_ber_record(tlv.value, tlv.length, values, found);
+			if (r) {
+				fflush(stdout);
+				fprintf(stderr, "Failed to parse record %zu\n", record_idx + 1);
+				return 1;
+			}
+			print_extract_row(values, found);
+			++record_idx;
+		}
+	}
+
+	return 0;
+}
+
 int main(int argc, char** argv)
 {
 	int r;
@@ -535,6 +1146,19 @@ int main(int argc, char** argv)
 			break;
 		}
 
+		case EMV_DECODE_TXN_RECORD: {
+			print_emv_txn_records(data, data_len, "  ", 0);
+			break;
+		}
+
+		case EMV_DECODE_EXTRACT: {
+			r = extract_records(data, data_len);
+			if (r) {
+				ret = EXIT_FAILURE;
+			}
+			break;
+		}
+
 		case EMV_DECODE_MCC: {
 			char str[1024];
 
@@ -988,6 +1612,8 @@ int main(int argc, char** argv)
 		}
 
 		case EMV_DECODE_ISO8859_X:
+		case EMV_DECODE_FILE:
+		case EMV_DECODE_HEX_FILE:
 		case EMV_DECODE_IGNORE_PADDING:
 		case EMV_DECODE_VERBOSE:
 		case EMV_DECODE_VERSION:
@@ -998,7 +1624,7 @@ int main(int argc, char** argv)
 	}
 
 	if (data) {
-		free(data);
+		unmap_file(data, data_len, data_mapped);
 	}
 	if (arg_str) {
 		free(arg_str);
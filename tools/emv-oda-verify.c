@@ -0,0 +1,514 @@
+/**
+ * @file emv-oda-verify.c
+ * @brief Bulk offline data authentication verification tool for logged
+ *        EMV transactions
+ *
+ * Copyright 2026 Leon Lynch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "emv.h"
+#include "emv_oda.h"
+#include "emv_oda_verify.h"
+#include "emv_tlv.h"
+#include "emv_tags.h"
+#include "emv_strings.h"
+#include "print_helpers.h"
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <argp.h>
+
+// Helper functions
+static error_t argp_parser_helper(int key, char* arg, struct argp_state* state);
+static int parse_hex(const char* hex, size_t hex_len, void* buf, size_t* buf_len);
+static char* read_line(FILE* file, char** buf, size_t* buf_size);
+
+// Number of logged transactions verified per batch
+#define EMV_ODA_VERIFY_BATCH_SIZE (4096)
+
+// Input data
+static const char* input_path = NULL;
+
+// Command line options
+enum emv_oda_verify_option_t {
+	EMV_ODA_VERIFY_OPTION_THREADS = -255, // Negative value to avoid short options
+	EMV_ODA_VERIFY_OPTION_TERM_CAPS,
+	EMV_ODA_VERIFY_OPTION_DDOL,
+	EMV_ODA_VERIFY_OPTION_VERBOSE,
+	EMV_ODA_VERIFY_OPTION_VERSION,
+};
+static unsigned int threads = 0;
+static uint8_t term_caps[3];
+static bool term_caps_present = false;
+static uint8_t ddol[252];
+static size_t ddol_len = 0;
+static bool verbose = false;
+
+// argp option structure
+static struct argp_option argp_options[] = {
+	{ "threads", EMV_ODA_VERIFY_OPTION_THREADS, "N", 0, "Number of worker threads. Default is the number of online processors." },
+	{ "term-caps", EMV_ODA_VERIFY_OPTION_TERM_CAPS, "HEX", 0, "Terminal Capabilities (field 9F33) used to select the ODA method when not logged" },
+	{ "ddol", EMV_ODA_VERIFY_OPTION_DDOL, "HEX", 0, "Default Dynamic Data Authentication Data Object List (DDOL) (field 9F49)" },
+	{ "verbose", EMV_ODA_VERIFY_OPTION_VERBOSE, NULL, 0, "Print Terminal Verification Results (TVR) bits and summary" },
+	{ "version", EMV_ODA_VERIFY_OPTION_VERSION, NULL, 0, "Display emv-utils version" },
+	{ 0 },
+};
+
+// argp configuration
+static struct argp argp_config = {
+	argp_options,
+	argp_parser_helper,
+	"[FILE]",
+	"Verify offline data authentication (ODA) of logged transactions without the card."
+	"\v" // Print remaining text after options
+	"FILE contains one logged transaction per line, or \"-\" to read from stdin. "
+	"Each line consists of space separated KEY=VALUE fields:\n"
+	"  method=none|sda|dda|cda  ODA method that was selected\n"
+	"  icc=HEX                  BER encoded ICC data\n"
+	"  terminal=HEX             BER encoded terminal data\n"
+	"  params=HEX               BER encoded transaction parameters\n"
+	"  records=HEX              Static data to be authenticated\n"
+	"  pdol=HEX                 PDOL data (CDA only)\n"
+	"  cdol1=HEX                CDOL1 data (CDA only)\n"
+	"  genac=HEX                GENERATE AC response data (CDA only)\n\n"
+	"Empty lines and lines starting with '#' are ignored. For each transaction, "
+	"a verdict line is printed consisting of the line number, ODA method, verdict, "
+	"Terminal Verification Results (TVR) and Transaction Status Information (TSI).",
+};
+
+// argp parser helper function
+static error_t argp_parser_helper(int key, char* arg, struct argp_state* state)
+{
+	int r;
+
+	switch (key) {
+		case ARGP_KEY_ARG: {
+			if (input_path) {
+				argp_error(state, "Only one FILE may be specified");
+				return EINVAL;
+			}
+			input_path = arg;
+			return 0;
+		}
+
+		case EMV_ODA_VERIFY_OPTION_THREADS: {
+			char* endptr = NULL;
+			unsigned long value;
+
+			value = strtoul(arg, &endptr, 10);
+			if (!*arg || *endptr || value > 1024) {
+				argp_error(state, "Invalid number of threads");
+				return EINVAL;
+			}
+			threads = value;
+			return 0;
+		}
+
+		case EMV_ODA_VERIFY_OPTION_TERM_CAPS: {
+			size_t len = sizeof(term_caps);
+
+			r = parse_hex(arg, strlen(arg), term_caps, &len);
+			if (r || len != sizeof(term_caps)) {
+				argp_error(state, "Terminal Capabilities must consist of 3 bytes (thus 6 hex digits)");
+				return EINVAL;
+			}
+			term_caps_present = true;
+			return 0;
+		}
+
+		case EMV_ODA_VERIFY_OPTION_DDOL: {
+			ddol_len = sizeof(ddol);
+			r = parse_hex(arg, strlen(arg), ddol, &ddol_len);
+			if (r || !ddol_len) {
+				argp_error(state, "DDOL must consist of hex digits");
+				return EINVAL;
+			}
+			return 0;
+		}
+
+		case EMV_ODA_VERIFY_OPTION_VERBOSE: {
+			verbose = true;
+			return 0;
+		}
+
+		case EMV_ODA_VERIFY_OPTION_VERSION: {
+			const char* version;
+
+			version = emv_lib_version_string();
+			if (version) {
+				printf("%s\n", version);
+			} else {
+				printf("Unknown\n");
+			}
+			exit(EXIT_SUCCESS);
+			return 0;
+		}
+
+		default:
+			return ARGP_ERR_UNKNOWN;
+	}
+}
+
+// Hex parser helper function
+static int parse_hex(const char* hex, size_t hex_len, void* buf, size_t* buf_len)
+{
+	uint8_t* ptr = buf;
+
+	if (hex_len & 1) {
+		// Uneven number of hex digits
+		return 1;
+	}
+	if (hex_len / 2 > *buf_len) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < hex_len; i += 2) {
+		char str[3] = { hex[i], hex[i + 1], 0 };
+
+		if (!isxdigit((unsigned char)str[0]) || !isxdigit((unsigned char)str[1])) {
+			return -2;
+		}
+		ptr[i / 2] = strtoul(str, NULL, 16);
+	}
+	*buf_len = hex_len / 2;
+
+	return 0;
+}
+
+// Line reader helper function that grows the buffer as required
+static char* read_line(FILE* file, char** buf, size_t* buf_size)
+{
+	size_t len = 0;
+
+	if (!*buf) {
+		*buf_size = 4096; // Use common page size
+		*buf = malloc(*buf_size);
+		if (!*buf) {
+			return NULL;
+		}
+	}
+
+	while (fgets(*buf + len, *buf_size - len, file)) {
+		len += strlen(*buf + len);
+		if (len && (*buf)[len - 1] == '\n') {
+			return *buf;
+		}
+		if (feof(file)) {
+			return *buf;
+		}
+
+		// Grow buffer
+		char* new_buf = realloc(*buf, *buf_size * 2);
+		if (!new_buf) {
+			return NULL;
+		}
+		*buf = new_buf;
+		*buf_size *= 2;
+	}
+
+	return len ? *buf : NULL;
+}
+
+// Logged transaction parsed from a single line
+struct oda_log_t {
+	unsigned long line;
+	uint8_t* data; // Binary data referenced by input
+	struct emv_oda_verify_input_t input;
+};
+
+static int parse_log(char* str, struct oda_log_t* log)
+{
+	int r;
+	size_t data_size;
+	size_t data_len = 0;
+	char* token;
+
+	// Binary data never exceeds half the length of the line
+	data_size = strlen(str) / 2 + 1;
+	log->data = malloc(data_size);
+	if (!log->data) {
+		return -1;
+	}
+
+	for (token = strtok(str, " \t\r\n"); token; token = strtok(NULL, " \t\r\n")) {
+		char* value;
+		const void** field_ptr;
+		size_t* field_len;
+		size_t len;
+
+		value = strchr(token, '=');
+		if (!value) {
+			fprintf(stderr, "Line %lu: Invalid field \"%s\"\n", log->line, token);
+			return 1;
+		}
+		*value++ = 0;
+
+		if (strcmp(token, "method") == 0) {
+			if (strcmp(value, "none") == 0) {
+				log->input.method = EMV_ODA_METHOD_NONE;
+			} else if (strcmp(value, "sda") == 0) {
+				log->input.method = EMV_ODA_METHOD_SDA;
+			} else if (strcmp(value, "dda") == 0) {
+				log->input.method = EMV_ODA_METHOD_DDA;
+			} else if (strcmp(value, "cda") == 0) {
+				log->input.method = EMV_ODA_METHOD_CDA;
+			} else {
+				fprintf(stderr, "Line %lu: Invalid method \"%s\"\n", log->line, value);
+				return 1;
+			}
+			continue;
+		}
+
+		if (strcmp(token, "icc") == 0) {
+			field_ptr = &log->input.icc;
+			field_len = &log->input.icc_len;
+		} else if (strcmp(token, "terminal") == 0) {
+			field_ptr = &log->input.terminal;
+			field_len = &log->input.terminal_len;
+		} else if (strcmp(token, "params") == 0) {
+			field_ptr = &log->input.params;
+			field_len = &log->input.params_len;
+		} else if (strcmp(token, "records") == 0) {
+			field_ptr = &log->input.records;
+			field_len = &log->input.records_len;
+		} else if (strcmp(token, "pdol") == 0) {
+			field_ptr = &log->input.pdol_data;
+			field_len = &log->input.pdol_data_len;
+		} else if (strcmp(token, "cdol1") == 0) {
+			field_ptr = &log->input.cdol1_data;
+			field_len = &log->input.cdol1_data_len;
+		} else if (strcmp(token, "genac") == 0) {
+			field_ptr = &log->input.genac_data;
+			field_len = &log->input.genac_data_len;
+		} else {
+			fprintf(stderr, "Line %lu: Unknown field \"%s\"\n", log->line, token);
+			return 1;
+		}
+
+		len = data_size - data_len;
+		r = parse_hex(value, strlen(value), log->data + data_len, &len);
+		if (r) {
+			fprintf(stderr, "Line %lu: Field \"%s\" must consist of an even number of hex digits\n", log->line, token);
+			return 1;
+		}
+		*field_ptr = log->data + data_len;
+		*field_len = len;
+		data_len += len;
+	}
+
+	return 0;
+}
+
+static const char* oda_method_str(enum emv_oda_method_t method)
+{
+	switch (method) {
+		case EMV_ODA_METHOD_NONE: return "none";
+		case EMV_ODA_METHOD_SDA: return "sda";
+		case EMV_ODA_METHOD_DDA: return "dda";
+		case EMV_ODA_METHOD_CDA: return "cda";
+		default: return "unknown";
+	}
+}
+
+static const char* oda_verdict_str(int r)
+{
+	switch (r) {
+		case 0: return "OK";
+		case EMV_ODA_NO_SUPPORTED_METHOD: return "NO_SUPPORTED_METHOD";
+		case EMV_ODA_ICC_DATA_MISSING: return "ICC_DATA_MISSING";
+		case EMV_ODA_SDA_FAILED: return "SDA_FAILED";
+		case EMV_ODA_SAD_AUTH_FAILED: return "SAD_AUTH_FAILED";
+		case EMV_ODA_DDA_FAILED: return "DDA_FAILED";
+		case EMV_ODA_CDA_FAILED: return "CDA_FAILED";
+		default: return "ERROR";
+	}
+}
+
+static size_t verify_logs(
+	struct emv_oda_verify_ctx_t* ctx,
+	struct oda_log_t* logs,
+	size_t count,
+	struct emv_oda_verify_input_t* input,
+	struct emv_oda_verify_result_t* result
+)
+{
+	int r;
+	size_t failed = 0;
+
+	for (size_t i = 0; i < count; ++i) {
+		input[i] = logs[i].input;
+	}
+	r = emv_oda_verify_batch(ctx, input, count, result);
+	if (r) {
+		fprintf(stderr, "emv_oda_verify_batch() failed; r=%d\n", r);
+		return count;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		printf("%lu %s %s %02X%02X%02X%02X%02X %02X%02X\n",
+			logs[i].line,
+			oda_method_str(result[i].method),
+			oda_verdict_str(result[i].r),
+			result[i].tvr[0], result[i].tvr[1], result[i].tvr[2], result[i].tvr[3], result[i].tvr[4],
+			result[i].tsi[0], result[i].tsi[1]
+		);
+		if (verbose) {
+			char str[2048];
+
+			r = emv_tvr_get_string_list(result[i].tvr, sizeof(result[i].tvr), str, sizeof(str));
+			if (r == 0) {
+				print_str_list(str, "\n", "  ", 1, "- ", "\n");
+			}
+		}
+		if (result[i].r) {
+			++failed;
+		}
+	}
+
+	return failed;
+}
+
+int main(int argc, char** argv)
+{
+	int r;
+	int ret = EXIT_SUCCESS;
+	FILE* file;
+	struct emv_tlv_list_t config = EMV_TLV_LIST_INIT;
+	struct emv_oda_verify_ctx_t ctx;
+	struct oda_log_t* logs = NULL;
+	struct emv_oda_verify_input_t* input = NULL;
+	struct emv_oda_verify_result_t* result = NULL;
+	size_t count = 0;
+	size_t total = 0;
+	size_t failed = 0;
+	unsigned long line = 0;
+	char* buf = NULL;
+	size_t buf_size = 0;
+
+	r = argp_parse(&argp_config, argc, argv, 0, 0, 0);
+	if (r) {
+		fprintf(stderr, "Failed to parse command line\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!input_path || strcmp(input_path, "-") == 0) {
+		file = stdin;
+	} else {
+		file = fopen(input_path, "r");
+		if (!file) {
+			fprintf(stderr, "Failed to open \"%s\"\n", input_path);
+			return EXIT_FAILURE;
+		}
+	}
+
+	r = emv_oda_verify_init(&ctx);
+	if (r) {
+		fprintf(stderr, "emv_oda_verify_init() failed; r=%d\n", r);
+		ret = EXIT_FAILURE;
+		goto exit;
+	}
+	ctx.threads = threads;
+	if (term_caps_present) {
+		emv_tlv_list_push(&config, EMV_TAG_9F33_TERMINAL_CAPABILITIES, sizeof(term_caps), term_caps, 0);
+	}
+	if (ddol_len) {
+		emv_tlv_list_push(&config, EMV_TAG_9F49_DDOL, ddol_len, ddol, 0);
+	}
+	ctx.config = &config;
+
+	logs = calloc(EMV_ODA_VERIFY_BATCH_SIZE, sizeof(*logs));
+	input = calloc(EMV_ODA_VERIFY_BATCH_SIZE, sizeof(*input));
+	result = calloc(EMV_ODA_VERIFY_BATCH_SIZE, sizeof(*result));
+	if (!logs || !input || !result) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		ret = EXIT_FAILURE;
+		goto exit;
+	}
+
+	while (true) {
+		char* str;
+
+		str = read_line(file, &buf, &buf_size);
+		if (str) {
+			++line;
+			str += strspn(str, " \t\r\n");
+			if (!*str || *str == '#') {
+				continue;
+			}
+
+			logs[count].line = line;
+			r = parse_log(str, &logs[count]);
+			++count;
+			if (r) {
+				ret = EXIT_FAILURE;
+				goto exit;
+			}
+		}
+
+		// Verify batch when it is full or at the end of the input
+		if (count && (count == EMV_ODA_VERIFY_BATCH_SIZE || !str)) {
+			failed += verify_logs(&ctx, logs, count, input, result);
+			total += count;
+
+			for (size_t i = 0; i < count; ++i) {
+				free(logs[i].data);
+			}
+			memset(logs, 0, count * sizeof(*logs));
+			count = 0;
+		}
+
+		if (!str) {
+			break;
+		}
+	}
+	if (ferror(file)) {
+		fprintf(stderr, "Failed to read input\n");
+		ret = EXIT_FAILURE;
+		goto exit;
+	}
+
+	if (verbose) {
+		printf("Transactions: %zu\n", total);
+		printf("Failed: %zu\n", failed);
+		printf("Issuer public key retrievals: %zu\n", emv_oda_verify_get_issuer_pkey_count(&ctx));
+	}
+	if (failed) {
+		ret = EXIT_FAILURE;
+	}
+
+exit:
+	if (logs) {
+		for (size_t i = 0; i < count; ++i) {
+			free(logs[i].data);
+		}
+	}
+	free(logs);
+	free(input);
+	free(result);
+	free(buf);
+	emv_oda_verify_clear(&ctx);
+	emv_tlv_list_clear(&config);
+	if (file != stdin) {
+		fclose(file);
+	}
+
+	return ret;
+}
@@ -22,6 +22,7 @@
 #include "pcsc.h"
 #include "print_helpers.h"
 #include "emv_ttl.h"
+#include "emv_session.h"
 #include "emv_tags.h"
 #include "emv_fields.h"
 #include "emv_strings.h"
@@ -60,6 +61,7 @@ enum emv_tool_param_t {
 	EMV_TOOL_PARAM_DEBUG_VERBOSE,
 	EMV_TOOL_PARAM_DEBUG_SOURCES_MASK,
 	EMV_TOOL_PARAM_DEBUG_LEVEL,
+	EMV_TOOL_PARAM_RECORD_SESSION,
 	EMV_TOOL_VERSION,
 	EMV_TOOL_OVERRIDE_ISOCODES_PATH,
 	EMV_TOOL_OVERRIDE_MCC_JSON,
@@ -81,6 +83,7 @@ static struct argp_option argp_options[] = {
 	{ "debug-verbose", EMV_TOOL_PARAM_DEBUG_VERBOSE, NULL, 0, "Enable verbose debug output. This will include the timestamp, debug source and debug level in the debug output." },
 	{ "debug-source", EMV_TOOL_PARAM_DEBUG_SOURCES_MASK, "x,y,z...", 0, "Comma separated list of debug sources. Allowed values are TTL, TAL, ODA, EMV, APP, ALL. Default is ALL." },
 	{ "debug-level", EMV_TOOL_PARAM_DEBUG_LEVEL, "LEVEL", 0, "Maximum debug level. Allowed values are NONE, ERROR, INFO, CARD, TRACE, ALL. Default is INFO." },
+	{ "record-session", EMV_TOOL_PARAM_RECORD_SESSION, "FILE", 0, "Record all card reader exchanges, with timing, to session file for later replay. WARNING: the session file contains sensitive cardholder data, including PAN, Track 2 and cardholder name, in the clear and is only readable by its owner." },
 
 	{ "version", EMV_TOOL_VERSION, NULL, 0, "Display emv-utils version" },
 
@@ -135,6 +138,7 @@ static const char* debug_level_str[] = {
 	"ALL",
 };
 static enum emv_debug_level_t debug_level = EMV_DEBUG_LEVEL_INFO;
+static char* record_session = NULL;
 
 // Testing parameters
 static char* isocodes_path = NULL;
@@ -339,6 +343,11 @@ static error_t argp_parser_helper(int key, char* arg, struct argp_state* state)
 			return EINVAL;
 		}
 
+		case EMV_TOOL_PARAM_RECORD_SESSION: {
+			record_session = strdup(arg);
+			return 0;
+		}
+
 		case EMV_TOOL_VERSION: {
 			const char* version;
 
@@ -763,6 +772,7 @@ int main(int argc, char** argv)
 	uint8_t atr[PCSC_MAX_ATR_SIZE];
 	size_t atr_len = 0;
 	struct emv_ttl_t ttl;
+	struct emv_session_recorder_t session_rec = { { 0, NULL, NULL }, NULL, 0, 0 };
 	struct emv_ctx_t emv;
 	struct emv_app_list_t app_list = EMV_APP_LIST_INIT; // Candidate list
 	bool application_selection_required;
@@ -908,6 +918,15 @@ int main(int argc, char** argv)
 	ttl.cardreader.mode = EMV_CARDREADER_MODE_APDU;
 	ttl.cardreader.ctx = reader;
 	ttl.cardreader.trx = &pcsc_reader_trx;
+	if (record_session) {
+		r = emv_session_recorder_init(&session_rec, &ttl.cardreader, record_session);
+		if (r) {
+			fprintf(stderr, "Failed to create session file \"%s\"\n", record_session);
+			goto pcsc_exit;
+		}
+		ttl.cardreader.ctx = &session_rec;
+		ttl.cardreader.trx = &emv_session_recorder_trx;
+	}
 	r = emv_ctx_init(&emv, &ttl);
 	if (r) {
 		fprintf(stderr, "emv_ctx_init() failed; r=%d\n", r);
@@ -1144,6 +1163,10 @@ emv_exit:
 	emv_ctx_clear(&emv);
 pcsc_exit:
 	pcsc_release(&pcsc);
+	if (record_session) {
+		emv_session_recorder_close(&session_rec);
+		free(record_session);
+	}
 
 	if (isocodes_path) {
 		free(isocodes_path);
@@ -32,6 +32,7 @@
 #include "emv_tlv.h"
 #include "emv_dol.h"
 #include "emv_app.h"
+#include "emv_txn_record.h"
 #include "emv_debug.h"
 #include "emv_strings.h"
 
@@ -947,6 +948,54 @@ void print_emv_tag_list(const void* ptr, size_t len, const char* prefix, unsigne
 	}
 }
 
+void print_emv_txn_records(const void* ptr, size_t len, const char* prefix, unsigned int depth)
+{
+	int r;
+	const uint8_t* buf = ptr;
+	unsigned int record_idx = 0;
+
+	while (len) {
+		struct emv_txn_record_t record;
+
+		r = emv_txn_record_init(buf, len, &record);
+		if (r) {
+			for (unsigned int i = 0; i < depth; ++i) {
+				printf("%s", prefix ? prefix : "");
+			}
+			printf("Invalid transaction record at offset %zu\n", (size_t)(buf - (const uint8_t*)ptr));
+			return;
+		}
+
+		for (unsigned int i = 0; i < depth; ++i) {
+			printf("%s", prefix ? prefix : "");
+		}
+		printf("Record %u:\n", ++record_idx);
+
+		// The directory is sorted by tag and therefore print the fields of
+		// each source separately to retain the grouping of the sources
+		for (unsigned int source = 0; source < emv_txn_record_get_source_count(&record); ++source) {
+			for (unsigned int i = 0; i < depth + 1; ++i) {
+				printf("%s", prefix ? prefix : "");
+			}
+			printf("Source %u:\n", source);
+
+			for (size_t idx = 0; idx < emv_txn_record_get_count(&record); ++idx) {
+				struct emv_tlv_t tlv;
+				unsigned int tlv_source;
+
+				emv_txn_record_get_field(&record, idx, &tlv_source, &tlv);
+				if (tlv_source != source) {
+					continue;
+				}
+				print_emv_tlv_internal(&tlv, prefix, depth + 2, false);
+			}
+		}
+
+		buf += emv_txn_record_get_length(&record);
+		len -= emv_txn_record_get_length(&record);
+	}
+}
+
 void print_emv_app(const struct emv_app_t* app)
 {
 	printf("Application: ");
@@ -186,6 +186,16 @@ void print_emv_dol(const void* ptr, size_t len, const char* prefix, unsigned int
  */
 void print_emv_tag_list(const void* ptr, size_t len, const char* prefix, unsigned int depth);
 
+/**
+ * Print EMV transaction records. Consecutive records are printed until the
+ * end of the data or until invalid data is found.
+ * @param ptr EMV transaction record data
+ * @param len Length of EMV transaction record data in bytes
+ * @param prefix Recursion prefix to print before every string
+ * @param depth Depth of current recursion
+ */
+void print_emv_txn_records(const void* ptr, size_t len, const char* prefix, unsigned int depth);
+
 /**
  * Print EMV application description
  * @param app EMV application object